@@ -71,6 +71,11 @@
         /// </summary>
         public const int SDBP_BADSCHEMA = -403;
 
+        /// <summary>
+        /// The server was overloaded and did not execute the command.
+        /// </summary>
+        public const int SDBP_OVERLOADED = -404;
+
         /// <summary>
         /// Return a textual presentation of a status code.
         /// </summary>
@@ -106,6 +111,8 @@
                     return "SDBP_FAILED";
                 case SDBP_BADSCHEMA:
                     return "SDBP_BADSCHEMA";
+                case SDBP_OVERLOADED:
+                    return "SDBP_OVERLOADED";
             }
 
             return "<UNKNOWN>";
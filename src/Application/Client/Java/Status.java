@@ -51,6 +51,8 @@ public class Status
     public final static int SDBP_FAILED         = -402;
     /** There was a schema error. */
     public final static int SDBP_BADSCHEMA      = -403;
+    /** The server was overloaded and did not execute the command. */
+    public final static int SDBP_OVERLOADED     = -404;
     
     /**
      * 	Return a textual presentation of a status code. 
@@ -82,6 +84,8 @@ public class Status
             return "SDBP_FAILED";
         case SDBP_BADSCHEMA:
             return "SDBP_BADSCHEMA";
+        case SDBP_OVERLOADED:
+            return "SDBP_OVERLOADED";
         }
 
         return "SDBP_UNKNOWN_STATUS";
@@ -20,6 +20,7 @@ SDBP_PRIMARY_TIMEOUT = -303
 SDBP_NOSERVICE = -401
 SDBP_FAILED = -402
 SDBP_BADSCHEMA = -403
+SDBP_OVERLOADED = -404
 
 SDBP_CONSISTENCY_ANY = 0
 SDBP_CONSISTENCY_RYW = 1
@@ -63,6 +64,8 @@ def str_status(status):
         return "SDBP_FAILED"
     elif status == SDBP_BADSCHEMA:
         return "SDBP_BADSCHEMA"
+    elif status == SDBP_OVERLOADED:
+        return "SDBP_OVERLOADED"
     return "<UNKNOWN>"
 
 # =============================================================================================
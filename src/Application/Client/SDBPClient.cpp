@@ -13,10 +13,13 @@
 #include "Framework/Replication/PaxosLease/PaxosLease.h"
 #include "Application/Common/ClientRequest.h"
 #include "Application/Common/ClientResponse.h"
+#include "Application/Common/ListFilter.h"
+#include "Application/SDBP/SDBPRequestMessage.h"
 
 // TODO: find out the optimal size
 #define MAX_IO_CONNECTION               32768
 #define DEFAULT_BATCH_LIMIT             (1*MB)
+#define DEFAULT_PARALLEL_SCAN_LIMIT     8       // sub-scans in flight per LIST/COUNT
 
 #ifndef CLIENT_MULTITHREADED
 #define CLIENT_MULTITHREADED
@@ -145,6 +148,7 @@ int Client::Init(int nodec, const char* nodev[])
     result = NULL;
     batchMode = SDBP_BATCH_DEFAULT;
     batchLimit = DEFAULT_BATCH_LIMIT;
+    parallelScanLimit = DEFAULT_PARALLEL_SCAN_LIMIT;
     proxy.Init();
     consistencyMode = SDBP_CONSISTENCY_STRICT;
     connectivityStatus = SDBP_NOCONNECTION;
@@ -153,6 +157,7 @@ int Client::Init(int nodec, const char* nodev[])
     numControllerRequests = 0;
     numNestedTransactions = 0;
     transactionQuorumID = 0;
+    optimisticTransaction = false;
     next = prev = this;
 
     // create the first result object
@@ -242,6 +247,23 @@ void Client::SetBatchLimit(unsigned batchLimit_)
     batchLimit = batchLimit_;
 }
 
+void Client::SetParallelScanLimit(unsigned parallelScanLimit_)
+{
+    parallelScanLimit = parallelScanLimit_;
+}
+
+int Client::SetListFilter(const ReadBuffer& filter)
+{
+    ListFilter  parsed;
+
+    // an empty filter clears it, it applies to the following ListKeys and ListKeyValues
+    if (!parsed.Parse(filter))
+        return SDBP_API_ERROR;
+
+    listFilter.Write(filter);
+    return SDBP_SUCCESS;
+}
+
 void Client::SetConsistencyMode(int consistencyMode_)
 {
     consistencyMode = consistencyMode_;
@@ -670,6 +692,8 @@ int Client::Get(uint64_t tableID, const ReadBuffer& key)
     
     req = new Request;
     req->Get(NextCommandID(), configState.paxosID, tableID, (ReadBuffer&) key);
+    // the primary records the version of the value read in an optimistic transaction
+    req->transactional = InTransaction() && optimisticTransaction;
 
     // find
     proxiedRequest = proxy.Find(req);
@@ -759,6 +783,37 @@ int Client::Add(uint64_t tableID, const ReadBuffer& key, int64_t number)
     return PassthroughRequest(req);
 }
 
+int Client::SetIfVersion(uint64_t tableID, const ReadBuffer& key, const ReadBuffer& value,
+ uint64_t versionPaxosID, uint64_t versionCommandID)
+{
+    Request*    req;
+
+    // the writes of a transaction are sent on commit, when the version is no longer known
+    if (InTransaction())
+        return SDBP_API_ERROR;
+
+    req = new Request;
+    req->SetIfVersion(NextCommandID(), configState.paxosID, tableID,
+     (ReadBuffer&) key, (ReadBuffer&) value, versionPaxosID, versionCommandID);
+
+    return PassthroughRequest(req);
+}
+
+int Client::DeleteIfVersion(uint64_t tableID, const ReadBuffer& key,
+ uint64_t versionPaxosID, uint64_t versionCommandID)
+{
+    Request*    req;
+
+    if (InTransaction())
+        return SDBP_API_ERROR;
+
+    req = new Request;
+    req->DeleteIfVersion(NextCommandID(), configState.paxosID, tableID,
+     (ReadBuffer&) key, versionPaxosID, versionCommandID);
+
+    return PassthroughRequest(req);
+}
+
 int Client::SequenceSet(uint64_t tableID, const ReadBuffer& key, const uint64_t value)
 {
     Request*    req;
@@ -794,6 +849,7 @@ int Client::ListKeys(
     req->skip = skip;
     req->ListKeys(NextCommandID(), configState.paxosID, tableID,
      (ReadBuffer&) startKey, (ReadBuffer&) endKey, (ReadBuffer&) prefix, count, forwardDirection);
+    req->filter.Write(listFilter);
 
     if (req->userCount > 0)
     {
@@ -830,6 +886,7 @@ int Client::ListKeyValues(
     req->skip = skip;
     req->ListKeyValues(NextCommandID(), configState.paxosID, tableID,
      (ReadBuffer&) startKey, (ReadBuffer&) endKey, (ReadBuffer&) prefix, count, forwardDirection);
+    req->filter.Write(listFilter);
 
     if (req->userCount > 0)
     {
@@ -966,6 +1023,7 @@ int Client::StartTransaction(uint64_t quorumID, const ReadBuffer& majorKey)
         return SDBP_SUCCESS;
 
     transactionQuorumID = quorumID;
+    optimisticTransaction = false;
     result->Close();
 
     req = new Request;
@@ -985,6 +1043,42 @@ int Client::StartTransaction(uint64_t quorumID, const ReadBuffer& majorKey)
     return SDBP_SUCCESS;
 }
 
+int Client::StartOptimisticTransaction(uint64_t quorumID)
+{    
+    Request*    req;
+
+    Log_Trace("quorumID: %U", quorumID);
+    
+    CLIENT_MUTEX_GUARD_DECLARE();
+
+    if (proxy.GetCount() > 0)
+        return SDBP_API_ERROR;
+
+    ASSERT(numNestedTransactions >= 0);
+    if (numNestedTransactions >= 1)
+        return SDBP_SUCCESS;
+
+    // no lock is taken, the commit fails if a key read in the transaction was written since
+    transactionQuorumID = quorumID;
+    result->Close();
+
+    req = new Request;
+    req->StartOptimisticTransaction(NextCommandID(), configState.paxosID, transactionQuorumID);
+    AppendDataRequest(req);
+
+    CLIENT_MUTEX_GUARD_UNLOCK();
+    EventLoop();
+    CLIENT_MUTEX_GUARD_LOCK();
+    
+    if (result->GetCommandStatus() != SDBP_SUCCESS)
+        return result->GetCommandStatus();
+    
+    optimisticTransaction = true;
+    numNestedTransactions++;
+
+    return SDBP_SUCCESS;
+}
+
 int Client::CommitTransaction()
 {
     Request*    req;
@@ -1002,6 +1096,8 @@ int Client::CommitTransaction()
     if (numNestedTransactions > 0)
         return SDBP_SUCCESS;
 
+    optimisticTransaction = false;
+
     req = new Request;
     req->CommitTransaction(NextCommandID(), transactionQuorumID);
 
@@ -1052,6 +1148,7 @@ int Client::RollbackTransaction()
     submittedRequests.ClearMembers();
     
     numNestedTransactions = 0;
+    optimisticTransaction = false;
 
     ClearRequests();
     proxy.Clear();
@@ -1394,6 +1491,13 @@ void Client::ReassignRequest(Request* req)
         return;
     }
 
+    // range scans that span several shards are sent as parallel sub-scans
+    if (req->IsList() && req->parent == NULL && req->items == NULL && SplitScanRequest(req))
+    {
+        SendScanItems(req);
+        return;
+    }
+
     if (req->quorumID == 0)
     {
         // find quorum by key
@@ -1416,7 +1520,7 @@ void Client::ReassignRequest(Request* req)
     }
     
     quorum = configState.GetQuorum(req->quorumID);
-    if (!req->IsReadRequest() && quorum && quorum->hasPrimary == false)
+    if ((!req->IsReadRequest() || req->transactional) && quorum && quorum->hasPrimary == false)
         submittedRequests.Append(req);
     else
         AddRequestToQuorum(req);
@@ -1503,8 +1607,12 @@ void Client::SendQuorumRequest(ShardConnection* conn, uint64_t quorumID)
     Request*            req;
     ConfigQuorum*       quorum;
     unsigned            maxRequests;
+    unsigned            maxItems;
     unsigned            numServed;
+    unsigned            numItems;
+    unsigned            i;
     bool                flushNeeded;
+    Request*            items[SDBP_MULTI_MAX_ITEMS];
 
     // sanity checks
     if (configState.paxosID == 0)
@@ -1537,8 +1645,38 @@ void Client::SendQuorumRequest(ShardConnection* conn, uint64_t quorumID)
     while (qrequests->GetLength() > 0)
     {   
         req = qrequests->First();
-        if (req->IsShardServerRequest() && !req->IsReadRequest() && quorum->primaryID != conn->GetNodeID())
+        if (req->IsShardServerRequest() && (!req->IsReadRequest() || req->transactional) &&
+         quorum->primaryID != conn->GetNodeID())
             break;
+
+        // consecutive GETs, SETs and DELETEs of a table are sent in one multi-key request
+        maxItems = SDBP_MULTI_MAX_ITEMS;
+        if (maxRequests != 0)
+            maxItems = MIN(maxItems, maxRequests - numServed);
+        numItems = 0;
+        if (conn->IsMultiRequestSupported())
+            numItems = CollectMultiRequest(qrequests, items, maxItems);
+        if (numItems > 0)
+        {
+            for (i = 0; i < numItems; i++)
+            {
+                items[i]->connNodeID = conn->GetNodeID();
+                items[i]->paxosID = GetRequestPaxosID(quorumID);
+            }
+            numServed += numItems;
+            if (!conn->SendMultiRequest(items, numItems))
+            {
+                flushNeeded = true;
+                break;
+            }
+            if (maxRequests != 0 && numServed >= maxRequests)
+            {
+                flushNeeded = true;
+                break;
+            }
+            continue;
+        }
+
         qrequests->Remove(req);
         
         // assign nodeID to request
@@ -1572,6 +1710,42 @@ void Client::SendQuorumRequest(ShardConnection* conn, uint64_t quorumID)
         conn->Flush();    
 }
 
+unsigned Client::CollectMultiRequest(RequestList* qrequests, Request** items, unsigned maxItems)
+{
+    Request*    first;
+    Request*    req;
+    Request*    next;
+    unsigned    numItems;
+    unsigned    size;
+
+    first = qrequests->First();
+    next = qrequests->Next(first);
+    if (ClientRequest::GetMultiType(first->type) == CLIENTREQUEST_UNDEFINED || first->transactional)
+        return 0;
+    if (maxItems < 2 || next == NULL || next->type != first->type || next->tableID != first->tableID ||
+     next->configPaxosID != first->configPaxosID || next->transactional)
+        return 0;
+
+    // the message is kept around the size of one write buffer
+    numItems = 0;
+    size = 0;
+    for (req = first; req != NULL && numItems < maxItems; req = next)
+    {
+        next = qrequests->Next(req);
+        if (req->type != first->type || req->tableID != first->tableID ||
+         req->configPaxosID != first->configPaxosID || req->transactional)
+            break;
+        if (numItems > 1 && size + req->key.GetLength() + req->value.GetLength() > MESSAGING_BUFFER_THRESHOLD)
+            break;
+
+        qrequests->Remove(req);
+        items[numItems++] = req;
+        size += req->key.GetLength() + req->value.GetLength();
+    }
+
+    return numItems;
+}
+
 void Client::SendQuorumRequests()
 {
     ShardConnection*        conn;
@@ -1719,7 +1893,8 @@ void Client::NextRequest(
     
     Log_Trace("count: %U, nextShardKey: %R", count, &nextShardKey);
     
-    if (req->count > 0)
+    // locally filtered requests are sent without count
+    if (req->count > 0 && !req->filterLocally)
         req->count = count;
 
     configTable = configState.GetTable(req->tableID);
@@ -1746,6 +1921,214 @@ void Client::NextRequest(
         req->key.Write(minKey);
 }
 
+bool Client::SplitScanRequest(Request* req)
+{
+    ConfigTable*    configTable;
+    ConfigShard*    configShard;
+    ConfigShard**   shards;
+    uint64_t*       itShard;
+    Request*        item;
+    ReadBuffer      firstKey;
+    ReadBuffer      lastKey;
+    ReadBuffer      prefix;
+    unsigned        numShards;
+    unsigned        i, j;
+
+    // backward scans and transactions are served by the sequential walk
+    if (parallelScanLimit < 2 || !req->forwardDirection || req->transactional || InTransaction())
+        return false;
+
+    configTable = configState.GetTable(req->tableID);
+    if (configTable == NULL || configTable->shards.GetLength() < 2)
+        return false;
+
+    prefix.Wrap(req->prefix);
+
+    // collect the shards that overlap the range, ordered by their first key
+    shards = new ConfigShard*[configTable->shards.GetLength()];
+    numShards = 0;
+    FOREACH (itShard, configTable->shards)
+    {
+        configShard = configState.GetShard(*itShard);
+        if (configShard == NULL)
+            continue;
+
+        firstKey.Wrap(configShard->firstKey);
+        lastKey.Wrap(configShard->lastKey);
+        if (req->endKey.GetLength() > 0 && firstKey.GetLength() > 0 &&
+         ReadBuffer::Cmp(firstKey, req->endKey) >= 0)
+            continue;
+        if (req->key.GetLength() > 0 && lastKey.GetLength() > 0 &&
+         ReadBuffer::Cmp(lastKey, req->key) <= 0)
+            continue;
+        if (req->prefix.GetLength() > 0)
+        {
+            if (lastKey.GetLength() > 0 && ReadBuffer::Cmp(lastKey, req->prefix) <= 0)
+                continue;
+            if (ReadBuffer::Cmp(firstKey, req->prefix) > 0 && !firstKey.BeginsWith(prefix))
+                continue;
+        }
+
+        for (i = numShards; i > 0 && Buffer::Cmp(shards[i - 1]->firstKey, configShard->firstKey) > 0; i--)
+            shards[i] = shards[i - 1];
+        shards[i] = configShard;
+        numShards++;
+    }
+
+    if (numShards < 2)
+    {
+        delete[] shards;
+        return false;
+    }
+
+    // each sub-scan is bounded by its shard, so the results can be merged in shard order
+    req->items = new ClientRequest*[numShards];
+    req->numItems = numShards;
+    req->numCompletedItems = 0;
+    req->numSentItems = 0;
+    req->numDeliveredItems = 0;
+    req->numDeliveredKeys = 0;
+    for (j = 0; j < numShards; j++)
+    {
+        item = new Request;
+        item->type = req->type;
+        item->commandID = NextCommandID();
+        item->configPaxosID = req->configPaxosID;
+        item->tableID = req->tableID;
+        item->count = req->count;
+        item->forwardDirection = true;
+        item->prefix.Write(req->prefix);
+        item->filter.Write(req->filter);
+        if (Buffer::Cmp(req->key, shards[j]->firstKey) >= 0)
+            item->key.Write(req->key);
+        else
+            item->key.Write(shards[j]->firstKey);
+        if (shards[j]->lastKey.GetLength() == 0 ||
+         (req->endKey.GetLength() > 0 && Buffer::Cmp(req->endKey, shards[j]->lastKey) < 0))
+            item->endKey.Write(req->endKey);
+        else
+            item->endKey.Write(shards[j]->lastKey);
+        item->parent = req;
+        item->client = this;
+        item->response.NoResponse();
+        req->items[j] = item;
+    }
+
+    delete[] shards;
+    return true;
+}
+
+void Client::SendScanItems(Request* req)
+{
+    Request*    item;
+
+    // bounded readahead, and no more sub-scans once count is satisfied
+    while (req->numSentItems < req->numItems)
+    {
+        if (req->numSentItems - req->numCompletedItems >= parallelScanLimit)
+            break;
+        if (req->count > 0 && req->numDeliveredKeys >= req->count)
+            break;
+
+        item = (Request*) req->items[req->numSentItems++];
+        if (req->count > 0)
+            item->count = req->count - req->numDeliveredKeys;
+        ReassignRequest(item);
+    }
+}
+
+void Client::DeliverScanItems(Request* req)
+{
+    Request*            item;
+    ClientResponse**    itResponse;
+
+    // move the buffered results of the sub-scans to the request in key order
+    while (req->numDeliveredItems < req->numSentItems)
+    {
+        item = (Request*) req->items[req->numDeliveredItems];
+        FOREACH_FIRST (itResponse, item->responses)
+        {
+            req->numDeliveredKeys += (*itResponse)->numKeys;
+            req->responses.Append(*itResponse);
+            item->responses.Remove(itResponse);
+            if (req->status != SDBP_FAILED)
+                req->status = SDBP_SUCCESS;
+        }
+
+        if (item->response.type == CLIENTRESPONSE_NORESPONSE)
+            break;
+        req->numDeliveredItems++;
+    }
+}
+
+void Client::OnScanItemResponse(Request* item, ClientResponse* resp)
+{
+    Request*        req;
+    Request*        it;
+    ClientResponse* respCopy;
+    ClientResponse  response;
+    unsigned        numSentItems;
+    unsigned        i;
+
+    req = (Request*) item->parent;
+
+    if (resp->type == CLIENTRESPONSE_LIST_KEYS ||
+     resp->type == CLIENTRESPONSE_LIST_KEYVALUES ||
+     resp->type == CLIENTRESPONSE_NUMBER)
+    {
+        // partial counts are summed, keys of the first undelivered sub-scan are streamed
+        if (req->type == CLIENTREQUEST_COUNT || req->items[req->numDeliveredItems] == item)
+        {
+            req->numDeliveredKeys += resp->numKeys;
+            resp->commandID = req->commandID;
+            result->AppendRequestResponse(resp);
+            return;
+        }
+
+        if (resp->type == CLIENTRESPONSE_LIST_KEYS)
+            resp->CopyKeys();
+        else
+            resp->CopyKeyValues();
+        respCopy = new ClientResponse;
+        resp->Transfer(*respCopy);
+        item->responses.Append(respCopy);
+        return;
+    }
+
+    // the sub-scan is finished
+    item->response.type = resp->type;
+    req->numCompletedItems++;
+    DeliverScanItems(req);
+
+    numSentItems = req->numSentItems;
+    SendScanItems(req);
+    if (req->numSentItems > numSentItems)
+    {
+        SendQuorumRequests();
+        return;
+    }
+
+    if (req->numCompletedItems < req->numSentItems)
+        return;
+
+    // all sub-scans are finished or count is satisfied, the first failure is the result
+    response.OK();
+    for (i = 0; i < req->numSentItems; i++)
+    {
+        it = (Request*) req->items[i];
+        if (it->response.type != CLIENTRESPONSE_OK)
+        {
+            response.type = it->response.type;
+            break;
+        }
+    }
+    response.commandID = req->commandID;
+    result->AppendRequestResponse(&response);
+
+    if (result->GetTransportStatus() == SDBP_SUCCESS)
+        TryWake();
+}
+
 void Client::ConfigureShardServers()
 {
     ConfigShardServer*          ssit;
@@ -49,6 +49,8 @@ public:
     void                    SetConsistencyMode(int consistencyMode);
     void					SetBatchMode(int batchMode);
     void                    SetBatchLimit(unsigned batchLimit);
+    void                    SetParallelScanLimit(unsigned parallelScanLimit);
+    int                     SetListFilter(const ReadBuffer& filter);
 
     void                    SetGlobalTimeout(uint64_t timeout);
     void                    SetMasterTimeout(uint64_t timeout);
@@ -104,6 +106,10 @@ public:
     int                     Set(uint64_t tableID, const ReadBuffer& key, const ReadBuffer& value);
     int                     Delete(uint64_t tableID, const ReadBuffer& key);
     int                     Add(uint64_t tableID, const ReadBuffer& key, int64_t number);
+    int                     SetIfVersion(uint64_t tableID, const ReadBuffer& key, const ReadBuffer& value,
+                             uint64_t versionPaxosID, uint64_t versionCommandID);
+    int                     DeleteIfVersion(uint64_t tableID, const ReadBuffer& key,
+                             uint64_t versionPaxosID, uint64_t versionCommandID);
     int                     SequenceSet(uint64_t tableID, const ReadBuffer& key, const uint64_t value);
     int                     SequenceNext(uint64_t tableID, const ReadBuffer& key);
 
@@ -128,6 +134,7 @@ public:
 
     // Transactions
     int                     StartTransaction(uint64_t quorumID, const ReadBuffer& majorKey);
+    int                     StartOptimisticTransaction(uint64_t quorumID);
     int                     CommitTransaction();
     int                     RollbackTransaction();
 
@@ -167,6 +174,8 @@ private:
     bool                    GetQuorumID(uint64_t tableID, ReadBuffer& key, uint64_t& quorumID);
     void                    AddRequestToQuorum(Request* req, bool end = true);
     void                    SendQuorumRequest(ShardConnection* conn, uint64_t quorumID);
+    unsigned                CollectMultiRequest(RequestList* qrequests, Request** items,
+                             unsigned maxItems);
     void                    SendQuorumRequests();
     void                    ClearQuorumRequests();
     void                    DeleteQuorumRequests();
@@ -176,6 +185,11 @@ private:
     void                    NextRequest(Request* req, ReadBuffer nextShardKey, ReadBuffer endKey,
                              ReadBuffer prefix, uint64_t count);
 
+    bool                    SplitScanRequest(Request* req);
+    void                    SendScanItems(Request* req);
+    void                    DeliverScanItems(Request* req);
+    void                    OnScanItemResponse(Request* item, ClientResponse* resp);
+
     void                    ConfigureShardServers();
     void                    ReleaseShardConnections();
 
@@ -204,6 +218,8 @@ private:
     RequestProxy            proxy;
     RequestList             submittedRequests;
     unsigned                batchLimit;
+    unsigned                parallelScanLimit;
+    Buffer                  listFilter;
     ShardConnectionMap      shardConnections;
     Controller*             controller;
     RequestListMap          quorumRequests;
@@ -214,6 +230,7 @@ private:
     unsigned                numControllerRequests;
     int                     numNestedTransactions;
     uint64_t                transactionQuorumID;
+    bool                    optimisticTransaction;
 
 //#ifdef CLIENT_MULTITHREAD
     Signal                  isDone;
@@ -51,6 +51,8 @@
 #define SDBP_FAILED             -402
 // the command was not executed, because of bad schema specification
 #define SDBP_BADSCHEMA          -403
+// the command was not executed, because the server was overloaded
+#define SDBP_OVERLOADED         -404
 
 //
 // CONSISTENCY LEVELS
@@ -8,16 +8,25 @@ Request::Request()
     numTry = 0;
     numShardServers = 0;
     skip = false;
+    filterLocally = false;
     client = NULL;
     requestTime = 0;
     responseTime = 0;
     userCount = 0;
     nodeID = UNDEFINED_NODEID;
+    numSentItems = 0;
+    numDeliveredItems = 0;
+    numDeliveredKeys = 0;
 }
 
 Request::~Request()
 {
     ClientResponse**    itResponse;
+    unsigned            i;
+
+    for (i = 0; i < numItems; i++)
+        delete (Request*) items[i];
+    delete[] items;
 
     FOREACH_FIRST (itResponse, responses)
     {
@@ -23,6 +23,9 @@ class Client;
 
  SDBPClient::Request
 
+ A LIST or COUNT request that spans several shards may be split into sub-scans by
+ the client. The sub-scans are Requests themselves, owned by the parent request.
+
 ===============================================================================================
 */
 
@@ -48,6 +51,15 @@ public:
     uint64_t        userCount;
     bool            skip;
     Client*         client;
+
+    // set if the shard server does not support LIST filters, the whole range
+    // is listed then and the responses are filtered by the client
+    bool            filterLocally;
+
+    // parallel range scans, the items are the per-shard sub-scans in key order
+    unsigned        numSentItems;
+    unsigned        numDeliveredItems;
+    uint64_t        numDeliveredKeys;
 };
 
 };  // namespace
@@ -204,6 +204,40 @@ bool SDBP_ResultIsConditionalSuccess(ResultObj result_)
     return ret;
 }
 
+uint64_t SDBP_ResultVersionPaxosID(ResultObj result_)
+{
+    Result*     result = (Result*) result_;
+    uint64_t    versionPaxosID;
+    uint64_t    versionCommandID;
+    int         status;
+    
+    if (!result)
+        return 0;
+    
+    status = result->GetVersion(versionPaxosID, versionCommandID);
+    if (status < 0)
+        return 0;
+    
+    return versionPaxosID;
+}
+
+uint64_t SDBP_ResultVersionCommandID(ResultObj result_)
+{
+    Result*     result = (Result*) result_;
+    uint64_t    versionPaxosID;
+    uint64_t    versionCommandID;
+    int         status;
+    
+    if (!result)
+        return 0;
+    
+    status = result->GetVersion(versionPaxosID, versionCommandID);
+    if (status < 0)
+        return 0;
+    
+    return versionCommandID;
+}
+
 uint64_t SDBP_ResultDatabaseID(ResultObj result_)
 {
     Result*     result = (Result*) result_;
@@ -459,6 +493,21 @@ void SDBP_SetBatchLimit(ClientObj client_, unsigned batchLimit)
     return client->SetBatchLimit(batchLimit);
 }
 
+void SDBP_SetParallelScanLimit(ClientObj client_, unsigned parallelScanLimit)
+{
+    Client* client = (Client*) client_;
+
+    return client->SetParallelScanLimit(parallelScanLimit);
+}
+
+int SDBP_SetListFilter(ClientObj client_, const std::string& filter_)
+{
+    Client*     client = (Client*) client_;
+    ReadBuffer  filter((char*) filter_.c_str(), filter_.length());
+
+    return client->SetListFilter(filter);
+}
+
 /*
 ===============================================================================================
 
@@ -860,6 +909,49 @@ int SDBP_DeleteCStr(ClientObj client_, uint64_t tableID, char* key_, int len)
     return client->Delete(tableID, key);
 }
 
+int SDBP_SetIfVersion(ClientObj client_, uint64_t tableID, const std::string& key_,
+ const std::string& value_, uint64_t versionPaxosID, uint64_t versionCommandID)
+{
+    Client*     client = (Client*) client_;
+    ReadBuffer  key((char*) key_.c_str(), key_.length());
+    ReadBuffer  value((char*) value_.c_str(), value_.length());
+
+    return client->SetIfVersion(tableID, key, value, versionPaxosID, versionCommandID);
+}
+
+int SDBP_SetIfVersionCStr(ClientObj client_, uint64_t tableID, char* key_, int lenKey,
+ char* value_, int lenValue, uint64_t versionPaxosID, uint64_t versionCommandID)
+{
+    Client*     client = (Client*) client_;
+    ReadBuffer  key;
+    ReadBuffer  value;
+
+    key.Wrap((char*) key_, lenKey);
+    value.Wrap((char*) value_, lenValue);
+
+    return client->SetIfVersion(tableID, key, value, versionPaxosID, versionCommandID);
+}
+
+int SDBP_DeleteIfVersion(ClientObj client_, uint64_t tableID, const std::string& key_,
+ uint64_t versionPaxosID, uint64_t versionCommandID)
+{
+    Client*     client = (Client*) client_;
+    ReadBuffer  key((char*) key_.c_str(), key_.length());
+
+    return client->DeleteIfVersion(tableID, key, versionPaxosID, versionCommandID);
+}
+
+int SDBP_DeleteIfVersionCStr(ClientObj client_, uint64_t tableID, char* key_, int len,
+ uint64_t versionPaxosID, uint64_t versionCommandID)
+{
+    Client*     client = (Client*) client_;
+    ReadBuffer  key;
+
+    key.Wrap((char*) key_, len);
+
+    return client->DeleteIfVersion(tableID, key, versionPaxosID, versionCommandID);
+}
+
 int SDBP_SequenceSet(ClientObj client_, uint64_t tableID, const std::string& key_, uint64_t number)
 {
     Client*     client = (Client*) client_;
@@ -1037,6 +1129,13 @@ int SDBP_StartTransactionCStr(ClientObj client_, uint64_t quorumID, char* majorK
     return client->StartTransaction(quorumID, majorKey);
 }
 
+int SDBP_StartOptimisticTransaction(ClientObj client_, uint64_t quorumID)
+{
+    Client*     client = (Client*) client_;
+
+    return client->StartOptimisticTransaction(quorumID);
+}
+
 int SDBP_CommitTransaction(ClientObj client_)
 {
     Client*     client = (Client*) client_;
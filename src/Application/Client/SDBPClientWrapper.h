@@ -62,6 +62,8 @@ SDBP_Buffer     SDBP_ResultValueBuffer(ResultObj result);
 int64_t         SDBP_ResultSignedNumber(ResultObj result);
 uint64_t        SDBP_ResultNumber(ResultObj result);
 bool            SDBP_ResultIsConditionalSuccess(ResultObj result);
+uint64_t        SDBP_ResultVersionPaxosID(ResultObj result);
+uint64_t        SDBP_ResultVersionCommandID(ResultObj result);
 uint64_t        SDBP_ResultDatabaseID(ResultObj result);
 uint64_t        SDBP_ResultTableID(ResultObj result);
 void            SDBP_ResultBegin(ResultObj result);
@@ -104,6 +106,8 @@ uint64_t        SDBP_GetMasterTimeout(ClientObj client);
 void            SDBP_SetConsistencyMode(ClientObj client, int consistencyMode);
 void            SDBP_SetBatchMode(ClientObj client, int batchMode);
 void            SDBP_SetBatchLimit(ClientObj client, unsigned batchLimit);
+void            SDBP_SetParallelScanLimit(ClientObj client, unsigned parallelScanLimit);
+int             SDBP_SetListFilter(ClientObj client, const std::string& filter);
 
 /*
 ===============================================================================================
@@ -165,6 +169,14 @@ int             SDBP_Add(ClientObj client, uint64_t tableID, const std::string&
 int             SDBP_AddCStr(ClientObj client_, uint64_t tableID, char* key, int len, int64_t number);
 int             SDBP_Delete(ClientObj client, uint64_t tableID, const std::string& key);
 int             SDBP_DeleteCStr(ClientObj client_, uint64_t tableID, char* key, int len);
+int             SDBP_SetIfVersion(ClientObj client, uint64_t tableID, const std::string& key,
+                 const std::string& value, uint64_t versionPaxosID, uint64_t versionCommandID);
+int             SDBP_SetIfVersionCStr(ClientObj client, uint64_t tableID, char* key, int lenKey,
+                 char* value, int lenValue, uint64_t versionPaxosID, uint64_t versionCommandID);
+int             SDBP_DeleteIfVersion(ClientObj client, uint64_t tableID, const std::string& key,
+                 uint64_t versionPaxosID, uint64_t versionCommandID);
+int             SDBP_DeleteIfVersionCStr(ClientObj client, uint64_t tableID, char* key, int len,
+                 uint64_t versionPaxosID, uint64_t versionCommandID);
 int             SDBP_SequenceSet(ClientObj client, uint64_t tableID, const std::string& key, uint64_t number);
 int             SDBP_SequenceSetCStr(ClientObj client_, uint64_t tableID, char* key, int len, uint64_t number);
 int             SDBP_SequenceNext(ClientObj client, uint64_t tableID, const std::string& key);
@@ -218,6 +230,7 @@ int             SDBP_StartTransaction(
                  ClientObj client, uint64_t quorumID, const std::string& majorKey);
 int             SDBP_StartTransactionCStr(
                  ClientObj client, uint64_t quorumID, char* majorKey, int majorKeyLen);
+int             SDBP_StartOptimisticTransaction(ClientObj client, uint64_t quorumID);
 int             SDBP_CommitTransaction(ClientObj client);
 int             SDBP_RollbackTransaction(ClientObj client);
 
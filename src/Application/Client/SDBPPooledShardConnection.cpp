@@ -255,6 +255,9 @@ bool PooledShardConnection::SendRequest(SDBPRequestMessage& msg)
 {
     ASSERT(state == CONNECTED);
 
+    // requests sent before the hello arrives are written as text
+    msg.binary = (protocolVersion >= SDBP_PROTOCOL_VERSION_BINARY);
+    msg.overloaded = (protocolVersion >= SDBP_PROTOCOL_VERSION_OVERLOADED);
     Write(msg);
 
     // buffer is saturated
@@ -264,6 +267,16 @@ bool PooledShardConnection::SendRequest(SDBPRequestMessage& msg)
     return true;
 }
 
+void PooledShardConnection::SetProtocolVersion(uint64_t protocolVersion_)
+{
+    protocolVersion = protocolVersion_;
+}
+
+uint64_t PooledShardConnection::GetProtocolVersion()
+{
+    return protocolVersion;
+}
+
 bool PooledShardConnection::OnMessage(ReadBuffer& msg)
 {
     if (conn == NULL)
@@ -286,6 +299,9 @@ void PooledShardConnection::OnConnect()
 {
     MessageConnection::OnConnect();
 
+    // the server announces its protocol version again on the new connection
+    protocolVersion = SDBP_PROTOCOL_VERSION_TEXT;
+
     if (conn != NULL)
         conn->OnConnect();
 }
@@ -319,6 +335,7 @@ PooledShardConnection::PooledShardConnection(Endpoint& endpoint_)
     prev = next = this;
     conn = NULL;
     lastUsed = 0;
+    protocolVersion = SDBP_PROTOCOL_VERSION_TEXT;
     name.Write(endpoint.ToString());
     
     ASSERT(name.GetLength() > 0);
@@ -38,6 +38,8 @@ public:
     void                                Connect();
     void                                Flush();
     bool                                SendRequest(SDBPRequestMessage& msg);
+    void                                SetProtocolVersion(uint64_t protocolVersion);
+    uint64_t                            GetProtocolVersion();
     bool                                IsWritePending();
     bool                                IsConnected();
 
@@ -57,6 +59,7 @@ private:
     Buffer                              name;
     Endpoint                            endpoint;
     uint64_t                            lastUsed;
+    uint64_t                            protocolVersion;
 };
 
 };  // namespace
@@ -116,7 +116,8 @@ bool Result::IsFinished()
         if (type == CLIENTRESPONSE_OK ||
          type == CLIENTRESPONSE_NOSERVICE ||
          type == CLIENTRESPONSE_BADSCHEMA ||
-         type == CLIENTRESPONSE_FAILED)
+         type == CLIENTRESPONSE_FAILED ||
+         type == CLIENTRESPONSE_OVERLOADED)
             return true;
     }
     
@@ -150,6 +151,8 @@ bool Result::AppendRequestResponse(ClientResponse* resp)
         req->status = SDBP_FAILED;
     else if (resp->type == CLIENTRESPONSE_BADSCHEMA)
         req->status = SDBP_BADSCHEMA;
+    else if (resp->type == CLIENTRESPONSE_OVERLOADED)
+        req->status = SDBP_OVERLOADED;
     else if (req->status != SDBP_FAILED)
         req->status = SDBP_SUCCESS;
 
@@ -314,6 +317,17 @@ int Result::IsConditionalSuccess(bool& isConditionalSuccess)
     return requestCursor->status;
 }
 
+int Result::GetVersion(uint64_t& versionPaxosID, uint64_t& versionCommandID)
+{
+    // the version of a value read from the batch is not known yet
+    if (proxied || requestCursor == NULL)
+        return SDBP_API_ERROR;
+
+    versionPaxosID = requestCursor->response.versionPaxosID;
+    versionCommandID = requestCursor->response.versionCommandID;
+    return requestCursor->status;
+}
+
 int Result::GetDatabaseID(uint64_t& databaseID)
 {
     if (requestCursor == NULL)
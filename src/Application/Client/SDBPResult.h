@@ -53,6 +53,7 @@ public:
     int                 GetSignedNumber(int64_t& number);
     int                 GetNumber(uint64_t& number);
     int                 IsConditionalSuccess(bool& isConditionalSuccess);
+    int                 GetVersion(uint64_t& versionPaxosID, uint64_t& versionCommandID);
     
     int                 GetDatabaseID(uint64_t& databaseID);
     int                 GetTableID(uint64_t& tableID);
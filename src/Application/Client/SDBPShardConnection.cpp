@@ -2,6 +2,7 @@
 #include "SDBPPooledShardConnection.h"
 #include "SDBPClient.h"
 #include "Application/Common/ClientResponse.h"
+#include "Application/Common/ListFilter.h"
 #include "Application/SDBP/SDBPRequestMessage.h"
 #include "Application/SDBP/SDBPResponseMessage.h"
 #include "System/Events/EventLoop.h"
@@ -45,10 +46,56 @@ bool ShardConnection::SendRequest(Request* request)
         if (conn == NULL)
             return false;
     }
+
+    request->filterLocally = (request->filter.GetLength() > 0 && !IsListFilterSupported());
+    if (request->filterLocally)
+        return SendUnfilteredRequest(request, msg);
     
     return conn->SendRequest(msg);
 }
 
+bool ShardConnection::SendMultiRequest(Request** requests, unsigned numRequests)
+{
+    SDBPRequestMessage  msg;
+    ClientRequest       multi;
+    ClientRequest*      items[SDBP_MULTI_MAX_ITEMS];
+    Request*            first;
+    unsigned            i;
+    bool                ret;
+
+    ASSERT(numRequests > 0 && numRequests <= SDBP_MULTI_MAX_ITEMS);
+
+    for (i = 0; i < numRequests; i++)
+    {
+        sentRequests.Append(requests[i]);
+        requests[i]->numTry++;
+        requests[i]->requestTime = EventLoop::Now();
+        items[i] = requests[i];
+    }
+
+    // the items share the fields of the first request
+    first = requests[0];
+    multi.type = ClientRequest::GetMultiType(first->type);
+    multi.commandID = first->commandID;
+    multi.configPaxosID = first->configPaxosID;
+    multi.tableID = first->tableID;
+    multi.paxosID = first->paxosID;
+    multi.items = items;
+    multi.numItems = numRequests;
+
+    msg.request = &multi;
+    ret = false;
+    if (conn == NULL)
+        conn = PooledShardConnection::GetConnection(this);
+    if (conn != NULL)
+        ret = conn->SendRequest(msg);
+
+    // the items are owned by the client
+    multi.items = NULL;
+    multi.numItems = 0;
+    return ret;
+}
+
 void ShardConnection::Flush()
 {
     if (conn == NULL)
@@ -96,6 +143,22 @@ bool ShardConnection::IsConnected()
     return conn->IsConnected();
 }
 
+bool ShardConnection::IsMultiRequestSupported()
+{
+    if (conn == NULL)
+        return false;
+
+    return conn->GetProtocolVersion() >= SDBP_PROTOCOL_VERSION_MULTI;
+}
+
+bool ShardConnection::IsListFilterSupported()
+{
+    if (conn == NULL)
+        return false;
+
+    return conn->GetProtocolVersion() >= SDBP_PROTOCOL_VERSION_FILTER;
+}
+
 unsigned ShardConnection::GetNumSentRequests()
 {
     return sentRequests.GetLength();
@@ -135,10 +198,8 @@ void ShardConnection::ReassignSentRequests()
 
 bool ShardConnection::OnMessage(ReadBuffer& rbuf)
 {
-    bool                clientLocked;
-    uint64_t            paxosID;
     SDBPResponseMessage msg;
-    Request*            request;
+    ReadBuffer          item;
 
     //Log_Debug("Shard conn: %s, message: %R", endpoint.ToString(), &rbuf);
     
@@ -150,9 +211,33 @@ bool ShardConnection::OnMessage(ReadBuffer& rbuf)
     if (response.type == CLIENTRESPONSE_HELLO)
     {
         Log_Trace("SDBP version: %U, message: %R", response.number, &response.value);
+        if (conn != NULL)
+            conn->SetProtocolVersion(response.number);
         return false;
     }
 
+    if (response.type != CLIENTRESPONSE_MULTI)
+        return OnResponse();
+
+    // the responses of a multi-key request are handled one by one
+    while (msg.ReadMultiItem(item))
+    {
+        response.Init();
+        msg.response = &response;
+        if (!msg.Read(item))
+            return false;
+        OnResponse();
+    }
+
+    return false;
+}
+
+bool ShardConnection::OnResponse()
+{
+    bool                clientLocked;
+    uint64_t            paxosID;
+    Request*            request;
+
     if (response.type == CLIENTRESPONSE_NEXT)
         Log_Trace("NEXT, %U", response.commandID);
     
@@ -205,6 +290,18 @@ bool ShardConnection::OnMessage(ReadBuffer& rbuf)
         }
     }
 
+    if (request != NULL && request->filterLocally)
+        FilterListResponse(request);
+
+    // sub-scans of a parallel range scan are merged by the client
+    if (request != NULL && request->parent != NULL)
+    {
+        client->Lock();
+        client->OnScanItemResponse(request, &response);
+        client->Unlock();
+        return false;
+    }
+
     clientLocked = false;
     if (!client->isDone.IsWaiting())
     {
@@ -227,6 +324,70 @@ bool ShardConnection::OnMessage(ReadBuffer& rbuf)
     return false;
 }
 
+// the request is sent without the filter and without count, the values are
+// listed too if the filter needs them, and the responses are filtered locally
+bool ShardConnection::SendUnfilteredRequest(Request* request, SDBPRequestMessage& msg)
+{
+    Buffer      filter;
+    ListFilter  listFilter;
+    uint64_t    count;
+    char        type;
+    bool        ret;
+
+    filter.Write(request->filter);
+    count = request->count;
+    type = request->type;
+    if (type == CLIENTREQUEST_LIST_KEYS && listFilter.Parse(ReadBuffer(filter)) && listFilter.IsValueNeeded())
+        request->type = CLIENTREQUEST_LIST_KEYVALUES;
+    request->filter.Clear();
+    request->count = 0;
+
+    ret = conn->SendRequest(msg);
+
+    request->filter.Write(filter);
+    request->count = count;
+    request->type = type;
+    return ret;
+}
+
+void ShardConnection::FilterListResponse(Request* request)
+{
+    ListFilter  listFilter;
+    ReadBuffer  value;
+    unsigned    i;
+    unsigned    num;
+
+    if (response.type != CLIENTRESPONSE_LIST_KEYS && response.type != CLIENTRESPONSE_LIST_KEYVALUES)
+        return;
+
+    // the filter was validated by Client::SetListFilter()
+    if (!listFilter.Parse(ReadBuffer(request->filter)))
+        return;
+
+    num = 0;
+    for (i = 0; i < response.numKeys; i++)
+    {
+        value.Reset();
+        if (response.type == CLIENTRESPONSE_LIST_KEYVALUES)
+            value = response.values[i];
+        if (!listFilter.Match(response.keys[i], value))
+            continue;
+
+        response.keys[num] = response.keys[i];
+        if (response.type == CLIENTRESPONSE_LIST_KEYVALUES)
+        {
+            listFilter.Project(value);
+            response.values[num] = value;
+        }
+        num++;
+    }
+    response.numKeys = num;
+
+    // the values were only listed for the filter
+    if (request->type == CLIENTREQUEST_LIST_KEYS)
+        response.type = CLIENTRESPONSE_LIST_KEYS;
+}
+
 void ShardConnection::OnWrite()
 {
     Log_Trace();
@@ -8,6 +8,8 @@
 #include "Application/Common/ClientResponse.h"
 #include "SDBPClientRequest.h"
 
+class SDBPRequestMessage;   // forward
+
 namespace SDBPClient
 {
 
@@ -31,6 +33,7 @@ public:
     
     void                    ClearRequests();
     bool                    SendRequest(Request* request);
+    bool                    SendMultiRequest(Request** requests, unsigned numRequests);
     void                    Flush();
     void                    ReleaseConnection();
 
@@ -38,6 +41,8 @@ public:
     Endpoint&               GetEndpoint();
     bool                    IsWritePending();
     bool                    IsConnected();
+    bool                    IsMultiRequestSupported();
+    bool                    IsListFilterSupported();
     unsigned                GetNumSentRequests();
 
     void                    SetQuorumMembership(uint64_t quorumID);
@@ -57,6 +62,9 @@ public:
 
 private:
     void                    InvalidateQuorum(uint64_t quorumID);
+    bool                    OnResponse();
+    bool                    SendUnfilteredRequest(Request* request, SDBPRequestMessage& msg);
+    void                    FilterListResponse(Request* request);
     void                    SendQuorumRequests();
 
     Client*                 client;
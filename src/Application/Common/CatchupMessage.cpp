@@ -45,6 +45,14 @@ bool CatchupMessage::Abort()
     return true;
 }
 
+bool CatchupMessage::Batch(uint64_t shardID_, ReadBuffer block)
+{
+    type = CATCHUPMESSAGE_BATCH;
+    shardID = shardID_;
+    value = block;
+    return true;
+}
+
 bool CatchupMessage::Read(ReadBuffer& buffer)
 {
     int     read;
@@ -79,6 +87,10 @@ bool CatchupMessage::Read(ReadBuffer& buffer)
             read = buffer.Readf("%c:%c",
              &proto, &type);
             break;
+        case CATCHUPMESSAGE_BATCH:
+            read = buffer.Readf("%c:%c:%U:%#R",
+             &proto, &type, &shardID, &value);
+            break;
         default:
             return false;
     }
@@ -116,6 +128,10 @@ bool CatchupMessage::Write(Buffer& buffer)
             buffer.Writef("%c:%c",
              proto, type);
             return true;
+        case CATCHUPMESSAGE_BATCH:
+            buffer.Writef("%c:%c:%U:%#R",
+             proto, type, shardID, &value);
+            return true;
         default:
             return false;
     }
@@ -11,6 +11,8 @@
 #define CATCHUPMESSAGE_DELETE          'D'
 #define CATCHUPMESSAGE_COMMIT          'C'
 #define CATCHUPMESSAGE_ABORT           'A'
+#define CATCHUPMESSAGE_BATCH           'K'
+
 /*
 ===============================================================================================
 
@@ -36,6 +38,7 @@ public:
     bool            Delete(uint64_t shardID, ReadBuffer key);
     bool            Commit(uint64_t paxosID);
     bool            Abort();
+    bool            Batch(uint64_t shardID, ReadBuffer block);
 
     // Serialization
     bool            Read(ReadBuffer& buffer);
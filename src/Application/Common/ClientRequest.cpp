@@ -26,16 +26,24 @@ void ClientRequest::Init()
     nodeID = 0;
     paxosID = 0;
     configPaxosID = 0;
+    versionPaxosID = 0;
+    versionCommandID = 0;
     priority = 0;
     number = 0;
     count = 0;
     changeTimeout = 0;
     lastChangeTime = 0;
+    receiveTime = 0;
+    parent = NULL;
+    items = NULL;
+    numItems = 0;
+    numCompletedItems = 0;
 
     response.NoResponse();
     name.Clear();
     key.Clear();
     value.Clear();
+    filter.Clear();
     nodes.Clear();
 }
 
@@ -91,6 +99,8 @@ bool ClientRequest::IsShardServerRequest()
         type == CLIENTREQUEST_SET_IF_NOT_EXISTS     ||
         type == CLIENTREQUEST_TEST_AND_SET          ||
         type == CLIENTREQUEST_TEST_AND_DELETE       ||
+        type == CLIENTREQUEST_SET_IF_VERSION        ||
+        type == CLIENTREQUEST_DELETE_IF_VERSION     ||
         type == CLIENTREQUEST_GET_AND_SET           ||
         type == CLIENTREQUEST_ADD                   ||
         type == CLIENTREQUEST_APPEND                ||
@@ -103,7 +113,8 @@ bool ClientRequest::IsShardServerRequest()
         type == CLIENTREQUEST_COUNT                 ||
         type == CLIENTREQUEST_START_TRANSACTION     ||
         type == CLIENTREQUEST_COMMIT_TRANSACTION    ||
-        type == CLIENTREQUEST_ROLLBACK_TRANSACTION)
+        type == CLIENTREQUEST_ROLLBACK_TRANSACTION  ||
+        type == CLIENTREQUEST_START_OPTIMISTIC_TRANSACTION)
             return true;
     
     return false;
@@ -130,12 +141,53 @@ bool ClientRequest::IsTransaction()
 {
     if (type == CLIENTREQUEST_START_TRANSACTION     ||
         type == CLIENTREQUEST_COMMIT_TRANSACTION    ||
-        type == CLIENTREQUEST_ROLLBACK_TRANSACTION)
+        type == CLIENTREQUEST_ROLLBACK_TRANSACTION  ||
+        type == CLIENTREQUEST_START_OPTIMISTIC_TRANSACTION)
             return true;
     
     return false;
 }
 
+bool ClientRequest::IsMulti()
+{
+    if (type == CLIENTREQUEST_MULTI_GET     ||
+        type == CLIENTREQUEST_MULTI_SET     ||
+        type == CLIENTREQUEST_MULTI_DELETE)
+            return true;
+    
+    return false;
+}
+
+char ClientRequest::GetMultiType(char itemType)
+{
+    switch (itemType)
+    {
+        case CLIENTREQUEST_GET:
+            return CLIENTREQUEST_MULTI_GET;
+        case CLIENTREQUEST_SET:
+            return CLIENTREQUEST_MULTI_SET;
+        case CLIENTREQUEST_DELETE:
+            return CLIENTREQUEST_MULTI_DELETE;
+        default:
+            return CLIENTREQUEST_UNDEFINED;
+    }
+}
+
+char ClientRequest::GetMultiItemType(char multiType)
+{
+    switch (multiType)
+    {
+        case CLIENTREQUEST_MULTI_GET:
+            return CLIENTREQUEST_GET;
+        case CLIENTREQUEST_MULTI_SET:
+            return CLIENTREQUEST_SET;
+        case CLIENTREQUEST_MULTI_DELETE:
+            return CLIENTREQUEST_DELETE;
+        default:
+            return CLIENTREQUEST_UNDEFINED;
+    }
+}
+
 bool ClientRequest::IsActive()
 {
     if (session && session->IsActive())
@@ -408,6 +460,33 @@ void ClientRequest::TestAndDelete(
     test.Write(test_);
 }
 
+void ClientRequest::SetIfVersion(
+ uint64_t commandID_, uint64_t configPaxosID_, uint64_t tableID_,
+ ReadBuffer& key_, ReadBuffer& value_, uint64_t versionPaxosID_, uint64_t versionCommandID_)
+{
+    type = CLIENTREQUEST_SET_IF_VERSION;
+    commandID = commandID_;
+    configPaxosID = configPaxosID_;
+    tableID = tableID_;
+    key.Write(key_);
+    value.Write(value_);
+    versionPaxosID = versionPaxosID_;
+    versionCommandID = versionCommandID_;
+}
+
+void ClientRequest::DeleteIfVersion(
+ uint64_t commandID_, uint64_t configPaxosID_, uint64_t tableID_,
+ ReadBuffer& key_, uint64_t versionPaxosID_, uint64_t versionCommandID_)
+{
+    type = CLIENTREQUEST_DELETE_IF_VERSION;
+    commandID = commandID_;
+    configPaxosID = configPaxosID_;
+    tableID = tableID_;
+    key.Write(key_);
+    versionPaxosID = versionPaxosID_;
+    versionCommandID = versionCommandID_;
+}
+
 void ClientRequest::GetAndSet(
  uint64_t commandID_, uint64_t configPaxosID_, uint64_t tableID_,
  ReadBuffer& key_, ReadBuffer& value_)
@@ -561,3 +640,12 @@ void ClientRequest::RollbackTransaction(uint64_t commandID_, uint64_t quorumID_)
     commandID = commandID_;
     quorumID = quorumID_;
 }
+
+void ClientRequest::StartOptimisticTransaction(
+ uint64_t commandID_, uint64_t configPaxosID_, uint64_t quorumID_)
+{
+    type = CLIENTREQUEST_START_OPTIMISTIC_TRANSACTION;
+    commandID = commandID_;
+    configPaxosID = configPaxosID_;
+    quorumID = quorumID_;
+}
@@ -34,6 +34,8 @@
 #define CLIENTREQUEST_SET_IF_NOT_EXISTS                 'I'
 #define CLIENTREQUEST_TEST_AND_SET                      's'
 #define CLIENTREQUEST_TEST_AND_DELETE                   'i'
+#define CLIENTREQUEST_SET_IF_VERSION                    'v'
+#define CLIENTREQUEST_DELETE_IF_VERSION                 'V'
 #define CLIENTREQUEST_GET_AND_SET                       'g'
 #define CLIENTREQUEST_ADD                               'a'
 #define CLIENTREQUEST_APPEND                            'p'
@@ -49,6 +51,10 @@
 #define CLIENTREQUEST_START_TRANSACTION                 '<'
 #define CLIENTREQUEST_COMMIT_TRANSACTION                '>'
 #define CLIENTREQUEST_ROLLBACK_TRANSACTION              '~'
+#define CLIENTREQUEST_START_OPTIMISTIC_TRANSACTION      'o'
+#define CLIENTREQUEST_MULTI_GET                         'J'
+#define CLIENTREQUEST_MULTI_SET                         'K'
+#define CLIENTREQUEST_MULTI_DELETE                      'Z'
 
 class ClientSession; // forward
 
@@ -74,7 +80,12 @@ public:
     bool            IsReadRequest();
     bool            IsList();
     bool            IsTransaction();
+    bool            IsMulti();
     bool            IsActive();
+
+    // Multi-key requests carry many GET, SET or DELETE items for one table
+    static char     GetMultiType(char itemType);
+    static char     GetMultiItemType(char multiType);
     
     // Master query
     void            GetMaster(
@@ -152,6 +163,14 @@ public:
     void            TestAndDelete(
                      uint64_t commandID, uint64_t configPaxosID,
                      uint64_t tableID, ReadBuffer& key, ReadBuffer& test);
+    void            SetIfVersion(
+                     uint64_t commandID, uint64_t configPaxosID,
+                     uint64_t tableID, ReadBuffer& key, ReadBuffer& value,
+                     uint64_t versionPaxosID, uint64_t versionCommandID);
+    void            DeleteIfVersion(
+                     uint64_t commandID, uint64_t configPaxosID,
+                     uint64_t tableID, ReadBuffer& key,
+                     uint64_t versionPaxosID, uint64_t versionCommandID);
     void            GetAndSet(
                      uint64_t commandID, uint64_t configPaxosID,
                      uint64_t tableID, ReadBuffer& key, ReadBuffer& value);
@@ -194,6 +213,8 @@ public:
                      uint64_t quorumID, ReadBuffer& majorKey);
     void            CommitTransaction(uint64_t commandID, uint64_t quorumID);
     void            RollbackTransaction(uint64_t commandID, uint64_t quorumID);
+    void            StartOptimisticTransaction(uint64_t commandID, uint64_t configPaxosID,
+                     uint64_t quorumID);
 
     // Variables
     ClientResponse  response;
@@ -214,6 +235,8 @@ public:
     uint64_t        nodeID;
     uint64_t        paxosID;
     uint64_t        configPaxosID;
+    uint64_t        versionPaxosID;     // version of the value for conditional writes,
+    uint64_t        versionCommandID;   // 0:0 if the key must not exist
     uint64_t        priority;
     int64_t         number;
     uint64_t        sequence;
@@ -224,10 +247,17 @@ public:
     Buffer          value;
     Buffer          test;
     Buffer          endKey;
+    Buffer          filter;         // ListFilter of LIST requests
     List<uint64_t>  nodes;
     uint64_t        changeTimeout;
     uint64_t        lastChangeTime;
-    
+    uint64_t        receiveTime;    // set by the shard server when the request is queued
+
+    // Multi-key requests
+    ClientRequest*  parent;
+    ClientRequest** items;
+    unsigned        numItems;
+    unsigned        numCompletedItems;
 };
 
 #endif
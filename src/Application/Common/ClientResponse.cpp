@@ -25,6 +25,8 @@ void ClientResponse::Init()
     snumber = 0;
     number = 0;
     paxosID = 0;
+    versionPaxosID = 0;
+    versionCommandID = 0;
     value.Reset();
     isConditionalSuccess = false;
 }
@@ -114,6 +116,8 @@ void ClientResponse::Transfer(ClientResponse& other)
     other.keys = keys;
     other.values = values;
     other.isConditionalSuccess = isConditionalSuccess;
+    other.versionPaxosID = versionPaxosID;
+    other.versionCommandID = versionCommandID;
 
     Init();
 }
@@ -198,6 +202,12 @@ bool ClientResponse::BadSchema()
     return true;
 }
 
+bool ClientResponse::Overloaded()
+{
+    type = CLIENTRESPONSE_OVERLOADED;
+    return true;
+}
+
 bool ClientResponse::Failed()
 {
     type = CLIENTRESPONSE_FAILED;
@@ -216,6 +226,12 @@ bool ClientResponse::Hello()
     return true;
 }
 
+bool ClientResponse::Multi()
+{
+    type = CLIENTRESPONSE_MULTI;
+    return true;
+}
+
 bool ClientResponse::Next(
  ReadBuffer& nextShardKey, ReadBuffer& endKey_, ReadBuffer& prefix_,
  uint64_t count)
@@ -232,3 +248,9 @@ void ClientResponse::SetConditionalSuccess(bool isConditionalSuccess_)
 {
     isConditionalSuccess = isConditionalSuccess_;
 }
+
+void ClientResponse::SetVersion(uint64_t versionPaxosID_, uint64_t versionCommandID_)
+{
+    versionPaxosID = versionPaxosID_;
+    versionCommandID = versionCommandID_;
+}
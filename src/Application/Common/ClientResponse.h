@@ -15,12 +15,16 @@
 #define CLIENTRESPONSE_NOSERVICE        'S'
 #define CLIENTRESPONSE_BADSCHEMA        'B'
 #define CLIENTRESPONSE_FAILED           'F'
+#define CLIENTRESPONSE_OVERLOADED       'o'
 #define CLIENTRESPONSE_NORESPONSE       ' '
 #define CLIENTRESPONSE_HELLO            '_'
 #define CLIENTRESPONSE_NEXT             'N'
+#define CLIENTRESPONSE_MULTI            'M'
 
 #define CLIENTRESPONSE_OPT_PAXOSID              'P'
 #define CLIENTRESPONSE_OPT_VALUE_CHANGED        'v'
+#define CLIENTRESPONSE_OPT_VERSION_PAXOSID      'e'
+#define CLIENTRESPONSE_OPT_VERSION_COMMANDID    'E'
 
 // this is needed on Visual C++ which cannot handle C99 type dynamic stack arrays
 #ifdef PLATFORM_WINDOWS
@@ -54,6 +58,8 @@ public:
     uint64_t        number;
     uint64_t        commandID;
     uint64_t        paxosID;
+    uint64_t        versionPaxosID;     // version of the value read or written,
+    uint64_t        versionCommandID;   // 0:0 if the key does not exist
     ReadBuffer      value;
     ReadBuffer      endKey;
     ReadBuffer      prefix;
@@ -84,13 +90,16 @@ public:
     bool            ConfigStateResponse(ConfigState& configState);
     bool            NoService();
     bool            BadSchema();
+    bool            Overloaded();
     bool            Failed();
     bool            NoResponse();
     bool            Hello();
+    bool            Multi();
     bool            Next(ReadBuffer& nextShardKey, ReadBuffer& endKey, ReadBuffer& prefix,
                      uint64_t count);
 
     void            SetConditionalSuccess(bool isConditionalSuccess);
+    void            SetVersion(uint64_t versionPaxosID, uint64_t versionCommandID);
 };
 
 #endif
@@ -1,5 +1,11 @@
 #include "ClientSession.h"
 
+ClientSession::ClientSession()
+{
+    optimistic = false;
+    optimisticQuorumID = 0;
+}
+
 ClientSession::~ClientSession()
 {
 }
@@ -8,11 +14,24 @@ void ClientSession::Init()
 {
     lockKey.Clear();
     transaction.Clear();
+    optimistic = false;
+    optimisticQuorumID = 0;
+    readVersions.Clear();
+}
+
+bool ClientSession::IsWriteReady()
+{
+    return true;
 }
 
 bool ClientSession::IsTransactional()
 {
-    return lockKey.GetLength() > 0;
+    return lockKey.GetLength() > 0 || optimistic;
+}
+
+bool ClientSession::IsOptimistic()
+{
+    return optimistic;
 }
 
 bool ClientSession::IsCommitting()
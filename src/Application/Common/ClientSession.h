@@ -17,17 +17,27 @@ class ClientSession
     typedef InList<ClientRequest> Transaction;
 
 public:
+    ClientSession();
     virtual ~ClientSession();
         
     virtual void    OnComplete(ClientRequest* request, bool last)       = 0;
     virtual bool    IsActive()                                          = 0;
+    // returns false while the responses already written are not yet sent
+    virtual bool    IsWriteReady();
 
     void            Init();
     bool            IsTransactional();
+    bool            IsOptimistic();
     bool            IsCommitting();
     
     Buffer          lockKey;
     Transaction     transaction;
+
+    // optimistic transactions take no lock, the versions of the keys read
+    // in the transaction are checked when the commit is replicated
+    bool            optimistic;
+    uint64_t        optimisticQuorumID;
+    Buffer          readVersions;
 };
 
 #endif
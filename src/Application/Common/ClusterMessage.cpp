@@ -112,6 +112,16 @@ bool ClusterMessage::ShardMigrationDelete(
     return true;
 }
 
+bool ClusterMessage::ShardMigrationBatch(
+ uint64_t quorumID_, uint64_t shardID_, ReadBuffer block)
+{
+    type = CLUSTERMESSAGE_SHARDMIGRATION_BATCH;
+    quorumID = quorumID_;
+    shardID = shardID_;
+    value = block;
+    return true;
+}
+
 bool ClusterMessage::ShardMigrationCommit(
  uint64_t quorumID_, uint64_t shardID_)
 {
@@ -231,6 +241,10 @@ bool ClusterMessage::Read(ReadBuffer& buffer)
             read = buffer.Readf("%c:%U:%U:%#R",
              &type, &quorumID, &shardID, &key);
             break;
+        case CLUSTERMESSAGE_SHARDMIGRATION_BATCH:
+            read = buffer.Readf("%c:%U:%U:%#R",
+             &type, &quorumID, &shardID, &value);
+            break;
         case CLUSTERMESSAGE_SHARDMIGRATION_COMMIT:
             read = buffer.Readf("%c:%U:%U",
              &type, &quorumID, &shardID);
@@ -318,6 +332,10 @@ bool ClusterMessage::Write(Buffer& buffer)
             buffer.Writef("%c:%U:%U:%#R",
              type, quorumID, shardID, &key);
             return true;
+        case CLUSTERMESSAGE_SHARDMIGRATION_BATCH:
+            buffer.Writef("%c:%U:%U:%#R",
+             type, quorumID, shardID, &value);
+            return true;
         case CLUSTERMESSAGE_SHARDMIGRATION_COMMIT:
             buffer.Writef("%c:%U:%U",
              type, quorumID, shardID);
@@ -20,6 +20,7 @@
 #define CLUSTERMESSAGE_SHARDMIGRATION_COMPLETE  '5' // shard server => master
 #define CLUSTERMESSAGE_SHARDMIGRATION_PAUSE     '6' // shard server => master
 #define CLUSTERMESSAGE_SHARDMIGRATION_RESUME    '7' // shard server => master
+#define CLUSTERMESSAGE_SHARDMIGRATION_BATCH     '8' // shard server => shard server
 #define CLUSTERMESSAGE_HELLO                    '_'
 #define CLUSTERMESSAGE_HTTP_ENDPOINT            'h' // controller => controllers
 
@@ -74,6 +75,7 @@ public:
     bool            ShardMigrationBegin(uint64_t quorumID, uint64_t srcShardID, uint64_t dstShardID);
     bool            ShardMigrationSet(uint64_t quorumID, uint64_t shardID, ReadBuffer key, ReadBuffer value);
     bool            ShardMigrationDelete(uint64_t quorumID, uint64_t shardID, ReadBuffer key);
+    bool            ShardMigrationBatch(uint64_t quorumID, uint64_t shardID, ReadBuffer block);
     bool            ShardMigrationCommit(uint64_t quorumID, uint64_t shardID);
     bool            ShardMigrationComplete(uint64_t quorumID, uint64_t shardID);
     bool            ShardMigrationPause();
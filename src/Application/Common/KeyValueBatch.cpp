@@ -0,0 +1,147 @@
+#include "KeyValueBatch.h"
+#include "System/Buffers/Varint.h"
+
+KeyValueBatch::KeyValueBatch()
+{
+    Clear();
+}
+
+void KeyValueBatch::Clear()
+{
+    numItems = 0;
+    items.Clear();
+    data.Reset();
+    position = 0;
+}
+
+void KeyValueBatch::Set(const ReadBuffer& key, const ReadBuffer& value)
+{
+    items.Append(KEYVALUEBATCH_SET);
+    AppendSlice(items, key);
+    AppendSlice(items, value);
+    numItems++;
+}
+
+void KeyValueBatch::Delete(const ReadBuffer& key)
+{
+    items.Append(KEYVALUEBATCH_DELETE);
+    AppendSlice(items, key);
+    numItems++;
+}
+
+unsigned KeyValueBatch::GetNumItems()
+{
+    return numItems;
+}
+
+unsigned KeyValueBatch::GetSize()
+{
+    return items.GetLength();
+}
+
+void KeyValueBatch::Write(Buffer& block, bool compression)
+{
+    ReadBuffer  payload;
+
+    block.Clear();
+    payload.Wrap(items);
+    if (compression && compressor.Compress(payload, compressed) &&
+     compressed.GetLength() < items.GetLength())
+    {
+        block.Append(KEYVALUEBATCH_COMPRESSED);
+        payload.Wrap(compressed);
+    }
+    else
+        block.Append(KEYVALUEBATCH_RAW);
+
+    block.AppendVarint(numItems);
+    block.AppendVarint(items.GetLength());
+    block.Append(payload.GetBuffer(), payload.GetLength());
+}
+
+bool KeyValueBatch::Read(const ReadBuffer& block)
+{
+    char        format;
+    uint64_t    num;
+    uint64_t    length;
+    const char* p;
+    const char* end;
+    char        type;
+    ReadBuffer  payload;
+    ReadBuffer  key;
+    ReadBuffer  value;
+
+    Clear();
+
+    if (block.GetLength() < 1)
+        return false;
+
+    p = block.GetBuffer();
+    end = p + block.GetLength();
+    format = *p++;
+    if (!DecodeVarint(p, end, num) || !DecodeVarint(p, end, length))
+        return false;
+    if (length > KEYVALUEBATCH_MAX_SIZE)
+        return false;
+    payload.Wrap((char*) p, (unsigned) (end - p));
+
+    if (format == KEYVALUEBATCH_COMPRESSED)
+    {
+        // items points into the uncompressed data
+        if (!compressor.Uncompress(payload, items, (uint32_t) length))
+            return false;
+        if (items.GetLength() != length)
+            return false;
+        data.Wrap(items);
+    }
+    else if (format == KEYVALUEBATCH_RAW)
+    {
+        // the items are wrapped, not copied
+        if (payload.GetLength() != length)
+            return false;
+        data = payload;
+    }
+    else
+        return false;
+
+    // check the items, so that a batch is either applied fully or not at all
+    numItems = 0;
+    position = 0;
+    while (Next(type, key, value))
+        numItems++;
+    if (position != data.GetLength() || numItems != num)
+    {
+        Clear();
+        return false;
+    }
+
+    position = 0;
+    return true;
+}
+
+bool KeyValueBatch::Next(char& type, ReadBuffer& key, ReadBuffer& value)
+{
+    const char* p;
+    const char* end;
+
+    if (position >= data.GetLength())
+        return false;
+
+    p = data.GetBuffer() + position;
+    end = data.GetBuffer() + data.GetLength();
+    type = *p++;
+    if (!DecodeSlice(p, end, key))
+        return false;
+    if (type == KEYVALUEBATCH_SET)
+    {
+        if (!DecodeSlice(p, end, value))
+            return false;
+    }
+    else if (type == KEYVALUEBATCH_DELETE)
+        value.Reset();
+    else
+        return false;
+
+    position = (unsigned) (p - data.GetBuffer());
+    return true;
+}
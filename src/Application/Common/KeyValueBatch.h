@@ -0,0 +1,53 @@
+#ifndef KEYVALUEBATCH_H
+#define KEYVALUEBATCH_H
+
+#include "System/Buffers/Buffer.h"
+#include "System/Compressor.h"
+
+#define KEYVALUEBATCH_SET               'S'
+#define KEYVALUEBATCH_DELETE            'D'
+
+#define KEYVALUEBATCH_RAW               'r'
+#define KEYVALUEBATCH_COMPRESSED        'z'
+
+#define KEYVALUEBATCH_MAX_SIZE          (64*MiB)
+
+/*
+===============================================================================================
+
+ KeyValueBatch
+
+ A block of sets and deletes sent in one catchup or migration message. The block is
+ a format byte, the varint number of items and uncompressed length, then the items:
+ a type byte, the key and for sets the value, both varint length prefixed.
+ The items are LZF compressed if that makes the block smaller.
+
+===============================================================================================
+*/
+
+class KeyValueBatch
+{
+public:
+    KeyValueBatch();
+
+    void            Clear();
+    void            Set(const ReadBuffer& key, const ReadBuffer& value);
+    void            Delete(const ReadBuffer& key);
+
+    unsigned        GetNumItems();
+    unsigned        GetSize();
+
+    void            Write(Buffer& block, bool compression);
+    bool            Read(const ReadBuffer& block);
+    bool            Next(char& type, ReadBuffer& key, ReadBuffer& value);
+
+private:
+    unsigned        numItems;
+    Buffer          items;
+    Buffer          compressed;
+    ReadBuffer      data;
+    unsigned        position;
+    Compressor      compressor;
+};
+
+#endif
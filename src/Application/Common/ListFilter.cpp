@@ -0,0 +1,380 @@
+#include "ListFilter.h"
+#include "System/Common.h"
+
+#define LISTFILTER_MAX_ARGS     2
+
+static bool ParseNumber(const ReadBuffer& text, int64_t& number)
+{
+    unsigned    nread;
+
+    if (text.GetLength() == 0)
+        return false;
+    if (text.GetLength() == 1 && text.GetCharAt(0) == '-')
+        return false;
+
+    number = BufferToInt64(text.GetBuffer(), text.GetLength(), &nread);
+    return nread == text.GetLength();
+}
+
+static const char* ClassEnd(const char* re, const char* reEnd)
+{
+    // re points after '['
+    if (re < reEnd && *re == '^')
+        re++;
+    if (re < reEnd && *re == ']')
+        re++;
+    while (re < reEnd && *re != ']')
+        re++;
+    return re;
+}
+
+static bool MatchClass(const char* re, const char* classEnd, char c)
+{
+    bool    negate;
+    bool    found;
+
+    negate = false;
+    if (re < classEnd && *re == '^')
+    {
+        negate = true;
+        re++;
+    }
+
+    found = false;
+    while (re < classEnd)
+    {
+        if (re + 2 < classEnd && re[1] == '-')
+        {
+            if ((unsigned char) c >= (unsigned char) re[0] && (unsigned char) c <= (unsigned char) re[2])
+                found = true;
+            re += 3;
+        }
+        else
+        {
+            if (c == *re)
+                found = true;
+            re++;
+        }
+    }
+
+    return found != negate;
+}
+
+// returns the end of the single character pattern at re, and whether it matches c
+static const char* MatchAtom(const char* re, const char* reEnd, const char* t, const char* tEnd,
+ bool& matched)
+{
+    const char* end;
+
+    if (*re == '[')
+    {
+        end = ClassEnd(re + 1, reEnd);
+        matched = (t < tEnd && end < reEnd && MatchClass(re + 1, end, *t));
+        return end < reEnd ? end + 1 : end;
+    }
+
+    if (*re == '\\' && re + 1 < reEnd)
+    {
+        matched = (t < tEnd && *t == re[1]);
+        return re + 2;
+    }
+
+    matched = (t < tEnd && (*re == '.' || *re == *t));
+    return re + 1;
+}
+
+static bool MatchHere(const char* re, const char* reEnd, const char* t, const char* tEnd)
+{
+    const char* atomEnd;
+    const char* s;
+    bool        matched;
+
+    while (re < reEnd)
+    {
+        if (*re == '$' && re + 1 == reEnd)
+            return t == tEnd;
+
+        atomEnd = MatchAtom(re, reEnd, t, tEnd, matched);
+        if (atomEnd < reEnd && (*atomEnd == '*' || *atomEnd == '+' || *atomEnd == '?'))
+        {
+            // greedy repetition, backtracking from the longest run
+            s = t;
+            while (s < tEnd)
+            {
+                MatchAtom(re, reEnd, s, tEnd, matched);
+                if (!matched)
+                    break;
+                s++;
+                if (*atomEnd == '?')
+                    break;
+            }
+            while (s > t || (s == t && *atomEnd != '+'))
+            {
+                if (MatchHere(atomEnd + 1, reEnd, s, tEnd))
+                    return true;
+                if (s == t)
+                    break;
+                s--;
+            }
+            return false;
+        }
+
+        if (!matched)
+            return false;
+        re = atomEnd;
+        t++;
+    }
+
+    return true;
+}
+
+ListFilter::ListFilter()
+{
+    numTerms = 0;
+    Clear();
+}
+
+bool ListFilter::Parse(const ReadBuffer& text)
+{
+    ReadBuffer  name;
+    Buffer      termArgs[LISTFILTER_MAX_ARGS];
+    unsigned    numArgs;
+    unsigned    i;
+    unsigned    start;
+    unsigned    length;
+    char        c;
+
+    Clear();
+
+    i = 0;
+    length = text.GetLength();
+    while (true)
+    {
+        while (i < length && (text.GetCharAt(i) == ' ' || text.GetCharAt(i) == '\t'))
+            i++;
+        if (i == length)
+            return true;
+
+        start = i;
+        while (i < length && text.GetCharAt(i) != '(')
+            i++;
+        if (i == length)
+            goto Fail;
+        name.Wrap(text.GetBuffer() + start, i - start);
+        i++;
+
+        numArgs = 1;
+        termArgs[0].Clear();
+        while (true)
+        {
+            if (i == length)
+                goto Fail;
+            c = text.GetCharAt(i++);
+            if (c == ')')
+                break;
+            if (c == ',')
+            {
+                if (numArgs == LISTFILTER_MAX_ARGS)
+                    goto Fail;
+                termArgs[numArgs++].Clear();
+                continue;
+            }
+            if (c == '\\')
+            {
+                if (i == length)
+                    goto Fail;
+                c = text.GetCharAt(i++);
+                // keep escapes in regexes, they are meaningful there
+                if (name.Equals("keyregex") || name.Equals("valueregex"))
+                    termArgs[numArgs - 1].Append('\\');
+            }
+            termArgs[numArgs - 1].Append(c);
+        }
+
+        if (!AddTerm(name, termArgs, numArgs))
+            goto Fail;
+    }
+
+Fail:
+    Clear();
+    return false;
+}
+
+void ListFilter::Clear()
+{
+    unsigned    i;
+
+    for (i = 0; i < numTerms && i < LISTFILTER_MAX_TERMS; i++)
+        args[i].Reset();
+    numTerms = 0;
+    hasProjection = false;
+    projection = 0;
+}
+
+bool ListFilter::IsEmpty()
+{
+    return numTerms == 0 && !hasProjection;
+}
+
+bool ListFilter::IsValueNeeded()
+{
+    unsigned    i;
+
+    for (i = 0; i < numTerms; i++)
+    {
+        if (types[i] == LISTFILTER_VALUE_PREFIX ||
+         types[i] == LISTFILTER_VALUE_CONTAINS ||
+         types[i] == LISTFILTER_VALUE_REGEX ||
+         types[i] == LISTFILTER_VALUE_RANGE)
+            return true;
+    }
+
+    return false;
+}
+
+bool ListFilter::HasProjection()
+{
+    return hasProjection;
+}
+
+bool ListFilter::Match(const ReadBuffer& key, const ReadBuffer& value)
+{
+    unsigned    i;
+
+    for (i = 0; i < numTerms; i++)
+    {
+        if (!MatchTerm(i, key, value))
+            return false;
+    }
+
+    return true;
+}
+
+void ListFilter::Project(ReadBuffer& value)
+{
+    if (hasProjection && value.GetLength() > projection)
+        value.SetLength(projection);
+}
+
+bool ListFilter::MatchRegex(const ReadBuffer& regex, const ReadBuffer& text)
+{
+    const char* re;
+    const char* reEnd;
+    const char* t;
+    const char* tEnd;
+
+    re = regex.GetBuffer();
+    reEnd = re + regex.GetLength();
+    t = text.GetBuffer();
+    tEnd = t + text.GetLength();
+
+    if (re < reEnd && *re == '^')
+        return MatchHere(re + 1, reEnd, t, tEnd);
+
+    // unanchored regexes match anywhere
+    do
+    {
+        if (MatchHere(re, reEnd, t, tEnd))
+            return true;
+    }
+    while (t++ < tEnd);
+
+    return false;
+}
+
+bool ListFilter::AddTerm(ReadBuffer name, Buffer* termArgs, unsigned numArgs)
+{
+    ReadBuffer  arg;
+    int64_t     number;
+    unsigned    i;
+
+    if (name.Equals("first"))
+    {
+        arg.Wrap(termArgs[0]);
+        if (numArgs != 1 || hasProjection || !ParseNumber(arg, number) || number < 0)
+            return false;
+        hasProjection = true;
+        projection = (unsigned) number;
+        return true;
+    }
+
+    if (numTerms == LISTFILTER_MAX_TERMS)
+        return false;
+    i = numTerms;
+
+    if (name.Equals("valuerange"))
+    {
+        if (numArgs != 2)
+            return false;
+        arg.Wrap(termArgs[0]);
+        hasMin[i] = (arg.GetLength() > 0);
+        if (hasMin[i] && !ParseNumber(arg, mins[i]))
+            return false;
+        arg.Wrap(termArgs[1]);
+        hasMax[i] = (arg.GetLength() > 0);
+        if (hasMax[i] && !ParseNumber(arg, maxs[i]))
+            return false;
+        types[i] = LISTFILTER_VALUE_RANGE;
+        numTerms++;
+        return true;
+    }
+
+    if (numArgs != 1)
+        return false;
+
+    if (name.Equals("keyprefix"))
+        types[i] = LISTFILTER_KEY_PREFIX;
+    else if (name.Equals("keycontains"))
+        types[i] = LISTFILTER_KEY_CONTAINS;
+    else if (name.Equals("keyregex"))
+        types[i] = LISTFILTER_KEY_REGEX;
+    else if (name.Equals("valueprefix"))
+        types[i] = LISTFILTER_VALUE_PREFIX;
+    else if (name.Equals("valuecontains"))
+        types[i] = LISTFILTER_VALUE_CONTAINS;
+    else if (name.Equals("valueregex"))
+        types[i] = LISTFILTER_VALUE_REGEX;
+    else
+        return false;
+
+    args[i].Write(termArgs[0]);
+    numTerms++;
+    return true;
+}
+
+bool ListFilter::MatchTerm(unsigned i, const ReadBuffer& key, const ReadBuffer& value)
+{
+    ReadBuffer  arg;
+    ReadBuffer  text;
+    int64_t     number;
+
+    arg.Wrap(args[i]);
+    switch (types[i])
+    {
+        case LISTFILTER_KEY_PREFIX:
+        case LISTFILTER_VALUE_PREFIX:
+            text = (types[i] == LISTFILTER_KEY_PREFIX ? key : value);
+            if (text.GetLength() < arg.GetLength())
+                return false;
+            return memcmp(text.GetBuffer(), arg.GetBuffer(), arg.GetLength()) == 0;
+        case LISTFILTER_KEY_CONTAINS:
+        case LISTFILTER_VALUE_CONTAINS:
+            text = (types[i] == LISTFILTER_KEY_CONTAINS ? key : value);
+            return text.Find(arg) >= 0;
+        case LISTFILTER_KEY_REGEX:
+            return MatchRegex(arg, key);
+        case LISTFILTER_VALUE_REGEX:
+            return MatchRegex(arg, value);
+        case LISTFILTER_VALUE_RANGE:
+            if (!ParseNumber(value, number))
+                return false;
+            if (hasMin[i] && number < mins[i])
+                return false;
+            if (hasMax[i] && number > maxs[i])
+                return false;
+            return true;
+        default:
+            ASSERT_FAIL();
+            return false;
+    }
+}
@@ -0,0 +1,67 @@
+#ifndef LISTFILTER_H
+#define LISTFILTER_H
+
+#include "System/Buffers/Buffer.h"
+
+#define LISTFILTER_MAX_TERMS            16
+
+#define LISTFILTER_KEY_PREFIX           'p'
+#define LISTFILTER_KEY_CONTAINS         'c'
+#define LISTFILTER_KEY_REGEX            'r'
+#define LISTFILTER_VALUE_PREFIX         'P'
+#define LISTFILTER_VALUE_CONTAINS       'C'
+#define LISTFILTER_VALUE_REGEX          'R'
+#define LISTFILTER_VALUE_RANGE          'N'
+
+/*
+===============================================================================================
+
+ ListFilter
+
+ Server-side filter of LIST requests, written as terms separated by spaces, all of which
+ must match:
+
+   keyprefix(abc)  keycontains(abc)  keyregex(^user:[0-9]*$)
+   valueprefix(abc)  valuecontains(abc)  valueregex(a.*b)
+   valuerange(10,20)    the value is a decimal number in the range, a bound may be empty
+   first(100)           projection: only the first 100 bytes of the values are returned
+
+ In arguments, a backslash escapes the next character, e.g. keycontains(\)).
+ Regexes support literals, '.', '*', '+', '?', '^', '$' and character classes like [a-z].
+
+===============================================================================================
+*/
+
+class ListFilter
+{
+public:
+    ListFilter();
+
+    bool            Parse(const ReadBuffer& text);
+    void            Clear();
+
+    bool            IsEmpty();
+    bool            IsValueNeeded();
+    bool            HasProjection();
+
+    bool            Match(const ReadBuffer& key, const ReadBuffer& value);
+    void            Project(ReadBuffer& value);
+
+    static bool     MatchRegex(const ReadBuffer& regex, const ReadBuffer& text);
+
+private:
+    bool            AddTerm(ReadBuffer name, Buffer* args, unsigned numArgs);
+    bool            MatchTerm(unsigned i, const ReadBuffer& key, const ReadBuffer& value);
+
+    unsigned        numTerms;
+    char            types[LISTFILTER_MAX_TERMS];
+    Buffer          args[LISTFILTER_MAX_TERMS];
+    int64_t         mins[LISTFILTER_MAX_TERMS];
+    int64_t         maxs[LISTFILTER_MAX_TERMS];
+    bool            hasMin[LISTFILTER_MAX_TERMS];
+    bool            hasMax[LISTFILTER_MAX_TERMS];
+    bool            hasProjection;
+    unsigned        projection;
+};
+
+#endif
@@ -0,0 +1,184 @@
+#include "ConfigBalanceManager.h"
+#include "System/Events/EventLoop.h"
+#include "System/Config.h"
+#include "ConfigServer.h"
+#include "ConfigQuorumProcessor.h"
+
+#define CONFIG_STATE            (configServer->GetDatabaseManager()->GetConfigState())
+#define QUORUM_PROCESSOR        (configServer->GetQuorumProcessor())
+#define HEARTBEAT_MANAGER       (configServer->GetHeartbeatManager())
+
+void ConfigBalanceManager::Init(ConfigServer* configServer_)
+{
+    configServer = configServer_;
+
+    enabled = configFile.GetBoolValue("balanceShards", true);
+    threshold = configFile.GetIntValue("balanceThreshold", DEFAULT_BALANCE_THRESHOLD);
+    minLoad = configFile.GetIntValue("balanceMinLoad", DEFAULT_BALANCE_MIN_LOAD);
+    maxShardSize = configFile.GetInt64Value("balanceMaxShardSize", DEFAULT_BALANCE_MAX_SHARD_SIZE);
+
+    balanceTimeout.SetCallable(MFUNC(ConfigBalanceManager, OnBalanceTimeout));
+    balanceTimeout.SetDelay(configFile.GetIntValue("balanceInterval", DEFAULT_BALANCE_INTERVAL));
+    EventLoop::Add(&balanceTimeout);
+}
+
+void ConfigBalanceManager::SetEnabled(bool enabled_)
+{
+    enabled = enabled_;
+}
+
+bool ConfigBalanceManager::IsEnabled()
+{
+    return enabled;
+}
+
+void ConfigBalanceManager::OnBalanceTimeout()
+{
+    unsigned        numQuorums;
+    uint64_t        load;
+    uint64_t        totalLoad;
+    uint64_t        srcLoad;
+    uint64_t        dstLoad;
+    ConfigQuorum*   itQuorum;
+    ConfigQuorum*   srcQuorum;
+    ConfigQuorum*   dstQuorum;
+    ConfigShard*    shard;
+
+    EventLoop::Add(&balanceTimeout);
+
+    if (!enabled || !QUORUM_PROCESSOR->IsMaster())
+        return;
+
+    // the shards are migrated one at a time
+    if (CONFIG_STATE->isMigrating)
+        return;
+
+    numQuorums = 0;
+    totalLoad = 0;
+    srcLoad = 0;
+    dstLoad = 0;
+    srcQuorum = NULL;
+    dstQuorum = NULL;
+    FOREACH (itQuorum, CONFIG_STATE->quorums)
+    {
+        if (!IsBalanceable(itQuorum))
+            continue;
+
+        load = GetLoad(itQuorum);
+        totalLoad += load;
+        numQuorums++;
+
+        if (srcQuorum == NULL || load > srcLoad)
+        {
+            srcQuorum = itQuorum;
+            srcLoad = load;
+        }
+        if (dstQuorum == NULL || load < dstLoad)
+        {
+            dstQuorum = itQuorum;
+            dstLoad = load;
+        }
+    }
+
+    if (numQuorums < 2 || srcQuorum == dstQuorum)
+        return;
+
+    if (srcLoad < minLoad)
+        return;
+
+    if (srcLoad * 100 <= (totalLoad / numQuorums) * (100 + threshold))
+        return;
+
+    shard = FindShard(srcQuorum, srcLoad - dstLoad);
+    if (shard == NULL)
+        return;
+
+    Log_Message("Balancing load: migrating shard %U (%U req/s) from quorum %U (%U req/s) to quorum %U (%U req/s)",
+     shard->shardID, shard->requestRate, srcQuorum->quorumID, srcLoad, dstQuorum->quorumID, dstLoad);
+
+    QUORUM_PROCESSOR->TryShardMigrationBegin(dstQuorum->quorumID, shard->shardID);
+}
+
+bool ConfigBalanceManager::IsBalanceable(ConfigQuorum* quorum)
+{
+    uint64_t*       itShardID;
+    ConfigShard*    shard;
+
+    if (!quorum->hasPrimary || !HEARTBEAT_MANAGER->HasHeartbeat(quorum->primaryID))
+        return false;
+
+    if (quorum->isActivatingNode || quorum->inactiveNodes.GetLength() > 0)
+        return false;
+
+    if (quorum->splitShardID != 0)
+        return false;
+
+    FOREACH (itShardID, quorum->shards)
+    {
+        shard = CONFIG_STATE->GetShard(*itShardID);
+        if (shard == NULL || shard->state != CONFIG_SHARD_STATE_NORMAL)
+            return false;
+    }
+
+    return true;
+}
+
+uint64_t ConfigBalanceManager::GetLoad(ConfigQuorum* quorum)
+{
+    uint64_t        load;
+    uint64_t*       itShardID;
+    ConfigShard*    shard;
+
+    load = 0;
+    FOREACH (itShardID, quorum->shards)
+    {
+        shard = CONFIG_STATE->GetShard(*itShardID);
+        ASSERT(shard != NULL);
+        load += shard->requestRate;
+    }
+
+    return load;
+}
+
+ConfigShard* ConfigBalanceManager::FindShard(ConfigQuorum* quorum, uint64_t loadDiff)
+{
+    uint64_t        diff;
+    uint64_t        bestDiff;
+    uint64_t*       itShardID;
+    ConfigShard*    shard;
+    ConfigShard*    best;
+    ConfigTable*    table;
+
+    // moving a shard with load l changes the difference of the quorums to |loadDiff - 2l|,
+    // only shards with l < loadDiff make it smaller
+    best = NULL;
+    bestDiff = loadDiff;
+    FOREACH (itShardID, quorum->shards)
+    {
+        shard = CONFIG_STATE->GetShard(*itShardID);
+        ASSERT(shard != NULL);
+
+        if (shard->requestRate == 0 || shard->requestRate >= loadDiff)
+            continue;
+        if (shard->shardSize > maxShardSize)
+            continue;
+
+        table = CONFIG_STATE->GetTable(shard->tableID);
+        if (table == NULL || table->isFrozen)
+            continue;
+
+        if (loadDiff > 2 * shard->requestRate)
+            diff = loadDiff - 2 * shard->requestRate;
+        else
+            diff = 2 * shard->requestRate - loadDiff;
+
+        // prefer the smaller shard when moving either is just as good
+        if (diff < bestDiff || (diff == bestDiff && best != NULL && shard->shardSize < best->shardSize))
+        {
+            best = shard;
+            bestDiff = diff;
+        }
+    }
+
+    return best;
+}
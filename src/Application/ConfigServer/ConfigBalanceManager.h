@@ -0,0 +1,52 @@
+#ifndef CONFIGBALANCEMANAGER_H
+#define CONFIGBALANCEMANAGER_H
+
+#include "System/Events/Countdown.h"
+#include "Application/ConfigState/ConfigState.h"
+
+class ConfigServer; // forward
+
+#define DEFAULT_BALANCE_INTERVAL        (60*1000)   // msec
+#define DEFAULT_BALANCE_THRESHOLD       20          // percent above the mean
+#define DEFAULT_BALANCE_MIN_LOAD        1000        // requests per sec
+#define DEFAULT_BALANCE_MAX_SHARD_SIZE  (1000*MB)
+
+/*
+===============================================================================================
+
+ ConfigBalanceManager
+
+ Moves shards from the quorum with the most requests to the quorum with the least,
+ using the request rates of the shards reported in the heartbeats. The moved shard is
+ the one that brings the two quorums closest to each other. Shards larger than
+ balanceMaxShardSize are not moved, the throughput of the migration itself is limited
+ by migrationMaxThroughput on the shard servers. The quorums are checked every
+ balanceInterval, and only one shard is migrated at a time.
+
+===============================================================================================
+*/
+
+class ConfigBalanceManager
+{
+public:
+    void            Init(ConfigServer* configServer);
+
+    void            SetEnabled(bool enabled);
+    bool            IsEnabled();
+
+    void            OnBalanceTimeout();
+
+private:
+    bool            IsBalanceable(ConfigQuorum* quorum);
+    uint64_t        GetLoad(ConfigQuorum* quorum);
+    ConfigShard*    FindShard(ConfigQuorum* quorum, uint64_t loadDiff);
+
+    Countdown       balanceTimeout;
+    ConfigServer*   configServer;
+    bool            enabled;
+    uint64_t        threshold;
+    uint64_t        minLoad;
+    uint64_t        maxShardSize;
+};
+
+#endif
@@ -26,6 +26,7 @@ void ConfigDatabaseManager::Init(bool restoreMode)
     sc.SetAbortWaitingListsNum( (uint64_t) configFile.GetInt64Value("database.abortWaitingListsNum",	0       ));
     sc.SetListDataPageCacheSize((uint64_t) configFile.GetInt64Value("database.listDataPageCacheSize",   1*MB    ));
     sc.SetMaxChunkPerShard(     (unsigned) configFile.GetIntValue  ("database.maxChunkPerShard",        10      ));
+    sc.SetMaxOpenChunkFiles(    (unsigned) configFile.GetIntValue  ("database.maxOpenChunkFiles",       STORAGE_DEFAULT_MAX_OPEN_CHUNK_FILES));
 
     envpath.Writef("%s", configFile.GetValue("database.dir", "db"));
     environment.Open(envpath, sc);
@@ -553,6 +553,7 @@ void ConfigHTTPClientSession::ProcessSettings()
     bool        boolValue;
     uint64_t    logStatTime;
     uint64_t    shardSplitSize;
+    uint64_t    shardSplitLoad;
     uint64_t    traceBufferSize;
     uint64_t    logTraceInterval;
     uint64_t    logFlushInterval;
@@ -631,6 +632,24 @@ void ConfigHTTPClientSession::ProcessSettings()
         session.PrintPair("ShardSplitSize", buf);
     }
 
+    if (HTTP_GET_OPT_PARAM(params, "shardSplitLoad", param))
+    {
+        // initialize variable, because conversion may fail
+        shardSplitLoad = 0;
+        HTTP_GET_OPT_U64_PARAM(params, "shardSplitLoad", shardSplitLoad);
+        // we expect shardSplitLoad is in requests per sec, 0 disables load splitting
+        configServer->GetHeartbeatManager()->SetShardSplitLoad(shardSplitLoad);
+        snprintf(buf, sizeof(buf), "%u", (unsigned) shardSplitLoad);
+        session.PrintPair("ShardSplitLoad", buf);
+    }
+
+    if (HTTP_GET_OPT_PARAM(params, "balanceShards", param))
+    {
+        boolValue = PARAM_BOOL_VALUE(param);
+        configServer->GetBalanceManager()->SetEnabled(boolValue);
+        session.PrintPair("BalanceShards", boolValue ? "on" : "off");
+    }
+
     if (HTTP_GET_OPT_PARAM(params, "numRoundsTriggerActivation", param))
     {
         // initialize variable, because conversion may fail
@@ -725,10 +744,12 @@ void ConfigHTTPClientSession::PrintStatistics()
     buffer.Appendf("logFileDiskUsage: %s\n", HumanBytes(databaseManager->GetEnvironment()->GetLogSegmentDiskUsage(), humanBuf));
 
     buffer.Appendf("shardSplitSize: %U\n", configServer->GetHeartbeatManager()->GetShardSplitSize());
+    buffer.Appendf("shardSplitLoad: %U\n", configServer->GetHeartbeatManager()->GetShardSplitLoad());
     buffer.Appendf("heartbeatExpireTimeout: %U\n", configServer->GetHeartbeatManager()->GetHeartbeatExpireTimeout());
     buffer.Appendf("numRoundsTriggerActivation: %U\n", configServer->GetActivationManager()->GetNumRoundsTriggerActivation());
     buffer.Appendf("activationTimeout: %U\n", configServer->GetActivationManager()->GetActivationTimeout());
     buffer.Appendf("shardSplitCooldownTime: %U\n", configServer->GetHeartbeatManager()->GetShardSplitCooldownTime());
+    buffer.Appendf("balanceShards: %b\n", configServer->GetBalanceManager()->IsEnabled());
 
     session.Print(buffer);
     session.Flush();
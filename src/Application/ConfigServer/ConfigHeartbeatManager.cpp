@@ -17,10 +17,9 @@ void ConfigHeartbeatManager::Init(ConfigServer* configServer_)
     EventLoop::Add(&heartbeatTimeout);
     
     shardSplitSize = configFile.GetIntValue("shardSplitSize", DEFAULT_SHARD_SPLIT_SIZE);
+    shardSplitLoad = configFile.GetIntValue("shardSplitLoad", DEFAULT_SHARD_SPLIT_LOAD);
     heartbeatExpireTimeout = configFile.GetIntValue("heartbeatExpireTimeout", HEARTBEAT_EXPIRE_TIME);
     shardSplitCooldownTime = configFile.GetIntValue("shardSplitCooldownTime", SPLIT_COOLDOWN_TIME);
-
-    lastSplitTime = 0;
 }
 
 void ConfigHeartbeatManager::Shutdown()
@@ -38,6 +37,16 @@ uint64_t ConfigHeartbeatManager::GetShardSplitSize()
     return shardSplitSize;
 }
 
+void ConfigHeartbeatManager::SetShardSplitLoad(uint64_t shardSplitLoad_)
+{
+    shardSplitLoad = shardSplitLoad_;
+}
+
+uint64_t ConfigHeartbeatManager::GetShardSplitLoad()
+{
+    return shardSplitLoad;
+}
+
 void ConfigHeartbeatManager::SetHeartbeatExpireTimeout(uint64_t heartbeatExpireTimeout_)
 {
     heartbeatExpireTimeout = heartbeatExpireTimeout_;
@@ -212,6 +221,7 @@ void ConfigHeartbeatManager::TrySplitShardActions(ClusterMessage& message)
     bool                    isSplitCreating;
     uint64_t                now;
     uint64_t                newShardID;
+    ReadBuffer              splitKey;
     ConfigShardServer*      configShardServer;
     ConfigQuorum*           itQuorum;
     ConfigShard*            configShard;
@@ -222,9 +232,9 @@ void ConfigHeartbeatManager::TrySplitShardActions(ClusterMessage& message)
         return;
     
     // look for quorums where the sender of the message is the primary
-    // make sure there are no inactive nodes and no splitting going on
+    // make sure there are no inactive nodes and no splitting going on in the quorum
     // then look for shards that are located in this quorum and should be split
-    // but only one-at-a-time
+    // one-at-a-time in each quorum, but different quorums may split concurrently
     
     configShardServer = CONFIG_STATE->GetShardServer(message.nodeID);
     if (!configShardServer)
@@ -237,10 +247,9 @@ void ConfigHeartbeatManager::TrySplitShardActions(ClusterMessage& message)
         if (itQuorum->primaryID != message.nodeID)
             continue;
             
-        // TODO: tidy up
         newShardID = 0;
         isSplitCreating = IsSplitCreating(itQuorum, newShardID);
-        isSplitCreating |= configServer->GetDatabaseManager()->GetConfigState()->isSplitting;
+        isSplitCreating |= (itQuorum->splitShardID != 0);
         
         FOREACH (itQuorumShardInfo, message.quorumShardInfos)
         {
@@ -255,7 +264,7 @@ void ConfigHeartbeatManager::TrySplitShardActions(ClusterMessage& message)
             }
                 
             if (!isSplitCreating && itQuorumShardInfo->isSplitable &&
-             itQuorumShardInfo->shardSize > shardSplitSize &&
+             GetSplitKey(itQuorumShardInfo, splitKey) &&
              itQuorumShardInfo->shardID != CONFIG_STATE->migrateSrcShardID)
             {
                 // make sure another shard with the same splitKey doesn't already exist
@@ -266,14 +275,13 @@ void ConfigHeartbeatManager::TrySplitShardActions(ClusterMessage& message)
                 ASSERT(configTable != NULL);
                 if (configTable->isFrozen)
                     continue;
-                if (!configServer->GetDatabaseManager()->ShardExists(
-                 configShard->tableID, ReadBuffer(itQuorumShardInfo->splitKey)))
+                if (!configServer->GetDatabaseManager()->ShardExists(configShard->tableID, splitKey))
                 {
-                    if (now > (lastSplitTime + shardSplitCooldownTime))
+                    if (now > (itQuorum->lastSplitTime + shardSplitCooldownTime))
                     {
                         configServer->GetQuorumProcessor()->TrySplitShardBegin(
-                            itQuorumShardInfo->shardID, ReadBuffer(itQuorumShardInfo->splitKey));
-                        lastSplitTime = now;
+                            itQuorumShardInfo->shardID, splitKey);
+                        itQuorum->lastSplitTime = now;
                     }
                     break;
                 }
@@ -299,10 +307,32 @@ void ConfigHeartbeatManager::TrySplitShardActions(ClusterMessage& message)
             configShard->isSplitable = itQuorumShardInfo->isSplitable;
             configShard->shardSize = itQuorumShardInfo->shardSize;
             configShard->splitKey.Write(itQuorumShardInfo->splitKey);
+            configShard->requestRate = itQuorumShardInfo->readRate + itQuorumShardInfo->writeRate;
+            configShard->bytesRate = itQuorumShardInfo->readBytesRate + itQuorumShardInfo->writeBytesRate;
         }
     }
 }
 
+bool ConfigHeartbeatManager::GetSplitKey(QuorumShardInfo* quorumShardInfo, ReadBuffer& splitKey)
+{
+    // large shards are split in the middle of their data,
+    // hot shards in the middle of their requests
+    if (quorumShardInfo->shardSize > shardSplitSize)
+    {
+        splitKey.Wrap(quorumShardInfo->splitKey);
+        return true;
+    }
+
+    if (shardSplitLoad > 0 && quorumShardInfo->loadSplitKey.GetLength() > 0 &&
+     quorumShardInfo->readRate + quorumShardInfo->writeRate > shardSplitLoad)
+    {
+        splitKey.Wrap(quorumShardInfo->loadSplitKey);
+        return true;
+    }
+
+    return false;
+}
+
 bool ConfigHeartbeatManager::IsSplitCreating(ConfigQuorum* configQuorum, uint64_t& newShardID)
 {
     uint64_t*           itShardID;
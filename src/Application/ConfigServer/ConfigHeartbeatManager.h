@@ -9,6 +9,7 @@ class Heartbeat;        // forward
 class ConfigServer;     // forward
 
 #define DEFAULT_SHARD_SPLIT_SIZE        500*MB
+#define DEFAULT_SHARD_SPLIT_LOAD        10000       // requests per sec
 
 /*
 ===============================================================================================
@@ -29,6 +30,9 @@ public:
     void                SetShardSplitSize(uint64_t shardSplitSize);
     uint64_t            GetShardSplitSize();
 
+    void                SetShardSplitLoad(uint64_t shardSplitLoad);
+    uint64_t            GetShardSplitLoad();
+
     void                SetHeartbeatExpireTimeout(uint64_t heartbeatExpireTimeout);
     uint64_t            GetHeartbeatExpireTimeout();
 
@@ -46,13 +50,14 @@ private:
     void                RegisterHeartbeat(uint64_t nodeID);
     void                TrySplitShardActions(ClusterMessage& message);
     bool                IsSplitCreating(ConfigQuorum* configQuorum, uint64_t& newShardID);
+    bool                GetSplitKey(QuorumShardInfo* quorumShardInfo, ReadBuffer& splitKey);
 
     ConfigServer*       configServer;
     HeartbeatList       heartbeats;
     Countdown           heartbeatTimeout;
     uint64_t            shardSplitSize;
+    uint64_t            shardSplitLoad;
     uint64_t            heartbeatExpireTimeout;
-    uint64_t            lastSplitTime;
     uint64_t            shardSplitCooldownTime;
 };
 
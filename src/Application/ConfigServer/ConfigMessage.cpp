@@ -214,6 +214,14 @@ bool ConfigMessage::SplitShardComplete(uint64_t shardID_)
     return true;
 }
 
+bool ConfigMessage::ShardMigrationBegin(uint64_t quorumID_, uint64_t shardID_)
+{
+    type = CONFIGMESSAGE_SHARD_MIGRATION_BEGIN;
+    quorumID = quorumID_;
+    shardID = shardID_;
+    return true;
+}
+
 bool ConfigMessage::ShardMigrationComplete(uint64_t quorumID_,
  uint64_t srcShardID_, uint64_t dstShardID_)
 {
@@ -134,6 +134,7 @@ public:
     bool            SplitShardBegin(uint64_t shardID, ReadBuffer& splitKey);
     bool            SplitShardComplete(uint64_t shardID);
     
+    bool            ShardMigrationBegin(uint64_t quorumID, uint64_t shardID);
     bool            ShardMigrationComplete(uint64_t quorumID,
                      uint64_t srcShardID, uint64_t dstShardID);
     
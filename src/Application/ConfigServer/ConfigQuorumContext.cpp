@@ -166,6 +166,11 @@ bool ConfigQuorumContext::AlwaysUseDatabaseCatchup()
     return true;
 }
 
+unsigned ConfigQuorumContext::GetPipelineDepth()
+{
+    return 1;
+}
+
 bool ConfigQuorumContext::IsPaxosBlocked()
 {
     return false;
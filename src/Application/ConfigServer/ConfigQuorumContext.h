@@ -56,6 +56,7 @@ public:
     virtual bool                    UseProposeTimeouts();
     virtual bool                    UseCommitChaining();
     virtual bool                    AlwaysUseDatabaseCatchup();
+    virtual unsigned                GetPipelineDepth();
     virtual bool                    IsPaxosBlocked();
     virtual Buffer&                 GetNextValue();
 
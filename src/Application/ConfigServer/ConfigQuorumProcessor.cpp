@@ -442,6 +442,25 @@ void ConfigQuorumProcessor::TryTruncateTableComplete(uint64_t tableID)
     TryAppend();
 }
 
+void ConfigQuorumProcessor::TryShardMigrationBegin(uint64_t quorumID, uint64_t shardID)
+{
+    ConfigMessage*  it;
+    ConfigMessage*  msg;
+
+    FOREACH (it, configMessages)
+    {
+        if (it->type == CONFIGMESSAGE_SHARD_MIGRATION_BEGIN)
+            return;
+    }
+
+    msg = new ConfigMessage;
+    msg->fromClient = false;    
+    msg->ShardMigrationBegin(quorumID, shardID);
+
+    configMessages.Append(msg);
+    TryAppend();
+}
+
 void ConfigQuorumProcessor::OnShardMigrationComplete(ClusterMessage& message)
 {
     ConfigMessage*  configMessage;
@@ -666,7 +685,6 @@ void ConfigQuorumProcessor::OnAppend(uint64_t paxosID, ConfigMessage& message, b
     else if (message.type == CONFIGMESSAGE_SPLIT_SHARD_COMPLETE)
     {
         Log_Message("Split shard process completed (new shardID = %U)...", message.shardID);
-        CONFIG_STATE->isSplitting = false;
     }
     
     if (IsMaster())
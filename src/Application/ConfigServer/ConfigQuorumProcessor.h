@@ -53,6 +53,7 @@ public:
     void                    TrySplitShardComplete(uint64_t shardID);
     void                    TryTruncateTableBegin(uint64_t tableID);
     void                    TryTruncateTableComplete(uint64_t tableID);
+    void                    TryShardMigrationBegin(uint64_t quorumID, uint64_t shardID);
     
     void                    OnShardMigrationComplete(ClusterMessage& message);
        
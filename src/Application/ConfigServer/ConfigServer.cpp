@@ -75,6 +75,7 @@ void ConfigServer::Init(ConfigServerApp* app)
     heartbeatManager.Init(this);
     primaryLeaseManager.Init(this);
     activationManager.Init(this);
+    balanceManager.Init(this);
     
     httpEndpoint.Set(configFile.GetValue("endpoint", ""));
     httpEndpoint.SetPort(configFile.GetIntValue("http.port", 8080));
@@ -121,6 +122,11 @@ ConfigActivationManager* ConfigServer::GetActivationManager()
     return &activationManager;
 }
 
+ConfigBalanceManager* ConfigServer::GetBalanceManager()
+{
+    return &balanceManager;
+}
+
 void ConfigServer::OnConfigStateChanged()
 {
     activationManager.UpdateTimeouts();
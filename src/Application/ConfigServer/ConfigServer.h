@@ -9,6 +9,7 @@
 #include "ConfigPrimaryLeaseManager.h"
 #include "ConfigHeartbeatManager.h"
 #include "ConfigActivationManager.h"
+#include "ConfigBalanceManager.h"
 
 #define BROADCAST_HTTP_ENDPOINT_DELAY        1000
 
@@ -37,6 +38,7 @@ public:
     ConfigHeartbeatManager*     GetHeartbeatManager();
     ConfigPrimaryLeaseManager*  GetPrimaryLeaseManager();
     ConfigActivationManager*    GetActivationManager();
+    ConfigBalanceManager*       GetBalanceManager();
 
     void                        OnConfigStateChanged();
     
@@ -72,6 +74,7 @@ private:
     ConfigHeartbeatManager      heartbeatManager;
     ConfigPrimaryLeaseManager   primaryLeaseManager;
     ConfigActivationManager     activationManager;
+    ConfigBalanceManager        balanceManager;
     List<uint64_t>              configServers;
     HashMap<uint64_t, Endpoint> httpEndpoints;
     Endpoint                    httpEndpoint;
@@ -371,6 +371,14 @@ void JSONConfigState::WriteQuorumShardInfo(QuorumShardInfo* info)
 
     JSON_NUMBER(info, shardID);
     json->PrintComma();
+    JSON_NUMBER(info, readRate);
+    json->PrintComma();
+    JSON_NUMBER(info, writeRate);
+    json->PrintComma();
+    JSON_NUMBER(info, readBytesRate);
+    json->PrintComma();
+    JSON_NUMBER(info, writeBytesRate);
+    json->PrintComma();
     JSON_BOOL(info, isSendingShard);
     
     if (info->isSendingShard)
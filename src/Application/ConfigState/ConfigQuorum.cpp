@@ -13,6 +13,8 @@ ConfigQuorum::ConfigQuorum()
     hasPrimary = false;
     primaryID = 0;
     paxosID = 0;
+    splitShardID = 0;
+    lastSplitTime = 0;
     ClearActivation();
 }
 
@@ -32,6 +34,8 @@ ConfigQuorum& ConfigQuorum::operator=(const ConfigQuorum& other)
     activatingNodeID = other.activatingNodeID;
     activationPaxosID = other.activationPaxosID;
     activationExpireTime = other.activationExpireTime;
+    splitShardID = other.splitShardID;
+    lastSplitTime = other.lastSplitTime;
     
     activeNodes = other.activeNodes;
     inactiveNodes = other.inactiveNodes;
@@ -50,6 +50,8 @@ public:
     uint64_t                activatingNodeID;
     uint64_t                activationPaxosID;          // not sent
     uint64_t                activationExpireTime;       // not sent
+    uint64_t                splitShardID;               // not sent
+    uint64_t                lastSplitTime;              // not sent
     
     bool                    hasPrimary;
     uint64_t                primaryID;
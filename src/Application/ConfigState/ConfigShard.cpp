@@ -8,6 +8,8 @@ ConfigShard::ConfigShard()
     parentShardID = 0;
     shardSize = 0;
     isSplitable = false;
+    requestRate = 0;
+    bytesRate = 0;
 }
 
 ConfigShard::ConfigShard(const ConfigShard& other)
@@ -31,6 +33,9 @@ ConfigShard& ConfigShard::operator=(const ConfigShard& other)
     shardSize = other.shardSize;
     splitKey = other.splitKey;
     isSplitable = other.isSplitable;
+
+    requestRate = other.requestRate;
+    bytesRate = other.bytesRate;
     
     prev = next = this;
     
@@ -40,6 +40,13 @@ public:
     Buffer          splitKey;
     bool            isSplitable;
 
+    // ========================================================================================
+    //
+    // load balancing, from the heartbeats, not sent
+
+    uint64_t        requestRate;    // reads and writes per sec
+    uint64_t        bytesRate;      // bytes read and written per sec
+
     // ========================================================================================
     
     
@@ -74,6 +74,10 @@ QuorumShardInfo::QuorumShardInfo()
     migrationBytesSent = 0;
     migrationBytesTotal = 0;
     migrationThroughput = 0;
+    readRate = 0;
+    writeRate = 0;
+    readBytesRate = 0;
+    writeBytesRate = 0;
 }
 
 bool QuorumShardInfo::ReadList(ReadBuffer& buffer, List<QuorumShardInfo>& quorumShardInfos)
@@ -88,12 +92,15 @@ bool QuorumShardInfo::ReadList(ReadBuffer& buffer, List<QuorumShardInfo>& quorum
     buffer.Advance(read);
     for (i = 0; i < length; i++)
     {
-        read = buffer.Readf(":%U:%U:%U:%#B:%b:%b:%U:%U:%U:%U:%U",
+        read = buffer.Readf(":%U:%U:%U:%#B:%b:%b:%U:%U:%U:%U:%U:%U:%U:%U:%U:%#B",
          &quorumShardInfo.quorumID, &quorumShardInfo.shardID,
          &quorumShardInfo.shardSize, &quorumShardInfo.splitKey, &quorumShardInfo.isSplitable,
          &quorumShardInfo.isSendingShard, &quorumShardInfo.migrationQuorumID,
          &quorumShardInfo.migrationNodeID, &quorumShardInfo.migrationBytesSent,
-         &quorumShardInfo.migrationBytesTotal, &quorumShardInfo.migrationThroughput);
+         &quorumShardInfo.migrationBytesTotal, &quorumShardInfo.migrationThroughput,
+         &quorumShardInfo.readRate, &quorumShardInfo.writeRate,
+         &quorumShardInfo.readBytesRate, &quorumShardInfo.writeBytesRate,
+         &quorumShardInfo.loadSplitKey);
         if (read < 6)
             return false;
         buffer.Advance(read);
@@ -109,11 +116,13 @@ bool QuorumShardInfo::WriteList(Buffer& buffer, List<QuorumShardInfo>& quorumSha
     buffer.Appendf("%u", quorumShardInfos.GetLength());
     FOREACH (it, quorumShardInfos)
     {
-        buffer.Appendf(":%U:%U:%U:%#B:%b:%b:%U:%U:%U:%U:%U",
+        buffer.Appendf(":%U:%U:%U:%#B:%b:%b:%U:%U:%U:%U:%U:%U:%U:%U:%U:%#B",
          it->quorumID, it->shardID, it->shardSize, &it->splitKey, it->isSplitable,
          it->isSendingShard, it->migrationQuorumID,
          it->migrationNodeID, it->migrationBytesSent,
-         it->migrationBytesTotal, it->migrationThroughput);
+         it->migrationBytesTotal, it->migrationThroughput,
+         it->readRate, it->writeRate, it->readBytesRate, it->writeBytesRate,
+         &it->loadSplitKey);
     }
     
     return true;
@@ -59,6 +59,12 @@ public:
     uint64_t            migrationBytesSent;
     uint64_t            migrationBytesTotal;
     uint64_t            migrationThroughput;
+
+    uint64_t            readRate;
+    uint64_t            writeRate;
+    uint64_t            readBytesRate;
+    uint64_t            writeBytesRate;
+    Buffer              loadSplitKey;
             
     static bool         ReadList(ReadBuffer& buffer, List<QuorumShardInfo>& quorumShardInfos);
     static bool         WriteList(Buffer& buffer, List<QuorumShardInfo>& quorumShardInfos);
@@ -60,8 +60,6 @@ ConfigState& ConfigState::operator=(const ConfigState& other)
     masterID = other.masterID;
     paxosID = other.paxosID;
     
-    isSplitting = other.isSplitting;
-    
     isMigrating = other.isMigrating;
     migrateQuorumID = other.migrateQuorumID;
     migrateSrcShardID = other.migrateSrcShardID;
@@ -100,8 +98,6 @@ void ConfigState::Init()
     masterID = 0;
     paxosID = 0;
     
-    isSplitting = false;
-    
     isMigrating = false;
     migrateQuorumID = 0;
     migrateSrcShardID = 0;
@@ -129,7 +125,6 @@ void ConfigState::Transfer(ConfigState& other)
     other.masterID = masterID;
     other.paxosID = paxosID;
     
-    other.isSplitting = isSplitting;
     
     other.isMigrating = isMigrating;
     other.migrateQuorumID = migrateQuorumID;
@@ -947,10 +942,11 @@ bool ConfigState::CompleteSplitShardBegin(ConfigMessage& message)
     if (ReadBuffer::Cmp(shard->lastKey, message.splitKey) == 0)
         return false;
     
-    if (isSplitting)
+    // one split at a time in a quorum
+    if (quorum->splitShardID != 0)
         return false;
     
-    isSplitting = true;
+    quorum->splitShardID = shard->shardID;
 
     return true;
 }
@@ -1442,7 +1438,11 @@ void ConfigState::OnSplitShardBegin(ConfigMessage& message)
     if (!parentShard)
     {
         // table has been deleted or truncated
-        isSplitting = false;
+        FOREACH (quorum, quorums)
+        {
+            if (quorum->splitShardID == message.shardID)
+                quorum->splitShardID = 0;
+        }
         return;
     }
     
@@ -1469,11 +1469,16 @@ void ConfigState::OnSplitShardBegin(ConfigMessage& message)
 
 void ConfigState::OnSplitShardComplete(ConfigMessage& message)
 {
-    ConfigShard* shard;
+    ConfigShard*    shard;
+    ConfigQuorum*   quorum;
 
     shard = GetShard(message.shardID);
     ASSERT(shard != NULL);
     shard->state = CONFIG_SHARD_STATE_NORMAL;
+
+    quorum = GetQuorum(shard->quorumID);
+    if (quorum != NULL)
+        quorum->splitShardID = 0;
 }
 
 void ConfigState::OnShardMigrationBegin(ConfigMessage& /*message*/)
@@ -47,8 +47,6 @@ public:
     uint64_t            masterID;
     uint64_t            paxosID;
     
-    bool                isSplitting;    
-
     bool                isMigrating;
     uint64_t            migrateSrcShardID;
     uint64_t            migrateDstShardID;
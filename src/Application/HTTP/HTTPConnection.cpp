@@ -21,6 +21,7 @@ void HTTPConnection::Init(HTTPServer* server_)
     request.Init();
     socket.GetEndpoint(endpoint);
     onCloseCallback.Unset();
+    onWriteReadyCallback.Unset();
     contentType.Reset();
     origin.Reset();
     
@@ -33,6 +34,11 @@ void HTTPConnection::SetOnClose(const Callable& callable)
     onCloseCallback = callable;
 }
 
+void HTTPConnection::SetOnWriteReady(const Callable& callable)
+{
+    onWriteReadyCallback = callable;
+}
+
 void HTTPConnection::SetContentType(ReadBuffer& contentType_)
 {
     contentType = contentType_;
@@ -93,6 +99,12 @@ void HTTPConnection::OnWrite()
         OnClose();
 }
 
+void HTTPConnection::OnWriteReadyness()
+{
+    if (onWriteReadyCallback.IsSet() && !closeAfterSend)
+        Call(onWriteReadyCallback);
+}
+
 void HTTPConnection::Print(const char* s)
 {
     Write(s, (unsigned) strlen(s));
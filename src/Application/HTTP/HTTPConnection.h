@@ -21,6 +21,7 @@ public:
     
     void                Init(HTTPServer* server_);
     void                SetOnClose(const Callable& callable);
+    void                SetOnWriteReady(const Callable& callable);
     void                SetContentType(ReadBuffer& contentType);
     void                SetOrigin(ReadBuffer& origin);
 
@@ -40,9 +41,11 @@ public:
     virtual void        OnRead();
     virtual void        OnClose();
     virtual void        OnWrite();
+    virtual void        OnWriteReadyness();
 
 protected:
     Callable            onCloseCallback;
+    Callable            onWriteReadyCallback;
     HTTPServer*         server;
     HTTPRequest         request;
     Endpoint            endpoint;
@@ -206,6 +206,15 @@ void HTTPSession::Flush(bool closeAfterSend)
         isFlushed = true;
 }
 
+// sends what was printed so far, the response is continued
+void HTTPSession::FlushPartial()
+{
+    if (!conn)
+        return;
+
+    conn->Flush(false);
+}
+
 void HTTPSession::SetType(Type type_)
 {
     const char* mime;
@@ -75,6 +75,7 @@ public:
     void                PrintPair(const ReadBuffer& key, const ReadBuffer& value);
     void                PrintPair(const char* key, const char* value);
     void                Flush(bool closeAfterSend = true);
+    void                FlushPartial();
     void                SetType(Type type);
 
     bool                IsFlushed();
@@ -16,6 +16,8 @@ SDBPConnection::SDBPConnection()
     context = NULL;
     numPending = 0;
     numCompleted = 0;
+    binaryProtocol = false;
+    overloadedResponse = false;
     autoFlush = false;
     onKeepAlive.SetCallable(MFUNC(SDBPConnection, OnKeepAlive));
     onKeepAlive.SetDelay(0);
@@ -36,6 +38,8 @@ void SDBPConnection::Init(SDBPServer* server_)
     ClientSession::Init();
     
     numCompleted = 0;
+    binaryProtocol = false;
+    overloadedResponse = false;
     connectTimestamp = NowClock();
     server = server_;
     
@@ -43,6 +47,10 @@ void SDBPConnection::Init(SDBPServer* server_)
     Log_Message("[%s] Client connected", remoteEndpoint.ToString());
     
     resp.Hello();
+    if (configFile.GetBoolValue("sdbp.binaryProtocol", true))
+        resp.number = SDBP_PROTOCOL_VERSION;
+    else
+        resp.number = SDBP_PROTOCOL_VERSION_TEXT;
     sdbpResponse.response = &resp;
     Write(sdbpResponse);
     Flush();
@@ -67,7 +75,26 @@ bool SDBPConnection::OnMessage(ReadBuffer& msg)
     request = REQUEST_CACHE->CreateRequest();
     request->session = this;
     sdbpRequest.request = request;
-    if (!sdbpRequest.Read(msg) || !context->IsValidClientRequest(request))
+    if (!sdbpRequest.Read(msg))
+    {
+        REQUEST_CACHE->DeleteRequest(request);
+        OnClose();
+        return true;
+    }
+
+    if (!binaryProtocol && SDBPRequestMessage::IsBinary(msg))
+    {
+        Log_Debug("[%s] Client switched to binary protocol", remoteEndpoint.ToString());
+        binaryProtocol = true;
+    }
+
+    if (!overloadedResponse && sdbpRequest.overloaded)
+        overloadedResponse = true;
+
+    if (request->IsMulti())
+        return OnMultiRequest(sdbpRequest, request);
+
+    if (!context->IsValidClientRequest(request))
     {
         REQUEST_CACHE->DeleteRequest(request);
         OnClose();
@@ -75,7 +102,9 @@ bool SDBPConnection::OnMessage(ReadBuffer& msg)
     }
 
     numPending++;
+    server->OnRequestBegin(this, 1);
     context->OnClientRequest(request);
+    UpdateReadActive();
     return false;
 }
 
@@ -89,6 +118,12 @@ void SDBPConnection::OnWrite()
     MessageConnection::OnWrite();
 }
 
+void SDBPConnection::OnWriteReadyness()
+{
+    if (state == TCPConnection::CONNECTED)
+        context->OnClientWriteReady(this);
+}
+
 void SDBPConnection::OnClose()
 {
     uint64_t    elapsed;
@@ -101,6 +136,13 @@ void SDBPConnection::OnClose()
     Log_Message("[%s] Client disconnected (active: %u seconds, served: %u requests)", 
      remoteEndpoint.ToString(), (unsigned)(elapsed / 1000.0 + 0.5), numCompleted);
     
+    // a closed connection no longer counts as paused
+    if (!IsReadActive())
+    {
+        ResumeRead();
+        server->OnReadResumed(this);
+    }
+
     context->OnClientClose(this);
     MessageConnection::Close();
     
@@ -115,8 +157,17 @@ void SDBPConnection::OnComplete(ClientRequest* request, bool last)
 {
     SDBPResponseMessage sdbpResponse;
 
+    if (request->parent != NULL)
+    {
+        OnMultiItemComplete(request);
+        return;
+    }
+
     if (last)
+    {
         numPending--;
+        server->OnRequestEnd(this);
+    }
 
     if (state == TCPConnection::CONNECTED &&
      request->response.type != CLIENTRESPONSE_NORESPONSE &&
@@ -124,10 +175,12 @@ void SDBPConnection::OnComplete(ClientRequest* request, bool last)
       TCPConnection::GetWriteBuffer().GetLength() > SDBP_MAX_QUEUED_BYTES))
     {
         sdbpResponse.response = &request->response;
+        sdbpResponse.binary = binaryProtocol;
+        sdbpResponse.overloaded = overloadedResponse;
         Write(sdbpResponse);
         // TODO: HACK
         if (TCPConnection::GetWriteBuffer().GetLength() >= MESSAGING_BUFFER_THRESHOLD || last ||
-         request->type == CLIENTREQUEST_GET_CONFIG_STATE)
+         request->type == CLIENTREQUEST_GET_CONFIG_STATE || request->IsList())
             Flush();
     }
 
@@ -152,6 +205,36 @@ bool SDBPConnection::IsActive()
     return true;
 }
 
+void SDBPConnection::UpdateReadActive()
+{
+    if (state != TCPConnection::CONNECTED)
+        return;
+
+    if (server->IsOverLimit(this, numPending))
+    {
+        if (IsReadActive())
+        {
+            Log_Debug("[%s] Client read paused, requests in flight: %u",
+             remoteEndpoint.ToString(), numPending);
+            PauseRead();
+            server->OnReadPaused(this);
+        }
+    }
+    else if (!IsReadActive())
+    {
+        ResumeRead();
+        server->OnReadResumed(this);
+    }
+}
+
+bool SDBPConnection::IsWriteReady()
+{
+    if (state != TCPConnection::CONNECTED)
+        return true;
+
+    return (TCPConnection::GetWriteBuffer().GetLength() <= SDBP_MAX_QUEUED_BYTES);
+}
+
 void SDBPConnection::UseKeepAlive(bool useKeepAlive)
 {
     if (useKeepAlive && configFile.GetIntValue("sdbp.keepAliveTimeout", keepAliveTimeout) > 0)
@@ -166,6 +249,89 @@ void SDBPConnection::UseKeepAlive(bool useKeepAlive)
     }
 }
 
+bool SDBPConnection::OnMultiRequest(SDBPRequestMessage& sdbpRequest, ClientRequest* request)
+{
+    unsigned        i;
+    unsigned        numItems;
+    ClientRequest*  item;
+
+    request->items = new ClientRequest*[request->numItems];
+    for (i = 0; i < request->numItems; i++)
+    {
+        item = REQUEST_CACHE->CreateRequest();
+        item->session = this;
+        item->parent = request;
+        request->items[i] = item;
+        if (!sdbpRequest.ReadMultiItem(item) || !context->IsValidClientRequest(item))
+        {
+            DeleteMultiRequest(request, i + 1);
+            OnClose();
+            return true;
+        }
+    }
+
+    // the request is deleted when its last item completes, which may happen synchronously
+    numItems = request->numItems;
+    numPending += numItems;
+    server->OnRequestBegin(this, numItems);
+    for (i = 0; i < numItems; i++)
+        context->OnClientRequest(request->items[i]);
+    UpdateReadActive();
+
+    return false;
+}
+
+void SDBPConnection::OnMultiItemComplete(ClientRequest* item)
+{
+    unsigned            i;
+    ClientRequest*      request;
+    SDBPResponseMessage sdbpResponse;
+
+    numPending--;
+    numCompleted++;
+    server->OnRequestEnd(this);
+
+    request = item->parent;
+    request->numCompletedItems++;
+    if (request->numCompletedItems < request->numItems)
+        return;
+
+    if (state == TCPConnection::CONNECTED)
+    {
+        for (i = 0; i < request->numItems; i++)
+        {
+            if (request->items[i]->response.type == CLIENTRESPONSE_NORESPONSE)
+                request->items[i]->response.Failed();
+        }
+
+        request->response.Multi();
+        sdbpResponse.response = &request->response;
+        sdbpResponse.binary = binaryProtocol;
+        sdbpResponse.overloaded = overloadedResponse;
+        Write(sdbpResponse);
+        Flush();
+    }
+
+    DeleteMultiRequest(request, request->numItems);
+
+    if (numPending == 0 && state == DISCONNECTED)
+    {
+        Log_Message("[%s] Connection deleted", remoteEndpoint.ToString());
+        server->DeleteConn(this);
+    }
+}
+
+void SDBPConnection::DeleteMultiRequest(ClientRequest* request, unsigned numItems)
+{
+    unsigned    i;
+
+    for (i = 0; i < numItems; i++)
+        REQUEST_CACHE->DeleteRequest(request->items[i]);
+    delete[] request->items;
+    request->items = NULL;
+    REQUEST_CACHE->DeleteRequest(request);
+}
+
 void SDBPConnection::OnKeepAlive()
 {
     Log_Message("[%s] Keep alive timeout occured", remoteEndpoint.ToString());
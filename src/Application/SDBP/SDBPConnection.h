@@ -10,12 +10,30 @@
 class SDBPContext;
 class SDBPServer;
 class ClientRequest;
+class SDBPRequestMessage;
 
 /*
 ===============================================================================================
 
  SDBPConnection
 
+ The hello message announces the binary protocol, unless it is disabled with
+ sdbp.binaryProtocol. Clients that understand it switch to binary requests, and once
+ a binary request arrives, responses on the connection are also written in binary.
+ Old clients never send one, so they keep talking the text protocol. Likewise, requests
+ are shed with OVERLOADED only once the client flagged that it understands it, older
+ clients get NOSERVICE instead.
+
+ The items of a multi-key request are handed to the context as separate requests,
+ so each key is routed to its own shard and quorum. Their responses are held back
+ until all items complete, then written as one packed response.
+
+ Partial LIST responses are flushed as they arrive. The list is paused while more than
+ SDBP_MAX_QUEUED_BYTES wait to be sent, and continues when the write completes.
+
+ Reading from the socket is paused while the server's in-flight limits are exceeded,
+ see SDBPServer.
+
 ===============================================================================================
 */
 
@@ -38,6 +56,8 @@ public:
     // Must override OnClose() to prevent the default behaviour, which is to call Close(),
     // in case numPendingOps > 0
     void                OnClose();
+    // Called when a write completed, lets paused list requests continue
+    void                OnWriteReadyness();
     // ========================================================================================
 
     // ========================================================================================
@@ -45,12 +65,20 @@ public:
     //
     virtual void        OnComplete(ClientRequest* request, bool last);
     virtual bool        IsActive();
+    virtual bool        IsWriteReady();
     // ========================================================================================
 
     void                UseKeepAlive(bool useKeepAlive);
     void                OnKeepAlive();
 
+    // Pauses or resumes reading according to the in-flight limits of the server
+    void                UpdateReadActive();
+
 private:
+    bool                OnMultiRequest(SDBPRequestMessage& sdbpRequest, ClientRequest* request);
+    void                OnMultiItemComplete(ClientRequest* item);
+    void                DeleteMultiRequest(ClientRequest* request, unsigned numItems);
+
     SDBPServer*         server;
     SDBPContext*        context;
     Countdown           onKeepAlive;
@@ -58,6 +86,8 @@ private:
     unsigned            numPending;
     unsigned            numCompleted;
     uint64_t            connectTimestamp;
+    bool                binaryProtocol;
+    bool                overloadedResponse;
 };
 
 #endif
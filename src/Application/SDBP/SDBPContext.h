@@ -22,6 +22,7 @@ public:
     virtual bool    IsValidClientRequest(ClientRequest* request)                            = 0;
     virtual void    OnClientRequest(ClientRequest* request)                                 = 0;
     virtual void    OnClientClose(ClientSession* session)                                   = 0;
+    virtual void    OnClientWriteReady(ClientSession* /*session*/)                          {}
 };
 
 #endif
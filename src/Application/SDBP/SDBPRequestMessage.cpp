@@ -1,4 +1,173 @@
 #include "SDBPRequestMessage.h"
+#include "System/Buffers/Varint.h"
+
+// fields of the binary format, written in this order after the commandID
+#define FIELD_NODEID            0x00001
+#define FIELD_NAME              0x00002
+#define FIELD_NODES             0x00004
+#define FIELD_DATABASEID        0x00008
+#define FIELD_QUORUMID          0x00010
+#define FIELD_SHARDID           0x00020
+#define FIELD_CONFIGPAXOSID     0x00040
+#define FIELD_TABLEID           0x00080
+#define FIELD_PAXOSID           0x00100
+#define FIELD_KEY               0x00200
+#define FIELD_ENDKEY            0x00400
+#define FIELD_PREFIX            0x00800
+#define FIELD_TEST              0x01000
+#define FIELD_VALUE             0x02000
+#define FIELD_NUMBER            0x04000
+#define FIELD_SEQUENCE          0x08000
+#define FIELD_COUNT             0x10000
+#define FIELD_DIRECTION         0x20000
+#define FIELD_VERSION           0x40000
+
+#define FIELDS_DATA             (FIELD_CONFIGPAXOSID | FIELD_TABLEID | FIELD_KEY)
+#define FIELDS_RANGE            (FIELDS_DATA | FIELD_ENDKEY | FIELD_PREFIX | FIELD_DIRECTION)
+
+static bool GetBinaryFields(char type, unsigned& fields)
+{
+    switch (type)
+    {
+        /* Master query */
+        case CLIENTREQUEST_GET_MASTER:
+        case CLIENTREQUEST_GET_CONFIG_STATE:
+            fields = 0;
+            return true;
+
+        /* Shard servers */
+        case CLIENTREQUEST_UNREGISTER_SHARDSERVER:
+        case CLIENTREQUEST_ACTIVATE_SHARDSERVER:
+            fields = FIELD_NODEID;
+            return true;
+
+        /* Quorum management */
+        case CLIENTREQUEST_CREATE_QUORUM:
+            fields = FIELD_NAME | FIELD_NODES;
+            return true;
+        case CLIENTREQUEST_RENAME_QUORUM:
+            fields = FIELD_QUORUMID | FIELD_NAME;
+            return true;
+        case CLIENTREQUEST_DELETE_QUORUM:
+            fields = FIELD_QUORUMID;
+            return true;
+        case CLIENTREQUEST_ADD_SHARDSERVER_TO_QUORUM:
+        case CLIENTREQUEST_REMOVE_SHARDSERVER_FROM_QUORUM:
+            fields = FIELD_QUORUMID | FIELD_NODEID;
+            return true;
+
+        /* Database management */
+        case CLIENTREQUEST_CREATE_DATABASE:
+            fields = FIELD_NAME;
+            return true;
+        case CLIENTREQUEST_RENAME_DATABASE:
+            fields = FIELD_DATABASEID | FIELD_NAME;
+            return true;
+        case CLIENTREQUEST_DELETE_DATABASE:
+        case CLIENTREQUEST_FREEZE_DATABASE:
+        case CLIENTREQUEST_UNFREEZE_DATABASE:
+            fields = FIELD_DATABASEID;
+            return true;
+        case CLIENTREQUEST_SPLIT_SHARD:
+            fields = FIELD_SHARDID | FIELD_KEY;
+            return true;
+        case CLIENTREQUEST_MIGRATE_SHARD:
+            fields = FIELD_QUORUMID | FIELD_SHARDID;
+            return true;
+
+        /* Table management */
+        case CLIENTREQUEST_CREATE_TABLE:
+            fields = FIELD_DATABASEID | FIELD_QUORUMID | FIELD_NAME;
+            return true;
+        case CLIENTREQUEST_RENAME_TABLE:
+            fields = FIELD_TABLEID | FIELD_NAME;
+            return true;
+        case CLIENTREQUEST_DELETE_TABLE:
+        case CLIENTREQUEST_TRUNCATE_TABLE:
+        case CLIENTREQUEST_FREEZE_TABLE:
+        case CLIENTREQUEST_UNFREEZE_TABLE:
+            fields = FIELD_TABLEID;
+            return true;
+
+        /* Data operations */
+        case CLIENTREQUEST_GET:
+            fields = FIELDS_DATA | FIELD_PAXOSID;
+            return true;
+        case CLIENTREQUEST_SET:
+        case CLIENTREQUEST_SET_IF_NOT_EXISTS:
+        case CLIENTREQUEST_GET_AND_SET:
+        case CLIENTREQUEST_APPEND:
+            fields = FIELDS_DATA | FIELD_VALUE;
+            return true;
+        case CLIENTREQUEST_TEST_AND_SET:
+            fields = FIELDS_DATA | FIELD_TEST | FIELD_VALUE;
+            return true;
+        case CLIENTREQUEST_TEST_AND_DELETE:
+            fields = FIELDS_DATA | FIELD_TEST;
+            return true;
+        case CLIENTREQUEST_SET_IF_VERSION:
+            fields = FIELDS_DATA | FIELD_VALUE | FIELD_VERSION;
+            return true;
+        case CLIENTREQUEST_DELETE_IF_VERSION:
+            fields = FIELDS_DATA | FIELD_VERSION;
+            return true;
+        case CLIENTREQUEST_ADD:
+            fields = FIELDS_DATA | FIELD_NUMBER;
+            return true;
+        case CLIENTREQUEST_DELETE:
+        case CLIENTREQUEST_REMOVE:
+        case CLIENTREQUEST_SEQUENCE_NEXT:
+            fields = FIELDS_DATA;
+            return true;
+        case CLIENTREQUEST_SEQUENCE_SET:
+            fields = FIELDS_DATA | FIELD_SEQUENCE;
+            return true;
+        case CLIENTREQUEST_LIST_KEYS:
+        case CLIENTREQUEST_LIST_KEYVALUES:
+            fields = FIELDS_RANGE | FIELD_COUNT;
+            return true;
+        case CLIENTREQUEST_COUNT:
+            fields = FIELDS_RANGE;
+            return true;
+
+        /* Transactions */
+        case CLIENTREQUEST_START_TRANSACTION:
+            fields = FIELD_CONFIGPAXOSID | FIELD_QUORUMID | FIELD_KEY;
+            return true;
+        case CLIENTREQUEST_COMMIT_TRANSACTION:
+        case CLIENTREQUEST_ROLLBACK_TRANSACTION:
+            fields = FIELD_QUORUMID;
+            return true;
+        case CLIENTREQUEST_START_OPTIMISTIC_TRANSACTION:
+            fields = FIELD_CONFIGPAXOSID | FIELD_QUORUMID;
+            return true;
+
+        default:
+            return false;
+    }
+}
+
+static inline bool DecodeBuffer(const char*& p, const char* end, Buffer& buffer)
+{
+    ReadBuffer  slice;
+
+    if (!DecodeSlice(p, end, slice))
+        return false;
+    buffer.Write(slice);
+    return true;
+}
+
+SDBPRequestMessage::SDBPRequestMessage()
+{
+    request = NULL;
+    binary = false;
+    overloaded = false;
+}
+
+bool SDBPRequestMessage::IsBinary(ReadBuffer& buffer)
+{
+    return (buffer.GetLength() > 0 && buffer.GetCharAt(0) == SDBP_BINARY_MARKER);
+}
 
 bool SDBPRequestMessage::Read(ReadBuffer& buffer)
 {
@@ -11,6 +180,18 @@ bool SDBPRequestMessage::Read(ReadBuffer& buffer)
     if (buffer.GetLength() < 1)
         return false;
     
+    overloaded = false;
+    if (IsBinary(buffer))
+    {
+        if (buffer.GetLength() > 1 &&
+         ClientRequest::GetMultiItemType(buffer.GetCharAt(1)) != CLIENTREQUEST_UNDEFINED)
+            return ReadMulti(buffer);
+        return ReadBinary(buffer);
+    }
+
+    if (ClientRequest::GetMultiItemType(buffer.GetCharAt(0)) != CLIENTREQUEST_UNDEFINED)
+        return ReadMulti(buffer);
+
     read = buffer.Readf("%c:", &transactional);
     if (read == 2 && transactional == CLIENTREQUEST_TRANSACTIONAL)
     {
@@ -168,6 +349,18 @@ bool SDBPRequestMessage::Read(ReadBuffer& buffer)
              &request->type, &request->commandID, &request->configPaxosID,
              &request->tableID, &request->key, &request->test);
             break;
+        case CLIENTREQUEST_SET_IF_VERSION:
+            read = buffer.Readf("%c:%U:%U:%U:%#B:%U:%U:%#B",
+             &request->type, &request->commandID, &request->configPaxosID,
+             &request->tableID, &request->key,
+             &request->versionPaxosID, &request->versionCommandID, &request->value);
+            break;
+        case CLIENTREQUEST_DELETE_IF_VERSION:
+            read = buffer.Readf("%c:%U:%U:%U:%#B:%U:%U",
+             &request->type, &request->commandID, &request->configPaxosID,
+             &request->tableID, &request->key,
+             &request->versionPaxosID, &request->versionCommandID);
+            break;
         case CLIENTREQUEST_ADD:
             read = buffer.Readf("%c:%U:%U:%U:%#B:%I",
              &request->type, &request->commandID, &request->configPaxosID,
@@ -219,6 +412,11 @@ bool SDBPRequestMessage::Read(ReadBuffer& buffer)
             read = buffer.Readf("%c:%U:%U",
              &request->type, &request->commandID, &request->quorumID);
             break;
+        case CLIENTREQUEST_START_OPTIMISTIC_TRANSACTION:
+            read = buffer.Readf("%c:%U:%U:%U",
+             &request->type, &request->commandID, &request->configPaxosID,
+             &request->quorumID);
+            break;
             
         default:
             return false;
@@ -231,6 +429,12 @@ bool SDBPRequestMessage::Write(Buffer& buffer)
 {
     uint64_t*   it;
     
+    if (request->IsMulti())
+        return WriteMulti(buffer);
+
+    if (binary)
+        return WriteBinary(buffer);
+
     if (request->transactional)
         buffer.Appendf("%c:", CLIENTREQUEST_TRANSACTIONAL);
 
@@ -387,6 +591,18 @@ bool SDBPRequestMessage::Write(Buffer& buffer)
              request->type, request->commandID, request->configPaxosID,
              request->tableID, &request->key, &request->test);
             return true;
+        case CLIENTREQUEST_SET_IF_VERSION:
+            buffer.Appendf("%c:%U:%U:%U:%#B:%U:%U:%#B",
+             request->type, request->commandID, request->configPaxosID,
+             request->tableID, &request->key,
+             request->versionPaxosID, request->versionCommandID, &request->value);
+            return true;
+        case CLIENTREQUEST_DELETE_IF_VERSION:
+            buffer.Appendf("%c:%U:%U:%U:%#B:%U:%U",
+             request->type, request->commandID, request->configPaxosID,
+             request->tableID, &request->key,
+             request->versionPaxosID, request->versionCommandID);
+            return true;
         case CLIENTREQUEST_SEQUENCE_SET:
             buffer.Appendf("%c:%U:%U:%U:%#B:%U",
              request->type, request->commandID, request->configPaxosID,
@@ -422,8 +638,292 @@ bool SDBPRequestMessage::Write(Buffer& buffer)
             buffer.Appendf("%c:%U:%U",
              request->type, request->commandID, request->quorumID);
             return true;            
+        case CLIENTREQUEST_START_OPTIMISTIC_TRANSACTION:
+            buffer.Appendf("%c:%U:%U:%U",
+             request->type, request->commandID, request->configPaxosID,
+             request->quorumID);
+            return true;
 
         default:
             return false;
     }
 }
+
+bool SDBPRequestMessage::ReadBinary(ReadBuffer& buffer)
+{
+    const char* p;
+    const char* end;
+    char        flags;
+    unsigned    fields;
+    uint64_t    i, numNodes, nodeID, u64;
+    bool        ret;
+
+    // marker, type, flags
+    if (buffer.GetLength() < 3)
+        return false;
+
+    p = buffer.GetBuffer() + 1;
+    end = buffer.GetBuffer() + buffer.GetLength();
+    request->type = *p++;
+    flags = *p++;
+    request->transactional = (flags & SDBP_BINARY_FLAG_TRANSACTIONAL) != 0;
+    overloaded = (flags & SDBP_BINARY_FLAG_OVERLOADED) != 0;
+
+    if (!GetBinaryFields(request->type, fields))
+        return false;
+
+    ret = DecodeVarint(p, end, request->commandID);
+    if (ret && (fields & FIELD_NODEID))
+        ret = DecodeVarint(p, end, request->nodeID);
+    if (ret && (fields & FIELD_NAME))
+        ret = DecodeBuffer(p, end, request->name);
+    if (ret && (fields & FIELD_NODES))
+    {
+        ret = DecodeVarint(p, end, numNodes);
+        for (i = 0; ret && i < numNodes; i++)
+        {
+            ret = DecodeVarint(p, end, nodeID);
+            request->nodes.Append(nodeID);
+        }
+    }
+    if (ret && (fields & FIELD_DATABASEID))
+        ret = DecodeVarint(p, end, request->databaseID);
+    if (ret && (fields & FIELD_QUORUMID))
+        ret = DecodeVarint(p, end, request->quorumID);
+    if (ret && (fields & FIELD_SHARDID))
+        ret = DecodeVarint(p, end, request->shardID);
+    if (ret && (fields & FIELD_CONFIGPAXOSID))
+        ret = DecodeVarint(p, end, request->configPaxosID);
+    if (ret && (fields & FIELD_TABLEID))
+        ret = DecodeVarint(p, end, request->tableID);
+    if (ret && (fields & FIELD_PAXOSID))
+        ret = DecodeVarint(p, end, request->paxosID);
+    if (ret && (fields & FIELD_KEY))
+        ret = DecodeBuffer(p, end, request->key);
+    if (ret && (fields & FIELD_ENDKEY))
+        ret = DecodeBuffer(p, end, request->endKey);
+    if (ret && (fields & FIELD_PREFIX))
+        ret = DecodeBuffer(p, end, request->prefix);
+    if (ret && (fields & FIELD_TEST))
+        ret = DecodeBuffer(p, end, request->test);
+    if (ret && (fields & FIELD_VALUE))
+        ret = DecodeBuffer(p, end, request->value);
+    if (ret && (fields & FIELD_NUMBER))
+    {
+        ret = DecodeVarint(p, end, u64);
+        request->number = ZigZagDecode(u64);
+    }
+    if (ret && (fields & FIELD_SEQUENCE))
+        ret = DecodeVarint(p, end, request->sequence);
+    if (ret && (fields & FIELD_COUNT))
+        ret = DecodeVarint(p, end, request->count);
+    if (ret && (fields & FIELD_DIRECTION))
+    {
+        ret = (p < end);
+        if (ret)
+            request->forwardDirection = (*p++ != 0);
+    }
+    if (ret && (fields & FIELD_VERSION))
+    {
+        ret = DecodeVarint(p, end, request->versionPaxosID) &&
+         DecodeVarint(p, end, request->versionCommandID);
+    }
+    if (ret && (flags & SDBP_BINARY_FLAG_FILTER))
+        ret = DecodeBuffer(p, end, request->filter);
+
+    return (ret && p == end);
+}
+
+bool SDBPRequestMessage::WriteBinary(Buffer& buffer)
+{
+    unsigned    fields;
+    uint64_t*   it;
+    char        flags;
+
+    if (!GetBinaryFields(request->type, fields))
+        return false;
+
+    buffer.Append(SDBP_BINARY_MARKER);
+    buffer.Append(request->type);
+    flags = 0;
+    if (request->transactional)
+        flags |= SDBP_BINARY_FLAG_TRANSACTIONAL;
+    if (request->filter.GetLength() > 0)
+        flags |= SDBP_BINARY_FLAG_FILTER;
+    if (overloaded)
+        flags |= SDBP_BINARY_FLAG_OVERLOADED;
+    buffer.Append(flags);
+    buffer.AppendVarint(request->commandID);
+
+    if (fields & FIELD_NODEID)
+        buffer.AppendVarint(request->nodeID);
+    if (fields & FIELD_NAME)
+        AppendSlice(buffer, request->name);
+    if (fields & FIELD_NODES)
+    {
+        buffer.AppendVarint(request->nodes.GetLength());
+        FOREACH (it, request->nodes)
+            buffer.AppendVarint(*it);
+    }
+    if (fields & FIELD_DATABASEID)
+        buffer.AppendVarint(request->databaseID);
+    if (fields & FIELD_QUORUMID)
+        buffer.AppendVarint(request->quorumID);
+    if (fields & FIELD_SHARDID)
+        buffer.AppendVarint(request->shardID);
+    if (fields & FIELD_CONFIGPAXOSID)
+        buffer.AppendVarint(request->configPaxosID);
+    if (fields & FIELD_TABLEID)
+        buffer.AppendVarint(request->tableID);
+    if (fields & FIELD_PAXOSID)
+        buffer.AppendVarint(request->paxosID);
+    if (fields & FIELD_KEY)
+        AppendSlice(buffer, request->key);
+    if (fields & FIELD_ENDKEY)
+        AppendSlice(buffer, request->endKey);
+    if (fields & FIELD_PREFIX)
+        AppendSlice(buffer, request->prefix);
+    if (fields & FIELD_TEST)
+        AppendSlice(buffer, request->test);
+    if (fields & FIELD_VALUE)
+        AppendSlice(buffer, request->value);
+    if (fields & FIELD_NUMBER)
+        buffer.AppendVarint(ZigZagEncode(request->number));
+    if (fields & FIELD_SEQUENCE)
+        buffer.AppendVarint(request->sequence);
+    if (fields & FIELD_COUNT)
+        buffer.AppendVarint(request->count);
+    if (fields & FIELD_DIRECTION)
+        buffer.Append((char) (request->forwardDirection ? 1 : 0));
+    if (fields & FIELD_VERSION)
+    {
+        buffer.AppendVarint(request->versionPaxosID);
+        buffer.AppendVarint(request->versionCommandID);
+    }
+    if (flags & SDBP_BINARY_FLAG_FILTER)
+        AppendSlice(buffer, request->filter);
+
+    return true;
+}
+
+bool SDBPRequestMessage::ReadMultiItem(ClientRequest* item)
+{
+    const char* p;
+    const char* end;
+    int         read;
+    bool        ret;
+
+    item->type = ClientRequest::GetMultiItemType(request->type);
+    item->configPaxosID = request->configPaxosID;
+    item->tableID = request->tableID;
+    item->paxosID = request->paxosID;
+
+    if (!binary)
+    {
+        if (item->type == CLIENTREQUEST_SET)
+            read = items.Readf(":%U:%#B:%#B", &item->commandID, &item->key, &item->value);
+        else
+            read = items.Readf(":%U:%#B", &item->commandID, &item->key);
+        if (read <= 0)
+            return false;
+        items.Advance(read);
+        return true;
+    }
+
+    p = items.GetBuffer();
+    end = items.GetBuffer() + items.GetLength();
+    ret = DecodeVarint(p, end, item->commandID) && DecodeBuffer(p, end, item->key);
+    if (ret && item->type == CLIENTREQUEST_SET)
+        ret = DecodeBuffer(p, end, item->value);
+    if (!ret)
+        return false;
+    items.Advance((unsigned) (p - items.GetBuffer()));
+    return true;
+}
+
+bool SDBPRequestMessage::ReadMulti(ReadBuffer& buffer)
+{
+    const char* p;
+    const char* end;
+    int         read;
+    uint64_t    numItems;
+
+    binary = IsBinary(buffer);
+    if (binary)
+    {
+        // marker, type, flags
+        if (buffer.GetLength() < 3)
+            return false;
+        p = buffer.GetBuffer() + 1;
+        end = buffer.GetBuffer() + buffer.GetLength();
+        request->type = *p++;
+        overloaded = (*p++ & SDBP_BINARY_FLAG_OVERLOADED) != 0;
+        if (!DecodeVarint(p, end, request->commandID) ||
+         !DecodeVarint(p, end, request->configPaxosID) ||
+         !DecodeVarint(p, end, request->tableID) ||
+         !DecodeVarint(p, end, request->paxosID) ||
+         !DecodeVarint(p, end, numItems))
+            return false;
+        items.Wrap((char*) p, (unsigned) (end - p));
+    }
+    else
+    {
+        read = buffer.Readf("%c:%U:%U:%U:%U:%U",
+         &request->type, &request->commandID, &request->configPaxosID,
+         &request->tableID, &request->paxosID, &numItems);
+        if (read <= 0)
+            return false;
+        items.Wrap(buffer.GetBuffer() + read, buffer.GetLength() - read);
+    }
+
+    // each item takes at least two bytes
+    if (numItems == 0 || numItems > SDBP_MULTI_MAX_ITEMS || numItems > items.GetLength())
+        return false;
+
+    request->numItems = (unsigned) numItems;
+    return true;
+}
+
+bool SDBPRequestMessage::WriteMulti(Buffer& buffer)
+{
+    unsigned        i;
+    ClientRequest*  item;
+    bool            withValue;
+
+    withValue = (request->type == CLIENTREQUEST_MULTI_SET);
+
+    if (!binary)
+    {
+        buffer.Appendf("%c:%U:%U:%U:%U:%u",
+         request->type, request->commandID, request->configPaxosID,
+         request->tableID, request->paxosID, request->numItems);
+        for (i = 0; i < request->numItems; i++)
+        {
+            item = request->items[i];
+            if (withValue)
+                buffer.Appendf(":%U:%#B:%#B", item->commandID, &item->key, &item->value);
+            else
+                buffer.Appendf(":%U:%#B", item->commandID, &item->key);
+        }
+        return true;
+    }
+
+    buffer.Append(SDBP_BINARY_MARKER);
+    buffer.Append(request->type);
+    buffer.Append((char) (overloaded ? SDBP_BINARY_FLAG_OVERLOADED : 0));
+    buffer.AppendVarint(request->commandID);
+    buffer.AppendVarint(request->configPaxosID);
+    buffer.AppendVarint(request->tableID);
+    buffer.AppendVarint(request->paxosID);
+    buffer.AppendVarint(request->numItems);
+    for (i = 0; i < request->numItems; i++)
+    {
+        item = request->items[i];
+        buffer.AppendVarint(item->commandID);
+        AppendSlice(buffer, item->key);
+        if (withValue)
+            AppendSlice(buffer, item->value);
+    }
+
+    return true;
+}
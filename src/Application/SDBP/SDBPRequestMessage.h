@@ -4,13 +4,65 @@
 #include "Framework/Messaging/Message.h"
 #include "Application/Common/ClientRequest.h"
 
+// protocol versions announced by the server in the hello message
+#define SDBP_PROTOCOL_VERSION_TEXT      1
+#define SDBP_PROTOCOL_VERSION_BINARY    2
+#define SDBP_PROTOCOL_VERSION_MULTI     3       // multi-key requests
+#define SDBP_PROTOCOL_VERSION_FILTER    4       // LIST filters
+#define SDBP_PROTOCOL_VERSION_OVERLOADED 5      // OVERLOADED responses
+#define SDBP_PROTOCOL_VERSION           SDBP_PROTOCOL_VERSION_OVERLOADED
+
+#define SDBP_MULTI_MAX_ITEMS            256
+
+// first byte of a binary encoded message, never a valid text message type
+#define SDBP_BINARY_MARKER              '\001'
+
+#define SDBP_BINARY_FLAG_TRANSACTIONAL  0x01
+#define SDBP_BINARY_FLAG_FILTER         0x02    // the ListFilter follows the fields
+#define SDBP_BINARY_FLAG_OVERLOADED     0x04    // the client understands OVERLOADED responses
+
+/*
+===============================================================================================
+
+ SDBPRequestMessage
+
+ Requests are encoded either as colon separated text, or in the binary format:
+ the marker byte, the type, a flags byte, then the fields of the request type as
+ varints and varint length prefixed byte strings. Read() accepts both formats,
+ the binary format is only written when the server announced it in the hello message.
+ The filter of LIST requests is only carried by the binary format. Clients set the
+ OVERLOADED flag once the server announced that version in the hello message.
+
+ Multi-key requests carry the table and consistency fields once, followed by the
+ items, each with its own commandID and key, and value for MULTI_SET. Read() leaves
+ the items in place, they are parsed into separate requests by ReadMultiItem().
+
+===============================================================================================
+*/
+
 class SDBPRequestMessage : public Message
 {
 public:
     ClientRequest*  request;
-    
+    bool            binary;
+    bool            overloaded;
+
+    SDBPRequestMessage();
+
+    static bool     IsBinary(ReadBuffer& buffer);
+
     bool            Read(ReadBuffer& buffer);
     bool            Write(Buffer& buffer);
+
+    bool            ReadMultiItem(ClientRequest* item);
+
+private:
+    bool            ReadBinary(ReadBuffer& buffer);
+    bool            WriteBinary(Buffer& buffer);
+    bool            ReadMulti(ReadBuffer& buffer);
+    bool            WriteMulti(Buffer& buffer);
+
+    ReadBuffer      items;
 };
 
 #endif
@@ -1,7 +1,16 @@
 #include "SDBPResponseMessage.h"
+#include "SDBPRequestMessage.h"
 #include "Application/Common/ClientRequest.h"
+#include "System/Buffers/Varint.h"
 #include "Version.h"
 
+SDBPResponseMessage::SDBPResponseMessage()
+{
+    response = NULL;
+    binary = false;
+    overloaded = false;
+}
+
 bool SDBPResponseMessage::Read(ReadBuffer& buffer)
 {
     int             read;
@@ -9,6 +18,13 @@ bool SDBPResponseMessage::Read(ReadBuffer& buffer)
     if (buffer.GetLength() < 1)
         return false;
     
+    if (SDBPRequestMessage::IsBinary(buffer))
+    {
+        if (buffer.GetLength() > 1 && buffer.GetCharAt(1) == CLIENTRESPONSE_MULTI)
+            return ReadMulti(buffer);
+        return ReadBinary(buffer);
+    }
+
     switch (buffer.GetCharAt(0))
     {
         case CLIENTRESPONSE_OK:
@@ -85,6 +101,7 @@ bool SDBPResponseMessage::Read(ReadBuffer& buffer)
         case CLIENTRESPONSE_NOSERVICE:
         case CLIENTRESPONSE_BADSCHEMA:
         case CLIENTRESPONSE_FAILED:
+        case CLIENTRESPONSE_OVERLOADED:
             read = buffer.Readf("%c:%U",
              &response->type, &response->commandID);
             break;
@@ -98,6 +115,8 @@ bool SDBPResponseMessage::Read(ReadBuffer& buffer)
              &response->type, &response->commandID, 
              &response->number, &response->value, &response->endKey);
             break;
+        case CLIENTRESPONSE_MULTI:
+            return ReadMulti(buffer);
         default:
             return false;
     }
@@ -107,6 +126,15 @@ bool SDBPResponseMessage::Read(ReadBuffer& buffer)
 
 bool SDBPResponseMessage::Write(Buffer& buffer)
 {
+    if (response->type == CLIENTRESPONSE_OVERLOADED && !overloaded)
+        response->NoService();
+
+    if (response->type == CLIENTRESPONSE_MULTI)
+        return WriteMulti(buffer);
+
+    if (binary && response->type != CLIENTRESPONSE_HELLO)
+        return WriteBinary(buffer);
+
     switch (response->type)
     {
         case CLIENTRESPONSE_OK:
@@ -148,12 +176,13 @@ bool SDBPResponseMessage::Write(Buffer& buffer)
         case CLIENTRESPONSE_NOSERVICE:
         case CLIENTRESPONSE_BADSCHEMA:
         case CLIENTRESPONSE_FAILED:
+        case CLIENTRESPONSE_OVERLOADED:
             buffer.Writef("%c:%U",
              response->type, response->request->commandID);
             return true;
         case CLIENTRESPONSE_HELLO:
             {
-                uint64_t    clientVersion = 1;
+                uint64_t    clientVersion = response->number;
                 uint64_t    commandID = 0;
                 Buffer      msg;
 
@@ -208,6 +237,12 @@ int SDBPResponseMessage::ReadOptionalParts(ReadBuffer buffer, int offset)
             case CLIENTRESPONSE_OPT_VALUE_CHANGED:
                 read = buffer.Readf(":%cb%b", &opt, &response->isConditionalSuccess);
                 break;
+            case CLIENTRESPONSE_OPT_VERSION_PAXOSID:
+                read = buffer.Readf(":%cU%U", &opt, &response->versionPaxosID);
+                break;
+            case CLIENTRESPONSE_OPT_VERSION_COMMANDID:
+                read = buffer.Readf(":%cU%U", &opt, &response->versionCommandID);
+                break;
             default:
                 // read any other message based on the type prefix
                 buffer.Advance(2);
@@ -245,4 +280,270 @@ void SDBPResponseMessage::WriteOptionalParts(Buffer& buffer)
         buffer.Appendf(":%cU%U", CLIENTRESPONSE_OPT_PAXOSID, response->paxosID);
     if (response->isConditionalSuccess)
         buffer.Appendf(":%cb%b", CLIENTRESPONSE_OPT_VALUE_CHANGED, response->isConditionalSuccess);
+    if (response->versionPaxosID > 0)
+    {
+        buffer.Appendf(":%cU%U", CLIENTRESPONSE_OPT_VERSION_PAXOSID, response->versionPaxosID);
+        buffer.Appendf(":%cU%U", CLIENTRESPONSE_OPT_VERSION_COMMANDID, response->versionCommandID);
+    }
+}
+
+bool SDBPResponseMessage::ReadBinary(ReadBuffer& buffer)
+{
+    const char*     p;
+    const char*     end;
+    char            flags;
+    uint64_t        u64;
+    unsigned        i;
+    bool            ret;
+    ReadBuffer*     keys;
+    ReadBuffer*     values;
+
+    // marker, type, flags
+    if (buffer.GetLength() < 3)
+        return false;
+
+    p = buffer.GetBuffer() + 1;
+    end = buffer.GetBuffer() + buffer.GetLength();
+    response->type = *p++;
+    flags = *p++;
+
+    ret = DecodeVarint(p, end, response->commandID);
+    if (ret && (flags & SDBP_BINARY_FLAG_PAXOSID))
+        ret = DecodeVarint(p, end, response->paxosID);
+    if (flags & SDBP_BINARY_FLAG_CONDITIONAL_SUCCESS)
+        response->isConditionalSuccess = true;
+    if (ret && (flags & SDBP_BINARY_FLAG_VERSION))
+    {
+        ret = DecodeVarint(p, end, response->versionPaxosID) &&
+         DecodeVarint(p, end, response->versionCommandID);
+    }
+    if (!ret)
+        return false;
+
+    switch (response->type)
+    {
+        case CLIENTRESPONSE_OK:
+        case CLIENTRESPONSE_NOSERVICE:
+        case CLIENTRESPONSE_BADSCHEMA:
+        case CLIENTRESPONSE_FAILED:
+        case CLIENTRESPONSE_OVERLOADED:
+            break;
+        case CLIENTRESPONSE_NUMBER:
+            ret = DecodeVarint(p, end, response->number);
+            break;
+        case CLIENTRESPONSE_SNUMBER:
+            ret = DecodeVarint(p, end, u64);
+            response->snumber = ZigZagDecode(u64);
+            break;
+        case CLIENTRESPONSE_VALUE:
+            ret = DecodeSlice(p, end, response->value);
+            break;
+        case CLIENTRESPONSE_LIST_KEYS:
+        case CLIENTRESPONSE_LIST_KEYVALUES:
+            if (!DecodeVarint(p, end, u64) || u64 > (uint64_t) (end - p))
+                return false;
+            response->numKeys = (unsigned) u64;
+            if (response->numKeys == 0)
+                break;
+            keys = new ReadBuffer[response->numKeys];
+            values = NULL;
+            if (response->type == CLIENTRESPONSE_LIST_KEYVALUES)
+                values = new ReadBuffer[response->numKeys];
+            for (i = 0; ret && i < response->numKeys; i++)
+            {
+                ret = DecodeSlice(p, end, keys[i]);
+                if (ret && values != NULL)
+                    ret = DecodeSlice(p, end, values[i]);
+            }
+            if (ret && values != NULL)
+                response->ListKeyValues(response->numKeys, keys, values);
+            else if (ret)
+                response->ListKeys(response->numKeys, keys);
+            delete[] keys;
+            delete[] values;
+            break;
+        case CLIENTRESPONSE_CONFIG_STATE:
+            // the config state keeps its own text encoding
+            buffer.Advance((unsigned) (p - buffer.GetBuffer()));
+            if (!response->configState.Get()->Read(buffer, true))
+            {
+                response->configState.Free();
+                return false;
+            }
+            return true;
+        case CLIENTRESPONSE_NEXT:
+            ret = DecodeVarint(p, end, response->number) &&
+             DecodeSlice(p, end, response->value) && DecodeSlice(p, end, response->endKey);
+            break;
+        default:
+            return false;
+    }
+
+    return (ret && p == end);
+}
+
+bool SDBPResponseMessage::WriteBinary(Buffer& buffer)
+{
+    char        flags;
+    unsigned    i;
+
+    flags = 0;
+    if (response->paxosID > 0)
+        flags |= SDBP_BINARY_FLAG_PAXOSID;
+    if (response->isConditionalSuccess)
+        flags |= SDBP_BINARY_FLAG_CONDITIONAL_SUCCESS;
+    if (response->versionPaxosID > 0)
+        flags |= SDBP_BINARY_FLAG_VERSION;
+
+    buffer.Clear();
+    buffer.Append(SDBP_BINARY_MARKER);
+    buffer.Append(response->type);
+    buffer.Append(flags);
+    buffer.AppendVarint(response->request->commandID);
+    if (flags & SDBP_BINARY_FLAG_PAXOSID)
+        buffer.AppendVarint(response->paxosID);
+    if (flags & SDBP_BINARY_FLAG_VERSION)
+    {
+        buffer.AppendVarint(response->versionPaxosID);
+        buffer.AppendVarint(response->versionCommandID);
+    }
+
+    switch (response->type)
+    {
+        case CLIENTRESPONSE_OK:
+        case CLIENTRESPONSE_NOSERVICE:
+        case CLIENTRESPONSE_BADSCHEMA:
+        case CLIENTRESPONSE_FAILED:
+        case CLIENTRESPONSE_OVERLOADED:
+            return true;
+        case CLIENTRESPONSE_NUMBER:
+            buffer.AppendVarint(response->number);
+            return true;
+        case CLIENTRESPONSE_SNUMBER:
+            buffer.AppendVarint(ZigZagEncode(response->snumber));
+            return true;
+        case CLIENTRESPONSE_VALUE:
+            AppendSlice(buffer, response->value);
+            return true;
+        case CLIENTRESPONSE_LIST_KEYS:
+            buffer.AppendVarint(response->numKeys);
+            for (i = 0; i < response->numKeys; i++)
+                AppendSlice(buffer, response->keys[i]);
+            return true;
+        case CLIENTRESPONSE_LIST_KEYVALUES:
+            buffer.AppendVarint(response->numKeys);
+            for (i = 0; i < response->numKeys; i++)
+            {
+                AppendSlice(buffer, response->keys[i]);
+                AppendSlice(buffer, response->values[i]);
+            }
+            return true;
+        case CLIENTRESPONSE_CONFIG_STATE:
+            return response->configState.Get()->Write(buffer, true);
+        case CLIENTRESPONSE_NEXT:
+            buffer.AppendVarint(response->number);
+            AppendSlice(buffer, response->value);
+            AppendSlice(buffer, response->endKey);
+            return true;
+        default:
+            return false;
+    }
+}
+
+bool SDBPResponseMessage::ReadMultiItem(ReadBuffer& item)
+{
+    const char* p;
+    const char* end;
+    int         read;
+
+    if (items.GetLength() == 0)
+        return false;
+
+    if (!binary)
+    {
+        read = items.Readf(":%#R", &item);
+        if (read <= 0)
+            return false;
+        items.Advance(read);
+        return true;
+    }
+
+    p = items.GetBuffer();
+    end = items.GetBuffer() + items.GetLength();
+    if (!DecodeSlice(p, end, item))
+        return false;
+    items.Advance((unsigned) (p - items.GetBuffer()));
+    return true;
+}
+
+bool SDBPResponseMessage::ReadMulti(ReadBuffer& buffer)
+{
+    const char* p;
+    const char* end;
+    int         read;
+    uint64_t    numItems;
+
+    binary = SDBPRequestMessage::IsBinary(buffer);
+    if (binary)
+    {
+        // marker, type, flags
+        if (buffer.GetLength() < 3)
+            return false;
+        p = buffer.GetBuffer() + 1;
+        end = buffer.GetBuffer() + buffer.GetLength();
+        response->type = *p++;
+        p++;
+        if (!DecodeVarint(p, end, response->commandID) || !DecodeVarint(p, end, numItems))
+            return false;
+        items.Wrap((char*) p, (unsigned) (end - p));
+    }
+    else
+    {
+        read = buffer.Readf("%c:%U:%U", &response->type, &response->commandID, &numItems);
+        if (read <= 0)
+            return false;
+        items.Wrap(buffer.GetBuffer() + read, buffer.GetLength() - read);
+    }
+
+    if (numItems > items.GetLength())
+        return false;
+    response->numKeys = (unsigned) numItems;
+    return true;
+}
+
+bool SDBPResponseMessage::WriteMulti(Buffer& buffer)
+{
+    unsigned            i;
+    ClientRequest*      request;
+    SDBPResponseMessage itemMessage;
+    Buffer              itemBuffer;
+
+    request = response->request;
+    if (binary)
+    {
+        buffer.Clear();
+        buffer.Append(SDBP_BINARY_MARKER);
+        buffer.Append(response->type);
+        buffer.Append((char) 0);
+        buffer.AppendVarint(request->commandID);
+        buffer.AppendVarint(request->numItems);
+    }
+    else
+        buffer.Writef("%c:%U:%u", response->type, request->commandID, request->numItems);
+
+    itemMessage.binary = binary;
+    itemMessage.overloaded = overloaded;
+    for (i = 0; i < request->numItems; i++)
+    {
+        itemBuffer.Clear();
+        itemMessage.response = &request->items[i]->response;
+        if (!itemMessage.Write(itemBuffer))
+            return false;
+        if (binary)
+            AppendSlice(buffer, itemBuffer);
+        else
+            buffer.Appendf(":%#B", &itemBuffer);
+    }
+
+    return true;
 }
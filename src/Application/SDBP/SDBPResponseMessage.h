@@ -4,16 +4,53 @@
 #include "Framework/Messaging/Message.h"
 #include "Application/Common/ClientResponse.h"
 
+#define SDBP_BINARY_FLAG_PAXOSID            0x01
+#define SDBP_BINARY_FLAG_CONDITIONAL_SUCCESS 0x02
+#define SDBP_BINARY_FLAG_VERSION            0x04
+
+/*
+===============================================================================================
+
+ SDBPResponseMessage
+
+ Responses use the same encoding as the request they answer: colon separated text,
+ or the binary format of SDBPRequestMessage, where a flags byte after the type replaces
+ the optional parts. The hello message is always written as text, because it is sent
+ before the client could announce anything.
+
+ OVERLOADED is written as NOSERVICE unless the client announced in its requests that
+ it understands it, as older clients do not know that response type.
+
+ The response of a multi-key request packs the responses of its items, each encoded
+ as a single response and length prefixed. ReadMultiItem() returns them one by one.
+
+===============================================================================================
+*/
+
 class SDBPResponseMessage : public Message
 {
 public:
     ClientResponse* response;
+    bool            binary;
+    bool            overloaded;
+
+    SDBPResponseMessage();
     
     bool            Read(ReadBuffer& buffer);
     bool            Write(Buffer& buffer);
     
     int             ReadOptionalParts(ReadBuffer buffer, int offset);
     void            WriteOptionalParts(Buffer& buffer);
+
+    bool            ReadMultiItem(ReadBuffer& item);
+
+private:
+    bool            ReadBinary(ReadBuffer& buffer);
+    bool            WriteBinary(Buffer& buffer);
+    bool            ReadMulti(ReadBuffer& buffer);
+    bool            WriteMulti(Buffer& buffer);
+
+    ReadBuffer      items;
 };
 
 #endif
@@ -7,6 +7,11 @@ void SDBPServer::Init(int port)
     if (!TCPServer<SDBPServer, SDBPConnection>::Init(port, true, CONN_BACKLOG))
         STOP_FAIL(1, "Cannot initialize SDBPServer");
     useKeepAlive = false;
+    maxRequests = 0;
+    maxSessionRequests = 0;
+    numRequests = 0;
+    numPausedConns = 0;
+    numReadPauses = 0;
 }
 
 void SDBPServer::Shutdown()
@@ -30,3 +35,89 @@ void SDBPServer::UseKeepAlive(bool useKeepAlive_)
 {
     useKeepAlive = useKeepAlive_;
 }
+
+void SDBPServer::SetMaxInFlightRequests(unsigned maxRequests_, unsigned maxSessionRequests_)
+{
+    maxRequests = maxRequests_;
+    maxSessionRequests = maxSessionRequests_;
+}
+
+void SDBPServer::OnRequestBegin(SDBPConnection* /*conn*/, unsigned numRequests_)
+{
+    numRequests += numRequests_;
+}
+
+void SDBPServer::OnRequestEnd(SDBPConnection* conn)
+{
+    ASSERT(numRequests > 0);
+    numRequests--;
+
+    conn->UpdateReadActive();
+
+    // the connections paused by the global limit continue together
+    if (numPausedConns > 0 && (maxRequests == 0 || numRequests < maxRequests))
+        ResumeConns();
+}
+
+bool SDBPServer::IsOverLimit(SDBPConnection* conn, unsigned numConnRequests)
+{
+    if (conn->IsTransactional())
+        return false;
+
+    if (maxSessionRequests > 0 && numConnRequests >= maxSessionRequests)
+        return true;
+
+    if (maxRequests > 0 && numRequests >= maxRequests)
+        return true;
+
+    return false;
+}
+
+void SDBPServer::OnReadPaused(SDBPConnection* /*conn*/)
+{
+    numPausedConns++;
+    numReadPauses++;
+}
+
+void SDBPServer::OnReadResumed(SDBPConnection* /*conn*/)
+{
+    ASSERT(numPausedConns > 0);
+    numPausedConns--;
+}
+
+unsigned SDBPServer::GetMaxInFlightRequests()
+{
+    return maxRequests;
+}
+
+unsigned SDBPServer::GetMaxSessionInFlightRequests()
+{
+    return maxSessionRequests;
+}
+
+unsigned SDBPServer::GetNumInFlightRequests()
+{
+    return numRequests;
+}
+
+unsigned SDBPServer::GetNumPausedConns()
+{
+    return numPausedConns;
+}
+
+uint64_t SDBPServer::GetNumReadPauses()
+{
+    return numReadPauses;
+}
+
+void SDBPServer::ResumeConns()
+{
+    SDBPConnection* conn;
+
+    FOREACH (conn, activeConns)
+    {
+        if (numPausedConns == 0)
+            break;
+        conn->UpdateReadActive();
+    }
+}
@@ -11,6 +11,12 @@ class SDBPContext; // forward
 
  SDBPServer
 
+ Counts the requests in flight on all connections. When a connection has more than
+ maxSessionRequests or the server has more than maxRequests in flight, the connection
+ stops reading the socket until enough requests complete. Transactional sessions are
+ never paused, as their requests are held until the commit arrives. Both limits are
+ off (0) by default.
+
 ===============================================================================================
 */
 
@@ -23,10 +29,30 @@ public:
     void            InitConn(SDBPConnection* conn);
     void            SetContext(SDBPContext* context);
     void            UseKeepAlive(bool useKeepAlive_);
+    void            SetMaxInFlightRequests(unsigned maxRequests, unsigned maxSessionRequests);
+
+    void            OnRequestBegin(SDBPConnection* conn, unsigned numRequests);
+    void            OnRequestEnd(SDBPConnection* conn);
+    bool            IsOverLimit(SDBPConnection* conn, unsigned numConnRequests);
+    void            OnReadPaused(SDBPConnection* conn);
+    void            OnReadResumed(SDBPConnection* conn);
+
+    unsigned        GetMaxInFlightRequests();
+    unsigned        GetMaxSessionInFlightRequests();
+    unsigned        GetNumInFlightRequests();
+    unsigned        GetNumPausedConns();
+    uint64_t        GetNumReadPauses();
 
 private:
+    void            ResumeConns();
+
     bool            useKeepAlive;
     SDBPContext*    context;
+    unsigned        maxRequests;
+    unsigned        maxSessionRequests;
+    unsigned        numRequests;
+    unsigned        numPausedConns;
+    uint64_t        numReadPauses;
 };
 
 #endif
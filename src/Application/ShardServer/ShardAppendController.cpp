@@ -0,0 +1,172 @@
+#include "ShardAppendController.h"
+#include "Application/Common/DatabaseConsts.h"
+#include "System/Config.h"
+
+#define EWMA(avg, sample)   ((avg) < 0 ? (sample) : ((avg) * 3 + (sample)) / 4)
+
+ShardAppendController::ShardAppendController()
+{
+    mode = SHARD_APPEND_MODE_LATENCY;
+    targetLatency = SHARD_APPEND_DEFAULT_TARGET_LATENCY;
+    limitDelay = 0;
+    maxBatchSize = SHARD_APPEND_MAX_BATCH_SIZE;
+    batchSize = DATABASE_REPLICATION_SIZE;
+    appendDelay = 0;
+    appendStart = 0;
+    appendSize = 0;
+    roundLatency = -1;
+    commitTime = -1;
+    costPerByte = -1;
+    bytesPerMessage = -1;
+}
+
+void ShardAppendController::Init()
+{
+    ReadBuffer  modeString;
+
+    modeString.Wrap(configFile.GetValue("replicationMode", ModeToString(mode)));
+    if (!StringToMode(modeString, mode))
+        Log_Message("Invalid replicationMode, using %s", ModeToString(mode));
+    
+    targetLatency = configFile.GetIntValue("replicationTargetLatency", SHARD_APPEND_DEFAULT_TARGET_LATENCY);
+    maxBatchSize = configFile.GetIntValue("replicationMaxBatchSize", SHARD_APPEND_MAX_BATCH_SIZE);
+    if (maxBatchSize < SHARD_APPEND_MIN_BATCH_SIZE)
+        maxBatchSize = SHARD_APPEND_MIN_BATCH_SIZE;
+}
+
+void ShardAppendController::SetMode(unsigned mode_)
+{
+    mode = mode_;
+}
+
+unsigned ShardAppendController::GetMode()
+{
+    return mode;
+}
+
+void ShardAppendController::SetTargetLatency(unsigned targetLatency_)
+{
+    targetLatency = targetLatency_;
+}
+
+unsigned ShardAppendController::GetTargetLatency()
+{
+    return targetLatency;
+}
+
+void ShardAppendController::SetReplicationLimit(unsigned replicationLimit)
+{
+    limitDelay = (unsigned)(replicationLimit == 0 ? 0 : 1000.0 / replicationLimit);
+}
+
+void ShardAppendController::OnAppendStart(uint64_t now, unsigned batchSize_, unsigned numMessages)
+{
+    appendStart = now;
+    appendSize = batchSize_;
+    if (numMessages > 0)
+        bytesPerMessage = EWMA(bytesPerMessage, (double) batchSize_ / numMessages);
+}
+
+void ShardAppendController::OnAppendComplete(uint64_t now, uint64_t commitTime_)
+{
+    double  round;
+
+    if (appendStart == 0)
+        return;     // not our append
+
+    round = (double) (now > appendStart ? now - appendStart : 0);
+    roundLatency = EWMA(roundLatency, round);
+    commitTime = EWMA(commitTime, (double) commitTime_);
+
+    // the part of the round which depends on the size of the batch
+    if (appendSize > 0 && round > commitTime)
+        costPerByte = EWMA(costPerByte, (round - commitTime) / appendSize);
+
+    appendStart = 0;
+}
+
+unsigned ShardAppendController::GetBatchSize()
+{
+    double  budget;
+
+    if (mode == SHARD_APPEND_MODE_THROUGHPUT)
+    {
+        batchSize = maxBatchSize;
+        return batchSize;
+    }
+
+    budget = targetLatency - (commitTime < 0 ? 0 : commitTime);
+    if (costPerByte <= 0 || budget <= 0)
+    {
+        // either no estimate yet, or the commit alone takes longer than the target,
+        // in which case small batches would only reduce throughput
+        batchSize = DATABASE_REPLICATION_SIZE;
+    }
+    else if (budget / costPerByte > DATABASE_REPLICATION_SIZE)
+        batchSize = DATABASE_REPLICATION_SIZE;
+    else if (budget / costPerByte < SHARD_APPEND_MIN_BATCH_SIZE)
+        batchSize = SHARD_APPEND_MIN_BATCH_SIZE;
+    else
+        batchSize = (unsigned) (budget / costPerByte);
+
+    return batchSize;
+}
+
+unsigned ShardAppendController::GetAppendDelay(unsigned queueLength)
+{
+    double      queuedBytes;
+    double      wait;
+
+    appendDelay = limitDelay;
+
+    if (mode == SHARD_APPEND_MODE_THROUGHPUT && roundLatency >= 0 && bytesPerMessage > 0)
+    {
+        // the delay is measured from the start of the previous append,
+        // wait about one more commit time when the queue would not fill a batch
+        queuedBytes = queueLength * bytesPerMessage;
+        if (queuedBytes < batchSize)
+        {
+            wait = roundLatency + commitTime;
+            if (wait > SHARD_APPEND_MAX_DELAY)
+                wait = SHARD_APPEND_MAX_DELAY;
+            if ((unsigned) wait > appendDelay)
+                appendDelay = (unsigned) wait;
+        }
+    }
+
+    return appendDelay;
+}
+
+unsigned ShardAppendController::GetLastAppendDelay()
+{
+    return appendDelay;
+}
+
+uint64_t ShardAppendController::GetRoundLatency()
+{
+    return roundLatency < 0 ? 0 : (uint64_t) roundLatency;
+}
+
+uint64_t ShardAppendController::GetCommitTime()
+{
+    return commitTime < 0 ? 0 : (uint64_t) commitTime;
+}
+
+const char* ShardAppendController::ModeToString(unsigned mode)
+{
+    if (mode == SHARD_APPEND_MODE_THROUGHPUT)
+        return "throughput";
+    return "latency";
+}
+
+bool ShardAppendController::StringToMode(ReadBuffer& str, unsigned& mode)
+{
+    if (ReadBuffer::Cmp(str, "latency") == 0)
+        mode = SHARD_APPEND_MODE_LATENCY;
+    else if (ReadBuffer::Cmp(str, "throughput") == 0)
+        mode = SHARD_APPEND_MODE_THROUGHPUT;
+    else
+        return false;
+
+    return true;
+}
@@ -0,0 +1,71 @@
+#ifndef SHARDAPPENDCONTROLLER_H
+#define SHARDAPPENDCONTROLLER_H
+
+#include "System/Buffers/ReadBuffer.h"
+
+#define SHARD_APPEND_MODE_LATENCY               0
+#define SHARD_APPEND_MODE_THROUGHPUT            1
+
+#define SHARD_APPEND_MIN_BATCH_SIZE             (16*KiB)
+#define SHARD_APPEND_MAX_BATCH_SIZE             (4*MB)
+#define SHARD_APPEND_DEFAULT_TARGET_LATENCY     (20)    // msec
+#define SHARD_APPEND_MAX_DELAY                  (50)    // msec
+
+/*
+===============================================================================================
+
+ ShardAppendController
+
+ Chooses the size of the next replicated batch and the delay before it is appended
+ from the measured round latency, commit time and queue depth.
+
+ In latency mode the batch is sized so that a round fits into the target latency, using
+ the per-byte cost of the previous rounds. In throughput mode batches are large, and when
+ the queue would not fill one, the append waits about a commit time to collect more.
+ The replicationLimit rate limit is always applied on top.
+
+===============================================================================================
+*/
+
+class ShardAppendController
+{
+public:
+    ShardAppendController();
+
+    void                    Init();
+
+    void                    SetMode(unsigned mode);
+    unsigned                GetMode();
+    void                    SetTargetLatency(unsigned targetLatency);
+    unsigned                GetTargetLatency();
+    void                    SetReplicationLimit(unsigned replicationLimit);
+
+    void                    OnAppendStart(uint64_t now, unsigned batchSize, unsigned numMessages);
+    void                    OnAppendComplete(uint64_t now, uint64_t commitTime);
+
+    unsigned                GetBatchSize();
+    unsigned                GetAppendDelay(unsigned queueLength);
+
+    unsigned                GetLastAppendDelay();
+    uint64_t                GetRoundLatency();
+    uint64_t                GetCommitTime();
+
+    static const char*      ModeToString(unsigned mode);
+    static bool             StringToMode(ReadBuffer& str, unsigned& mode);
+
+private:
+    unsigned                mode;
+    unsigned                targetLatency;
+    unsigned                limitDelay;
+    unsigned                maxBatchSize;
+    unsigned                batchSize;
+    unsigned                appendDelay;
+    uint64_t                appendStart;
+    unsigned                appendSize;
+    double                  roundLatency;
+    double                  commitTime;
+    double                  costPerByte;
+    double                  bytesPerMessage;
+};
+
+#endif
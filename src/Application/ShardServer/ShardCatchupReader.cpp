@@ -87,6 +87,36 @@ void ShardCatchupReader::OnDelete(CatchupMessage& msg)
     TryCommit();
 }
 
+void ShardCatchupReader::OnBatch(CatchupMessage& msg)
+{
+    char        type;
+    ReadBuffer  key;
+    ReadBuffer  value;
+
+    if (!batch.Read(msg.value))
+    {
+        Log_Message("Invalid catchup batch for shard %U", msg.shardID);
+        Abort();
+        return;
+    }
+
+    while (batch.Next(type, key, value))
+    {
+        if (type == KEYVALUEBATCH_SET)
+        {
+            environment->Set(QUORUM_DATABASE_DATA_CONTEXT, msg.shardID, key, value);
+            bytesReceived += key.GetLength() + value.GetLength();
+        }
+        else
+        {
+            environment->Delete(QUORUM_DATABASE_DATA_CONTEXT, msg.shardID, key);
+            bytesReceived += key.GetLength();
+        }
+    }
+
+    TryCommit();
+}
+
 void ShardCatchupReader::OnCommit(CatchupMessage& message)
 {
     ASSERT(isActive);
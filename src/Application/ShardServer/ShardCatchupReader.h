@@ -2,6 +2,7 @@
 #define SHARDCATCHUPREADER_H
 
 #include "Application/Common/CatchupMessage.h"
+#include "Application/Common/KeyValueBatch.h"
 #include "Framework/Storage/StorageEnvironment.h"
 
 class ShardQuorumProcessor;
@@ -32,6 +33,7 @@ public:
     void                    OnBeginShard(CatchupMessage& msg);
     void                    OnSet(CatchupMessage& msg);
     void                    OnDelete(CatchupMessage& msg);
+    void                    OnBatch(CatchupMessage& msg);
     void                    OnCommit(CatchupMessage& msg);
     void                    OnAbort(CatchupMessage& msg);
 
@@ -44,6 +46,7 @@ private:
     uint64_t                bytesReceived;
     uint64_t                prevBytesReceived;
     uint64_t                nextCommit;
+    KeyValueBatch           batch;
     ShardQuorumProcessor*   quorumProcessor;
     StorageEnvironment*     environment;
     Countdown               onTimeout;
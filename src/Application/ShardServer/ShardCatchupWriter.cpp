@@ -1,13 +1,17 @@
 #include "ShardCatchupWriter.h"
 #include "System/Events/EventLoop.h"
+#include "System/Config.h"
 #include "ShardQuorumProcessor.h"
 #include "ShardServer.h"
 #include "Framework/Replication/ReplicationConfig.h"
 
+#define SCHEDULER   (quorumProcessor->GetShardServer()->GetScheduler())
+
 ShardCatchupWriter::ShardCatchupWriter()
 {
     onTimeout.SetCallable(MFUNC(ShardCatchupWriter, OnTimeout));
     onTimeout.SetDelay(SHARD_CATCHUP_WRITER_DELAY);
+    onThrottle.SetCallable(MFUNC(ShardCatchupWriter, OnThrottle));
     onTryCommit.SetCallable(MFUNC(ShardCatchupWriter, OnTryCommit));
     writeReadyness.SetCallable(MFUNC(ShardCatchupWriter, OnWriteReadyness));
     Reset();
@@ -23,6 +27,8 @@ void ShardCatchupWriter::Init(ShardQuorumProcessor* quorumProcessor_)
 {
     quorumProcessor = quorumProcessor_;
     environment = quorumProcessor->GetShardServer()->GetDatabaseManager()->GetEnvironment();
+    batching = configFile.GetBoolValue("catchupBatching", true);
+    compression = configFile.GetBoolValue("catchupCompression", true);
     Reset();
 }
 
@@ -32,9 +38,12 @@ void ShardCatchupWriter::Reset()
     isActive = false;
     bytesSent = 0;
     startTime = 0;
+    deferStartTime = 0;
     prevBytesSent = 0;
+    batch.Clear();
     forwardShardIDs.Clear();
     EventLoop::Remove(&onTimeout);
+    EventLoop::Remove(&onThrottle);
 }
 
 bool ShardCatchupWriter::IsActive()
@@ -168,6 +177,8 @@ void ShardCatchupWriter::SendCommit()
     uint64_t paxosID;
     CatchupMessage msg;
     
+    SendBatch();
+
     paxosID = quorumProcessor->GetPaxosID() - 1;
     msg.Commit(paxosID);
     CONTEXT_TRANSPORT->SendQuorumMessage(nodeID, quorumID, msg);
@@ -188,39 +199,15 @@ void ShardCatchupWriter::SendCommit()
 
 void ShardCatchupWriter::SendFirst()
 {
-    CatchupMessage      msg;
-    ReadBuffer          key;
-    ReadBuffer          value;
-
     ASSERT(quorumProcessor->GetConfigQuorum()->shards.GetLength() > 0);
     shardID = *(quorumProcessor->GetConfigQuorum()->shards.First());
 
-    ASSERT(cursor == NULL);
-    cursor = environment->GetBulkCursor(QUORUM_DATABASE_DATA_CONTEXT, shardID);
-    cursor->SetOnBlockShard(MFUNC(ShardCatchupWriter, OnBlockShard), MFUNC(ShardCatchupWriter, OnUnblockShard));
-    ASSERT(cursor != NULL);
-
-    msg.BeginShard(shardID);
-    CONTEXT_TRANSPORT->SendQuorumMessage(nodeID, quorumID, msg);
-
-
-    // send first KV
-    kv = cursor->First();
-    if (kv == NULL)
-    {
-        SendNext();
-        return;
-    }
-
-    TransformKeyValue(kv, msg);
-    CONTEXT_TRANSPORT->SendQuorumMessage(nodeID, quorumID, msg);
-    Log_Debug("Sending BEGIN SHARD %U", shardID);
+    SendBeginShard();
 }
 
 void ShardCatchupWriter::SendNext()
 {
     uint64_t*           itShardID;
-    CatchupMessage      msg;
 
     ASSERT(cursor != NULL);
     if (kv != NULL)
@@ -228,16 +215,25 @@ void ShardCatchupWriter::SendNext()
         kv = cursor->Next(kv);
         if (kv)
         {
-            TransformKeyValue(kv, msg);
-            CONTEXT_TRANSPORT->SendQuorumMessage(nodeID, quorumID, msg);
+            SendKeyValue(kv);
             return;
         }
     }
 
+    // the receiver would miss the keys that could not be read
+    if (cursor->HasReadError())
+    {
+        Log_Message("Unable to read shard %U for catchup", shardID);
+        Abort();
+        return;
+    }
+
     // kv is NULL, at end of current shard
     delete cursor;
     cursor = NULL;
     
+    // the batch must arrive before the forwarded writes of the shard
+    SendBatch();
     forwardShardIDs.Add(shardID);
     itShardID = NextShard();
     
@@ -249,8 +245,16 @@ void ShardCatchupWriter::SendNext()
 
     shardID = *itShardID;
 
-    cursor = quorumProcessor->GetShardServer()->GetDatabaseManager()->GetEnvironment()->GetBulkCursor(
-     QUORUM_DATABASE_DATA_CONTEXT, shardID);
+    SendBeginShard();
+}
+
+void ShardCatchupWriter::SendBeginShard()
+{
+    CatchupMessage      msg;
+
+    ASSERT(cursor == NULL);
+    cursor = environment->GetBulkCursor(QUORUM_DATABASE_DATA_CONTEXT, shardID);
+    ASSERT(cursor != NULL);
     cursor->SetOnBlockShard(MFUNC(ShardCatchupWriter, OnBlockShard), MFUNC(ShardCatchupWriter, OnUnblockShard));
 
     msg.BeginShard(shardID);
@@ -265,13 +269,69 @@ void ShardCatchupWriter::SendNext()
         return;
     }
     
-    TransformKeyValue(kv, msg);
+    SendKeyValue(kv);
+}
+
+void ShardCatchupWriter::SendKeyValue(StorageKeyValue* kv)
+{
+    CatchupMessage  msg;
+
+    if (!batching)
+    {
+        TransformKeyValue(kv, msg);
+        CONTEXT_TRANSPORT->SendQuorumMessage(nodeID, quorumID, msg);
+        return;
+    }
+
+    if (kv->GetType() == STORAGE_KEYVALUE_TYPE_SET)
+    {
+        batch.Set(kv->GetKey(), kv->GetValue());
+        bytesSent += kv->GetKey().GetLength() + kv->GetValue().GetLength();
+    }
+    else
+    {
+        batch.Delete(kv->GetKey());
+        bytesSent += kv->GetKey().GetLength();
+    }
+
+    if (batch.GetSize() >= MESSAGING_BUFFER_THRESHOLD)
+        SendBatch();
+}
+
+void ShardCatchupWriter::SendBatch()
+{
+    CatchupMessage  msg;
+    ReadBuffer      block;
+
+    if (batch.GetNumItems() == 0)
+        return;
+
+    batch.Write(batchBuffer, compression);
+    block.Wrap(batchBuffer);
+    msg.Batch(shardID, block);
     CONTEXT_TRANSPORT->SendQuorumMessage(nodeID, quorumID, msg);
+    batch.Clear();
 }
 
 void ShardCatchupWriter::OnWriteReadyness()
 {
-    uint64_t bytesBegin;
+    uint64_t    bytesBegin;
+
+    if (onThrottle.IsActive())
+        return;
+
+    if (SCHEDULER->IsDeferred(SHARD_SCHEDULER_CATCHUP))
+    {
+        if (deferStartTime == 0)
+            deferStartTime = Now();
+        onThrottle.SetDelay(SHARD_SCHEDULER_DEFER_DELAY);
+        EventLoop::Add(&onThrottle);
+        return;
+    }
+
+    SCHEDULER->OnQueueDelay(SHARD_SCHEDULER_CATCHUP, deferStartTime > 0 ? Now() - deferStartTime : 0);
+    deferStartTime = 0;
+    ShardSchedulerSlice slice(SCHEDULER, SHARD_SCHEDULER_CATCHUP);
 
     bytesBegin = bytesSent;
 
@@ -283,6 +343,14 @@ void ShardCatchupWriter::OnWriteReadyness()
             break;
         SendNext();
     }
+
+    SendBatch();
+}
+
+void ShardCatchupWriter::OnThrottle()
+{
+    if (isActive)
+        OnWriteReadyness();
 }
 
 uint64_t* ShardCatchupWriter::NextShard()
@@ -6,6 +6,7 @@
 #include "Framework/Storage/StorageBulkCursor.h"
 #include "Application/Common/CatchupMessage.h"
 #include "Application/Common/ContextTransport.h"
+#include "Application/Common/KeyValueBatch.h"
 
 
 class ShardQuorumProcessor; // forward
@@ -19,6 +20,9 @@ class ShardMessage;         // forward
 
  ShardCatchupWriter
 
+ If catchupBatching is enabled, the key-values are sent in BATCH messages, which are
+ compressed if catchupCompression is enabled.
+
 ===============================================================================================
 */
 
@@ -49,7 +53,11 @@ public:
 private:
     void                    SendFirst();
     void                    SendNext();
+    void                    SendBeginShard();
+    void                    SendKeyValue(StorageKeyValue* kv);
+    void                    SendBatch();
     void                    OnWriteReadyness();
+    void                    OnThrottle();
     uint64_t*               NextShard();
     void                    TransformKeyValue(StorageKeyValue* kv, CatchupMessage& msg);
     void                    OnTimeout();
@@ -60,13 +68,19 @@ private:
     uint64_t                shardID;
     uint64_t                bytesSent;
     uint64_t                startTime;
+    uint64_t                deferStartTime;
     uint64_t                prevBytesSent;
+    bool                    batching;
+    bool                    compression;
+    KeyValueBatch           batch;
+    Buffer                  batchBuffer;
     List<uint64_t>          forwardShardIDs;
     ShardQuorumProcessor*   quorumProcessor;
     StorageEnvironment*     environment;
     StorageBulkCursor*      cursor;
     StorageKeyValue*        kv;
     Countdown               onTimeout;
+    Countdown               onThrottle;
     YieldTimer              onTryCommit;
     WriteReadyness          writeReadyness;
 };
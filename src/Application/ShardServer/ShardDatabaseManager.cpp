@@ -6,10 +6,12 @@
 #include "Framework/Replication/ReplicationConfig.h"
 #include "Framework/Storage/StoragePageCache.h"
 #include "Framework/Storage/StorageListPageCache.h"
+#include "System/Buffers/Varint.h"
 
 #define SHARD_MIGRATION_WRITER  (shardServer->GetShardMigrationWriter())
 #define LOCK_MANAGER            (shardServer->GetTransactionManager()->GetLockManager())
 #define WAITQUEUE_MANAGER       (shardServer->GetTransactionManager()->GetWaitQueueManager())
+#define SCHEDULER               (shardServer->GetScheduler())
 
 static void WriteValue(
 Buffer &buffer, uint64_t paxosID, uint64_t commandID, ReadBuffer userValue)
@@ -29,11 +31,58 @@ ReadBuffer& buffer, uint64_t& paxosID, uint64_t& commandID, ReadBuffer& userValu
         ASSERT_FAIL();
 }
 
+static void AppendReadVersion(
+Buffer& buffer, uint64_t shardID, ReadBuffer key, uint64_t paxosID, uint64_t commandID)
+{
+    buffer.AppendVarint(shardID);
+    AppendSlice(buffer, key);
+    buffer.AppendVarint(paxosID);
+    buffer.AppendVarint(commandID);
+}
+
 static size_t Hash(uint64_t h)
 {
     return h;
 }
 
+/*
+===============================================================================================
+
+ ShardDatabaseListFilter
+
+===============================================================================================
+*/
+
+bool ShardDatabaseListFilter::Match(const ReadBuffer& key, ReadBuffer& value)
+{
+    ReadBuffer  storedValue;
+    ReadBuffer  userValue;
+    uint64_t    paxosID;
+    uint64_t    commandID;
+    unsigned    projected;
+
+    // KEY lists may not read the values
+    if (value.GetLength() == 0)
+        return listFilter.Match(key, value);
+
+    storedValue = value;
+    if (storedValue.Readf("%U:%U:%R", &paxosID, &commandID, &userValue) < 4)
+        return false;
+
+    if (!listFilter.Match(key, userValue))
+        return false;
+
+    projected = userValue.GetLength();
+    listFilter.Project(userValue);
+    value.SetLength(value.GetLength() - (projected - userValue.GetLength()));
+    return true;
+}
+
+bool ShardDatabaseListFilter::IsValueNeeded()
+{
+    return listFilter.IsValueNeeded();
+}
+
 /*
 ===============================================================================================
 
@@ -72,33 +121,57 @@ ShardDatabaseSequence::ShardDatabaseSequence()
 ===============================================================================================
 */
 
+ShardDatabaseAsyncGet::ShardDatabaseAsyncGet(ShardDatabaseManager* manager_)
+{
+    manager = manager_;
+    request = NULL;
+    shardID = 0;
+    active = false;
+    async = false;
+    done = false;
+
+    next = prev = this;
+}
+
 void ShardDatabaseAsyncGet::OnRequestComplete()
 {
     uint64_t        paxosID;
     uint64_t        commandID;
     ReadBuffer      userValue;
 
-    active = false;
-
+    // a missing key is read with version 0
+    paxosID = 0;
+    commandID = 0;
+    if (failed)
+        Log_Message("Unable to read value of key %R in shard %U from the value log", &key, shardID);
     if (!ret || !request->session->IsActive())
     {
         if (!request->session->IsActive())
             request->response.NoResponse();
         else
             request->response.Failed();
-            
+    }
+    else
+    {
+        ReadValue(value, paxosID, commandID, userValue);    
+        request->response.Value(userValue);
+        request->response.SetVersion(paxosID, commandID);
+    }
+
+    // the versions read by an optimistic transaction are checked when it commits
+    if (request->transactional && request->session->IsOptimistic() && request->session->IsActive())
+        AppendReadVersion(request->session->readVersions, shardID, key, paxosID, commandID);
+
+    manager->shardServer->GetLoadTracker()->OnRead(shardID, key, userValue.GetLength());
+
+    // nonblocking GET, completed synchronously
+    if (!active)
+    {
         request->OnComplete();
-        if (async && !manager->executeReads.IsActive())
-            EventLoop::Add(&manager->executeReads);
         return;
     }
-    
-    ReadValue(value, paxosID, commandID, userValue);    
-    request->response.Value(userValue);
-    request->OnComplete();
 
-    if (async && !manager->executeReads.IsActive())
-        EventLoop::Add(&manager->executeReads);
+    manager->OnAsyncGetComplete(this);
 }
 
 
@@ -115,10 +188,16 @@ ShardDatabaseAsyncList::ShardDatabaseAsyncList(ShardDatabaseManager* manager_)
     manager = manager_;
     request = NULL;
     total = 0;
+    pauseTimeout.SetCallable(MFUNC(ShardDatabaseAsyncList, OnPauseTimeout));
 
     next = prev = this;
 }
 
+ShardDatabaseAsyncList::~ShardDatabaseAsyncList()
+{
+    EventLoop::Remove(&pauseTimeout);
+}
+
 void ShardDatabaseAsyncList::SetRequest(ClientRequest* request_)
 {
     request = request_;
@@ -139,6 +218,11 @@ void ShardDatabaseAsyncList::OnShardComplete()
     ReadBuffer*             values;
     unsigned                numKeys;
     unsigned                i;
+    ShardScheduler*         scheduler;
+
+    // merging the results runs as a slice of the lists
+    scheduler = manager->shardServer->GetScheduler();
+    ShardSchedulerSlice     slice(scheduler, SHARD_SCHEDULER_LIST);
 
     // possibly an error happened or already disconnected
     if (!lastResult || !request || !request->IsActive())
@@ -148,6 +232,15 @@ void ShardDatabaseAsyncList::OnShardComplete()
         return;
     }
 
+    // the keys that could not be read are not skipped, the list fails
+    if (HasReadError())
+    {
+        Log_Message("List[%U] unable to read values of shard %U from the value log",
+         requestID, shard->GetShardID());
+        OnRequestComplete();
+        return;
+    }
+
     Log_Debug("List[%U] OnShardComplete, final: %b", requestID, lastResult->final);
 
     numKeys = lastResult->numKeys;
@@ -190,18 +283,36 @@ void ShardDatabaseAsyncList::OnShardComplete()
     if (lastResult->final && request->count != 0 && total == request->count)
     {
         Log_Debug("List[%U] OnShardComplete count found", requestID);
+        if (keepCursor)
+            manager->AddListCursor(DetachCursor(), request->session, shard->GetContextID(), shard->GetShardID());
         OnRequestComplete();
         return;
     }
 
     if (lastResult->final)
         TryNextShard();
+    else if (!request->session->IsWriteReady())
+    {
+        // the list is continued by ContinueList() or OnPauseTimeout()
+        pauseTimeout.SetDelay(manager->listPauseTimeout);
+        EventLoop::Reset(&pauseTimeout);
+    }
+    else if (scheduler->IsDeferred(SHARD_SCHEDULER_LIST))
+    {
+        // the other classes are behind, the list is continued by OnPauseTimeout()
+        pauseTimeout.SetDelay(SHARD_SCHEDULER_DEFER_DELAY);
+        EventLoop::Reset(&pauseTimeout);
+    }
+    else
+        Continue();
 }
 
 void ShardDatabaseAsyncList::OnRequestComplete()
 {
     uint64_t    number;
     
+    EventLoop::Remove(&pauseTimeout);
+
     number = total;
     
     // reset async list variables
@@ -226,7 +337,8 @@ void ShardDatabaseAsyncList::OnRequestComplete()
     // already disconnected
     if (!request)
     {
-        manager->inactiveAsyncLists.Append(this);
+        if (lastResult->final)
+            manager->inactiveAsyncLists.Append(this);
         goto ActivateExecuteList;
     }
     
@@ -237,10 +349,22 @@ void ShardDatabaseAsyncList::OnRequestComplete()
         request->response.NoResponse();
         request->OnComplete();
         request = NULL;
-        manager->inactiveAsyncLists.Append(this);
+        // the list is still merging, it becomes inactive with the final result
+        if (lastResult->final)
+            manager->inactiveAsyncLists.Append(this);
         goto ActivateExecuteList;        
     }
 
+    // the merge stopped at the value that could not be read
+    if (lastResult->final && HasReadError())
+    {
+        request->response.Failed();
+        request->OnComplete(true);
+        request = NULL;
+        manager->inactiveAsyncLists.Append(this);
+        goto ActivateExecuteList;
+    }
+
     // send final message
     if (lastResult->final)
     {
@@ -287,6 +411,13 @@ void ShardDatabaseAsyncList::TryNextShard()
         return;
     }
 
+    // check if the next shard is past endKey, e.g. a sub-scan of a parallel range scan
+    if (forwardDirection && endKey.GetLength() > 0 && ReadBuffer::Cmp(rbShardLastKey, endKey) >= 0)
+    {
+        OnRequestComplete();
+        return;
+    }
+
     // send COUNT partial result
     if (request->type == CLIENTREQUEST_COUNT)
     {
@@ -320,6 +451,21 @@ bool ShardDatabaseAsyncList::IsActive()
     return false;
 }
 
+void ShardDatabaseAsyncList::ContinueList(ClientSession* session)
+{
+    if (request != NULL && request->session == session)
+    {
+        EventLoop::Remove(&pauseTimeout);
+        Continue();
+    }
+}
+
+void ShardDatabaseAsyncList::OnPauseTimeout()
+{
+    Log_Debug("List[%U] continuing paused list", requestID);
+    Continue();
+}
+
 /*
 ===============================================================================================
 
@@ -332,6 +478,7 @@ ShardDatabaseManager::ShardDatabaseManager()
 {
     executeReads.SetCallable(MFUNC(ShardDatabaseManager, OnExecuteReads));
     executeLists.SetCallable(MFUNC(ShardDatabaseManager, OnExecuteLists));
+    listCursorTimer.SetCallable(MFUNC(ShardDatabaseManager, OnListCursorTimeout));
 }
 
 void ShardDatabaseManager::Init(ShardServer* shardServer_)
@@ -352,6 +499,7 @@ void ShardDatabaseManager::Init(ShardServer* shardServer_)
     sc.SetAbortWaitingListsNum( (uint64_t) configFile.GetInt64Value("database.abortWaitingListsNum",	0       ));
     sc.SetListDataPageCacheSize((uint64_t) configFile.GetInt64Value("database.listDataPageCacheSize",   64*MB   ));
     sc.SetMaxChunkPerShard(     (unsigned) configFile.GetIntValue  ("database.maxChunkPerShard",        10      ));
+    sc.SetMaxOpenChunkFiles(    (unsigned) configFile.GetIntValue  ("database.maxOpenChunkFiles",       STORAGE_DEFAULT_MAX_OPEN_CHUNK_FILES));
 
     envPath.Writef("%s", configFile.GetValue("database.dir", "db"));
     environment.Open(envPath, sc);
@@ -371,9 +519,19 @@ void ShardDatabaseManager::Init(ShardServer* shardServer_)
     systemShard.Init(&environment, QUORUM_DATABASE_SYSTEM_CONTEXT, 1);
     REPLICATION_CONFIG->Init(&systemShard);
     
-    // Initialize async GET
-    asyncGet.active = false;
-    asyncGet.manager = this;
+    // Initialize async GET operations
+    numAsyncGets = configFile.GetIntValue("database.asyncGetDepth", 16);
+    if (numAsyncGets < 1)
+        numAsyncGets = 1;
+    asyncGetSessionDepth = configFile.GetIntValue("database.asyncGetSessionDepth", 4);
+    if (asyncGetSessionDepth < 1)
+        asyncGetSessionDepth = 1;
+    asyncGets = new ShardDatabaseAsyncGet*[numAsyncGets];
+    for (unsigned i = 0; i < numAsyncGets; i++)
+    {
+        asyncGets[i] = new ShardDatabaseAsyncGet(this);
+        inactiveAsyncGets.Append(asyncGets[i]);
+    }
 
     // Initialize async LIST operations
     numAsyncLists = configFile.GetIntValue("database.numAsyncThreads", 10);
@@ -384,11 +542,25 @@ void ShardDatabaseManager::Init(ShardServer* shardServer_)
         inactiveAsyncLists.Append(asyncLists[i]);
     }
 
+    // Size of the partial results of a list, 0 sends them without flow control
+    listBatchSize = configFile.GetIntValue("database.listBatchSize", 64*KiB);
+    listPauseTimeout = configFile.GetIntValue("database.listPauseTimeout", 1000);
+
+    // Initialize list cursors, timeout is in msec, 0 disables them
+    listCursorTimeout = configFile.GetIntValue("database.listCursorTimeout", 10000);
+    maxListCursors = configFile.GetIntValue("database.maxListCursors", 1000);
+    maxListCursorsPerSession = configFile.GetIntValue("database.maxListCursorsPerSession", 4);
+    if (maxListCursors == 0 || maxListCursorsPerSession == 0)
+        listCursorTimeout = 0;
+    numResumedListCursors = 0;
+
     // Used for identifying async requests
     nextListRequestID = 0;
     nextGetRequestID = 0;
 
     numAbortedListRequests = 0;
+    transactionConflict = false;
+    numTransactionConflicts = 0;
 }
 
 void ShardDatabaseManager::Shutdown()
@@ -401,6 +573,8 @@ void ShardDatabaseManager::Shutdown()
         delete node->Value();
     
     readRequests.DeleteList();
+    EventLoop::Remove(&listCursorTimer);
+    listCursors.DeleteList();
     environment.Close();
     StoragePageCache::Shutdown();
     StorageListPageCache::Shutdown();
@@ -413,6 +587,13 @@ void ShardDatabaseManager::Shutdown()
     }
 
     delete[] asyncLists;
+
+    activeAsyncGets.ClearMembers();
+    inactiveAsyncGets.ClearMembers();
+    for (unsigned i = 0; i < numAsyncGets; i++)
+        delete asyncGets[i];
+
+    delete[] asyncGets;
 }
 
 StorageEnvironment* ShardDatabaseManager::GetEnvironment()
@@ -559,6 +740,18 @@ void ShardDatabaseManager::RemoveDeletedDataShards(SortedList<uint64_t>& myShard
 
 void ShardDatabaseManager::OnClientReadRequest(ClientRequest* request)
 {
+    ClientRequest*  oldest;
+
+    // the blocking reads were queued before the ones not yet tried
+    oldest = blockingReadRequests.First();
+    if (oldest == NULL)
+        oldest = readRequests.First();
+    if (shardServer->IsOverloaded(readRequests.GetLength() + blockingReadRequests.GetLength(), oldest))
+    {
+        shardServer->OnOverloaded(request);
+        return;
+    }
+
     readRequests.Append(request);
 
     if (!executeReads.IsActive())
@@ -567,6 +760,12 @@ void ShardDatabaseManager::OnClientReadRequest(ClientRequest* request)
 
 void ShardDatabaseManager::OnClientListRequest(ClientRequest* request)
 {
+    if (shardServer->IsOverloaded(listRequests.GetLength(), listRequests.First()))
+    {
+        shardServer->OnOverloaded(request);
+        return;
+    }
+
     listRequests.Append(request);
 
     if (!executeLists.IsActive())
@@ -636,12 +835,16 @@ uint64_t ShardDatabaseManager::ExecuteMessage(uint64_t quorumID, uint64_t paxosI
     unsigned        nread;
     ReadBuffer      userValue;
     ReadBuffer      readBuffer;
+    Buffer          storedValue;
     Buffer          buffer;
     Buffer          numberBuffer;
     Buffer          tmpBuffer;
     ConfigShard*    configShard;
     ShardDatabaseSequence* sequence;
     Buffer          shardIDs;
+    char            batchType;
+    ReadBuffer      batchKey;
+    ReadBuffer      batchValue;
     ReadBuffer      parse;
     ClientRequest*  request;
     
@@ -654,6 +857,15 @@ uint64_t ShardDatabaseManager::ExecuteMessage(uint64_t quorumID, uint64_t paxosI
         message.clientRequest->response.paxosID = paxosID;
     }
 
+    // the writes of a conflicting optimistic transaction are skipped until its commit
+    if (transactionConflict &&
+     (message.type == SHARDMESSAGE_SET || message.type == SHARDMESSAGE_DELETE))
+    {
+        if (message.clientRequest)
+            message.clientRequest->response.Failed();
+        return 0;
+    }
+
     switch (message.type)
     {
         case SHARDMESSAGE_SET:
@@ -669,11 +881,55 @@ uint64_t ShardDatabaseManager::ExecuteMessage(uint64_t quorumID, uint64_t paxosI
             if (!environment.Delete(contextID, shardID, message.key))
                 RESPONSE_FAIL();
             break;
+        case SHARDMESSAGE_SET_IF_VERSION:
+        case SHARDMESSAGE_DELETE_IF_VERSION:
+            shardID = environment.GetShardID(contextID, message.tableID, message.key);
+            CHECK_SHARDID();
+            // a missing key has version 0:0
+            readPaxosID = 0;
+            readCommandID = 0;
+            if (GetStoredValue(contextID, shardID, message.key, readBuffer, storedValue))
+                ReadValue(readBuffer, readPaxosID, readCommandID, userValue);
+            if (readPaxosID != message.versionPaxosID || readCommandID != message.versionCommandID)
+            {
+                // not changed, the client gets the current version to retry with
+                if (message.clientRequest)
+                    message.clientRequest->response.SetVersion(readPaxosID, readCommandID);
+                break;
+            }
+            if (message.type == SHARDMESSAGE_SET_IF_VERSION)
+            {
+                WriteValue(buffer, paxosID, commandID, message.value);
+                if (!environment.Set(contextID, shardID, message.key, buffer))
+                    RESPONSE_FAIL();
+                if (message.clientRequest)
+                    message.clientRequest->response.SetVersion(paxosID, commandID);
+            }
+            else if (readPaxosID != 0)
+            {
+                if (!environment.Delete(contextID, shardID, message.key))
+                    RESPONSE_FAIL();
+            }
+            if (message.clientRequest)
+                message.clientRequest->response.SetConditionalSuccess(true);
+            break;
         case SHARDMESSAGE_START_TRANSACTION:
-            // nothing
+            // the read versions are checked on every replica in the same state,
+            // before the writes of the transaction which follow in the same value
+            transactionConflict = !CheckReadVersions(message.value);
+            if (transactionConflict)
+            {
+                Log_Debug("Optimistic transaction conflicts with a previous write, aborting");
+                numTransactionConflicts++;
+            }
             break;
         case SHARDMESSAGE_COMMIT_TRANSACTION:
-            if (message.clientRequest)
+            if (message.clientRequest && message.clientRequest->session->IsOptimistic())
+            {
+                // there is no lock to release, the session is done with the transaction
+                message.clientRequest->session->Init();
+            }
+            else if (message.clientRequest)
             {
                 ASSERT(message.clientRequest->session->IsTransactional());
                 LOCK_MANAGER->Unlock(message.clientRequest->session->lockKey);
@@ -683,13 +939,17 @@ uint64_t ShardDatabaseManager::ExecuteMessage(uint64_t quorumID, uint64_t paxosI
                     shardServer->OnClientRequest(request);
                 message.clientRequest->session->lockKey.Clear();
             }
-            // nothing
+            if (transactionConflict)
+            {
+                transactionConflict = false;
+                RESPONSE_FAIL();
+            }
             break;
         case SHARDMESSAGE_ADD:
         case SHARDMESSAGE_SEQUENCE_ADD:
             shardID = environment.GetShardID(contextID, message.tableID, message.key);
             CHECK_SHARDID();
-            if (environment.Get(contextID, shardID, message.key, readBuffer))
+            if (GetStoredValue(contextID, shardID, message.key, readBuffer, storedValue))
             {
                 // GET succeeded, key exists, try to parse number
                 ReadValue(readBuffer, readPaxosID, readCommandID, userValue);
@@ -796,11 +1056,31 @@ uint64_t ShardDatabaseManager::ExecuteMessage(uint64_t quorumID, uint64_t paxosI
             break;
          case SHARDMESSAGE_MIGRATION_SET:
             //Log_Debug("shardMigration SET shardID = %U", message.shardID);
-            environment.Set(contextID, message.shardID, message.key, message.value);
+            // the version of the source quorum could repeat a version of this quorum
+            readBuffer = message.value;
+            ReadValue(readBuffer, readPaxosID, readCommandID, userValue);
+            WriteValue(buffer, paxosID, commandID, userValue);
+            environment.Set(contextID, message.shardID, message.key, buffer);
             break;
          case SHARDMESSAGE_MIGRATION_DELETE:
             environment.Delete(contextID, message.shardID, message.key);
             break;
+         case SHARDMESSAGE_MIGRATION_BATCH:
+            // the batch was checked before it was replicated
+            if (!migrationBatch.Read(message.value))
+                ASSERT_FAIL();
+            while (migrationBatch.Next(batchType, batchKey, batchValue))
+            {
+                if (batchType == KEYVALUEBATCH_SET)
+                {
+                    ReadValue(batchValue, readPaxosID, readCommandID, userValue);
+                    WriteValue(buffer, paxosID, commandID, userValue);
+                    environment.Set(contextID, message.shardID, batchKey, buffer);
+                }
+                else
+                    environment.Delete(contextID, message.shardID, batchKey);
+            }
+            break;
          case SHARDMESSAGE_MIGRATION_COMPLETE:
             // TODO: handle this message type
             Log_Debug("TODO SHARDMESSAGE_MIGRATION_COMPLETE");
@@ -817,6 +1097,62 @@ uint64_t ShardDatabaseManager::ExecuteMessage(uint64_t quorumID, uint64_t paxosI
 #undef CHECK_SHARDID
 }
 
+bool ShardDatabaseManager::CheckReadVersions(ReadBuffer readVersions)
+{
+    uint64_t        shardID;
+    uint64_t        paxosID;
+    uint64_t        commandID;
+    uint64_t        readPaxosID;
+    uint64_t        readCommandID;
+    const char*     p;
+    const char*     end;
+    ReadBuffer      key;
+    ReadBuffer      value;
+    ReadBuffer      userValue;
+    Buffer          storedValue;
+
+    p = readVersions.GetBuffer();
+    end = p + readVersions.GetLength();
+    while (p < end)
+    {
+        if (!DecodeVarint(p, end, shardID) || !DecodeSlice(p, end, key) ||
+         !DecodeVarint(p, end, paxosID) || !DecodeVarint(p, end, commandID))
+            return false;
+
+        // the key is missing if it was deleted, or moved by a split since it was read
+        readPaxosID = 0;
+        readCommandID = 0;
+        if (GetStoredValue(QUORUM_DATABASE_DATA_CONTEXT, shardID, key, value, storedValue))
+            ReadValue(value, readPaxosID, readCommandID, userValue);
+
+        if (readPaxosID != paxosID || readCommandID != commandID)
+            return false;
+    }
+
+    return true;
+}
+
+// this is called while applying replicated commands, a value that cannot be read
+// would make this replica diverge from the others, so it stops instead
+bool ShardDatabaseManager::GetStoredValue(uint16_t contextID, uint64_t shardID, ReadBuffer key,
+ ReadBuffer& value, Buffer& valueBuffer)
+{
+    bool    failed;
+
+    if (environment.Get(contextID, shardID, key, value, valueBuffer, failed))
+        return true;
+
+    if (failed)
+    {
+        Log_Message("Unable to read value of key %R in shard %U from the value log", &key, shardID);
+        Log_Message("This should not happen.");
+        Log_Message("Possible causes: damaged file, corrupted file...");
+        STOP_FAIL(1);
+    }
+
+    return false;
+}
+
 void ShardDatabaseManager::OnLeaseTimeout()
 {
     sequences.DeleteTree();
@@ -832,6 +1168,11 @@ unsigned ShardDatabaseManager::GetNumBlockingReadRequests()
     return blockingReadRequests.GetLength();
 }
 
+unsigned ShardDatabaseManager::GetNumActiveAsyncGets()
+{
+    return activeAsyncGets.GetLength();
+}
+
 unsigned ShardDatabaseManager::GetNumListRequests()
 {
     return listRequests.GetLength();
@@ -852,11 +1193,26 @@ uint64_t ShardDatabaseManager::GetNextGetRequestID()
     return nextGetRequestID;
 }
 
+uint64_t ShardDatabaseManager::GetNumTransactionConflicts()
+{
+    return numTransactionConflicts;
+}
+
 uint64_t ShardDatabaseManager::GetNumAbortedListRequests()
 {
     return numAbortedListRequests;
 }
 
+unsigned ShardDatabaseManager::GetNumListCursors()
+{
+    return listCursors.GetLength();
+}
+
+uint64_t ShardDatabaseManager::GetNumResumedListCursors()
+{
+    return numResumedListCursors;
+}
+
 void ShardDatabaseManager::DeleteQuorumPaxosShard(uint64_t quorumID)
 {
     StorageShardProxy*  shard;
@@ -898,22 +1254,25 @@ void ShardDatabaseManager::DeleteDataShards(uint64_t quorumID)
 
 void ShardDatabaseManager::OnExecuteReads()
 {
-    uint64_t        start;
-    uint64_t        shardID;
-    int16_t         contextID;
-    ReadBuffer      key;
-    ClientRequest*  itRequest;
+    uint64_t                start;
+    uint64_t                shardID;
+    int16_t                 contextID;
+    ReadBuffer              key;
+    ClientRequest*          itRequest;
+    ClientRequest*          nextRequest;
+    ShardDatabaseAsyncGet*  asyncGet;
 
-    Log_Trace("asyncGet: %b", asyncGet.active);
+    Log_Trace("numActiveAsyncGets: %u", activeAsyncGets.GetLength());
 
-    if (asyncGet.active)
+    if (inactiveAsyncGets.GetLength() == 0)
         return;
     
     start = NowClock();
+    ShardSchedulerSlice     slice(SCHEDULER, SHARD_SCHEDULER_READ);
 
     FOREACH_FIRST (itRequest, readRequests)
     {
-        TRY_YIELD_RETURN(executeReads, start);
+        TRY_YIELD_SLICE_RETURN(executeReads, slice);
 
         readRequests.Remove(itRequest);
 
@@ -925,67 +1284,162 @@ void ShardDatabaseManager::OnExecuteReads()
             continue;
         }
 
+        // the client has likely given up on requests that waited this long
+        if (shardServer->IsExpired(itRequest))
+        {
+            shardServer->OnOverloaded(itRequest);
+            continue;
+        }
+
         key.Wrap(itRequest->key);
         contextID = QUORUM_DATABASE_DATA_CONTEXT;
         shardID = environment.GetShardID(contextID, itRequest->tableID, key);
 
         nextGetRequestID += 1;
 
-        asyncGet.request = itRequest;
-        asyncGet.key = key;
-        asyncGet.onComplete = MFUNC_OF(ShardDatabaseAsyncGet, OnRequestComplete, &asyncGet);
-        asyncGet.active = true;
-        asyncGet.async = false;
-        if (!environment.TryNonblockingGet(contextID, shardID, &asyncGet))
+        // the nonblocking GET completes synchronously, the context stays inactive
+        asyncGet = inactiveAsyncGets.First();
+        asyncGet->request = itRequest;
+        asyncGet->shardID = shardID;
+        asyncGet->key = key;
+        asyncGet->onComplete = MFUNC_OF(ShardDatabaseAsyncGet, OnRequestComplete, asyncGet);
+        asyncGet->active = false;
+        asyncGet->async = false;
+        if (!environment.TryNonblockingGet(contextID, shardID, asyncGet))
         {
             // HACK store timestamp for later comparison in order to avoid duplicate memo chunk search
-            asyncGet.active = false;
             itRequest->changeTimeout = start;
             blockingReadRequests.Append(itRequest);
+            continue;
         }
+
+        SCHEDULER->OnQueueDelay(SHARD_SCHEDULER_READ, Now() - itRequest->receiveTime);
     }
 
     Log_Trace("blocking");
         
-    FOREACH_FIRST (itRequest, blockingReadRequests)
+    for (itRequest = blockingReadRequests.First(); itRequest != NULL; itRequest = nextRequest)
     {
-        TRY_YIELD_RETURN(executeReads, start);
+        if (inactiveAsyncGets.GetLength() == 0)
+            return;     // continued when an async GET completes
 
-        blockingReadRequests.Remove(itRequest);
+        TRY_YIELD_SLICE_RETURN(executeReads, slice);
+
+        nextRequest = blockingReadRequests.Next(itRequest);
 
         // silently drop requests from disconnected clients
         if (!itRequest->session->IsActive())
         {
+            blockingReadRequests.Remove(itRequest);
             itRequest->response.NoResponse();
             itRequest->OnComplete();
             continue;
         }
 
+        if (shardServer->IsExpired(itRequest))
+        {
+            blockingReadRequests.Remove(itRequest);
+            shardServer->OnOverloaded(itRequest);
+            continue;
+        }
+
+        // per-connection fairness: a session cannot use up all the async GETs
+        if (GetNumActiveAsyncGets(itRequest->session) >= asyncGetSessionDepth)
+            continue;
+
+        blockingReadRequests.Remove(itRequest);
+        SCHEDULER->OnQueueDelay(SHARD_SCHEDULER_READ, Now() - itRequest->receiveTime);
+
         key.Wrap(itRequest->key);
         contextID = QUORUM_DATABASE_DATA_CONTEXT;
         shardID = environment.GetShardID(contextID, itRequest->tableID, key);
 
-        asyncGet.skipMemoChunk = false;
+        asyncGet = inactiveAsyncGets.First();
+        inactiveAsyncGets.Remove(asyncGet);
+        activeAsyncGets.Append(asyncGet);
+
+        asyncGet->skipMemoChunk = false;
         if (itRequest->changeTimeout == start)
-            asyncGet.skipMemoChunk = true;
-        asyncGet.request = itRequest;
-        asyncGet.key = key;
-        asyncGet.onComplete = MFUNC_OF(ShardDatabaseAsyncGet, OnRequestComplete, &asyncGet);
-        asyncGet.active = true;
-        asyncGet.async = false;
-        environment.AsyncGet(contextID, shardID, &asyncGet);
-        if (asyncGet.active)
+            asyncGet->skipMemoChunk = true;
+        asyncGet->request = itRequest;
+        asyncGet->shardID = shardID;
+        asyncGet->key = key;
+        asyncGet->onComplete = MFUNC_OF(ShardDatabaseAsyncGet, OnRequestComplete, asyncGet);
+        asyncGet->active = true;
+        asyncGet->async = false;
+        asyncGet->done = false;
+        environment.AsyncGet(contextID, shardID, asyncGet);
+        if (asyncGet->active)
+            asyncGet->async = true;
+    }
+}
+
+void ShardDatabaseManager::OnAsyncGetComplete(ShardDatabaseAsyncGet* asyncGet)
+{
+    bool                    async;
+    ShardDatabaseAsyncGet*  it;
+    ShardDatabaseAsyncGet*  next;
+    ShardDatabaseAsyncGet*  prev;
+
+    async = asyncGet->async;
+    asyncGet->done = true;
+
+    // the value may point into a page or the memo chunk, which can change before it is sent
+    asyncGet->request->response.CopyValue();
+
+    // GETs of a session are answered in the order they were started
+    for (it = activeAsyncGets.First(); it != NULL; it = next)
+    {
+        next = activeAsyncGets.Next(it);
+        if (!it->done)
+            continue;
+
+        for (prev = activeAsyncGets.Prev(it); prev != NULL; prev = activeAsyncGets.Prev(prev))
         {
-            // TODO: HACK
-            asyncGet.async = true;
-            return;
+            if (prev->request->session == it->request->session)
+                break;
         }
+        if (prev != NULL)
+            continue;
+
+        activeAsyncGets.Remove(it);
+        inactiveAsyncGets.Append(it);
+        it->active = false;
+        it->done = false;
+        if (!it->request->session->IsActive())
+            it->request->response.NoResponse();
+        it->request->OnComplete();
     }
+
+    if (async && !executeReads.IsActive())
+        EventLoop::Add(&executeReads);
+}
+
+unsigned ShardDatabaseManager::GetNumActiveAsyncGets(ClientSession* session)
+{
+    unsigned                num;
+    ShardDatabaseAsyncGet*  it;
+
+    num = 0;
+    FOREACH (it, activeAsyncGets)
+    {
+        if (it->request->session == session)
+            num++;
+    }
+
+    return num;
+}
+
+void ShardDatabaseManager::ContinueLists(ClientSession* session)
+{
+    unsigned    i;
+
+    for (i = 0; i < numAsyncLists; i++)
+        asyncLists[i]->ContinueList(session);
 }
 
 void ShardDatabaseManager::OnExecuteLists()
 {
-    uint64_t                    start;
     uint64_t                    shardID;
     int16_t                     contextID;
     ReadBuffer                  prefix;
@@ -1015,11 +1469,11 @@ void ShardDatabaseManager::OnExecuteLists()
         }
     }
     
-    start = NowClock();
+    ShardSchedulerSlice         slice(SCHEDULER, SHARD_SCHEDULER_LIST);
 
     FOREACH_FIRST (request, listRequests)
     {
-        TRY_YIELD_RETURN(executeLists, start);
+        TRY_YIELD_SLICE_RETURN(executeLists, slice);
         listRequests.Remove(request);
 
         // silently drop requests from disconnected clients
@@ -1030,6 +1484,14 @@ void ShardDatabaseManager::OnExecuteLists()
             continue;
         }
 
+        if (shardServer->IsExpired(request))
+        {
+            shardServer->OnOverloaded(request);
+            continue;
+        }
+
+        SCHEDULER->OnQueueDelay(SHARD_SCHEDULER_LIST, Now() - request->receiveTime);
+
         if (IsEmptyListRange(request))
         {
             request->response.OK();
@@ -1092,9 +1554,24 @@ void ShardDatabaseManager::OnExecuteLists()
             continue;
         }
 
+        shardServer->GetLoadTracker()->OnRead(shardID, startKey, 0);
+
         asyncList = inactiveAsyncLists.Pop();
         asyncList->Clear();
 
+        if (request->filter.GetLength() > 0)
+        {
+            if (!asyncList->requestFilter.listFilter.Parse(ReadBuffer(request->filter)))
+            {
+                Log_Debug("Invalid list filter: %B", &request->filter);
+                request->response.Failed();
+                request->OnComplete();
+                inactiveAsyncLists.Append(asyncList);
+                continue;
+            }
+            asyncList->filter = &asyncList->requestFilter;
+        }
+
         // set type based on request type
         if (request->type == CLIENTREQUEST_LIST_KEYS)
             asyncList->type = StorageAsyncList::KEY;
@@ -1119,6 +1596,12 @@ void ShardDatabaseManager::OnExecuteLists()
         asyncList->shardFirstKey.Write(configShard->firstKey);
         asyncList->shardLastKey.Write(configShard->lastKey);
         asyncList->onComplete = MFUNC_OF(ShardDatabaseAsyncList, OnShardComplete, asyncList);
+        if (asyncList->type != StorageAsyncList::COUNT)
+            asyncList->batchSize = listBatchSize;
+        asyncList->keepCursor = (listCursorTimeout > 0 && request->forwardDirection && request->count > 0 &&
+         asyncList->type != StorageAsyncList::COUNT && asyncList->filter == NULL);
+        if (asyncList->keepCursor)
+            asyncList->cursor = FindListCursor(request->session, contextID, shardID, asyncList);
         
         Log_Debug("List[%U] shard: shardFirstKey: %B, shardLastKey: %B", 
          asyncList->requestID, &asyncList->shardFirstKey, &asyncList->shardLastKey);
@@ -1134,6 +1617,95 @@ void ShardDatabaseManager::OnExecuteLists()
     }
 }
 
+StorageListCursor* ShardDatabaseManager::FindListCursor(
+ ClientSession* session, uint16_t contextID, uint64_t shardID, StorageAsyncList* asyncList)
+{
+    StorageListCursor*  cursor;
+
+    FOREACH (cursor, listCursors)
+    {
+        if (cursor->owner != session || cursor->contextID != contextID || cursor->shardID != shardID)
+            continue;
+        if (cursor->keysOnly != (asyncList->type != StorageAsyncList::KEYVALUE))
+            continue;
+        if (ReadBuffer::Cmp(cursor->lastKey, asyncList->startKey) != 0)
+            continue;
+        if (ReadBuffer::Cmp(cursor->prefix, asyncList->prefix) != 0)
+            continue;
+        if (ReadBuffer::Cmp(cursor->endKey, asyncList->endKey) != 0)
+            continue;
+
+        Log_Debug("List[%U] resuming list cursor at %B", asyncList->requestID, &cursor->lastKey);
+        listCursors.Remove(cursor);
+        numResumedListCursors++;
+        return cursor;
+    }
+
+    return NULL;
+}
+
+void ShardDatabaseManager::AddListCursor(
+ StorageListCursor* cursor, ClientSession* session, uint16_t contextID, uint64_t shardID)
+{
+    StorageListCursor*  it;
+    StorageListCursor*  oldest;
+    unsigned            num;
+
+    if (cursor == NULL)
+        return;
+
+    cursor->owner = session;
+    cursor->contextID = contextID;
+    cursor->shardID = shardID;
+    cursor->expireTime = Now() + listCursorTimeout;
+
+    // cursors are appended in order of expiry, so the oldest ones are at the head
+    num = 0;
+    oldest = NULL;
+    FOREACH (it, listCursors)
+    {
+        if (it->owner != session)
+            continue;
+        if (oldest == NULL)
+            oldest = it;
+        num++;
+    }
+
+    if (num >= maxListCursorsPerSession)
+        listCursors.Delete(oldest);
+    else if (listCursors.GetLength() >= maxListCursors)
+        listCursors.Delete(listCursors.First());
+
+    listCursors.Append(cursor);
+
+    if (!listCursorTimer.IsActive())
+    {
+        listCursorTimer.SetDelay(listCursorTimeout);
+        EventLoop::Add(&listCursorTimer);
+    }
+}
+
+void ShardDatabaseManager::OnListCursorTimeout()
+{
+    uint64_t            now;
+    StorageListCursor*  cursor;
+
+    now = Now();
+    FOREACH_FIRST (cursor, listCursors)
+    {
+        if (cursor->expireTime > now)
+            break;
+        listCursors.Delete(cursor);
+    }
+
+    cursor = listCursors.First();
+    if (cursor != NULL)
+    {
+        listCursorTimer.SetDelay(cursor->expireTime - now);
+        EventLoop::Add(&listCursorTimer);
+    }
+}
+
 bool ShardDatabaseManager::IsEmptyListRange(ClientRequest* request)
 {
     int cmp;
@@ -4,10 +4,15 @@
 #include "System/Containers/HashMap.h"
 #include "System/Containers/InSortedList.h"
 #include "System/Containers/InTreeMap.h"
+#include "System/Events/Countdown.h"
 #include "Framework/Storage/StorageEnvironment.h"
 #include "Framework/Storage/StorageShardProxy.h"
 #include "Framework/Storage/StorageAsyncGet.h"
 #include "Framework/Storage/StorageAsyncList.h"
+#include "Framework/Storage/StorageListCursor.h"
+#include "Framework/Storage/StorageListFilter.h"
+#include "Application/Common/ListFilter.h"
+#include "Application/Common/KeyValueBatch.h"
 #include "Application/ConfigState/ConfigState.h"
 #include "Application/Common/ClientRequest.h"
 #include "ShardMessage.h"
@@ -44,6 +49,10 @@ public:
 ===============================================================================================
  
  ShardDatabaseAsyncGet -- helper class for async GET operation
+
+ The manager keeps a pool of these, so several GETs missing the page cache can load
+ pages in parallel. Completed GETs are answered in the order they were started within
+ a session.
  
 ===============================================================================================
 */
@@ -51,14 +60,38 @@ public:
 class ShardDatabaseAsyncGet : public StorageAsyncGet
 {
 public:
+    ShardDatabaseAsyncGet*  next;
+    ShardDatabaseAsyncGet*  prev;
     ClientRequest*          request;
     ShardDatabaseManager*   manager;
+    uint64_t                shardID;
     bool                    active;
     bool                    async;
+    bool                    done;
     
+    ShardDatabaseAsyncGet(ShardDatabaseManager* manager);
+
     void                    OnRequestComplete();
 };
 
+/*
+===============================================================================================
+
+ ShardDatabaseListFilter -- evaluates the ListFilter of a LIST request on the user value,
+ without the paxosID and commandID stored in front of it
+
+===============================================================================================
+*/
+
+class ShardDatabaseListFilter : public StorageListFilter
+{
+public:
+    ListFilter              listFilter;
+
+    bool                    Match(const ReadBuffer& key, ReadBuffer& value);
+    bool                    IsValueNeeded();
+};
+
 /*
 ===============================================================================================
  
@@ -72,8 +105,10 @@ class ShardDatabaseAsyncList : public StorageAsyncList
 public:
     ShardDatabaseAsyncList* next;
     ShardDatabaseAsyncList* prev;
+    ShardDatabaseListFilter requestFilter;
     
     ShardDatabaseAsyncList(ShardDatabaseManager* manager);
+    ~ShardDatabaseAsyncList();
 
     void                    SetRequest(ClientRequest* request);
     void                    SetTotal(uint64_t total);
@@ -82,11 +117,14 @@ public:
     void                    OnRequestComplete();
     void                    TryNextShard();
     bool                    IsActive();
+    void                    ContinueList(ClientSession* session);
+    void                    OnPauseTimeout();
 
 private:
     ShardDatabaseManager*   manager;
     ClientRequest*          request;
     uint64_t                total;
+    Countdown               pauseTimeout;
 };
 
 /*
@@ -94,6 +132,14 @@ private:
 
  ShardDatabaseManager
 
+ When a forward LIST stops at its count, the positions of its listers are kept as a list
+ cursor for a while. The next page, sent by the same session with the last key as the
+ start key, resumes the cursor instead of locating the start key in every chunk again.
+
+ KEYS and KEYVALUES lists are sent to the client in batches of database.listBatchSize
+ bytes. The next batch is only merged when the session is ready to write it, or after
+ database.listPauseTimeout msec, because a paused list blocks the merging of chunks.
+
 ===============================================================================================
 */
 
@@ -103,6 +149,8 @@ class ShardDatabaseManager
     typedef InList<ClientRequest>                   ClientRequestList;
     typedef InTreeMap<ShardDatabaseSequence>        Sequences;
     typedef InList<ShardDatabaseAsyncList>          ShardDatabaseAsyncListList;
+    typedef InList<ShardDatabaseAsyncGet>           ShardDatabaseAsyncGetList;
+    typedef InList<StorageListCursor>               ListCursorList;
 
     friend class ShardDatabaseAsyncGet;
     friend class ShardDatabaseAsyncList;
@@ -126,6 +174,7 @@ public:
     
     void                        OnClientReadRequest(ClientRequest* request);
     void                        OnClientListRequest(ClientRequest* request);
+    void                        ContinueLists(ClientSession* session);
     bool                        OnClientSequenceNext(ClientRequest* request);
     uint64_t                    ExecuteMessage(uint64_t quorumID, uint64_t paxosID, uint64_t commandID, ShardMessage& message);
 
@@ -133,11 +182,15 @@ public:
 
     unsigned                    GetNumReadRequests();
     unsigned                    GetNumBlockingReadRequests();
+    unsigned                    GetNumActiveAsyncGets();
     unsigned                    GetNumListRequests();
     unsigned                    GetNumInactiveListThreads();
     uint64_t                    GetNextListRequestID();
     uint64_t                    GetNumAbortedListRequests();
+    unsigned                    GetNumListCursors();
+    uint64_t                    GetNumResumedListCursors();
     uint64_t                    GetNextGetRequestID();
+    uint64_t                    GetNumTransactionConflicts();
         
 private:
     void                        DeleteQuorumPaxosShard(uint64_t quorumID);
@@ -145,8 +198,18 @@ private:
     void                        DeleteDataShards(uint64_t quorumID);
 
     void                        OnExecuteReads();
+    void                        OnAsyncGetComplete(ShardDatabaseAsyncGet* asyncGet);
+    unsigned                    GetNumActiveAsyncGets(ClientSession* session);
     void                        OnExecuteLists();
     bool                        IsEmptyListRange(ClientRequest* request);
+    StorageListCursor*          FindListCursor(ClientSession* session, uint16_t contextID, uint64_t shardID,
+                                 StorageAsyncList* asyncList);
+    void                        AddListCursor(StorageListCursor* cursor, ClientSession* session,
+                                 uint16_t contextID, uint64_t shardID);
+    void                        OnListCursorTimeout();
+    bool                        CheckReadVersions(ReadBuffer readVersions);
+    bool                        GetStoredValue(uint16_t contextID, uint64_t shardID, ReadBuffer key,
+                                 ReadBuffer& value, Buffer& valueBuffer);
 
     ShardServer*                shardServer;
     StorageEnvironment          environment;
@@ -157,15 +220,30 @@ private:
     ClientRequestList           blockingReadRequests;
     ClientRequestList           listRequests;
     YieldTimer                  executeReads;
-    ShardDatabaseAsyncGet       asyncGet;
+    unsigned                    numAsyncGets;
+    unsigned                    asyncGetSessionDepth;
+    ShardDatabaseAsyncGet**     asyncGets;
+    ShardDatabaseAsyncGetList   activeAsyncGets;
+    ShardDatabaseAsyncGetList   inactiveAsyncGets;
     YieldTimer                  executeLists;
     unsigned                    numAsyncLists;
     ShardDatabaseAsyncList**    asyncLists;
     ShardDatabaseAsyncListList  inactiveAsyncLists;
+    uint32_t                    listBatchSize;
+    unsigned                    listPauseTimeout;
+    ListCursorList              listCursors;
+    Countdown                   listCursorTimer;
+    unsigned                    listCursorTimeout;
+    unsigned                    maxListCursors;
+    unsigned                    maxListCursorsPerSession;
+    uint64_t                    numResumedListCursors;
     Sequences                   sequences;
+    KeyValueBatch               migrationBatch;
     uint64_t                    nextListRequestID;
     uint64_t                    numAbortedListRequests;
     uint64_t                    nextGetRequestID;
+    bool                        transactionConflict;
+    uint64_t                    numTransactionConflicts;
 };
 
 #endif
@@ -13,6 +13,7 @@
 #include "Framework/Storage/StoragePageCache.h"
 #include "Framework/Storage/StorageListPageCache.h"
 #include "Framework/Storage/StorageFileDeleter.h"
+#include "Framework/Storage/StorageFDCache.h"
 #include "Version.h"
 
 #define PARAM_BOOL_VALUE(param)                         \
@@ -24,6 +25,9 @@
 #define SHARD_MIGRATION_WRITER  (shardServer->GetShardMigrationWriter())
 #define LOCK_MANAGER            (shardServer->GetTransactionManager()->GetLockManager())
 #define WAITQUEUE_MANAGER       (shardServer->GetTransactionManager()->GetWaitQueueManager())
+// partial LIST results are sent while less than this is waiting to be written
+#define MAX_QUEUED_BYTES        (100*KiB)
+
 #define PRINT_BOOL(str, b) { if ((b)) buffer.Appendf("%s: yes\n", str); else buffer.Appendf("%s: no\n", str); }
 
 /*
@@ -89,6 +93,7 @@ void ShardHTTPClientSession::SetConnection(HTTPConnection* conn_)
 {
     session.SetConnection(conn_);
     conn_->SetOnClose(MFUNC(ShardHTTPClientSession, OnConnectionClose));
+    conn_->SetOnWriteReady(MFUNC(ShardHTTPClientSession, OnConnectionWriteReady));
 }
 
 bool ShardHTTPClientSession::HandleRequest(HTTPRequest& request)
@@ -216,6 +221,9 @@ void ShardHTTPClientSession::OnComplete(ClientRequest* request, bool last)
         else
             session.Print("FAILED");
         break;
+    case CLIENTRESPONSE_OVERLOADED:
+        session.Print("OVERLOADED");
+        break;
     }
     
     if (last)
@@ -223,6 +231,8 @@ void ShardHTTPClientSession::OnComplete(ClientRequest* request, bool last)
         session.Flush();        
         delete request;
     }
+    else if (request->IsList())
+        session.FlushPartial();
 }
 
 bool ShardHTTPClientSession::IsActive()
@@ -230,6 +240,14 @@ bool ShardHTTPClientSession::IsActive()
     return true;
 }
 
+bool ShardHTTPClientSession::IsWriteReady()
+{
+    if (session.conn == NULL)
+        return true;
+
+    return (session.conn->GetWriteBuffer().GetLength() <= MAX_QUEUED_BYTES);
+}
+
 void ShardHTTPClientSession::PrintStatus()
 {
     Buffer                      keybuf;
@@ -319,10 +337,14 @@ void ShardHTTPClientSession::PrintStatus()
     keybuf.Writef("Migrating shard (sending)");
     keybuf.NullTerminate();
     if (SHARD_MIGRATION_WRITER->IsActive())
-        valbuf.Writef("yes (sent: %s/%s, aggregate throughput: %s/s)",
+        valbuf.Writef("yes (phase: %s, sent: %s/%s, aggregate throughput: %s/s, "
+         "tail keys: %u, fenced: %U msec)",
+         SHARD_MIGRATION_WRITER->GetPhaseName(),
          HumanBytes(SHARD_MIGRATION_WRITER->GetBytesSent(), humanBytesSent),
          HumanBytes(SHARD_MIGRATION_WRITER->GetBytesTotal(), humanBytesTotal),
-         HumanBytes(SHARD_MIGRATION_WRITER->GetThroughput(), humanThroughput));
+         HumanBytes(SHARD_MIGRATION_WRITER->GetThroughput(), humanThroughput),
+         SHARD_MIGRATION_WRITER->GetNumTailKeys(),
+         SHARD_MIGRATION_WRITER->GetFencedTime());
     else
         valbuf.Writef("no");
     valbuf.NullTerminate();
@@ -358,6 +380,11 @@ void ShardHTTPClientSession::PrintStatistics()
     FS_Stat                 fsStat;
     ShardDatabaseManager*   databaseManager;
     ShardQuorumProcessor*   quorumProcessor;
+    ShardAppendController*  appendController;
+    SDBPServer*             sdbpServer;
+    ShardScheduler*         scheduler;
+    ShardSchedulerClass*    schedulerClass;
+    int                     cls;
     ReadBuffer              param;
     char                    formatBuf[100];
     ByteFormatType          formatType;
@@ -403,9 +430,13 @@ void ShardHTTPClientSession::PrintStatistics()
     buffer.Appendf("nextGetRequestID: %U\n", databaseManager->GetNextGetRequestID());
     buffer.Appendf("pendingReadRequests: %u\n", databaseManager->GetNumReadRequests());
     buffer.Appendf("pendingBlockingReadRequests: %u\n", databaseManager->GetNumBlockingReadRequests());
+    buffer.Appendf("activeAsyncGets: %u\n", databaseManager->GetNumActiveAsyncGets());
     buffer.Appendf("pendingListRequests: %u\n", databaseManager->GetNumListRequests());
     buffer.Appendf("inactiveListThreads: %u\n", databaseManager->GetNumInactiveListThreads());
     buffer.Appendf("numAbortedListRequests: %U\n", databaseManager->GetNumAbortedListRequests());
+    buffer.Appendf("numTransactionConflicts: %U\n", databaseManager->GetNumTransactionConflicts());
+    buffer.Appendf("numListCursors: %u\n", databaseManager->GetNumListCursors());
+    buffer.Appendf("numResumedListCursors: %U\n", databaseManager->GetNumResumedListCursors());
     buffer.Appendf("nextListRequestID: %U\n", databaseManager->GetNextListRequestID());
     buffer.Appendf("listPageCacheSize: %U\n", StorageListPageCache::GetCacheSize());
     buffer.Appendf("maxListPageCacheSize: %U\n", StorageListPageCache::GetMaxCacheSize());
@@ -422,6 +453,7 @@ void ShardHTTPClientSession::PrintStatistics()
     buffer.Appendf("logFileDiskUsage: %s\n", FormatBytes(databaseManager->GetEnvironment()->GetLogSegmentDiskUsage(), formatBuf, formatType));
     buffer.Appendf("numShards: %u\n", databaseManager->GetEnvironment()->GetNumShards());
     buffer.Appendf("numFileChunks: %u\n", databaseManager->GetEnvironment()->GetNumFileChunks());
+    buffer.Appendf("numPendingFileDeletes: %u\n", StorageFileDeleter::GetNumPending());
 
     for (registryNode = Registry::First(); registryNode != NULL; registryNode = Registry::Next(registryNode))
     {
@@ -447,7 +479,7 @@ void ShardHTTPClientSession::PrintStatistics()
     buffer.Appendf("lockMaxCacheCount: %u\n", LOCK_MANAGER->GetMaxCacheCount());
     buffer.Appendf("lockMaxPoolCount: %u\n", LOCK_MANAGER->GetMaxPoolCount());
     // internal structures
-    buffer.Appendf("lockTreeCount: %u\n", LOCK_MANAGER->GetTreeCount());
+    buffer.Appendf("lockTableCount: %u\n", LOCK_MANAGER->GetTableCount());
     buffer.Appendf("lockCacheListLength: %u\n", LOCK_MANAGER->GetCacheListLength());
     buffer.Appendf("lockPoolListLength: %u\n", LOCK_MANAGER->GetPoolListLength());
     buffer.Appendf("lockExpiryListLength: %u\n", LOCK_MANAGER->GetExpiryListLength());
@@ -465,6 +497,37 @@ void ShardHTTPClientSession::PrintStatistics()
     buffer.Appendf("waitQueueNodeExpiryListLength: %u\n", WAITQUEUE_MANAGER->GetNodeExpiryListLength());
     buffer.Appendf("waitQueueNodePoolListLength: %u\n", WAITQUEUE_MANAGER->GetNodePoolListLength());
 
+    sdbpServer = shardServer->GetShardServerApp()->GetSDBPServer();
+    buffer.Append("  Category: Admission\n");
+    // user settings
+    buffer.Appendf("maxInFlightRequests: %u\n", sdbpServer->GetMaxInFlightRequests());
+    buffer.Appendf("maxSessionInFlightRequests: %u\n", sdbpServer->GetMaxSessionInFlightRequests());
+    buffer.Appendf("maxQueuedRequests: %u\n", shardServer->GetMaxQueuedRequests());
+    buffer.Appendf("maxRequestQueueTime: %U\n", shardServer->GetMaxRequestQueueTime());
+    // counters
+    buffer.Appendf("inFlightRequests: %u\n", sdbpServer->GetNumInFlightRequests());
+    buffer.Appendf("readPausedConnections: %u\n", sdbpServer->GetNumPausedConns());
+    buffer.Appendf("numReadPauses: %U\n", sdbpServer->GetNumReadPauses());
+    buffer.Appendf("numOverloadedRequests: %U\n", shardServer->GetNumOverloadedRequests());
+
+    buffer.Append("  Category: Scheduler\n");
+    scheduler = shardServer->GetScheduler();
+    buffer.Appendf("schedulerEnabled: %b\n", scheduler->IsEnabled());
+    buffer.Appendf("schedulerQuantum: %u\n", scheduler->GetQuantum());
+    for (cls = 0; cls < SHARD_SCHEDULER_NUM_CLASSES; cls++)
+    {
+        schedulerClass = scheduler->GetClass(cls);
+        buffer.Appendf("scheduler.%s.weight: %u\n", schedulerClass->name, schedulerClass->weight);
+        buffer.Appendf("scheduler.%s.latencyTarget: %u\n", schedulerClass->name, schedulerClass->latencyTarget);
+        buffer.Appendf("scheduler.%s.busyTime: %U\n", schedulerClass->name, schedulerClass->busyTime);
+        buffer.Appendf("scheduler.%s.numSlices: %U\n", schedulerClass->name, schedulerClass->numSlices);
+        buffer.Appendf("scheduler.%s.numDeferred: %U\n", schedulerClass->name, schedulerClass->numDeferred);
+        buffer.Appendf("scheduler.%s.queueDelay: %U\n", schedulerClass->name, schedulerClass->delay);
+        buffer.Appendf("scheduler.%s.queueDelayHistogram: ", schedulerClass->name);
+        scheduler->AppendHistogram(cls, buffer);
+        buffer.Append("\n");
+    }
+
     buffer.Append("  Category: Replication\n");
     FOREACH (quorumProcessor, *shardServer->GetQuorumProcessors())
     {
@@ -472,6 +535,19 @@ void ShardHTTPClientSession::PrintStatistics()
          quorumProcessor->GetMessageListLength());
         buffer.Appendf("quorum[%U].replicationThroughput: %s\n", quorumProcessor->GetQuorumID(), 
             FormatBytes(quorumProcessor->GetReplicationThroughput(), formatBuf, formatType));
+        appendController = quorumProcessor->GetAppendController();
+        buffer.Appendf("quorum[%U].replicationMode: %s\n", quorumProcessor->GetQuorumID(), 
+         ShardAppendController::ModeToString(appendController->GetMode()));
+        buffer.Appendf("quorum[%U].replicationBatchSize: %s\n", quorumProcessor->GetQuorumID(), 
+            FormatBytes(appendController->GetBatchSize(), formatBuf, formatType));
+        buffer.Appendf("quorum[%U].replicationAppendDelay: %u\n", quorumProcessor->GetQuorumID(), 
+         appendController->GetLastAppendDelay());
+        buffer.Appendf("quorum[%U].replicationRoundLatency: %U\n", quorumProcessor->GetQuorumID(), 
+         appendController->GetRoundLatency());
+        buffer.Appendf("quorum[%U].replicationCommitTime: %U\n", quorumProcessor->GetQuorumID(), 
+         appendController->GetCommitTime());
+        buffer.Appendf("quorum[%U].replicationPipelinedRounds: %u\n", quorumProcessor->GetQuorumID(), 
+         quorumProcessor->GetNumPipelinedRounds());
 
     }
 
@@ -778,6 +854,8 @@ bool ShardHTTPClientSession::ProcessSettings()
     uint64_t                logFlushInterval;
     uint64_t                logTraceInterval;
     uint64_t                replicationLimit;
+    uint64_t                replicationTargetLatency;
+    unsigned                replicationMode;
     uint64_t				abortWaitingListsNum;
     uint64_t                listDataPageCacheSize;
     ShardQuorumProcessor*   quorumProcessor;
@@ -917,6 +995,26 @@ bool ShardHTTPClientSession::ProcessSettings()
         session.PrintPair("ReplicationLimit", buf);
     }
 
+    if (HTTP_GET_OPT_PARAM(params, "replicationMode", param))
+    {
+        if (ShardAppendController::StringToMode(param, replicationMode))
+        {
+            FOREACH (quorumProcessor, *shardServer->GetQuorumProcessors())
+                quorumProcessor->GetAppendController()->SetMode(replicationMode);
+            session.PrintPair("ReplicationMode", ShardAppendController::ModeToString(replicationMode));
+        }
+    }
+
+    if (HTTP_GET_OPT_PARAM(params, "replicationTargetLatency", param))
+    {
+        replicationTargetLatency = 0;
+        HTTP_GET_OPT_U64_PARAM(params, "replicationTargetLatency", replicationTargetLatency);
+        FOREACH (quorumProcessor, *shardServer->GetQuorumProcessors())
+            quorumProcessor->GetAppendController()->SetTargetLatency((unsigned) replicationTargetLatency);
+        snprintf(buf, sizeof(buf), "%u", (unsigned) replicationTargetLatency);
+        session.PrintPair("ReplicationTargetLatency", buf);
+    }
+
     if (HTTP_GET_OPT_PARAM(params, "abortWaitingListsNum", param))
     {
         // initialize variable, because conversion may fail
@@ -941,6 +1039,8 @@ bool ShardHTTPClientSession::ProcessSettings()
     }
 
     CHECK_AND_SET_POSITIVE_UINT64("maxChunkPerShard", shardServer->GetDatabaseManager()->GetEnvironment()->GetConfig().SetMaxChunkPerShard);
+    CHECK_AND_SET_POSITIVE_UINT64("maxOpenChunkFiles", StorageFDCache::SetMaxOpen);
+    CHECK_AND_SET_UINT64("deleteBytesPerSec", StorageFileDeleter::SetBytesPerSec);
 
     CHECK_AND_SET_POSITIVE_UINT64("lockExpireTime", LOCK_MANAGER->SetLockExpireTime);
     CHECK_AND_SET_UINT64("lockMaxCacheTime",        LOCK_MANAGER->SetMaxCacheTime);
@@ -1156,6 +1256,7 @@ ClientRequest* ShardHTTPClientSession::ProcessListKeys()
     ReadBuffer      endKey;
     ReadBuffer      prefix;
     ReadBuffer      dirBuffer;
+    ReadBuffer      filter;
     ClientRequest*  request;
     
     HTTP_GET_U64_PARAM(params, "tableID", tableID);
@@ -1163,6 +1264,7 @@ ClientRequest* ShardHTTPClientSession::ProcessListKeys()
     HTTP_GET_OPT_PARAM(params, "endKey", endKey);
     HTTP_GET_OPT_PARAM(params, "prefix", prefix);
     HTTP_GET_OPT_PARAM(params, "direction", dirBuffer);
+    HTTP_GET_OPT_PARAM(params, "filter", filter);
     count = 0;
     HTTP_GET_OPT_U64_PARAM(params, "count", count);
 
@@ -1175,6 +1277,7 @@ ClientRequest* ShardHTTPClientSession::ProcessListKeys()
     request->ListKeys(0, 0, tableID, startKey, endKey, prefix, count, forwardDirection);
 
     HTTP_GET_OPT_U64_PARAM(params, "paxosID", request->paxosID);
+    request->filter.Write(filter);
 
     return request;    
 }
@@ -1188,6 +1291,7 @@ ClientRequest* ShardHTTPClientSession::ProcessListKeyValues()
     ReadBuffer      endKey;
     ReadBuffer      prefix;
     ReadBuffer      dirBuffer;
+    ReadBuffer      filter;
     ClientRequest*  request;
     
     HTTP_GET_U64_PARAM(params, "tableID", tableID);
@@ -1195,6 +1299,7 @@ ClientRequest* ShardHTTPClientSession::ProcessListKeyValues()
     HTTP_GET_OPT_PARAM(params, "endKey", endKey);
     HTTP_GET_OPT_PARAM(params, "prefix", prefix);
     HTTP_GET_OPT_PARAM(params, "direction", dirBuffer);
+    HTTP_GET_OPT_PARAM(params, "filter", filter);
     count = 0;
     HTTP_GET_OPT_U64_PARAM(params, "count", count);
 
@@ -1207,6 +1312,7 @@ ClientRequest* ShardHTTPClientSession::ProcessListKeyValues()
     request->ListKeyValues(0, 0, tableID, startKey, endKey, prefix, count, forwardDirection);
 
     HTTP_GET_OPT_U64_PARAM(params, "paxosID", request->paxosID);
+    request->filter.Write(filter);
 
     return request;    
 }
@@ -1240,6 +1346,11 @@ ClientRequest* ShardHTTPClientSession::ProcessCount()
     return request;    
 }
 
+void ShardHTTPClientSession::OnConnectionWriteReady()
+{
+    shardServer->OnClientWriteReady(this);
+}
+
 void ShardHTTPClientSession::OnConnectionClose()
 {
     shardServer->OnClientClose(this);
@@ -30,6 +30,7 @@ public:
     //
     virtual void        OnComplete(ClientRequest* request, bool last);
     virtual bool        IsActive();
+    virtual bool        IsWriteReady();
     // ========================================================================================
 
 private:
@@ -61,6 +62,7 @@ private:
     ClientRequest*      ProcessListKeyValues();
     ClientRequest*      ProcessCount();    
     void                OnConnectionClose();
+    void                OnConnectionWriteReady();
     bool                GetRedirectedShardServer(uint64_t tableID, const ReadBuffer& key, Buffer& location);
     
     void                OnTraceOffTimeout();
@@ -7,6 +7,7 @@
 #include "System/Config.h"
 
 #define SHARD_MIGRATION_WRITER (shardServer->GetShardMigrationWriter())
+#define LOAD_TRACKER           (shardServer->GetLoadTracker())
 
 ShardHeartbeatManager::ShardHeartbeatManager()
 {
@@ -41,6 +42,7 @@ void ShardHeartbeatManager::OnHeartbeatTimeout()
     ConfigQuorum*           configQuorum;
     StorageEnvironment*     env;
     StorageShard*           shard;
+    ShardLoad*              load;
     
     Log_Trace();
     
@@ -54,6 +56,7 @@ void ShardHeartbeatManager::OnHeartbeatTimeout()
     
     configState = shardServer->GetConfigState();
     env = shardServer->GetDatabaseManager()->GetEnvironment();
+    LOAD_TRACKER->Update();
 
     ShardServer::QuorumProcessorList* quorumProcessors = shardServer->GetQuorumProcessors();
     FOREACH (itQuorumProcessor, *quorumProcessors)
@@ -79,6 +82,25 @@ void ShardHeartbeatManager::OnHeartbeatTimeout()
             quorumShardInfo.isSplitable = shard->IsSplitable();
             quorumShardInfo.shardSize = shard->GetSize();
             quorumShardInfo.splitKey.Write(shard->GetMidpoint());
+
+            load = LOAD_TRACKER->GetLoad(*itShardID);
+            if (load)
+            {
+                quorumShardInfo.readRate = load->readRate;
+                quorumShardInfo.writeRate = load->writeRate;
+                quorumShardInfo.readBytesRate = load->readBytesRate;
+                quorumShardInfo.writeBytesRate = load->writeBytesRate;
+                LOAD_TRACKER->GetSplitKey(*itShardID, shard->GetFirstKey(), shard->GetLastKey(),
+                 quorumShardInfo.loadSplitKey);
+            }
+            else
+            {
+                quorumShardInfo.readRate = 0;
+                quorumShardInfo.writeRate = 0;
+                quorumShardInfo.readBytesRate = 0;
+                quorumShardInfo.writeBytesRate = 0;
+                quorumShardInfo.loadSplitKey.Clear();
+            }
             
             if (SHARD_MIGRATION_WRITER->IsActive() && SHARD_MIGRATION_WRITER->GetShardID() == quorumShardInfo.shardID)
             {
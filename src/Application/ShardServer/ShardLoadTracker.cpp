@@ -0,0 +1,187 @@
+#include "System/Platform.h"
+
+// declared before InTreeMap.h, the uint64_t arguments are not found by argument-dependent lookup
+static inline int KeyCmp(uint64_t a, uint64_t b)
+{
+    if (a < b)
+        return -1;
+    if (a > b)
+        return 1;
+    return 0;
+}
+
+#include "ShardLoadTracker.h"
+#include "System/Events/EventLoop.h"
+
+#define SHARD_LOAD_MAX_SEEN     (1 << 30)
+
+static inline uint64_t Key(const ShardLoad* load)
+{
+    return load->shardID;
+}
+
+ShardLoad::ShardLoad()
+{
+    shardID = 0;
+    numReads = 0;
+    numWrites = 0;
+    readBytes = 0;
+    writeBytes = 0;
+    readRate = 0;
+    writeRate = 0;
+    readBytesRate = 0;
+    writeBytesRate = 0;
+    numSeen = 0;
+    numSamples = 0;
+}
+
+ShardLoadTracker::ShardLoadTracker()
+{
+    lastUpdate = 0;
+}
+
+ShardLoadTracker::~ShardLoadTracker()
+{
+    loads.DeleteTree();
+}
+
+void ShardLoadTracker::OnRead(uint64_t shardID, ReadBuffer key, unsigned numBytes)
+{
+    ShardLoad*  load;
+
+    load = Track(shardID, key);
+    load->numReads++;
+    load->readBytes += key.GetLength() + numBytes;
+}
+
+void ShardLoadTracker::OnWrite(uint64_t shardID, ReadBuffer key, unsigned numBytes)
+{
+    ShardLoad*  load;
+
+    load = Track(shardID, key);
+    load->numWrites++;
+    load->writeBytes += key.GetLength() + numBytes;
+}
+
+void ShardLoadTracker::Update()
+{
+    uint64_t    now;
+    uint64_t    elapsed;
+    ShardLoad*  load;
+    ShardLoad*  next;
+
+    now = EventLoop::Now();
+    if (lastUpdate == 0)
+        lastUpdate = now;
+    elapsed = now - lastUpdate;
+    if (elapsed < SHARD_LOAD_INTERVAL)
+        return;
+    lastUpdate = now;
+
+    for (load = loads.First(); load != NULL; load = next)
+    {
+        next = loads.Next(load);
+
+        load->readRate = (load->readRate + load->numReads * 1000 / elapsed) / 2;
+        load->writeRate = (load->writeRate + load->numWrites * 1000 / elapsed) / 2;
+        load->readBytesRate = (load->readBytesRate + load->readBytes * 1000 / elapsed) / 2;
+        load->writeBytesRate = (load->writeBytesRate + load->writeBytes * 1000 / elapsed) / 2;
+        load->numReads = 0;
+        load->numWrites = 0;
+        load->readBytes = 0;
+        load->writeBytes = 0;
+
+        // new keys replace the older samples with a higher probability
+        load->numSeen /= 2;
+
+        if (load->readRate == 0 && load->writeRate == 0)
+        {
+            loads.Remove(load);
+            delete load;
+        }
+    }
+}
+
+ShardLoad* ShardLoadTracker::GetLoad(uint64_t shardID)
+{
+    return loads.Get(shardID);
+}
+
+bool ShardLoadTracker::GetSplitKey(uint64_t shardID, ReadBuffer firstKey, ReadBuffer lastKey,
+ Buffer& splitKey)
+{
+    unsigned    i, j, num;
+    ShardLoad*  load;
+    Buffer*     tmp;
+    Buffer*     keys[SHARD_LOAD_NUM_SAMPLES];
+
+    splitKey.Clear();
+
+    load = loads.Get(shardID);
+    if (load == NULL)
+        return false;
+
+    // the shard may have been split since the keys were sampled
+    num = 0;
+    for (i = 0; i < load->numSamples; i++)
+    {
+        if (!RangeContains(firstKey, lastKey, load->samples[i]))
+            continue;
+        keys[num++] = &load->samples[i];
+    }
+    if (num < SHARD_LOAD_NUM_SAMPLES / 2)
+        return false;
+
+    for (i = 1; i < num; i++)
+    {
+        tmp = keys[i];
+        for (j = i; j > 0 && Buffer::Cmp(*keys[j - 1], *tmp) > 0; j--)
+            keys[j] = keys[j - 1];
+        keys[j] = tmp;
+    }
+
+    // the first key of the new shard must be inside the range of the parent
+    for (i = num / 2; i < num; i++)
+    {
+        if (ReadBuffer::Cmp(firstKey, *keys[i]) != 0)
+            break;
+    }
+    if (i == num)
+        return false;
+
+    splitKey.Write(*keys[i]);
+    return true;
+}
+
+ShardLoad* ShardLoadTracker::Track(uint64_t shardID, ReadBuffer key)
+{
+    int         cmpres;
+    unsigned    i;
+    ShardLoad*  load;
+    ShardLoad*  newLoad;
+
+    load = loads.Locate(shardID, cmpres);
+    if (cmpres != 0 || load == NULL)
+    {
+        newLoad = new ShardLoad;
+        newLoad->shardID = shardID;
+        loads.InsertAt(newLoad, load, cmpres);
+        load = newLoad;
+    }
+
+    // reservoir sampling of the keys
+    if (load->numSeen < SHARD_LOAD_MAX_SEEN)
+        load->numSeen++;
+    if (load->numSamples < SHARD_LOAD_NUM_SAMPLES)
+    {
+        load->samples[load->numSamples++].Write(key);
+    }
+    else
+    {
+        i = (unsigned) RandomInt(0, (int) MAX(load->numSeen, SHARD_LOAD_NUM_SAMPLES) - 1);
+        if (i < SHARD_LOAD_NUM_SAMPLES)
+            load->samples[i].Write(key);
+    }
+
+    return load;
+}
@@ -0,0 +1,83 @@
+#ifndef SHARDLOADTRACKER_H
+#define SHARDLOADTRACKER_H
+
+#include "System/Buffers/Buffer.h"
+#include "System/Containers/InTreeMap.h"
+
+#define SHARD_LOAD_NUM_SAMPLES      64
+#define SHARD_LOAD_INTERVAL         1000    // msec
+
+/*
+===============================================================================================
+
+ ShardLoad
+
+ The requests of one shard: counters of the current interval, rates smoothed over the
+ previous intervals and a reservoir sample of the accessed keys.
+
+===============================================================================================
+*/
+
+class ShardLoad
+{
+    typedef InTreeNode<ShardLoad> TreeNode;
+
+public:
+    ShardLoad();
+
+    uint64_t        shardID;
+
+    uint64_t        numReads;
+    uint64_t        numWrites;
+    uint64_t        readBytes;
+    uint64_t        writeBytes;
+
+    uint64_t        readRate;
+    uint64_t        writeRate;
+    uint64_t        readBytesRate;
+    uint64_t        writeBytesRate;
+
+    uint64_t        numSeen;
+    unsigned        numSamples;
+    Buffer          samples[SHARD_LOAD_NUM_SAMPLES];
+
+    TreeNode        treeNode;
+};
+
+/*
+===============================================================================================
+
+ ShardLoadTracker
+
+ Counts the reads and writes of the shards, reported in the heartbeat to the controllers.
+ The split key is the median of the sampled keys, so that both halves of a hot shard get
+ about the same number of requests. The weight of the older samples halves every interval.
+
+===============================================================================================
+*/
+
+class ShardLoadTracker
+{
+    typedef InTreeMap<ShardLoad> LoadMap;
+
+public:
+    ShardLoadTracker();
+    ~ShardLoadTracker();
+
+    void            OnRead(uint64_t shardID, ReadBuffer key, unsigned numBytes);
+    void            OnWrite(uint64_t shardID, ReadBuffer key, unsigned numBytes);
+
+    void            Update();
+
+    ShardLoad*      GetLoad(uint64_t shardID);
+    bool            GetSplitKey(uint64_t shardID, ReadBuffer firstKey, ReadBuffer lastKey,
+                     Buffer& splitKey);
+
+private:
+    ShardLoad*      Track(uint64_t shardID, ReadBuffer key);
+
+    uint64_t        lastUpdate;
+    LoadMap         loads;
+};
+
+#endif
@@ -2,11 +2,6 @@
 #include "ShardTransactionManager.h"
 #include "System/Events/EventLoop.h"
 
-static inline int KeyCmp(const Buffer& a, const Buffer& b)
-{
-    return Buffer::Cmp(a, b);
-}
-
 static inline const Buffer& Key(const ShardLock* lock)
 {
     return lock->key;
@@ -55,9 +50,9 @@ unsigned ShardLockManager::GetNumLocks()
     return numLocked;
 }
 
-unsigned ShardLockManager::GetTreeCount()
+unsigned ShardLockManager::GetTableCount()
 {
-    return lockTree.GetCount();
+    return lockTable.GetCount();
 }
 
 unsigned ShardLockManager::GetCacheListLength()
@@ -117,28 +112,22 @@ unsigned ShardLockManager::GetMaxPoolCount()
 
 bool ShardLockManager::TryLock(ReadBuffer key, ClientSession* session)
 {
-    int         cmpres;
-    Buffer      keyBuffer;
     ShardLock*  lock;
-    ShardLock*  newLock;
     
-    keyBuffer.Write(key);
+    lock = lockTable.Get(key);
     
-    lock = lockTree.Locate(keyBuffer, cmpres);
-    
-    if (!FOUND_IN_TREE(lock, cmpres))
+    if (!lock)
     {
-        // not in tree
-        newLock = NewLock();
-        newLock->key.Write(key);
-        lockTree.InsertAt(newLock, lock, cmpres);
-        lock = newLock;
+        // not in table
+        lock = NewLock();
+        lock->key.Write(key);
+        lockTable.Insert(lock);
     }
     else if (lock->locked)
         return false;
     else
     {
-        // in tree, not locked
+        // in table, not locked
         // in lock cache list
         ASSERT(lock->listCacheNode.next != lock);
         lockCacheList.Remove(lock);
@@ -149,7 +138,7 @@ bool ShardLockManager::TryLock(ReadBuffer key, ClientSession* session)
         ASSERT(lock->listPoolNode.next == lock);
     }
 
-    // in tree, not locked
+    // in table, not locked
     lock->locked = true;
     lock->session = session;
     numLocked++;
@@ -158,8 +147,8 @@ bool ShardLockManager::TryLock(ReadBuffer key, ClientSession* session)
     lockExpiryList.Append(lock);
     UpdateExpireLockTimeout();
 
-    // in lock tree
-    ASSERT(lock->treeNode.IsInTree());
+    // in lock table
+    ASSERT(lock->hashNode.IsInTable());
     // not in lock cache list
     ASSERT(lock->listCacheNode.next == lock);
     // in lock expiry list
@@ -174,12 +163,9 @@ bool ShardLockManager::TryLock(ReadBuffer key, ClientSession* session)
 
 bool ShardLockManager::IsLocked(ReadBuffer key)
 {
-    Buffer      keyBuffer;
     ShardLock*  lock;
     
-    keyBuffer.Write(key);
-    
-    lock = lockTree.Get(keyBuffer);
+    lock = lockTable.Get(key);
     if (!lock)
         return false;
     
@@ -188,14 +174,12 @@ bool ShardLockManager::IsLocked(ReadBuffer key)
 
 void ShardLockManager::Unlock(ReadBuffer key)
 {
-    Buffer      keyBuffer;
     ShardLock*  lock;
     
-    keyBuffer.Write(key);
-    lock = lockTree.Get(keyBuffer);
+    lock = lockTable.Get(key);
     
     if (!lock)
-        return; // not in tree
+        return; // not in table
 
     if (lock->locked)
         Unlock(lock);
@@ -206,7 +190,7 @@ void ShardLockManager::UnlockAll()
     lockCacheList.Clear();
     lockExpiryList.Clear();
     lockPoolList.DeleteList();
-    lockTree.DeleteTree();
+    lockTable.DeleteTable();
     numLocked = 0;
     UpdateExpireLockTimeout();
 }
@@ -228,12 +212,12 @@ void ShardLockManager::OnRemoveCachedLocks()
         ASSERT(lock->listExpiryNode.next == lock);
         // not in lock pool list
         ASSERT(lock->listPoolNode.next == lock);
-        // in tree
-        ASSERT(lock->treeNode.IsInTree());
+        // in table
+        ASSERT(lock->hashNode.IsInTable());
 
         if (lock->unlockTime < now || lockCacheList.GetLength() > maxCacheCount)
         {
-            lockTree.Remove(lock);
+            lockTable.Remove(lock);
             lockCacheList.Remove(lock);
             DeleteLock(lock);
         }
@@ -258,8 +242,8 @@ void ShardLockManager::OnExpireLocks(ShardTransactionManager* transactionManager
         ASSERT(lock->locked);
         // session is set
         ASSERT(lock->session);
-        // in tree
-        ASSERT(lock->treeNode.IsInTree());
+        // in table
+        ASSERT(lock->hashNode.IsInTable());
         // not in lock cache list
         ASSERT(lock->listCacheNode.next == lock);
         // not in lock pool list
@@ -281,7 +265,7 @@ void ShardLockManager::OnExpireLocks(ShardTransactionManager* transactionManager
 
  void ShardLockManager::Unlock(ShardLock* lock)
 {
-    // in tree, locked
+    // in table, locked
     lock->locked = false;
     lock->session = NULL;
     numLocked--;
@@ -323,8 +307,8 @@ ShardLock* ShardLockManager::NewLock()
     ASSERT(lock->locked == false);
     ASSERT(lock->session == NULL);
     ASSERT(lock->expireTime == 0);
-    // not in lock tree
-    ASSERT(!lock->treeNode.IsInTree());
+    // not in lock table
+    ASSERT(!lock->hashNode.IsInTable());
     // not in lock cache list
     ASSERT(lock->listCacheNode.next == lock);
     // not in lock expiry list
@@ -337,8 +321,8 @@ ShardLock* ShardLockManager::NewLock()
 
 void ShardLockManager::DeleteLock(ShardLock* lock)
 {
-    // not in lock tree
-    ASSERT(!lock->treeNode.IsInTree());
+    // not in lock table
+    ASSERT(!lock->hashNode.IsInTable());
     // not in lock cache list
     ASSERT(lock->listCacheNode.next == lock);
     // not in lock expiry list
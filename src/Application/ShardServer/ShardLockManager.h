@@ -3,7 +3,7 @@
 
 #include "System/Buffers/Buffer.h"
 #include "System/Events/Countdown.h"
-#include "System/Containers/InTreeMap.h"
+#include "System/Containers/InHashTable.h"
 #include "System/Containers/InNodeList.h"
 
 #define LOCK_CHECK_FREQUENCY        (1000)      // msec
@@ -24,7 +24,7 @@ class ClientSession;
 
 class ShardLock
 {
-    typedef InTreeNode<ShardLock> TreeNode;
+    typedef InHashNode<ShardLock> HashNode;
     typedef InListNode<ShardLock> ListNode;
 
 public:
@@ -38,7 +38,7 @@ public:
     Buffer          key;
     ClientSession*  session;
 
-    TreeNode        treeNode;
+    HashNode        hashNode;
     ListNode        listCacheNode;
     ListNode        listPoolNode;
     ListNode        listExpiryNode;
@@ -56,7 +56,7 @@ class ShardTransactionManager;
 
 class ShardLockManager
 {
-    typedef InTreeMap<ShardLock>                                LockTree;
+    typedef InHashTable<ShardLock>                              LockTable;
     typedef InNodeList<ShardLock, &ShardLock::listCacheNode>    LockCacheList;
     typedef InNodeList<ShardLock, &ShardLock::listExpiryNode>   LockExpiryList;
     typedef InNodeList<ShardLock, &ShardLock::listPoolNode>     LockPoolList;
@@ -70,7 +70,7 @@ public:
     
     // internal data structures stats
     unsigned        GetNumLocks();
-    unsigned        GetTreeCount();
+    unsigned        GetTableCount();
     unsigned        GetCacheListLength();
     unsigned        GetPoolListLength();
     unsigned        GetExpiryListLength();
@@ -102,7 +102,7 @@ private:
     void            UpdateExpireLockTimeout();
 
     unsigned        numLocked;
-    LockTree        lockTree;
+    LockTable       lockTable;
     LockCacheList   lockCacheList;
     LockPoolList    lockPoolList;
     LockExpiryList  lockExpiryList;
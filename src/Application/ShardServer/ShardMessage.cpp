@@ -1,4 +1,5 @@
 #include "ShardMessage.h"
+#include "System/Buffers/Varint.h"
 
 ShardMessage::ShardMessage()
 {
@@ -13,7 +14,9 @@ bool ShardMessage::IsClientWrite()
     return (type == SHARDMESSAGE_SET ||
             type == SHARDMESSAGE_ADD ||
             type == SHARDMESSAGE_SEQUENCE_ADD ||
-            type == SHARDMESSAGE_DELETE);
+            type == SHARDMESSAGE_DELETE ||
+            type == SHARDMESSAGE_SET_IF_VERSION ||
+            type == SHARDMESSAGE_DELETE_IF_VERSION);
 }
 
 void ShardMessage::SplitShard(uint64_t shardID_, uint64_t newShardID_, ReadBuffer& splitKey_)
@@ -56,6 +59,14 @@ void ShardMessage::ShardMigrationDelete(uint64_t shardID_, ReadBuffer& key_)
     key.Wrap(migrationKey);
 }
 
+void ShardMessage::ShardMigrationBatch(uint64_t shardID_, ReadBuffer& block)
+{
+    type = SHARDMESSAGE_MIGRATION_BATCH;
+    shardID = shardID_;
+    migrationValue.Write(block);
+    value.Wrap(migrationValue);
+}
+
 void ShardMessage::ShardMigrationComplete(uint64_t shardID_)
 {
     type = SHARDMESSAGE_MIGRATION_COMPLETE;
@@ -65,6 +76,12 @@ void ShardMessage::ShardMigrationComplete(uint64_t shardID_)
 void ShardMessage::StartTransaction()
 {
     type = SHARDMESSAGE_START_TRANSACTION;
+    value.Reset();
+}
+
+bool ShardMessage::IsBinary(ReadBuffer& buffer)
+{
+    return (buffer.GetLength() > 0 && buffer.GetCharAt(0) == SHARDMESSAGE_BINARY_VERSION);
 }
 
 int ShardMessage::Read(ReadBuffer& buffer)
@@ -74,6 +91,9 @@ int ShardMessage::Read(ReadBuffer& buffer)
     if (buffer.GetLength() < 1)
         return 0;
     
+    if (IsBinary(buffer))
+        return ReadBinary(buffer);
+
     switch (buffer.GetCharAt(0))
     {
         // Data manipulation
@@ -90,8 +110,25 @@ int ShardMessage::Read(ReadBuffer& buffer)
             read = buffer.Readf("%c:%U:%#R",
              &type, &tableID, &key);
             break;
+        case SHARDMESSAGE_SET_IF_VERSION:
+            read = buffer.Readf("%c:%U:%#R:%U:%U:%#R",
+             &type, &tableID, &key, &versionPaxosID, &versionCommandID, &value);
+            break;
+        case SHARDMESSAGE_DELETE_IF_VERSION:
+            read = buffer.Readf("%c:%U:%#R:%U:%U",
+             &type, &tableID, &key, &versionPaxosID, &versionCommandID);
+            break;
         // Transactions
         case SHARDMESSAGE_START_TRANSACTION:
+            // the read versions of an optimistic transaction are optional
+            value.Reset();
+            if (buffer.GetLength() > 1 && buffer.GetCharAt(1) == ':')
+                read = buffer.Readf("%c:%#R",
+                 &type, &value);
+            else
+                read = buffer.Readf("%c",
+                 &type);
+            break;
         case SHARDMESSAGE_COMMIT_TRANSACTION:
             read = buffer.Readf("%c",
              &type);
@@ -118,6 +155,10 @@ int ShardMessage::Read(ReadBuffer& buffer)
             read = buffer.Readf("%c:%U:%#R",
              &type, &shardID, &key);
             break;
+        case SHARDMESSAGE_MIGRATION_BATCH:
+            read = buffer.Readf("%c:%U:%#R",
+             &type, &shardID, &value);
+            break;
         case SHARDMESSAGE_MIGRATION_COMPLETE:
             read = buffer.Readf("%c:%U",
              &type, &shardID);
@@ -147,8 +188,23 @@ bool ShardMessage::Append(Buffer& buffer)
             buffer.Appendf("%c:%U:%#R",
              type, tableID, &key);
             break;
+        case SHARDMESSAGE_SET_IF_VERSION:
+            buffer.Appendf("%c:%U:%#R:%U:%U:%#R",
+             type, tableID, &key, versionPaxosID, versionCommandID, &value);
+            break;
+        case SHARDMESSAGE_DELETE_IF_VERSION:
+            buffer.Appendf("%c:%U:%#R:%U:%U",
+             type, tableID, &key, versionPaxosID, versionCommandID);
+            break;
         // Transactions
         case SHARDMESSAGE_START_TRANSACTION:
+            if (value.GetLength() > 0)
+                buffer.Appendf("%c:%#R",
+                 type, &value);
+            else
+                buffer.Appendf("%c",
+                 type);
+            break;
         case SHARDMESSAGE_COMMIT_TRANSACTION:
             buffer.Appendf("%c",
              type);
@@ -175,6 +231,10 @@ bool ShardMessage::Append(Buffer& buffer)
             buffer.Appendf("%c:%U:%#R",
              type, shardID, &key);
             break;
+        case SHARDMESSAGE_MIGRATION_BATCH:
+            buffer.Appendf("%c:%U:%#R",
+             type, shardID, &value);
+            break;
         case SHARDMESSAGE_MIGRATION_COMPLETE:
             buffer.Appendf("%c:%U",
              type, shardID);
@@ -185,3 +245,187 @@ bool ShardMessage::Append(Buffer& buffer)
     
     return true;
 }
+
+bool ShardMessage::AppendBinary(Buffer& buffer)
+{
+    unsigned    start;
+    uint32_t    length;
+    ReadBuffer  rb;
+
+    start = buffer.GetLength();
+    buffer.Append(SHARDMESSAGE_BINARY_VERSION);
+    buffer.AppendLittle32(0); // body length, set below
+    buffer.Append(type);
+
+    switch (type)
+    {
+        // Data manipulation
+        case SHARDMESSAGE_SET:
+            buffer.AppendVarint(tableID);
+            AppendSlice(buffer, key);
+            AppendSlice(buffer, value);
+            break;
+        case SHARDMESSAGE_ADD:
+        case SHARDMESSAGE_SEQUENCE_ADD:
+            buffer.AppendVarint(tableID);
+            AppendSlice(buffer, key);
+            buffer.AppendVarint(ZigZagEncode(number));
+            break;
+        case SHARDMESSAGE_DELETE:
+            buffer.AppendVarint(tableID);
+            AppendSlice(buffer, key);
+            break;
+        case SHARDMESSAGE_SET_IF_VERSION:
+            buffer.AppendVarint(tableID);
+            AppendSlice(buffer, key);
+            buffer.AppendVarint(versionPaxosID);
+            buffer.AppendVarint(versionCommandID);
+            AppendSlice(buffer, value);
+            break;
+        case SHARDMESSAGE_DELETE_IF_VERSION:
+            buffer.AppendVarint(tableID);
+            AppendSlice(buffer, key);
+            buffer.AppendVarint(versionPaxosID);
+            buffer.AppendVarint(versionCommandID);
+            break;
+        // Transactions
+        case SHARDMESSAGE_START_TRANSACTION:
+            if (value.GetLength() > 0)
+                AppendSlice(buffer, value);
+            break;
+        case SHARDMESSAGE_COMMIT_TRANSACTION:
+            break;
+        // Shard splitting
+        case SHARDMESSAGE_SPLIT_SHARD:
+            buffer.AppendVarint(shardID);
+            buffer.AppendVarint(newShardID);
+            rb.Wrap(splitKey);
+            AppendSlice(buffer, rb);
+            break;
+        // Shard migration
+        case SHARDMESSAGE_TRUNCATE_TABLE:
+            buffer.AppendVarint(tableID);
+            buffer.AppendVarint(newShardID);
+            break;
+        case SHARDMESSAGE_MIGRATION_BEGIN:
+            buffer.AppendVarint(srcShardID);
+            buffer.AppendVarint(dstShardID);
+            break;
+        case SHARDMESSAGE_MIGRATION_SET:
+            buffer.AppendVarint(shardID);
+            AppendSlice(buffer, key);
+            AppendSlice(buffer, value);
+            break;
+        case SHARDMESSAGE_MIGRATION_DELETE:
+            buffer.AppendVarint(shardID);
+            AppendSlice(buffer, key);
+            break;
+        case SHARDMESSAGE_MIGRATION_BATCH:
+            buffer.AppendVarint(shardID);
+            AppendSlice(buffer, value);
+            break;
+        case SHARDMESSAGE_MIGRATION_COMPLETE:
+            buffer.AppendVarint(shardID);
+            break;
+        default:
+            buffer.SetLength(start);
+            return false;
+    }
+
+    length = ToLittle32(buffer.GetLength() - start - SHARDMESSAGE_BINARY_HEADER_SIZE);
+    memcpy(buffer.GetBuffer() + start + 1, &length, sizeof(uint32_t));
+
+    return true;
+}
+
+int ShardMessage::ReadBinary(ReadBuffer& buffer)
+{
+    bool        ret;
+    uint32_t    length;
+    uint64_t    u64;
+    const char* p;
+    const char* end;
+    ReadBuffer  slice;
+
+    if (buffer.GetLength() < SHARDMESSAGE_BINARY_HEADER_SIZE)
+        return 0;
+
+    p = buffer.GetBuffer();
+    memcpy(&length, p + 1, sizeof(uint32_t));
+    length = FromLittle32(length);
+    if (length < 1 || length > buffer.GetLength() - SHARDMESSAGE_BINARY_HEADER_SIZE)
+        return 0;
+
+    p += SHARDMESSAGE_BINARY_HEADER_SIZE;
+    end = p + length;
+    type = *p++;
+
+    // fields added by later versions are appended to the body, and skipped here
+    switch (type)
+    {
+        // Data manipulation
+        case SHARDMESSAGE_SET:
+            ret = DecodeVarint(p, end, tableID) && DecodeSlice(p, end, key) && DecodeSlice(p, end, value);
+            break;
+        case SHARDMESSAGE_ADD:
+        case SHARDMESSAGE_SEQUENCE_ADD:
+            ret = DecodeVarint(p, end, tableID) && DecodeSlice(p, end, key) && DecodeVarint(p, end, u64);
+            if (ret)
+                number = ZigZagDecode(u64);
+            break;
+        case SHARDMESSAGE_DELETE:
+            ret = DecodeVarint(p, end, tableID) && DecodeSlice(p, end, key);
+            break;
+        case SHARDMESSAGE_SET_IF_VERSION:
+            ret = DecodeVarint(p, end, tableID) && DecodeSlice(p, end, key) &&
+             DecodeVarint(p, end, versionPaxosID) && DecodeVarint(p, end, versionCommandID) &&
+             DecodeSlice(p, end, value);
+            break;
+        case SHARDMESSAGE_DELETE_IF_VERSION:
+            ret = DecodeVarint(p, end, tableID) && DecodeSlice(p, end, key) &&
+             DecodeVarint(p, end, versionPaxosID) && DecodeVarint(p, end, versionCommandID);
+            break;
+        // Transactions
+        case SHARDMESSAGE_START_TRANSACTION:
+            value.Reset();
+            ret = true;
+            if (p < end)
+                ret = DecodeSlice(p, end, value);
+            break;
+        case SHARDMESSAGE_COMMIT_TRANSACTION:
+            ret = true;
+            break;
+        // Shard splitting
+        case SHARDMESSAGE_SPLIT_SHARD:
+            ret = DecodeVarint(p, end, shardID) && DecodeVarint(p, end, newShardID) &&
+             DecodeSlice(p, end, slice);
+            splitKey.Write(slice);
+            break;
+        // Shard migration
+        case SHARDMESSAGE_TRUNCATE_TABLE:
+            ret = DecodeVarint(p, end, tableID) && DecodeVarint(p, end, newShardID);
+            break;
+        case SHARDMESSAGE_MIGRATION_BEGIN:
+            ret = DecodeVarint(p, end, srcShardID) && DecodeVarint(p, end, dstShardID);
+            break;
+        case SHARDMESSAGE_MIGRATION_SET:
+            ret = DecodeVarint(p, end, shardID) && DecodeSlice(p, end, key) && DecodeSlice(p, end, value);
+            break;
+        case SHARDMESSAGE_MIGRATION_DELETE:
+            ret = DecodeVarint(p, end, shardID) && DecodeSlice(p, end, key);
+            break;
+        case SHARDMESSAGE_MIGRATION_BATCH:
+            ret = DecodeVarint(p, end, shardID) && DecodeSlice(p, end, value);
+            break;
+        case SHARDMESSAGE_MIGRATION_COMPLETE:
+            ret = DecodeVarint(p, end, shardID);
+            break;
+        default:
+            return 0;
+    }
+
+    if (!ret)
+        return 0;
+
+    return SHARDMESSAGE_BINARY_HEADER_SIZE + length;
+}
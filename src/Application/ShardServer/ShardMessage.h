@@ -8,6 +8,8 @@
 #define SHARDMESSAGE_ADD                    'a'
 #define SHARDMESSAGE_SEQUENCE_ADD           'A'
 #define SHARDMESSAGE_DELETE                 'X'
+#define SHARDMESSAGE_SET_IF_VERSION         'v'
+#define SHARDMESSAGE_DELETE_IF_VERSION      'V'
 #define SHARDMESSAGE_START_TRANSACTION      '<'
 #define SHARDMESSAGE_COMMIT_TRANSACTION     '>'
 #define SHARDMESSAGE_SPLIT_SHARD            'z'
@@ -16,6 +18,11 @@
 #define SHARDMESSAGE_MIGRATION_SET          '2'
 #define SHARDMESSAGE_MIGRATION_DELETE       '3'
 #define SHARDMESSAGE_MIGRATION_COMPLETE     '4'
+#define SHARDMESSAGE_MIGRATION_BATCH        '5'
+
+// first byte of a binary encoded message, never a valid text message type
+#define SHARDMESSAGE_BINARY_VERSION         '\001'
+#define SHARDMESSAGE_BINARY_HEADER_SIZE     5       // version, body length
 
 class ClientRequest;
 
@@ -24,6 +31,12 @@ class ClientRequest;
 
  ShardMessage
 
+ Messages are replicated either in the text format, separated by a space, or in the
+ binary format: a version byte, a 32-bit little endian body length, then the body
+ starting with the type. Integers in the body are varints, keys and values are
+ varint length prefixed slices, which are wrapped and not copied by Read().
+ Read() accepts both formats, so values written by older versions can be replayed.
+
 ===============================================================================================
 */
 
@@ -39,6 +52,8 @@ public:
     uint64_t        srcShardID;
     uint64_t        dstShardID;
     int64_t         number;
+    uint64_t        versionPaxosID;
+    uint64_t        versionCommandID;
     ReadBuffer      key;
     ReadBuffer      value;
     ReadBuffer      test;
@@ -58,17 +73,23 @@ public:
     void            ShardMigrationBegin(uint64_t srcShardID, uint64_t dstShardID);
     void            ShardMigrationSet(uint64_t shardID, ReadBuffer& key, ReadBuffer& value);
     void            ShardMigrationDelete(uint64_t shardID, ReadBuffer& key);
+    void            ShardMigrationBatch(uint64_t shardID, ReadBuffer& block);
     void            ShardMigrationComplete(uint64_t shardID);
     
     void            StartTransaction();
 
     // Serialization
+    static bool     IsBinary(ReadBuffer& buffer);
     int             Read(ReadBuffer& buffer);
     bool            Append(Buffer& buffer);
+    bool            AppendBinary(Buffer& buffer);
 
     // For InList<>
     ShardMessage*   prev;
     ShardMessage*   next;
+
+private:
+    int             ReadBinary(ReadBuffer& buffer);
 };
 
 #endif
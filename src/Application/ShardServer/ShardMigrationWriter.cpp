@@ -1,12 +1,34 @@
 #include "ShardMigrationWriter.h"
 #include "ShardServer.h"
 #include "ShardQuorumProcessor.h"
+#include "System/Config.h"
+#include "System/Registry.h"
+
+#define SCHEDULER   (shardServer->GetScheduler())
+
+static inline int KeyCmp(const ReadBuffer& a, const ReadBuffer& b)
+{
+    return ReadBuffer::Cmp(a, b);
+}
+
+static inline const ReadBuffer Key(const ShardMigrationTailKey* tailKey)
+{
+    return ReadBuffer(tailKey->key);
+}
 
 ShardMigrationWriter::ShardMigrationWriter()
 {
     onTimeout.SetCallable(MFUNC(ShardMigrationWriter, OnTimeout));
     onTimeout.SetDelay(SHARD_MIGRATION_WRITER_DELAY);
+    onCutover.SetCallable(MFUNC(ShardMigrationWriter, OnWriteReadyness));
+    onCutover.SetDelay(SHARD_MIGRATION_CUTOVER_DELAY);
+    onThrottle.SetCallable(MFUNC(ShardMigrationWriter, OnThrottle));
+    onThrottle.SetDelay(SHARD_MIGRATION_THROTTLE_DELAY);
+    onDefer.SetCallable(MFUNC(ShardMigrationWriter, OnThrottle));
+    onDefer.SetDelay(SHARD_SCHEDULER_DEFER_DELAY);
     writeReadyness.SetCallable(MFUNC(ShardMigrationWriter, OnWriteReadyness));
+    fencedShardID = 0;
+    tailSize = 0;
     Reset();
 }
 
@@ -14,12 +36,22 @@ ShardMigrationWriter::~ShardMigrationWriter()
 {
     if (cursor != NULL)
         delete cursor;
+    tailKeys.DeleteTree();
 }
 
 void ShardMigrationWriter::Init(ShardServer* shardServer_)
 {
     shardServer = shardServer_;
     environment = shardServer->GetDatabaseManager()->GetEnvironment();
+    batching = configFile.GetBoolValue("migrationBatching", true);
+    compression = configFile.GetBoolValue("migrationCompression", true);
+    cutoverSize = (uint64_t) configFile.GetInt64Value("migrationCutoverSize", 64*KiB);
+    maxTailTime = (uint64_t) configFile.GetInt64Value("migrationMaxTailTime", 60*1000);
+    maxThroughput = (uint64_t) configFile.GetInt64Value("migrationMaxThroughput", 0);
+
+    numTailKeysSent = Registry::GetUintPtr("migration.numTailKeysSent");
+    fencedTime = Registry::GetUintPtr("migration.fencedTime");
+    lastFencedTime = Registry::GetUintPtr("migration.lastFencedTime");
 
     Reset();
 }
@@ -28,22 +60,34 @@ void ShardMigrationWriter::Reset()
 {
     cursor = NULL;
     isActive = false;
+    isPaused = false;
     sendFirst = false;
+    phase = SHARD_MIGRATION_COPY;
     quorumProcessor = NULL;
     bytesSent = 0;
     bytesTotal = 0;
     startTime = 0;
+    tailStartTime = 0;
+    fenceStartTime = 0;
+    deferStartTime = 0;
     prevBytesSent = 0;
+    batch.Clear();
+    ClearTail();
     EventLoop::Remove(&onTimeout);
+    EventLoop::Remove(&onCutover);
+    EventLoop::Remove(&onThrottle);
+    EventLoop::Remove(&onDefer);
 }
 
 void ShardMigrationWriter::Pause()
 {
+    isPaused = true;
     CONTEXT_TRANSPORT->UnregisterWriteReadyness(&writeReadyness);
 }
 
 void ShardMigrationWriter::Resume()
 {
+    isPaused = false;
     CONTEXT_TRANSPORT->RegisterWriteReadyness(&writeReadyness);
 }
 
@@ -52,6 +96,24 @@ bool ShardMigrationWriter::IsActive()
     return isActive;
 }
 
+bool ShardMigrationWriter::IsFenced(uint64_t shardID)
+{
+    ConfigState*    configState;
+
+    if (fencedShardID == 0 || fencedShardID != shardID)
+        return false;
+
+    // the fence is lifted when the migration is completed or aborted by the controllers
+    configState = shardServer->GetConfigState();
+    if (!configState->isMigrating || configState->migrateSrcShardID != shardID)
+    {
+        fencedShardID = 0;
+        return false;
+    }
+
+    return true;
+}
+
 uint64_t ShardMigrationWriter::GetShardID()
 {
     return srcShardID;
@@ -80,21 +142,50 @@ uint64_t ShardMigrationWriter::GetBytesTotal()
 uint64_t ShardMigrationWriter::GetThroughput()
 {
     uint64_t now;
-    
+
     now = NowClock();
-    
+
     if (now > startTime)
         return (uint64_t)(bytesSent / ((now - startTime)/1000.0));
     else
         return 0;
 }
 
+const char* ShardMigrationWriter::GetPhaseName()
+{
+    switch (phase)
+    {
+        case SHARD_MIGRATION_COPY:
+            return "copy";
+        case SHARD_MIGRATION_TAIL:
+            return "tail";
+        case SHARD_MIGRATION_FENCED:
+            return "fenced";
+        default:
+            ASSERT_FAIL();
+            return NULL;
+    }
+}
+
+unsigned ShardMigrationWriter::GetNumTailKeys()
+{
+    return tailKeys.GetCount();
+}
+
+uint64_t ShardMigrationWriter::GetFencedTime()
+{
+    if (phase != SHARD_MIGRATION_FENCED)
+        return 0;
+
+    return NowClock() - fenceStartTime;
+}
+
 void ShardMigrationWriter::Begin(ClusterMessage& request)
 {
     ConfigState*        configState;
     ConfigShard*        configShard;
     ConfigShardServer*  configShardServer;
-    
+
     ASSERT(!isActive);
     ASSERT(cursor == NULL);
 
@@ -103,22 +194,23 @@ void ShardMigrationWriter::Begin(ClusterMessage& request)
     ASSERT(configShard != NULL);
     configShardServer = configState->GetShardServer(request.nodeID);
     ASSERT(configShardServer != NULL);
-    
+
     quorumProcessor = shardServer->GetQuorumProcessor(configShard->quorumID);
     ASSERT(quorumProcessor != NULL);
-    
+
     isActive = true;
     nodeID = request.nodeID;
     writeReadyness.nodeID = request.nodeID;
     quorumID = request.quorumID;
     srcShardID = request.srcShardID;
     dstShardID = request.dstShardID;
-    
+    fencedShardID = 0;
+
     bytesTotal = environment->GetSize(QUORUM_DATABASE_DATA_CONTEXT, srcShardID);
     startTime = NowClock();
-    
+
     CONTEXT_TRANSPORT->AddConnection(nodeID, configShardServer->endpoint);
-    
+
     Log_Debug("ShardMigrationWriter::Begin() nodeID = %U", nodeID);
     Log_Debug("ShardMigrationWriter::Begin() quorumID = %U", quorumID);
     Log_Debug("ShardMigrationWriter::Begin() srcShardID = %U", srcShardID);
@@ -135,26 +227,42 @@ void ShardMigrationWriter::Begin(ClusterMessage& request)
 void ShardMigrationWriter::Abort()
 {
     Log_Message("Aborting shard migration...");
-    
+
     CONTEXT_TRANSPORT->UnregisterWriteReadyness(&writeReadyness);
-    Reset();
+    fencedShardID = 0;
 
     if (cursor != NULL)
     {
         delete cursor;
         cursor = NULL;
     }
+
+    Reset();
+}
+
+void ShardMigrationWriter::OnWrite(ReadBuffer& key)
+{
+    int                     cmpres;
+    ShardMigrationTailKey*  tailKey;
+    ShardMigrationTailKey*  newTailKey;
+
+    tailKey = tailKeys.Locate(key, cmpres);
+    if (tailKey != NULL && cmpres == 0)
+        return;
+
+    newTailKey = new ShardMigrationTailKey;
+    newTailKey->key.Write(key);
+    tailKeys.InsertAt(newTailKey, tailKey, cmpres);
+    tailSize += key.GetLength();
 }
 
 void ShardMigrationWriter::SendFirst()
 {
     ClusterMessage      msg;
-    ReadBuffer          key;
-    ReadBuffer          value;
 
     ASSERT(cursor == NULL);
+    // the cursor does not block the shard, the keys written meanwhile are sent from the tail
     cursor = environment->GetBulkCursor(QUORUM_DATABASE_DATA_CONTEXT, srcShardID);
-    cursor->SetOnBlockShard(MFUNC(ShardMigrationWriter, OnBlockShard), MFUNC(ShardMigrationWriter, OnUnblockShard));
 
     msg.ShardMigrationBegin(quorumID, srcShardID, dstShardID);
     CONTEXT_TRANSPORT->SendClusterMessage(nodeID, msg);
@@ -166,27 +274,98 @@ void ShardMigrationWriter::SendFirst()
     if (kv)
         SendItem(kv);
     else
-        SendCommit();
+        SendNext();
 }
 
 void ShardMigrationWriter::SendNext()
 {
     ASSERT(cursor != NULL);
-    kv = cursor->Next(kv);
     if (kv)
+        kv = cursor->Next(kv);
+    if (kv)
+    {
         SendItem(kv);
-    else
-        SendCommit();
+        return;
+    }
+
+    // the destination would miss the keys that could not be read
+    if (cursor->HasReadError())
+    {
+        Log_Message("Unable to read shard %U for migration", srcShardID);
+        Abort();
+        return;
+    }
+
+    delete cursor;
+    cursor = NULL;
+
+    phase = SHARD_MIGRATION_TAIL;
+    tailStartTime = NowClock();
+    Log_Message("Copied shard %U, sending the %u keys written meanwhile...",
+     srcShardID, tailKeys.GetCount());
+}
+
+bool ShardMigrationWriter::SendTail()
+{
+    ShardMigrationTailKey*  tailKey;
+    ReadBuffer              key;
+    ReadBuffer              value;
+    Buffer                  valueBuffer;
+    bool                    failed;
+
+    if (phase == SHARD_MIGRATION_TAIL &&
+     (tailSize <= cutoverSize || NowClock() - tailStartTime > maxTailTime))
+        Fence();
+
+    tailKey = tailKeys.First();
+    if (tailKey != NULL)
+    {
+        // the current value is sent, or a delete if the key was deleted
+        key.Wrap(tailKey->key);
+        if (environment->Get(QUORUM_DATABASE_DATA_CONTEXT, srcShardID, key, value, valueBuffer, failed))
+            SendSet(key, value);
+        else if (!failed)
+            SendDelete(key);
+        else
+        {
+            Log_Message("Unable to read key %R of shard %U for migration", &key, srcShardID);
+            Abort();
+            return false;
+        }
+
+        tailKeys.Remove(tailKey);
+        tailSize -= tailKey->key.GetLength();
+        delete tailKey;
+        (*numTailKeysSent)++;
+        return true;
+    }
+
+    ASSERT(phase == SHARD_MIGRATION_FENCED);
+
+    // the writes accepted before the fence must be executed and sent first
+    if (quorumProcessor->HasPendingMessages(srcShardID))
+    {
+        EventLoop::TryAdd(&onCutover);
+        return false;
+    }
+
+    SendCommit();
+    return false;
 }
 
 void ShardMigrationWriter::SendCommit()
 {
     ClusterMessage msg;
-    
+
+    SendBatch();
+
     msg.ShardMigrationCommit(quorumID, dstShardID);
     CONTEXT_TRANSPORT->SendClusterMessage(nodeID, msg);
 
-    Log_Message("Finished sending shard %U...", srcShardID);
+    *lastFencedTime = NowClock() - fenceStartTime;
+    *fencedTime += *lastFencedTime;
+    Log_Message("Finished sending shard %U, writes were fenced for %U msec",
+     srcShardID, *lastFencedTime);
 
     if (cursor != NULL)
     {
@@ -201,28 +380,96 @@ void ShardMigrationWriter::SendCommit()
 
 void ShardMigrationWriter::SendItem(StorageKeyValue* kv)
 {
-    ClusterMessage msg;
-    
     if (kv->GetType() == STORAGE_KEYVALUE_TYPE_SET)
+        SendSet(kv->GetKey(), kv->GetValue());
+    else
+        SendDelete(kv->GetKey());
+}
+
+void ShardMigrationWriter::SendSet(ReadBuffer key, ReadBuffer value)
+{
+    ClusterMessage msg;
+
+    bytesSent += key.GetLength() + value.GetLength();
+
+    if (batching)
     {
-        msg.ShardMigrationSet(quorumID, dstShardID, kv->GetKey(), kv->GetValue());
-        bytesSent += kv->GetKey().GetLength() + kv->GetValue().GetLength();
+        batch.Set(key, value);
+        if (batch.GetSize() >= MESSAGING_BUFFER_THRESHOLD)
+            SendBatch();
+        return;
     }
-    else
+
+    msg.ShardMigrationSet(quorumID, dstShardID, key, value);
+    CONTEXT_TRANSPORT->SendClusterMessage(nodeID, msg);
+}
+
+void ShardMigrationWriter::SendDelete(ReadBuffer key)
+{
+    ClusterMessage msg;
+
+    bytesSent += key.GetLength();
+
+    if (batching)
     {
-        msg.ShardMigrationDelete(quorumID, dstShardID, kv->GetKey());
-        bytesSent += kv->GetKey().GetLength();
+        batch.Delete(key);
+        if (batch.GetSize() >= MESSAGING_BUFFER_THRESHOLD)
+            SendBatch();
+        return;
     }
 
+    msg.ShardMigrationDelete(quorumID, dstShardID, key);
+    CONTEXT_TRANSPORT->SendClusterMessage(nodeID, msg);
+}
+
+void ShardMigrationWriter::SendBatch()
+{
+    ClusterMessage  msg;
+    ReadBuffer      block;
+
+    if (batch.GetNumItems() == 0)
+        return;
+
+    batch.Write(batchBuffer, compression);
+    block.Wrap(batchBuffer);
+    msg.ShardMigrationBatch(quorumID, dstShardID, block);
     CONTEXT_TRANSPORT->SendClusterMessage(nodeID, msg);
+    batch.Clear();
+}
+
+void ShardMigrationWriter::Fence()
+{
+    // new writes of the shard are rejected from now on
+    phase = SHARD_MIGRATION_FENCED;
+    fencedShardID = srcShardID;
+    fenceStartTime = NowClock();
+    Log_Message("Fencing writes of shard %U for cutover, %u keys left to send",
+     srcShardID, tailKeys.GetCount());
+}
+
+void ShardMigrationWriter::ClearTail()
+{
+    tailKeys.DeleteTree();
+    tailSize = 0;
+}
+
+bool ShardMigrationWriter::IsThrottled()
+{
+    if (maxThroughput == 0)
+        return false;
+
+    return bytesSent * 1000 > (NowClock() - startTime) * maxThroughput;
 }
 
 void ShardMigrationWriter::OnWriteReadyness()
 {
     Log_Debug("ShardMigrationWriter::OnWriteReadyness()");
-    
+
     uint64_t bytesBegin;
-    
+
+    if (!isActive)
+        return;
+
     ASSERT(quorumProcessor != NULL);
 
     if (!quorumProcessor->IsPrimary()
@@ -243,34 +490,48 @@ void ShardMigrationWriter::OnWriteReadyness()
     }
     else
     {
+        // the copy and the tail are sent at most at migrationMaxThroughput, the cutover is not
+        if (phase != SHARD_MIGRATION_FENCED && IsThrottled())
+        {
+            EventLoop::TryAdd(&onThrottle);
+            return;
+        }
+
+        // the cutover blocks the writes of the shard, it is never deferred
+        if (phase != SHARD_MIGRATION_FENCED && SCHEDULER->IsDeferred(SHARD_SCHEDULER_MIGRATION))
+        {
+            if (deferStartTime == 0)
+                deferStartTime = Now();
+            EventLoop::TryAdd(&onDefer);
+            return;
+        }
+
+        SCHEDULER->OnQueueDelay(SHARD_SCHEDULER_MIGRATION, deferStartTime > 0 ? Now() - deferStartTime : 0);
+        deferStartTime = 0;
+        ShardSchedulerSlice slice(SCHEDULER, SHARD_SCHEDULER_MIGRATION);
+
         bytesBegin = bytesSent;
 
-        while (bytesSent < bytesBegin + SHARD_MIGRATION_WRITER_GRAN)
+        while (isActive && bytesSent < bytesBegin + SHARD_MIGRATION_WRITER_GRAN)
         {
-            if (!cursor)
+            if (phase == SHARD_MIGRATION_COPY)
+                SendNext();
+            else if (!SendTail())
                 break;
-            SendNext();
         }
     }
-}
-
-void ShardMigrationWriter::OnBlockShard()
-{
-    ConfigState*            configState;
-    ConfigShard*            configShard;
-    ShardQuorumProcessor*   quorumProcessor;
 
-    configState = shardServer->GetConfigState();
-    configShard = configState->GetShard(srcShardID);
-    ASSERT(configShard);
-    quorumProcessor = shardServer->GetQuorumProcessor(configShard->quorumID);
-    ASSERT(quorumProcessor);
-    quorumProcessor->SetBlockReplication(true);
+    // send what is left of this round, the batch is not kept between writes
+    SendBatch();
 }
 
-void ShardMigrationWriter::OnUnblockShard()
+void ShardMigrationWriter::OnThrottle()
 {
-    quorumProcessor->SetBlockReplication(false);
+    // a paused migration is continued by Resume()
+    if (!isActive || isPaused)
+        return;
+
+    OnWriteReadyness();
 }
 
 void ShardMigrationWriter::OnTimeout()
@@ -289,7 +550,7 @@ void ShardMigrationWriter::OnTimeout()
         Abort();
         return;
     }
-    
+
     // check the destination nodeID is still in the quorum
     configState = quorumProcessor->GetShardServer()->GetConfigState();
     configQuorum = configState->GetQuorum(quorumID);
@@ -2,77 +2,147 @@
 #define SHARDMIGRATIONWRITER_H
 
 #include "System/Events/Countdown.h"
+#include "System/Containers/InTreeMap.h"
 #include "Framework/Storage/StorageBulkCursor.h"
 #include "Framework/Storage/StorageAsyncBulkCursor.h"
 #include "Application/Common/ClusterMessage.h"
 #include "Application/Common/ContextTransport.h"
+#include "Application/Common/KeyValueBatch.h"
 
 class ShardServer;
 class ShardQuorumProcessor;
 
 #define SHARD_MIGRATION_WRITER_DELAY  (10*1000) // msec
 #define SHARD_MIGRATION_WRITER_GRAN   (10*KiB)
+#define SHARD_MIGRATION_CUTOVER_DELAY 10        // msec
+#define SHARD_MIGRATION_THROTTLE_DELAY 100      // msec
+
+#define SHARD_MIGRATION_COPY          0
+#define SHARD_MIGRATION_TAIL          1
+#define SHARD_MIGRATION_FENCED        2
+
+/*
+===============================================================================================
+
+ ShardMigrationTailKey
+
+===============================================================================================
+*/
+
+class ShardMigrationTailKey
+{
+    typedef InTreeNode<ShardMigrationTailKey> TreeNode;
+
+public:
+    Buffer                  key;
+
+    TreeNode                treeNode;
+};
 
 /*
 ===============================================================================================
 
  ShardMigrationWriter
 
+ The shard is migrated in three phases, without blocking the replication of the quorum:
+
+ COPY:    the shard is read with a bulk cursor and sent while it is being written.
+          The keys written since the copy started are collected in the tail.
+ TAIL:    the current values of the tail's keys are sent, while new writes add keys to it.
+ FENCED:  when the tail is smaller than migrationCutoverSize, or the tail phase took
+          longer than migrationMaxTailTime, new writes of the shard are rejected,
+          the rest of the tail is sent and the migration is committed. The fence holds
+          until the controllers move the shard to the new quorum or abort the migration.
+
 ===============================================================================================
 */
 
 class ShardMigrationWriter
 {
+    typedef InTreeMap<ShardMigrationTailKey> TailKeys;
+
 public:
     ShardMigrationWriter();
     ~ShardMigrationWriter();
-    
+
     void                    Init(ShardServer* shardServer);
     void                    Reset();
-    
+
     void                    Pause();
     void                    Resume();
-    
+
     bool                    IsActive();
+    bool                    IsFenced(uint64_t shardID);
     uint64_t                GetShardID();
     uint64_t                GetQuorumID();
     uint64_t                GetNodeID();
     uint64_t                GetBytesSent();
     uint64_t                GetBytesTotal();
     uint64_t                GetThroughput();
+    const char*             GetPhaseName();
+    unsigned                GetNumTailKeys();
+    uint64_t                GetFencedTime();
 
     void                    Begin(ClusterMessage& request);
     void                    Abort();
 
+    void                    OnWrite(ReadBuffer& key);
     void                    OnResult();
 
 private:
     void                    SendFirst();
     void                    SendNext();
+    bool                    SendTail();
     void                    SendCommit();
     void                    SendItem(StorageKeyValue* kv);
+    void                    SendSet(ReadBuffer key, ReadBuffer value);
+    void                    SendDelete(ReadBuffer key);
+    void                    SendBatch();
+    void                    Fence();
+    void                    ClearTail();
+    bool                    IsThrottled();
     void                    OnWriteReadyness();
-    void                    OnBlockShard();
-    void                    OnUnblockShard();
+    void                    OnThrottle();
     void                    OnTimeout();
 
     bool                    isActive;
+    bool                    isPaused;
     bool                    sendFirst;
+    bool                    batching;
+    bool                    compression;
+    int                     phase;
     uint64_t                nodeID;
     uint64_t                quorumID;
     uint64_t                srcShardID;
     uint64_t                dstShardID;
+    uint64_t                fencedShardID;
     uint64_t                bytesSent;
     uint64_t                bytesTotal;
     uint64_t                startTime;
+    uint64_t                tailStartTime;
+    uint64_t                fenceStartTime;
+    uint64_t                deferStartTime;
     uint64_t                prevBytesSent;
+    uint64_t                cutoverSize;
+    uint64_t                maxTailTime;
+    uint64_t                maxThroughput;
+    uint64_t                tailSize;
+    uint64_t*               numTailKeysSent;
+    uint64_t*               fencedTime;
+    uint64_t*               lastFencedTime;
     ShardServer*            shardServer;
     ShardQuorumProcessor*   quorumProcessor;
     StorageEnvironment*     environment;
     StorageBulkCursor*      cursor;
     StorageKeyValue*        kv;
+    TailKeys                tailKeys;
     Countdown               onTimeout;
+    Countdown               onCutover;
+    Countdown               onThrottle;
+    Countdown               onDefer;
     WriteReadyness          writeReadyness;
+    KeyValueBatch           batch;
+    Buffer                  batchBuffer;
 };
 
 #endif
@@ -4,6 +4,7 @@
 #include "Application/Common/ContextTransport.h"
 #include "ShardQuorumProcessor.h"
 #include "ShardServer.h"
+#include "System/Config.h"
 
 #define PAXOS_QUEUE_LENGTH  1000
 
@@ -16,6 +17,12 @@ void ShardQuorumContext::Init(ConfigQuorum* configQuorum,
     quorumProcessor = quorumProcessor_;
     quorumID = configQuorum->quorumID;
     numPendingPaxos = 0;
+
+    pipelineDepth = configFile.GetIntValue("replicationPipelineDepth", SHARD_DEFAULT_PIPELINE_DEPTH);
+    if (pipelineDepth < 1)
+        pipelineDepth = 1;
+    if (pipelineDepth > MAX_PIPELINE_DEPTH)
+        pipelineDepth = MAX_PIPELINE_DEPTH;
   
     configQuorum->GetVolatileActiveNodes(activeNodes);
 
@@ -55,6 +62,11 @@ void ShardQuorumContext::RestartReplication()
     replicatedLog.Restart();
 }
 
+unsigned ShardQuorumContext::GetNumPipelined()
+{
+    return replicatedLog.GetNumPipelined();
+}
+
 void ShardQuorumContext::TryReplicationCatchup()
 {
     replicatedLog.TryCatchup();
@@ -181,7 +193,9 @@ void ShardQuorumContext::OnStartProposing()
 
 void ShardQuorumContext::OnAppend(uint64_t paxosID, Buffer& value, bool ownAppend)
 {
-    nextValue.Clear();
+    // when pipelining, nextValue may already hold the value after the ones in flight
+    if (pipelineDepth <= 1 || !ownAppend)
+        nextValue.Clear();
 
     quorumProcessor->OnAppend(paxosID, value, ownAppend);
 }
@@ -206,6 +220,11 @@ bool ShardQuorumContext::AlwaysUseDatabaseCatchup()
     return false;
 }
 
+unsigned ShardQuorumContext::GetPipelineDepth()
+{
+    return pipelineDepth;
+}
+
 bool ShardQuorumContext::IsPaxosBlocked()
 {
     return quorumProcessor->IsPaxosBlocked();
@@ -339,7 +358,10 @@ void ShardQuorumContext::OnPaxosMessage(ReadBuffer buffer)
         }
     }
 
-    RegisterPaxosID(msg.paxosID);
-    replicatedLog.RegisterPaxosID(msg.paxosID, msg.nodeID);
+    if (!replicatedLog.IsPipelinedMessage(msg))
+    {
+        RegisterPaxosID(msg.paxosID);
+        replicatedLog.RegisterPaxosID(msg.paxosID, msg.nodeID);
+    }
     replicatedLog.OnMessage(msg);
 }
@@ -11,6 +11,8 @@
 
 class ShardQuorumProcessor; // forward
 
+#define SHARD_DEFAULT_PIPELINE_DEPTH    1
+
 /*
 ===============================================================================================
 
@@ -28,6 +30,7 @@ public:
     
     void                            SetQuorumNodes(SortedList<uint64_t>& activeNodes);
     void                            RestartReplication();
+    unsigned                        GetNumPipelined();
     void                            TryReplicationCatchup();
     void                            AppendDummy();
     void                            Append(); // nextValue was filled up using GetNextValue()
@@ -67,6 +70,7 @@ public:
     virtual bool                    UseProposeTimeouts();
     virtual bool                    UseCommitChaining();
     virtual bool                    AlwaysUseDatabaseCatchup();
+    virtual unsigned                GetPipelineDepth();
     virtual bool                    IsPaxosBlocked();
     virtual Buffer&                 GetNextValue();
     virtual void                    OnMessage(ReadBuffer msg);
@@ -86,6 +90,7 @@ private:
     void                            OnPaxosMessage(ReadBuffer buffer);
     
     bool                            isReplicationActive;
+    unsigned                        pipelineDepth;
     uint64_t                        quorumID;
     uint64_t                        highestPaxosID;
     ShardQuorumProcessor*           quorumProcessor;
@@ -1,8 +1,10 @@
 #include "ShardQuorumProcessor.h"
+#include "System/Config.h"
 #include "Framework/Replication/ReplicationConfig.h"
 #include "Application/Common/DatabaseConsts.h"
 #include "Application/Common/ContextTransport.h"
 #include "Application/Common/ClientSession.h"
+#include "Application/Common/KeyValueBatch.h"
 #include "ShardServer.h"
 
 #define CONFIG_STATE            (shardServer->GetConfigState())
@@ -12,6 +14,7 @@
 #define TRANSACTION_MANAGER     (shardServer->GetTransactionManager())
 #define LOCK_MANAGER            (shardServer->GetTransactionManager()->GetLockManager())
 #define WAITQUEUE_MANAGER       (shardServer->GetTransactionManager()->GetWaitQueueManager())
+#define SCHEDULER               (shardServer->GetScheduler())
 
 static bool LessThan(uint64_t a, uint64_t b)
 {
@@ -67,8 +70,12 @@ void ShardQuorumProcessor::Init(ConfigQuorum* configQuorum, ShardServer* shardSe
     blockReplication = false;
     needCatchup = false;
     appendState.Reset();
-    appendDelay = 0;
+    appendController.Init();
     prevAppendTime = 0;
+    appendQueueTime = 0;
+    numProposedMessages = 0;
+    // off by default, older nodes in the quorum cannot parse the binary encoding
+    binaryMessages = configFile.GetBoolValue("replicationBinaryMessages", false);
     activationTargetPaxosID = 0;
     quorumContext.Init(configQuorum, this);
     CONTEXT_TRANSPORT->AddQuorumContext(&quorumContext);
@@ -354,7 +361,16 @@ void ShardQuorumProcessor::OnAppend(uint64_t paxosID, Buffer& value, bool ownApp
     appendState.valueBuffer.Write(value);
     appendState.value.Wrap(appendState.valueBuffer);
     appendState.currentAppend = ownAppend && quorumContext.IsLeaseOwner();
+    if (!appendState.currentAppend)
+        numProposedMessages = 0;
 
+    if (ownAppend)
+    {
+        appendController.OnAppendComplete(EventLoop::Now(),
+         shardServer->GetDatabaseManager()->GetEnvironment()->GetLastCommitTime());
+    }
+
+    appendQueueTime = Now();
     OnResumeAppend();
 }
 
@@ -432,6 +448,7 @@ void ShardQuorumProcessor::OnLeaseTimeout()
     }
     
     appendState.currentAppend = false;
+    numProposedMessages = 0;
     isPrimary = false;
     migrateShardID = 0;
     migrateNodeID = 0;
@@ -468,7 +485,8 @@ void ShardQuorumProcessor::OnClientRequest(ClientRequest* request)
         return;
     }
 
-    if (request->session->IsTransactional() && !LOCK_MANAGER->IsLocked(request->session->lockKey))
+    if (request->session->IsTransactional() && !request->session->IsOptimistic() &&
+     !LOCK_MANAGER->IsLocked(request->session->lockKey))
     {
         // lock expired
         Log_Debug("Client sending transactional command but is not holding the lock");
@@ -479,6 +497,17 @@ void ShardQuorumProcessor::OnClientRequest(ClientRequest* request)
         return;
     }
 
+    if (request->transactional && request->session->IsOptimistic() &&
+     request->session->optimisticQuorumID != GetQuorumID())
+    {
+        // the read versions are checked by the quorum the transaction was started in
+        Log_Debug("Optimistic transactional command sent to another quorum");
+        TRANSACTION_MANAGER->ClearSessionTransaction(request->session);
+        request->response.Failed();
+        request->OnComplete();
+        return;
+    }
+
     if (request->session->IsTransactional() && request->session->IsCommitting())
     {
         // client already sent a COMMIT_TRANSACTION command
@@ -530,7 +559,8 @@ void ShardQuorumProcessor::OnClientRequest(ClientRequest* request)
     
     if (request->type == CLIENTREQUEST_COMMIT_TRANSACTION)
     {
-        if (!request->session->IsTransactional() || !LOCK_MANAGER->IsLocked(request->session->lockKey))
+        if (!request->session->IsTransactional() ||
+         (!request->session->IsOptimistic() && !LOCK_MANAGER->IsLocked(request->session->lockKey)))
         {
             Log_Debug("Client sending commit but is not holding the lock");
             if (request->session->IsTransactional())
@@ -552,6 +582,12 @@ void ShardQuorumProcessor::OnClientRequest(ClientRequest* request)
         return;
     }
 
+    if (request->type == CLIENTREQUEST_START_OPTIMISTIC_TRANSACTION)
+    {
+        StartOptimisticTransaction(request);
+        return;
+    }
+
     if (request->key.GetLength() == 0)
     {
         // TODO: move this to a better place
@@ -573,6 +609,17 @@ void ShardQuorumProcessor::OnClientRequest(ClientRequest* request)
         StartTransaction(request);
         return;
     }
+
+    // the shard is being handed over to another quorum
+    if (SHARD_MIGRATION_WRITER->IsFenced(request->shardID))
+    {
+        Log_Trace();
+        if (request->session->IsTransactional())
+            TRANSACTION_MANAGER->ClearSessionTransaction(request->session);
+        request->response.NoService();
+        request->OnComplete();
+        return;
+    }
         
     if (request->session->IsTransactional())
     {
@@ -592,6 +639,17 @@ void ShardQuorumProcessor::OnClientRequest(ClientRequest* request)
         return;
     }
 
+    // shed the write if the queue is too long or is not draining
+    message = shardMessages.First();
+    if (shardServer->IsOverloaded(shardMessages.GetLength(), message ? message->clientRequest : NULL))
+    {
+        Log_Debug("Write queue overloaded, length: %u", shardMessages.GetLength());
+        if (request->session->IsTransactional())
+            TRANSACTION_MANAGER->ClearSessionTransaction(request->session);
+        shardServer->OnOverloaded(request);
+        return;
+    }
+
     message = messageCache.Acquire();
     TransformRequest(request, message);
     
@@ -622,6 +680,19 @@ uint64_t ShardQuorumProcessor::GetMigrateShardID()
     return migrateShardID;
 }
 
+bool ShardQuorumProcessor::HasPendingMessages(uint64_t shardID)
+{
+    ShardMessage*   message;
+
+    FOREACH (message, shardMessages)
+    {
+        if (message->clientRequest && message->clientRequest->shardID == shardID)
+            return true;
+    }
+
+    return false;
+}
+
 void ShardQuorumProcessor::TrySplitShard(uint64_t shardID, uint64_t newShardID, ReadBuffer& splitKey)
 {
     ShardMessage* itMessage;
@@ -715,6 +786,7 @@ void ShardQuorumProcessor::OnShardMigrationClusterMessage(uint64_t nodeID, Clust
     ShardMessage*   shardMessage;
     ConfigQuorum*   configQuorum;
     ClusterMessage  pauseMessage;
+    KeyValueBatch   batch;
 
     configQuorum = CONFIG_STATE->GetQuorum(GetQuorumID());
     ASSERT(configQuorum);
@@ -725,6 +797,13 @@ void ShardQuorumProcessor::OnShardMigrationClusterMessage(uint64_t nodeID, Clust
         return;
     }
 
+    // batches are applied on every replica, so they are checked before replication
+    if (clusterMessage.type == CLUSTERMESSAGE_SHARDMIGRATION_BATCH && !batch.Read(clusterMessage.value))
+    {
+        Log_Message("Invalid shard migration batch for shard %U", clusterMessage.shardID);
+        return;
+    }
+
     shardMessage = messageCache.Acquire();
     shardMessage->clientRequest = NULL;
 
@@ -752,6 +831,11 @@ void ShardQuorumProcessor::OnShardMigrationClusterMessage(uint64_t nodeID, Clust
             migrateCache += clusterMessage.key.GetLength();
             //Log_Debug("ShardMigration DELETE");
             break;
+        case CLUSTERMESSAGE_SHARDMIGRATION_BATCH:
+            ASSERT(migrateShardID == clusterMessage.shardID);
+            shardMessage->ShardMigrationBatch(clusterMessage.shardID, clusterMessage.value);
+            migrateCache += clusterMessage.value.GetLength();
+            break;
         case CLUSTERMESSAGE_SHARDMIGRATION_COMMIT:
             ASSERT(migrateShardID == clusterMessage.shardID);
             Log_Debug("Received shard migration COMMIT");
@@ -780,7 +864,17 @@ void ShardQuorumProcessor::SetBlockReplication(bool blockReplication_)
 
 void ShardQuorumProcessor::SetReplicationLimit(unsigned replicationLimit)
 {
-    appendDelay = (unsigned)(replicationLimit == 0 ? 0 : 1000.0 / replicationLimit);
+    appendController.SetReplicationLimit(replicationLimit);
+}
+
+ShardAppendController* ShardQuorumProcessor::GetAppendController()
+{
+    return &appendController;
+}
+
+unsigned ShardQuorumProcessor::GetNumPipelinedRounds()
+{
+    return quorumContext.GetNumPipelined();
 }
 
 uint64_t ShardQuorumProcessor::GetMessageCacheSize()
@@ -832,6 +926,21 @@ void ShardQuorumProcessor::TransformRequest(ClientRequest* request, ShardMessage
             message->tableID = request->tableID;
             message->key.Wrap(request->key);
             break;
+        case CLIENTREQUEST_SET_IF_VERSION:
+            message->type = SHARDMESSAGE_SET_IF_VERSION;
+            message->tableID = request->tableID;
+            message->key.Wrap(request->key);
+            message->value.Wrap(request->value);
+            message->versionPaxosID = request->versionPaxosID;
+            message->versionCommandID = request->versionCommandID;
+            break;
+        case CLIENTREQUEST_DELETE_IF_VERSION:
+            message->type = SHARDMESSAGE_DELETE_IF_VERSION;
+            message->tableID = request->tableID;
+            message->key.Wrap(request->key);
+            message->versionPaxosID = request->versionPaxosID;
+            message->versionCommandID = request->versionCommandID;
+            break;
         case CLIENTREQUEST_SEQUENCE_SET:
             message->type = SHARDMESSAGE_SET;
             message->tableID = request->tableID;
@@ -870,6 +979,8 @@ void ShardQuorumProcessor::ExecuteMessage(uint64_t paxosID, uint64_t commandID,
         migrateCache -= (shardMessage->key.GetLength() + shardMessage->value.GetLength());
     else if (shardMessage->type == SHARDMESSAGE_MIGRATION_DELETE && migrateCache > 0)
         migrateCache -= shardMessage->key.GetLength();
+    else if (shardMessage->type == SHARDMESSAGE_MIGRATION_BATCH && migrateCache > 0)
+        migrateCache -= shardMessage->value.GetLength();
 
     ASSERT(migrateCache >= 0);
     
@@ -890,6 +1001,15 @@ void ShardQuorumProcessor::ExecuteMessage(uint64_t paxosID, uint64_t commandID,
     else
     {
         shardID = DATABASE_MANAGER->ExecuteMessage(GetQuorumID(), paxosID, commandID, *shardMessage);
+
+        // the load of the shards is reported to the controllers in the heartbeat
+        if (shardID != 0 && shardMessage->IsClientWrite())
+            shardServer->GetLoadTracker()->OnWrite(shardID, shardMessage->key, shardMessage->value.GetLength());
+
+        // the keys written during a migration are sent again after the copy
+        if (SHARD_MIGRATION_WRITER->IsActive() && SHARD_MIGRATION_WRITER->GetShardID() == shardID &&
+         shardMessage->IsClientWrite())
+            SHARD_MIGRATION_WRITER->OnWrite(shardMessage->key);
     }
 
     if (!ownCommand)
@@ -921,10 +1041,13 @@ void ShardQuorumProcessor::ExecuteMessage(uint64_t paxosID, uint64_t commandID,
 void ShardQuorumProcessor::TryAppend()
 {
     bool            inTransaction;
+    unsigned        i;
     unsigned        numMessages;
+    unsigned        appendDelay;
+    unsigned        batchSize;
     ShardMessage*   message;
     
-    if (shardMessages.GetLength() == 0 || quorumContext.IsAppending())
+    if (shardMessages.GetLength() <= numProposedMessages || quorumContext.IsAppending())
         return;
 
     if (resumeAppend.IsActive())
@@ -933,7 +1056,9 @@ void ShardQuorumProcessor::TryAppend()
         return;
     }
 
-    // rate control
+    // rate control and batching, adapted to the measured round latency
+    appendDelay = appendController.GetAppendDelay(shardMessages.GetLength() - numProposedMessages);
+    batchSize = appendController.GetBatchSize();
     if (EventLoop::Now() < prevAppendTime + appendDelay)
     {
         tryAppend.SetExpireTime(prevAppendTime + appendDelay);
@@ -944,7 +1069,13 @@ void ShardQuorumProcessor::TryAppend()
     numMessages = 0;
     Buffer& nextValue = quorumContext.GetNextValue();
     inTransaction = false;
-    FOREACH (message, shardMessages)
+
+    // when pipelining, skip the messages of the values already in flight
+    message = shardMessages.First();
+    for (i = 0; i < numProposedMessages; i++)
+        message = shardMessages.Next(message);
+
+    for (/* empty */; message != NULL; message = shardMessages.Next(message))
     {
         if (!inTransaction && message->configPaxosID > CONFIG_STATE->paxosID)
             break;
@@ -956,8 +1087,13 @@ void ShardQuorumProcessor::TryAppend()
             break;
         }
 
-        message->Append(nextValue);
-        nextValue.Appendf(" ");
+        if (binaryMessages)
+            message->AppendBinary(nextValue);
+        else
+        {
+            message->Append(nextValue);
+            nextValue.Appendf(" ");
+        }
         numMessages++;
 
         if (message->type == SHARDMESSAGE_START_TRANSACTION)
@@ -967,11 +1103,7 @@ void ShardQuorumProcessor::TryAppend()
 
         if (!inTransaction)
         {
-            if (message->type == SHARDMESSAGE_SPLIT_SHARD || nextValue.GetLength() >= DATABASE_REPLICATION_SIZE)
-                break;
-            
-            if (message->clientRequest && SHARD_MIGRATION_WRITER->IsActive() &&
-             SHARD_MIGRATION_WRITER->GetShardID() == message->clientRequest->shardID)
+            if (message->type == SHARDMESSAGE_SPLIT_SHARD || nextValue.GetLength() >= batchSize)
                 break;
         }
     }
@@ -986,7 +1118,17 @@ void ShardQuorumProcessor::TryAppend()
 //    Log_Debug("length = %s", HUMAN_BYTES(appendValue.GetLength()));
     
     if (nextValue.GetLength() > 0)
+    {
+        // the controller measures one round at a time
+        if (numProposedMessages == 0)
+            appendController.OnAppendStart(EventLoop::Now(), nextValue.GetLength(), numMessages);
+        numProposedMessages += numMessages;
         quorumContext.Append();
+
+        // the value was taken into the pipeline, the next one can be prepared
+        if (!quorumContext.IsAppending() && shardMessages.GetLength() > numProposedMessages)
+            EventLoop::TryAdd(&tryAppend);
+    }
     else
         EventLoop::Add(&tryAppend);
 }
@@ -994,9 +1136,9 @@ void ShardQuorumProcessor::TryAppend()
 void ShardQuorumProcessor::OnResumeAppend()
 {
     bool            inTransaction;
+    bool            binary;
     int             read;
     int64_t         prevMigrateCache;
-    uint64_t        start;
     ShardMessage*   itShardMessage;
     ShardMessage    shardMessage;
     ClusterMessage  clusterMessage;
@@ -1004,20 +1146,29 @@ void ShardQuorumProcessor::OnResumeAppend()
     if (blockReplication)
     {
         Log_Debug("Blocking replication...");
+        // the time spent blocked is not a queueing delay
+        appendQueueTime = 0;
         EventLoop::Add(&resumeBlockedAppend);
         return;
     }
 
+    if (appendQueueTime > 0)
+        SCHEDULER->OnQueueDelay(SHARD_SCHEDULER_APPLY, Now() - appendQueueTime);
+    ShardSchedulerSlice slice(SCHEDULER, SHARD_SCHEDULER_APPLY);
+
     inTransaction = false;
-    start = NowClock();
     while (appendState.value.GetLength() > 0)
     {
-        // parse message
+        // parse message, values may contain both formats
+        binary = ShardMessage::IsBinary(appendState.value);
         read = shardMessage.Read(appendState.value);
         ASSERT(read > 0);
         appendState.value.Advance(read);
-        ASSERT(appendState.value.GetCharAt(0) == ' ');
-        appendState.value.Advance(1);
+        if (!binary)
+        {
+            ASSERT(appendState.value.GetCharAt(0) == ' ');
+            appendState.value.Advance(1);
+        }
 
         itShardMessage = NULL;  // suppress compiler warning
         if (appendState.currentAppend)
@@ -1025,6 +1176,8 @@ void ShardQuorumProcessor::OnResumeAppend()
             // find this message in the shardMessages list
             itShardMessage = shardMessages.First();
             ASSERT(itShardMessage != NULL);
+            if (numProposedMessages > 0)
+                numProposedMessages--;
         }
 
         prevMigrateCache = migrateCache;
@@ -1047,14 +1200,20 @@ void ShardQuorumProcessor::OnResumeAppend()
 
         appendState.commandID++;
 
-        if (!inTransaction)
-            TRY_YIELD_RETURN(resumeAppend, start);
+        if (!inTransaction && slice.IsExpired())
+        {
+            ASSERT(!resumeAppend.IsActive());
+            appendQueueTime = Now();
+            EventLoop::Add(&resumeAppend);
+            return;
+        }
     }
     ASSERT(!inTransaction);
 
     Log_Debug("numOps: %U", appendState.commandID);
     
     appendState.Reset();
+    appendQueueTime = 0;
     
     quorumContext.OnAppendComplete();
 
@@ -1108,8 +1267,22 @@ void ShardQuorumProcessor::CommitTransaction(ClientRequest* request)
         return;
     }
 
+    FOREACH(it, request->session->transaction)
+    {
+        if (SHARD_MIGRATION_WRITER->IsFenced(it->shardID))
+        {
+            Log_Debug("Transaction writes a shard fenced for migration");
+            TRANSACTION_MANAGER->ClearSessionTransaction(request->session);
+            request->response.Failed();
+            request->OnComplete();
+            return;
+        }
+    }
+
     message = messageCache.Acquire();
     message->StartTransaction();
+    if (request->session->IsOptimistic())
+        message->value.Wrap(request->session->readVersions);
     message->clientRequest = NULL;
     shardMessages.Append(message);
 
@@ -1132,6 +1305,30 @@ void ShardQuorumProcessor::CommitTransaction(ClientRequest* request)
     EventLoop::TryAdd(&tryAppend);
 }
 
+void ShardQuorumProcessor::StartOptimisticTransaction(ClientRequest* request)
+{
+    if (request->session->IsTransactional())
+    {
+        // only allow one transaction at a time
+        request->response.Failed();
+        request->OnComplete();
+    }
+    else if (!IsPrimary())
+    {
+        // the versions are checked by the primary's replication
+        request->response.NoService();
+        request->OnComplete();
+    }
+    else
+    {
+        // no lock is taken, conflicts are detected on commit
+        request->session->optimistic = true;
+        request->session->optimisticQuorumID = GetQuorumID();
+        request->response.OK();
+        request->OnComplete();
+    }
+}
+
 void ShardQuorumProcessor::RollbackTransaction(ClientRequest* request)
 {
     if (!request->session->IsTransactional())
@@ -6,6 +6,7 @@
 #include "Application/Common/ClientRequest.h"
 #include "ShardMessage.h"
 #include "ShardQuorumContext.h"
+#include "ShardAppendController.h"
 
 class ShardServer;
 
@@ -107,9 +108,12 @@ public:
     bool                    NeedCatchup();
 
     uint64_t                GetMigrateShardID();
+    bool                    HasPendingMessages(uint64_t shardID);
     void                    OnShardMigrationClusterMessage(uint64_t nodeID, ClusterMessage& message);
     void                    SetBlockReplication(bool blockReplication);
     void                    SetReplicationLimit(unsigned replicationLimit);
+    ShardAppendController*  GetAppendController();
+    unsigned                GetNumPipelinedRounds();
     
     uint64_t                GetMessageCacheSize();
     uint64_t                GetMessageListSize();
@@ -142,6 +146,7 @@ private:
     void                    OnResumeAppend();
     void                    OnResumeBlockedAppend();
     void                    StartTransaction(ClientRequest* request);
+    void                    StartOptimisticTransaction(ClientRequest* request);
     void                    CommitTransaction(ClientRequest* request);
     void                    RollbackTransaction(ClientRequest* request);
 
@@ -149,7 +154,9 @@ private:
     uint64_t                highestProposalID;
     uint64_t                configID;
     uint64_t                prevAppendTime;
-    unsigned                appendDelay;
+    unsigned                numProposedMessages;    // handed to replication, not yet executed
+    bool                    binaryMessages;
+    ShardAppendController   appendController;
 
     ShardAppendState        appendState;
 
@@ -173,6 +180,7 @@ private:
     Timer                   leaseTimeout;
     Timer                   tryAppend;
     YieldTimer              resumeAppend;
+    uint64_t                appendQueueTime;
     Countdown               resumeBlockedAppend;
     uint64_t                activationTargetPaxosID;
 };
@@ -0,0 +1,318 @@
+#include "ShardScheduler.h"
+#include "System/Config.h"
+
+static const char* classNames[SHARD_SCHEDULER_NUM_CLASSES] =
+{
+    "read", "list", "apply", "catchup", "migration"
+};
+
+// the point reads and the writes are preferred over the background work by default
+static const unsigned defaultWeights[SHARD_SCHEDULER_NUM_CLASSES] =
+{
+    100, 25, 100, 10, 10
+};
+
+static const unsigned defaultLatencyTargets[SHARD_SCHEDULER_NUM_CLASSES] =
+{
+    20, 500, 20, 0, 0
+};
+
+ShardSchedulerClass::ShardSchedulerClass()
+{
+    name = "";
+    weight = 1;
+    latencyTarget = 0;
+    vtime = 0;
+    lastRunTime = 0;
+    delay = 0;
+    busyTime = 0;
+    numSlices = 0;
+    numDeferred = 0;
+    memset(delayHistogram, 0, sizeof(delayHistogram));
+}
+
+ShardScheduler::ShardScheduler()
+{
+    int     cls;
+
+    for (cls = 0; cls < SHARD_SCHEDULER_NUM_CLASSES; cls++)
+    {
+        classes[cls].name = classNames[cls];
+        classes[cls].weight = defaultWeights[cls];
+        classes[cls].latencyTarget = defaultLatencyTargets[cls];
+    }
+
+    enabled = true;
+    quantum = YIELD_TIME;
+    current = SHARD_SCHEDULER_NONE;
+    sliceStart = 0;
+    sliceLength = 0;
+}
+
+void ShardScheduler::Init()
+{
+    int     cls;
+    Buffer  key;
+
+    enabled = configFile.GetBoolValue("scheduler.enabled", true);
+    quantum = configFile.GetIntValue("scheduler.quantum", YIELD_TIME);
+    if (quantum < SHARD_SCHEDULER_MIN_SLICE)
+        quantum = SHARD_SCHEDULER_MIN_SLICE;
+
+    // eg. scheduler.read.weight, scheduler.read.latencyTarget
+    for (cls = 0; cls < SHARD_SCHEDULER_NUM_CLASSES; cls++)
+    {
+        key.Writef("scheduler.%s.weight", classNames[cls]);
+        key.NullTerminate();
+        SetWeight(cls, configFile.GetIntValue(key.GetBuffer(), defaultWeights[cls]));
+
+        key.Writef("scheduler.%s.latencyTarget", classNames[cls]);
+        key.NullTerminate();
+        SetLatencyTarget(cls, configFile.GetIntValue(key.GetBuffer(), defaultLatencyTargets[cls]));
+    }
+}
+
+void ShardScheduler::SetEnabled(bool enabled_)
+{
+    enabled = enabled_;
+}
+
+bool ShardScheduler::IsEnabled()
+{
+    return enabled;
+}
+
+unsigned ShardScheduler::GetQuantum()
+{
+    return quantum;
+}
+
+void ShardScheduler::SetWeight(int cls, unsigned weight)
+{
+    ASSERT(cls >= 0 && cls < SHARD_SCHEDULER_NUM_CLASSES);
+    classes[cls].weight = MAX(weight, 1);
+}
+
+void ShardScheduler::SetLatencyTarget(int cls, unsigned latencyTarget)
+{
+    ASSERT(cls >= 0 && cls < SHARD_SCHEDULER_NUM_CLASSES);
+    classes[cls].latencyTarget = latencyTarget;
+}
+
+ShardSchedulerClass* ShardScheduler::GetClass(int cls)
+{
+    ASSERT(cls >= 0 && cls < SHARD_SCHEDULER_NUM_CLASSES);
+    return &classes[cls];
+}
+
+void ShardScheduler::Begin(int cls)
+{
+    int         i;
+    uint64_t    now;
+    uint64_t    minVtime;
+    bool        found;
+
+    ASSERT(cls >= 0 && cls < SHARD_SCHEDULER_NUM_CLASSES);
+    ASSERT(current == SHARD_SCHEDULER_NONE);
+
+    now = Now();
+
+    // a class returning from idle starts level with the others
+    if (!IsCompeting(cls, now))
+    {
+        found = false;
+        minVtime = 0;
+        for (i = 0; i < SHARD_SCHEDULER_NUM_CLASSES; i++)
+        {
+            if (i == cls || !IsCompeting(i, now))
+                continue;
+            if (!found || classes[i].vtime < minVtime)
+                minVtime = classes[i].vtime;
+            found = true;
+        }
+        if (found && classes[cls].vtime < minVtime)
+            classes[cls].vtime = minVtime;
+    }
+
+    current = cls;
+    sliceStart = now;
+    sliceLength = GetSliceLength(cls, now);
+}
+
+void ShardScheduler::End()
+{
+    uint64_t                now;
+    uint64_t                elapsed;
+    ShardSchedulerClass*    c;
+
+    ASSERT(current != SHARD_SCHEDULER_NONE);
+
+    now = Now();
+    elapsed = (now > sliceStart ? now - sliceStart : 0);
+
+    c = &classes[current];
+    c->vtime += elapsed * SHARD_SCHEDULER_WEIGHT_SCALE / c->weight;
+    c->busyTime += elapsed;
+    c->numSlices++;
+    c->lastRunTime = now;
+
+    current = SHARD_SCHEDULER_NONE;
+}
+
+bool ShardScheduler::IsRunning()
+{
+    return current != SHARD_SCHEDULER_NONE;
+}
+
+bool ShardScheduler::IsSliceExpired()
+{
+    ASSERT(current != SHARD_SCHEDULER_NONE);
+
+    return Now() - sliceStart >= sliceLength;
+}
+
+bool ShardScheduler::IsDeferred(int cls)
+{
+    uint64_t    now;
+
+    if (!enabled)
+        return false;
+
+    now = Now();
+    if (GetSliceLength(cls, now) > SHARD_SCHEDULER_MIN_SLICE)
+        return false;
+
+    classes[cls].numDeferred++;
+    return true;
+}
+
+uint64_t ShardScheduler::GetSliceLength(int cls)
+{
+    return GetSliceLength(cls, Now());
+}
+
+void ShardScheduler::OnQueueDelay(int cls, uint64_t delay)
+{
+    unsigned                bucket;
+    ShardSchedulerClass*    c;
+
+    ASSERT(cls >= 0 && cls < SHARD_SCHEDULER_NUM_CLASSES);
+    c = &classes[cls];
+
+    bucket = 0;
+    while (bucket < SHARD_SCHEDULER_NUM_BUCKETS - 1 && delay >= ((uint64_t) 1 << bucket))
+        bucket++;
+    c->delayHistogram[bucket]++;
+
+    // the average of about the last eight delays
+    c->delay = (c->delay * 7 + delay) / 8;
+}
+
+void ShardScheduler::AppendHistogram(int cls, Buffer& buffer)
+{
+    unsigned                bucket;
+    ShardSchedulerClass*    c;
+
+    ASSERT(cls >= 0 && cls < SHARD_SCHEDULER_NUM_CLASSES);
+    c = &classes[cls];
+
+    for (bucket = 0; bucket < SHARD_SCHEDULER_NUM_BUCKETS - 1; bucket++)
+        buffer.Appendf("<%u:%U ", 1 << bucket, c->delayHistogram[bucket]);
+    buffer.Appendf(">=%u:%U", 1 << (bucket - 1), c->delayHistogram[bucket]);
+}
+
+bool ShardScheduler::IsCompeting(int cls, uint64_t now)
+{
+    return classes[cls].lastRunTime + SHARD_SCHEDULER_ACTIVE_TIME >= now && classes[cls].numSlices > 0;
+}
+
+bool ShardScheduler::IsLate(int cls, uint64_t now)
+{
+    ShardSchedulerClass*    c;
+
+    c = &classes[cls];
+    if (c->latencyTarget == 0)
+        return false;
+
+    return IsCompeting(cls, now) && c->delay > c->latencyTarget;
+}
+
+uint64_t ShardScheduler::GetSliceLength(int cls, uint64_t now)
+{
+    int         i;
+    bool        found;
+    uint64_t    minVtime;
+    uint64_t    slice;
+    uint64_t    diff;
+    unsigned    maxWeight;
+    unsigned    weight;
+
+    if (!enabled || IsLate(cls, now))
+        return quantum;
+
+    found = false;
+    minVtime = 0;
+    maxWeight = classes[cls].weight;
+    for (i = 0; i < SHARD_SCHEDULER_NUM_CLASSES; i++)
+    {
+        if (i == cls || !IsCompeting(i, now))
+            continue;
+
+        // someone else is missing its latency target
+        if (IsLate(i, now))
+            return SHARD_SCHEDULER_MIN_SLICE;
+
+        if (!found || classes[i].vtime < minVtime)
+            minVtime = classes[i].vtime;
+        maxWeight = MAX(maxWeight, classes[i].weight);
+        found = true;
+    }
+
+    if (!found)
+        return quantum;
+
+    // the heaviest class gets the full quantum, the rest in proportion,
+    // corrected by how far the class is ahead of or behind the others
+    weight = classes[cls].weight;
+    slice = (uint64_t) quantum * weight / maxWeight;
+    if (classes[cls].vtime > minVtime)
+    {
+        diff = (classes[cls].vtime - minVtime) * weight / SHARD_SCHEDULER_WEIGHT_SCALE;
+        slice = (slice > diff ? slice - diff : 0);
+    }
+    else
+    {
+        diff = (minVtime - classes[cls].vtime) * weight / SHARD_SCHEDULER_WEIGHT_SCALE;
+        slice += diff;
+    }
+
+    if (slice < SHARD_SCHEDULER_MIN_SLICE)
+        slice = SHARD_SCHEDULER_MIN_SLICE;
+    if (slice > quantum)
+        slice = quantum;
+
+    return slice;
+}
+
+ShardSchedulerSlice::ShardSchedulerSlice(ShardScheduler* scheduler_, int cls)
+{
+    scheduler = scheduler_;
+    nested = scheduler->IsRunning();
+    start = Now();
+    if (!nested)
+        scheduler->Begin(cls);
+}
+
+ShardSchedulerSlice::~ShardSchedulerSlice()
+{
+    if (!nested)
+        scheduler->End();
+}
+
+bool ShardSchedulerSlice::IsExpired()
+{
+    if (nested)
+        return Now() - start >= YIELD_TIME;
+
+    return scheduler->IsSliceExpired();
+}
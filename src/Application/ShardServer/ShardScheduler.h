@@ -0,0 +1,145 @@
+#ifndef SHARDSCHEDULER_H
+#define SHARDSCHEDULER_H
+
+#include "System/Common.h"
+#include "System/Buffers/Buffer.h"
+#include "System/Events/EventLoop.h"
+
+#define SHARD_SCHEDULER_NONE                -1
+#define SHARD_SCHEDULER_READ                0
+#define SHARD_SCHEDULER_LIST                1
+#define SHARD_SCHEDULER_APPLY               2
+#define SHARD_SCHEDULER_CATCHUP             3
+#define SHARD_SCHEDULER_MIGRATION           4
+#define SHARD_SCHEDULER_NUM_CLASSES         5
+
+#define SHARD_SCHEDULER_NUM_BUCKETS         12      // <1, <2, <4 ... <1024 msec and the rest
+#define SHARD_SCHEDULER_MIN_SLICE           1       // msec
+#define SHARD_SCHEDULER_ACTIVE_TIME         100     // msec
+#define SHARD_SCHEDULER_DEFER_DELAY         CLOCK_RESOLUTION
+#define SHARD_SCHEDULER_WEIGHT_SCALE        1000
+
+// like TRY_YIELD_RETURN, but the length of the slice is given by the scheduler
+#define TRY_YIELD_SLICE_RETURN(yieldTimer, slice)                               \
+    if (slice.IsExpired())                                                      \
+    {                                                                           \
+        ASSERT(!yieldTimer.IsActive());                                         \
+        EventLoop::Add(&yieldTimer);                                            \
+        return;                                                                 \
+    }
+
+/*
+===============================================================================================
+
+ ShardSchedulerClass
+
+ The state of one class of work: its share, the event loop time it used and the
+ queueing delays of its work.
+
+===============================================================================================
+*/
+
+class ShardSchedulerClass
+{
+public:
+    ShardSchedulerClass();
+
+    const char*     name;
+    unsigned        weight;
+    unsigned        latencyTarget;  // msec, 0 if there is none
+    uint64_t        vtime;          // msec used, scaled by the weight
+    uint64_t        lastRunTime;
+    uint64_t        delay;          // smoothed queueing delay
+    uint64_t        busyTime;
+    uint64_t        numSlices;
+    uint64_t        numDeferred;
+    uint64_t        delayHistogram[SHARD_SCHEDULER_NUM_BUCKETS];
+};
+
+/*
+===============================================================================================
+
+ ShardScheduler
+
+ Shares the time of the event loop between point reads, lists, applying replicated
+ writes, catchup and migration, in proportion to the configured weights. The event loop
+ already runs the pending work round robin, one time slice per class, so the scheduler
+ only sets the length of the slices: a class that used more than its share runs short
+ slices until the others catch up, one that used less runs up to scheduler.quantum.
+ A class that has not run for SHARD_SCHEDULER_ACTIVE_TIME does not compete, and cannot
+ save up time while it is idle.
+
+ When the smoothed queueing delay of a class exceeds its latency target, the other
+ classes run minimal slices until it is back on target. Work driven by write readiness
+ (lists continuing, catchup and migration) is deferred instead of shortened.
+
+ The queueing delays are collected into log2 histograms, printed in the HTTP stats.
+
+===============================================================================================
+*/
+
+class ShardScheduler
+{
+public:
+    ShardScheduler();
+
+    void                    Init();
+
+    void                    SetEnabled(bool enabled);
+    bool                    IsEnabled();
+    unsigned                GetQuantum();
+    void                    SetWeight(int cls, unsigned weight);
+    void                    SetLatencyTarget(int cls, unsigned latencyTarget);
+    ShardSchedulerClass*    GetClass(int cls);
+
+    void                    Begin(int cls);
+    void                    End();
+    bool                    IsRunning();
+    bool                    IsSliceExpired();
+
+    // The work of the class should wait, because the other classes are behind
+    bool                    IsDeferred(int cls);
+    uint64_t                GetSliceLength(int cls);
+    void                    OnQueueDelay(int cls, uint64_t delay);
+
+    void                    AppendHistogram(int cls, Buffer& buffer);
+
+private:
+    bool                    IsCompeting(int cls, uint64_t now);
+    bool                    IsLate(int cls, uint64_t now);
+    uint64_t                GetSliceLength(int cls, uint64_t now);
+
+    ShardSchedulerClass     classes[SHARD_SCHEDULER_NUM_CLASSES];
+    bool                    enabled;
+    unsigned                quantum;
+    int                     current;
+    uint64_t                sliceStart;
+    uint64_t                sliceLength;
+};
+
+/*
+===============================================================================================
+
+ ShardSchedulerSlice
+
+ Runs a slice of the class while in scope. Nested slices are not accounted, they
+ expire after YIELD_TIME as before.
+
+===============================================================================================
+*/
+
+class ShardSchedulerSlice
+{
+public:
+    ShardSchedulerSlice(ShardScheduler* scheduler, int cls);
+    ~ShardSchedulerSlice();
+
+    bool                    IsExpired();
+
+private:
+    ShardScheduler*         scheduler;
+    bool                    nested;
+    uint64_t                start;
+};
+
+#endif
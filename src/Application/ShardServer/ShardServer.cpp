@@ -27,7 +27,11 @@ void ShardServer::Init(ShardServerApp* app, bool restoreMode, bool setNodeID, ui
 
     startTimestamp = Now();
     numRequests = 0;
+    numOverloadedRequests = 0;
+    maxQueuedRequests = configFile.GetIntValue("maxQueuedRequests", DEFAULT_MAX_QUEUED_REQUESTS);
+    maxRequestQueueTime = configFile.GetIntValue("maxRequestQueueTime", DEFAULT_MAX_REQUEST_QUEUE_TIME);
 
+    scheduler.Init();
     databaseManager.Init(this); 
     heartbeatManager.Init(this);
     transactionManager.Init(this);
@@ -128,6 +132,16 @@ ShardTransactionManager* ShardServer::GetTransactionManager()
     return &transactionManager;
 }
 
+ShardLoadTracker* ShardServer::GetLoadTracker()
+{
+    return &loadTracker;
+}
+
+ShardScheduler* ShardServer::GetScheduler()
+{
+    return &scheduler;
+}
+
 ConfigState* ShardServer::GetConfigState()
 {
     return &configState;
@@ -157,6 +171,7 @@ void ShardServer::OnClientRequest(ClientRequest* request)
     ShardQuorumProcessor*   quorumProcessor;
     
     numRequests += 1;
+    request->receiveTime = Now();
 
     if (request->IsTransaction())
     {
@@ -196,6 +211,9 @@ void ShardServer::OnClientClose(ClientSession* session)
 {
     ClientRequest* request;
     
+    // paused lists of the session must run to the end
+    databaseManager.ContinueLists(session);
+
     if (!session->IsTransactional())
         return;
     
@@ -215,6 +233,11 @@ void ShardServer::OnClientClose(ClientSession* session)
     session->Init();
 }
 
+void ShardServer::OnClientWriteReady(ClientSession* session)
+{
+    databaseManager.ContinueLists(session);
+}
+
 void ShardServer::OnClusterMessage(uint64_t nodeID, ClusterMessage& message)
 {
     ShardQuorumProcessor*   quorumProcessor;
@@ -281,6 +304,7 @@ void ShardServer::OnClusterMessage(uint64_t nodeID, ClusterMessage& message)
         case CLUSTERMESSAGE_SHARDMIGRATION_BEGIN:
         case CLUSTERMESSAGE_SHARDMIGRATION_SET:
         case CLUSTERMESSAGE_SHARDMIGRATION_DELETE:
+        case CLUSTERMESSAGE_SHARDMIGRATION_BATCH:
         case CLUSTERMESSAGE_SHARDMIGRATION_COMMIT:
             quorumProcessor = GetQuorumProcessor(message.quorumID);
             ASSERT(quorumProcessor != NULL);
@@ -479,6 +503,47 @@ uint64_t ShardServer::GetNumRequests()
     return numRequests;
 }
 
+bool ShardServer::IsOverloaded(unsigned queueLength, ClientRequest* oldest)
+{
+    if (maxQueuedRequests > 0 && queueLength >= maxQueuedRequests)
+        return true;
+
+    if (oldest != NULL && IsExpired(oldest))
+        return true;
+
+    return false;
+}
+
+bool ShardServer::IsExpired(ClientRequest* request)
+{
+    if (maxRequestQueueTime == 0 || request->receiveTime == 0)
+        return false;
+
+    return (Now() - request->receiveTime > maxRequestQueueTime);
+}
+
+void ShardServer::OnOverloaded(ClientRequest* request)
+{
+    numOverloadedRequests++;
+    request->response.Overloaded();
+    request->OnComplete();
+}
+
+unsigned ShardServer::GetMaxQueuedRequests()
+{
+    return maxQueuedRequests;
+}
+
+uint64_t ShardServer::GetMaxRequestQueueTime()
+{
+    return maxRequestQueueTime;
+}
+
+uint64_t ShardServer::GetNumOverloadedRequests()
+{
+    return numOverloadedRequests;
+}
+
 void ShardServer::OnSetConfigState(uint64_t nodeID, ClusterMessage& message)
 {
     ConfigQuorum*           configQuorum;
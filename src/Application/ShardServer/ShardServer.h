@@ -9,14 +9,29 @@
 #include "ShardHeartbeatManager.h"
 #include "ShardTransactionManager.h"
 #include "ShardMigrationWriter.h"
+#include "ShardLoadTracker.h"
+#include "ShardScheduler.h"
 
 class ShardServerApp;
 
+#define DEFAULT_MAX_QUEUED_REQUESTS         10000
+#define DEFAULT_MAX_REQUEST_QUEUE_TIME      (10*1000)   // msec
+
 /*
 ===============================================================================================
 
  ShardServer
 
+ Client requests are shed with an OVERLOADED response when the queue they would enter
+ (the writes of a quorum, the reads or the lists) already holds maxQueuedRequests, or
+ its oldest request has been waiting for more than maxRequestQueueTime. Queued reads
+ and lists that exceed maxRequestQueueTime are also shed when they are dequeued.
+ Older SDBP clients receive NOSERVICE instead, see SDBPConnection.
+ The number of requests in flight is limited by the SDBP server, see SDBPServer.
+
+ The event loop time of the request classes and the background work is shared by the
+ scheduler, see ShardScheduler.
+
 ===============================================================================================
 */
 
@@ -34,6 +49,8 @@ public:
     ShardMigrationWriter*   GetShardMigrationWriter();
     ShardHeartbeatManager*  GetHeartbeatManager();
     ShardTransactionManager* GetTransactionManager();
+    ShardLoadTracker*       GetLoadTracker();
+    ShardScheduler*         GetScheduler();
     ConfigState*            GetConfigState();
     ShardServerApp*         GetShardServerApp();
 
@@ -45,6 +62,7 @@ public:
     bool                    IsValidClientRequest(ClientRequest* request);
     void                    OnClientRequest(ClientRequest* request);
     void                    OnClientClose(ClientSession* session);
+    void                    OnClientWriteReady(ClientSession* session);
 
     // ========================================================================================
     // ClusterContext interface:
@@ -66,6 +84,14 @@ public:
     uint64_t                GetStartTimestamp();
     uint64_t                GetNumRequests();
 
+    // Admission control of the request queues
+    bool                    IsOverloaded(unsigned queueLength, ClientRequest* oldest);
+    bool                    IsExpired(ClientRequest* request);
+    void                    OnOverloaded(ClientRequest* request);
+    unsigned                GetMaxQueuedRequests();
+    uint64_t                GetMaxRequestQueueTime();
+    uint64_t                GetNumOverloadedRequests();
+
 private:
     void                    OnSetConfigState(uint64_t nodeID, ClusterMessage& message);
     void                    ResetChangedConnections();
@@ -82,9 +108,14 @@ private:
     ShardDatabaseManager    databaseManager;
     ShardTransactionManager transactionManager;
     ShardMigrationWriter    migrationWriter;
+    ShardLoadTracker        loadTracker;
+    ShardScheduler          scheduler;
     ShardServerApp*         shardServerApp;
     uint64_t                startTimestamp;
     uint64_t                numRequests;
+    unsigned                maxQueuedRequests;
+    uint64_t                maxRequestQueueTime;
+    uint64_t                numOverloadedRequests;
 };
 
 #endif
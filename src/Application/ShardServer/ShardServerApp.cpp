@@ -23,6 +23,9 @@ void ShardServerApp::Init()
     sdbpServer.Init(sdbpPort);
     sdbpServer.SetContext(&shardServer);
     sdbpServer.UseKeepAlive(true);
+    sdbpServer.SetMaxInFlightRequests(
+     configFile.GetIntValue("sdbp.maxInFlightRequests", DEFAULT_MAX_INFLIGHT_REQUESTS),
+     configFile.GetIntValue("sdbp.maxSessionInFlightRequests", DEFAULT_MAX_SESSION_INFLIGHT_REQUESTS));
 
     // start shardServer only after network servers are started
     shardServer.Init(this, restoreMode, setNodeID, nodeID);
@@ -47,3 +50,8 @@ unsigned ShardServerApp::GetNumSDBPClients()
 {
     return sdbpServer.GetNumActiveConns();
 }
+
+SDBPServer* ShardServerApp::GetSDBPServer()
+{
+    return &sdbpServer;
+}
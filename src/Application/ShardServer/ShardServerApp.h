@@ -7,6 +7,9 @@
 #include "Application/HTTP/HTTPServer.h"
 #include "Application/SDBP/SDBPServer.h"
 
+#define DEFAULT_MAX_INFLIGHT_REQUESTS           50000
+#define DEFAULT_MAX_SESSION_INFLIGHT_REQUESTS   10000
+
 /*
 ===============================================================================================
 
@@ -28,6 +31,7 @@ public:
 
     uint64_t                GetMemoryUsage();
     unsigned                GetNumSDBPClients();
+    SDBPServer*             GetSDBPServer();
 
 private:
     ShardServer             shardServer;
@@ -3,11 +3,6 @@
 #include "Application/Common/ClientRequest.h"
 #include "Application/ShardServer/ShardServer.h"
 
-static inline int KeyCmp(const Buffer& a, const Buffer& b)
-{
-    return Buffer::Cmp(a, b);
-}
-
 static inline const Buffer& Key(const ShardWaitQueue* waitQueue)
 {
     return waitQueue->key;
@@ -57,8 +52,8 @@ void ShardWaitQueue::AssertClear()
     ASSERT(emptyTime == 0);
     ASSERT(key.GetLength() == 0);
     ASSERT(nodes.GetLength() == 0);
-    // not in wait queue tree
-    ASSERT(!treeNode.IsInTree());
+    // not in wait queue table
+    ASSERT(!hashNode.IsInTable());
     // not in wait queue cache list
     ASSERT(listCacheNode.next == this);
     // not in wait queue pool list
@@ -90,15 +85,15 @@ void ShardWaitQueueManager::Shutdown()
     ASSERT(nodeExpiryList.GetLength() == 0);
     nodePoolList.DeleteList();
     queueCacheList.Clear();
-    queueTree.DeleteTree();
+    queueTable.DeleteTable();
     queuePoolList.DeleteList();
     UpdateExpireRequestsTimeout();
 }
 
 unsigned ShardWaitQueueManager::GetNumWaitQueues()
 {
-    ASSERT(queueTree.GetCount() - queueCacheList.GetLength() >= 0);
-    return queueTree.GetCount() - queueCacheList.GetLength();
+    ASSERT(queueTable.GetCount() - queueCacheList.GetLength() >= 0);
+    return queueTable.GetCount() - queueCacheList.GetLength();
 }
 
 unsigned ShardWaitQueueManager::GetQueueCacheListLength()
@@ -163,24 +158,21 @@ unsigned ShardWaitQueueManager::GetMaxPoolCount()
 
 void ShardWaitQueueManager::Push(ClientRequest* request)
 {
-    int                 cmpres;
     ShardWaitQueue*     waitQueue;
-    ShardWaitQueue*     newWaitQueue;
     ShardWaitQueueNode* waitQueueNode;
 
-    waitQueue = queueTree.Locate(request->key, cmpres);
+    waitQueue = queueTable.Get(request->key);
     
-    if (!FOUND_IN_TREE(waitQueue, cmpres))
+    if (!waitQueue)
     {
-        // not in tree
-        newWaitQueue = NewWaitQueue();
-        newWaitQueue->key.Write(request->key);
-        queueTree.InsertAt(newWaitQueue, waitQueue, cmpres);
-        waitQueue = newWaitQueue;
+        // not in table
+        waitQueue = NewWaitQueue();
+        waitQueue->key.Write(request->key);
+        queueTable.Insert(waitQueue);
     }
     else if (waitQueue->nodes.GetLength() == 0)
     {
-        // in tree, but wait queue is empty
+        // in table, but wait queue is empty
         ASSERT(waitQueue->emptyTime > 0);
         // in wait queue cache list
         ASSERT(waitQueue->listCacheNode.next != waitQueue);
@@ -189,8 +181,8 @@ void ShardWaitQueueManager::Push(ClientRequest* request)
         waitQueue->emptyTime = 0;
         queueCacheList.Remove(waitQueue);    }
 
-    // in wait queue tree
-    ASSERT(waitQueue->treeNode.IsInTree());
+    // in wait queue table
+    ASSERT(waitQueue->hashNode.IsInTable());
     // not in wait queue cache list
     ASSERT(waitQueue->listCacheNode.next == waitQueue);
     // not in wait queue pool list
@@ -217,15 +209,11 @@ void ShardWaitQueueManager::Push(ClientRequest* request)
 
 ClientRequest* ShardWaitQueueManager::Pop(ReadBuffer key)
 {
-    int                 cmpres;
-    Buffer              keyBuffer;
     ShardWaitQueue*     waitQueue;
 
-    keyBuffer.Write(key);
-
-    waitQueue = queueTree.Locate(keyBuffer, cmpres);
+    waitQueue = queueTable.Get(key);
     
-    if (!FOUND_IN_TREE(waitQueue, cmpres))
+    if (!waitQueue)
         return NULL;
 
     return Pop(waitQueue);
@@ -236,7 +224,7 @@ void ShardWaitQueueManager::FailAll()
     ShardWaitQueue*     waitQueue;
     ClientRequest*      request;
 
-    FOREACH(waitQueue, queueTree)
+    FOREACH(waitQueue, queueTable)
     {
         while ((request = Pop(waitQueue)) != NULL)
             Fail(request);
@@ -256,8 +244,8 @@ void ShardWaitQueueManager::OnRemoveCachedWaitQueues()
         ASSERT(waitQueue->emptyTime > 0);
         // wait queue should be empty
         ASSERT(waitQueue->nodes.GetLength() == 0);
-        // in wait queue tree
-        ASSERT(waitQueue->treeNode.IsInTree());
+        // in wait queue table
+        ASSERT(waitQueue->hashNode.IsInTable());
         // in wait queue cache list
         ASSERT(waitQueue->listCacheNode.next != waitQueue);
         // not in wait queue pool list
@@ -267,7 +255,7 @@ void ShardWaitQueueManager::OnRemoveCachedWaitQueues()
         {
             waitQueue->emptyTime = 0;
             waitQueue->key.Clear();
-            queueTree.Remove(waitQueue);
+            queueTable.Remove(waitQueue);
             queueCacheList.Remove(waitQueue);
             DeleteWaitQueue(waitQueue);
         }
@@ -3,7 +3,7 @@
 
 #include "System/Buffers/Buffer.h"
 #include "System/Events/Countdown.h"
-#include "System/Containers/InTreeMap.h"
+#include "System/Containers/InHashTable.h"
 #include "System/Containers/InNodeList.h"
 
 #define WAITQUEUE_CHECK_FREQUENCY        (1000)      // msec
@@ -46,14 +46,14 @@ public:
 /*
 ===============================================================================================
 
- ShardWaitQueueTreeNode
+ ShardWaitQueue
  
 ===============================================================================================
 */
 
 class ShardWaitQueue
 {
-    typedef InTreeNode<ShardWaitQueue> TreeNode;
+    typedef InHashNode<ShardWaitQueue> HashNode;
     typedef InListNode<ShardWaitQueue> ListNode;
     typedef InNodeList<ShardWaitQueueNode, &ShardWaitQueueNode::listWaitQueueNode> Nodes;
 
@@ -67,7 +67,7 @@ public:
     uint64_t        emptyTime; // when this waitQueue was emptied
     Nodes           nodes;
 
-    TreeNode        treeNode;
+    HashNode        hashNode;
     ListNode        listCacheNode;
     ListNode        listPoolNode;
 };
@@ -82,7 +82,7 @@ public:
 
 class ShardWaitQueueManager
 {
-    typedef InTreeMap<ShardWaitQueue>                                           QueueTree;
+    typedef InHashTable<ShardWaitQueue>                                         QueueTable;
     typedef InNodeList<ShardWaitQueueNode, &ShardWaitQueueNode::listExpiryNode> NodeExpiryList;
     typedef InNodeList<ShardWaitQueueNode, &ShardWaitQueueNode::listPoolNode>   NodePoolList;
     typedef InNodeList<ShardWaitQueue, &ShardWaitQueue::listCacheNode>          QueueCacheList;
@@ -137,7 +137,7 @@ private:
     unsigned            maxPoolCount;
     Timer               expireRequests;
     Countdown           removeCachedWaitQueues;
-    QueueTree           queueTree;
+    QueueTable          queueTable;
     QueueCacheList      queueCacheList;
     QueuePoolList       queuePoolList;
     NodeExpiryList      nodeExpiryList;
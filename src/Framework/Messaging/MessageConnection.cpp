@@ -22,6 +22,7 @@ MessageConnection::~MessageConnection()
 void MessageConnection::InitConnected(bool startRead)
 {
     readBuffer.Allocate(MESSAGING_BUFFER_THRESHOLD * 2);    
+    readActive = true;
     TCPConnection::InitConnected(startRead);    
     Log_Trace();
 }
@@ -116,13 +117,9 @@ void MessageConnection::OnRead()
     Stopwatch       sw;
     ReadBuffer      msg;
 
+    // the received data stays in the buffer until ResumeRead() is called
     if (!readActive)
-    {
-        if (resumeRead.IsActive())
-            STOP_FAIL(1, "Program bug: resumeRead.IsActive() should be false.");
-        EventLoop::Add(&resumeRead);
         return;
-    }
 
     sw.Start();
     
@@ -187,7 +184,14 @@ void MessageConnection::OnRead()
         if (tcpread.buffer->GetLength() == msgend)
             break;
 
-        if (NowClock() - start >= YIELD_TIME || !readActive)
+        if (!readActive)
+        {
+            // stop reading, tcpread is not posted again until ResumeRead()
+            yield = true;
+            break;
+        }
+
+        if (NowClock() - start >= YIELD_TIME)
         {
             // let other code run every YIELD_TIME msec
             yield = true;
@@ -213,6 +217,26 @@ void MessageConnection::OnRead()
     //Log_Debug("time spent in OnRead(): %U", sw.Elapsed());
 }
 
+void MessageConnection::PauseRead()
+{
+    readActive = false;
+}
+
+void MessageConnection::ResumeRead()
+{
+    if (readActive)
+        return;
+
+    readActive = true;
+    if (state == CONNECTED && !resumeRead.IsActive())
+        EventLoop::Add(&resumeRead);
+}
+
+bool MessageConnection::IsReadActive()
+{
+    return readActive;
+}
+
 void MessageConnection::OnResumeRead()
 {
     Log_Trace();
@@ -34,6 +34,12 @@ public:
     void                Write(Buffer& prefix, Buffer& msg);
     void                Write(Buffer& prefix, Message& msg);
 
+    // While reading is paused no messages are passed to OnMessage(), and the socket
+    // is not read, so the peer is blocked by TCP flow control
+    void                PauseRead();
+    void                ResumeRead();
+    bool                IsReadActive();
+
     // Must implement OnMessage() in derived classes
     // OnMessage() returns whether the connection was closed and deleted
     virtual bool        OnMessage(ReadBuffer& msg)                              = 0;
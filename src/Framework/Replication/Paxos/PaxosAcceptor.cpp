@@ -2,15 +2,35 @@
 #include "PaxosProposer.h"
 #include "Framework/Replication/ReplicationConfig.h"
 
+PaxosAcceptorSlot::PaxosAcceptorSlot()
+{
+    paxosID = 0;
+    proposalID = 0;
+    runID = 0;
+    chosen = false;
+    chosenNodeID = 0;
+    prev = next = this;
+}
+
 PaxosAcceptor::PaxosAcceptor()
 {
     onStateWritten = MFUNC(PaxosAcceptor, OnStateWritten);
 }
 
+PaxosAcceptor::~PaxosAcceptor()
+{
+    slots.DeleteList();
+}
+
 void PaxosAcceptor::Init(QuorumContext* context_)
 {
     context = context_;
     isCommitting = false;
+    chosen = false;
+    chosenNodeID = 0;
+    // enabled by the next prepare request
+    pipelineEnabled = false;
+    pipelinePromisedProposalID = 0;
     
     ReadState();
 }
@@ -43,7 +63,18 @@ bool PaxosAcceptor::OnProposeRequest(PaxosMessage& imsg)
     Log_Trace("state.promisedProposalID: %U msg.proposalID: %U",
      state.promisedProposalID, imsg.proposalID);
     
-    reject = TestRejection(imsg);
+    if (imsg.paxosID > context->GetPaxosID() && context->GetPipelineDepth() > 1)
+    {
+        // the leader is pipelining, this is for one of the next rounds
+        reject = TestPipelinedRejection(imsg);
+        if (!reject)
+        {
+            AcceptPipelinedProposeRequest(imsg);
+            return false; // OnMessageProcessed() will be called in OnStateWritten()
+        }
+    }
+    else
+        reject = TestRejection(imsg);
 
     if (reject)
     {
@@ -56,8 +87,54 @@ bool PaxosAcceptor::OnProposeRequest(PaxosMessage& imsg)
     return false; // OnMessageProcessed() will be called in OnStateWritten()
 }
 
+bool PaxosAcceptor::OnPipelinedLearn(PaxosMessage& imsg)
+{
+    PaxosAcceptorSlot*  slot;
+
+    // the learn for a round ahead of the current one arrived before
+    // the current round was executed, remember it for OnNewPaxosRound()
+    slot = GetSlot(imsg.paxosID);
+    if (slot == NULL || slot->proposalID != imsg.proposalID)
+        return false;
+
+    slot->chosen = true;
+    slot->chosenNodeID = imsg.nodeID;
+    return true;
+}
+
+void PaxosAcceptor::OnNewPaxosRound()
+{
+    PaxosAcceptorSlot*  slot;
+
+    state.OnNewPaxosRound();
+    chosen = false;
+    chosenNodeID = 0;
+
+    while ((slot = slots.First()) != NULL && slot->paxosID <= context->GetPaxosID())
+    {
+        if (slot->paxosID == context->GetPaxosID())
+        {
+            state.promisedProposalID = slot->proposalID;
+            state.accepted = true;
+            state.acceptedProposalID = slot->proposalID;
+            state.acceptedRunID = slot->runID;
+            state.acceptedValue.Write(slot->value);
+            chosen = slot->chosen;
+            chosenNodeID = slot->chosenNodeID;
+        }
+        slots.Delete(slot);
+    }
+
+    // the promise of the last prepare request holds for the rounds after it
+    if (state.promisedProposalID < pipelinePromisedProposalID)
+        state.promisedProposalID = pipelinePromisedProposalID;
+}
+
 void PaxosAcceptor::OnCatchupStarted()
 {
+    pipelineEnabled = false;
+    pipelinePromisedProposalID = 0;
+    ClearSlots();
     state.Init();
     WriteState();
     context->GetDatabase()->Commit();
@@ -68,6 +145,9 @@ void PaxosAcceptor::OnCatchupComplete()
     ASSERT(!isCommitting);
     ASSERT(!context->GetDatabase()->IsCommitting());
 
+    pipelineEnabled = false;
+    pipelinePromisedProposalID = 0;
+    ClearSlots();
     state.Init();
     WriteState();
     context->GetDatabase()->Commit();
@@ -89,11 +169,31 @@ void PaxosAcceptor::WriteState()
         ASSERT(state.acceptedValue.GetLength() > 0);
         db->SetAcceptedValue(context->GetPaxosID(), state.acceptedValue);
     }
+
+    WritePipelinedState();
+}
+
+bool PaxosAcceptor::IsChosen(uint64_t& nodeID)
+{
+    nodeID = chosenNodeID;
+    return chosen && state.accepted;
+}
+
+bool PaxosAcceptor::IsPipelineEnabled()
+{
+    return pipelineEnabled;
 }
 
 uint64_t PaxosAcceptor::GetMemoryUsage()
 {
-    return sizeof(PaxosAcceptor) + state.acceptedValue.GetSize();
+    uint64_t            size;
+    PaxosAcceptorSlot*  slot;
+
+    size = sizeof(PaxosAcceptor) + state.acceptedValue.GetSize();
+    FOREACH (slot, slots)
+        size += sizeof(PaxosAcceptorSlot) + slot->value.GetSize();
+
+    return size;
 }
 
 void PaxosAcceptor::Commit()
@@ -121,7 +221,11 @@ void PaxosAcceptor::OnStateWritten()
     isCommitting = false;
 
     if (writtenPaxosID == context->GetPaxosID())
+    {
+        if (omsg.type == PAXOS_PREPARE_PREVIOUSLY_ACCEPTED || omsg.type == PAXOS_PREPARE_CURRENTLY_OPEN)
+            SendPipelinedAccepted();
         context->GetTransport()->SendMessage(senderID, omsg);
+    }
 
     context->OnMessageProcessed();
 }
@@ -142,6 +246,8 @@ void PaxosAcceptor::ReadState()
         db->GetAcceptedValue(context->GetPaxosID(), state.acceptedValue);
         ASSERT(state.acceptedValue.GetLength() > 0);
     }
+
+    ReadPipelinedState();
 }
 
 bool PaxosAcceptor::TestRejection(PaxosMessage& msg)
@@ -173,9 +279,44 @@ bool PaxosAcceptor::TestRejection(PaxosMessage& msg)
     return reject;
 }
 
+bool PaxosAcceptor::TestPipelinedRejection(PaxosMessage& msg)
+{
+    bool                reject;
+
+    reject = false;
+    if (!pipelineEnabled)
+        reject = true;
+    if (msg.paxosID >= context->GetPaxosID() + context->GetPipelineDepth())
+        reject = true;
+    // only the proposer of the last accepted prepare request knows the values accepted ahead,
+    // a value accepted by a majority could be overwritten otherwise
+    if (msg.proposalID != pipelinePromisedProposalID)
+        reject = true;
+    if (isCommitting)
+        reject = true;
+    if (context->GetDatabase()->IsCommitting())
+        reject = true;
+    if (context->IsPaxosBlocked())
+        reject = true;
+
+    if (reject)
+    {
+        Log_Debug("Pipelined propose rejected, imsg.paxosID = %U, context->GetPaxosID() = %U",
+         msg.paxosID, context->GetPaxosID());
+        Log_Debug("imsg.proposalID = %U, pipelinePromisedProposalID = %U, pipelineEnabled = %b",
+         msg.proposalID, pipelinePromisedProposalID, pipelineEnabled);
+    }
+
+    return reject;
+}
+
 void PaxosAcceptor::AcceptPrepareRequest(PaxosMessage& imsg)
 {
     state.promisedProposalID = imsg.proposalID;
+    pipelineEnabled = true;
+    // the promise covers the rounds ahead, their values are sent in OnStateWritten()
+    if (context->GetPipelineDepth() > 1)
+        pipelinePromisedProposalID = imsg.proposalID;
 
     senderID = imsg.nodeID;
     if (!state.accepted)
@@ -208,3 +349,152 @@ void PaxosAcceptor::AcceptProposeRequest(PaxosMessage& imsg)
     WriteState();
     Commit();
 }
+
+void PaxosAcceptor::AcceptPipelinedProposeRequest(PaxosMessage& imsg)
+{
+    PaxosAcceptorSlot*  slot;
+    PaxosAcceptorSlot*  it;
+
+    slot = GetSlot(imsg.paxosID);
+    if (slot == NULL)
+    {
+        slot = new PaxosAcceptorSlot;
+        slot->paxosID = imsg.paxosID;
+
+        // keep the slots ordered by paxosID
+        FOREACH_BACK (it, slots)
+        {
+            if (it->paxosID < slot->paxosID)
+                break;
+        }
+        if (it == NULL)
+            slots.Prepend(slot);
+        else
+            slots.InsertAfter(it, slot);
+    }
+
+    slot->proposalID = imsg.proposalID;
+    slot->runID = imsg.runID;
+    ASSERT(imsg.value.GetLength() > 0);
+    slot->value.Write(imsg.value);
+    slot->chosen = false;
+    slot->chosenNodeID = 0;
+
+    senderID = imsg.nodeID;
+    omsg.ProposeAccepted(imsg.paxosID, MY_NODEID, imsg.proposalID);
+
+    context->GetDatabase()->SetAcceptedValue(slot->paxosID, slot->value);
+    WritePipelinedState();
+    Commit();
+}
+
+void PaxosAcceptor::SendPipelinedAccepted()
+{
+    PaxosMessage        msg;
+    PaxosAcceptorSlot*  slot;
+
+    // sent before the response, so the proposer has them when the prepare succeeds
+    FOREACH (slot, slots)
+    {
+        msg.PreparePipelinedAccepted(slot->paxosID, MY_NODEID,
+         omsg.proposalID, slot->proposalID, slot->runID, slot->value);
+        context->GetTransport()->SendMessage(senderID, msg);
+    }
+}
+
+void PaxosAcceptor::WritePipelinedState()
+{
+    Buffer              buffer;
+    PaxosAcceptorSlot*  slot;
+
+    if (pipelinePromisedProposalID > 0 || slots.GetLength() > 0)
+        buffer.Appendf("%U ", pipelinePromisedProposalID);
+    FOREACH (slot, slots)
+        buffer.Appendf("%U:%U:%U ", slot->paxosID, slot->proposalID, slot->runID);
+
+    // don't touch the database if pipelining was never used
+    if (buffer.GetLength() == 0 && !hasPipelinedState)
+        return;
+
+    context->GetDatabase()->SetPipelinedState(buffer);
+    hasPipelinedState = (buffer.GetLength() > 0);
+}
+
+void PaxosAcceptor::ReadPipelinedState()
+{
+    int                 read;
+    uint64_t            paxosID;
+    uint64_t            proposalID;
+    uint64_t            runID;
+    Buffer              buffer;
+    ReadBuffer          parse;
+    PaxosAcceptorSlot*  slot;
+
+    slots.DeleteList();
+
+    context->GetDatabase()->GetPipelinedState(buffer);
+    hasPipelinedState = (buffer.GetLength() > 0);
+
+    parse.Wrap(buffer);
+    if (parse.GetLength() > 0)
+    {
+        read = parse.Readf("%U ", &pipelinePromisedProposalID);
+        if (read < 0)
+        {
+            Log_Message("Invalid pipelined Paxos state in quorum %U", context->GetQuorumID());
+            return;
+        }
+        parse.Advance(read);
+    }
+
+    while (parse.GetLength() > 0)
+    {
+        read = parse.Readf("%U:%U:%U ", &paxosID, &proposalID, &runID);
+        if (read < 0)
+        {
+            Log_Message("Invalid pipelined Paxos state in quorum %U", context->GetQuorumID());
+            break;
+        }
+        parse.Advance(read);
+
+        if (paxosID <= context->GetPaxosID())
+            continue;
+
+        slot = new PaxosAcceptorSlot;
+        slot->paxosID = paxosID;
+        slot->proposalID = proposalID;
+        slot->runID = runID;
+        context->GetDatabase()->GetAcceptedValue(paxosID, slot->value);
+        if (slot->value.GetLength() == 0)
+        {
+            delete slot;
+            continue;
+        }
+        slots.Append(slot);
+    }
+}
+
+void PaxosAcceptor::ClearSlots()
+{
+    PaxosAcceptorSlot*  slot;
+
+    // these values were never chosen in this node's log,
+    // they must not be served to lagging nodes later
+    FOREACH (slot, slots)
+        context->GetDatabase()->DeleteAcceptedValue(slot->paxosID);
+
+    slots.DeleteList();
+}
+
+PaxosAcceptorSlot* PaxosAcceptor::GetSlot(uint64_t paxosID)
+{
+    PaxosAcceptorSlot*  slot;
+
+    FOREACH (slot, slots)
+    {
+        if (slot->paxosID == paxosID)
+            return slot;
+    }
+
+    return NULL;
+}
@@ -2,6 +2,7 @@
 #define PAXOSACCEPTOR_H
 
 #include "System/Common.h"
+#include "System/Containers/InList.h"
 #include "PaxosMessage.h"
 #include "Framework/Replication/Quorums/QuorumContext.h"
 #include "Framework/Replication/Quorums/QuorumDatabase.h"
@@ -9,11 +10,46 @@
 
 class ReplicatedLog; // forward
 
+/*
+===============================================================================================
+
+ PaxosAcceptorSlot
+
+ A value accepted for a round ahead of the current one, proposed by a pipelining leader.
+
+===============================================================================================
+*/
+
+struct PaxosAcceptorSlot
+{
+    PaxosAcceptorSlot();
+
+    uint64_t            paxosID;
+    uint64_t            proposalID;
+    uint64_t            runID;
+    Buffer              value;
+    bool                chosen;
+    uint64_t            chosenNodeID;
+
+    PaxosAcceptorSlot*  prev;
+    PaxosAcceptorSlot*  next;
+};
+
 /*
 ===============================================================================================
 
  PaxosAcceptor
 
+ Besides the state of the current round, the acceptor keeps the rounds accepted ahead
+ of it while the leader is pipelining. These are persisted before the accept is sent,
+ and become the state of the current round in OnNewPaxosRound().
+
+ A prepare request covers the rounds ahead as well: its proposalID is promised for all
+ of them, and the values accepted ahead are sent to the proposer before the response,
+ so that a new leader proposes them again. Proposals ahead of the current round are only
+ accepted with the proposalID of the last accepted prepare, and only after a prepare
+ request was accepted since the last restart or catchup.
+
 ===============================================================================================
 */
 
@@ -23,13 +59,18 @@ class PaxosAcceptor
 
 public:
     PaxosAcceptor();
+    ~PaxosAcceptor();
         
     void            Init(QuorumContext* context);
     bool            OnPrepareRequest(PaxosMessage& msg);
     bool            OnProposeRequest(PaxosMessage& msg);
+    bool            OnPipelinedLearn(PaxosMessage& msg);
+    void            OnNewPaxosRound();
     void            OnCatchupStarted();
     void            OnCatchupComplete();
     void            WriteState();
+    bool            IsChosen(uint64_t& nodeID);
+    bool            IsPipelineEnabled();
     uint64_t        GetMemoryUsage();
 
     State           state;
@@ -39,10 +80,23 @@ private:
     void            OnStateWritten();
     void            ReadState();
     bool            TestRejection(PaxosMessage& msg);
+    bool            TestPipelinedRejection(PaxosMessage& msg);
     void            AcceptPrepareRequest(PaxosMessage& msg);
     void            AcceptProposeRequest(PaxosMessage& msg);
+    void            AcceptPipelinedProposeRequest(PaxosMessage& msg);
+    void            SendPipelinedAccepted();
+    void            WritePipelinedState();
+    void            ReadPipelinedState();
+    void            ClearSlots();
+    PaxosAcceptorSlot* GetSlot(uint64_t paxosID);
 
     bool            isCommitting;
+    bool            hasPipelinedState;
+    bool            pipelineEnabled;
+    uint64_t        pipelinePromisedProposalID;
+    bool            chosen;
+    uint64_t        chosenNodeID;
+    InList<PaxosAcceptorSlot> slots;
     QuorumContext*  context;
     PaxosMessage    omsg;
     uint64_t        senderID;
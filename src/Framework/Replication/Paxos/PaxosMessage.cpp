@@ -54,6 +54,22 @@ bool PaxosMessage::PrepareCurrentlyOpen(
     return true;
 }
 
+// sent for each round accepted ahead before the response to a prepare request,
+// paxosID is the round the value was accepted for
+bool PaxosMessage::PreparePipelinedAccepted(
+ uint64_t paxosID_, uint64_t nodeID_,
+ uint64_t proposalID_, uint64_t acceptedProposalID_,
+ uint64_t runID_, Buffer& value_)
+{
+    Init(paxosID_, PAXOS_PREPARE_PIPELINED_ACCEPTED, nodeID_);
+    proposalID = proposalID_;
+    acceptedProposalID = acceptedProposalID_;
+    runID = runID_;
+    value.Wrap(value_);
+    
+    return true;
+}
+
 bool PaxosMessage::ProposeRequest(
  uint64_t paxosID_, uint64_t nodeID_,
  uint64_t proposalID_, uint64_t runID_, Buffer& value_)
@@ -138,7 +154,8 @@ bool PaxosMessage::IsPrepareResponse()
 {
     return (type == PAXOS_PREPARE_REJECTED ||
             type == PAXOS_PREPARE_PREVIOUSLY_ACCEPTED ||
-            type == PAXOS_PREPARE_CURRENTLY_OPEN);
+            type == PAXOS_PREPARE_CURRENTLY_OPEN ||
+            type == PAXOS_PREPARE_PIPELINED_ACCEPTED);
 }
 
 bool PaxosMessage::IsProposeResponse()
@@ -172,6 +189,7 @@ bool PaxosMessage::Read(ReadBuffer& buffer)
              &proto, &type, &paxosID, &nodeID, &proposalID, &promisedProposalID);
             break;
         case PAXOS_PREPARE_PREVIOUSLY_ACCEPTED:
+        case PAXOS_PREPARE_PIPELINED_ACCEPTED:
             read = buffer.Readf("%c:%c:%U:%U:%U:%U:%U:%#R",
              &proto, &type, &paxosID, &nodeID, &proposalID, &acceptedProposalID, &runID, &value);
             break;
@@ -232,6 +250,7 @@ bool PaxosMessage::Write(Buffer& buffer)
              proto, type, paxosID, nodeID, proposalID, promisedProposalID);
             break;
         case PAXOS_PREPARE_PREVIOUSLY_ACCEPTED:
+        case PAXOS_PREPARE_PIPELINED_ACCEPTED:
             buffer.Writef("%c:%c:%U:%U:%U:%U:%U:%#R",
              proto, type, paxosID, nodeID, proposalID, acceptedProposalID, runID, &value);
             break;
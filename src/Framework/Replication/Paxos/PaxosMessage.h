@@ -15,6 +15,7 @@
 #define PAXOS_LEARN_VALUE                   '9'
 #define PAXOS_REQUEST_CHOSEN                '0'
 #define PAXOS_START_CATCHUP                 'c'
+#define PAXOS_PREPARE_PIPELINED_ACCEPTED    'p'
 
 /*
 ===============================================================================================
@@ -55,6 +56,11 @@ public:
                      uint64_t paxosID, uint64_t nodeID,
                      uint64_t proposalID);
 
+    bool            PreparePipelinedAccepted(
+                     uint64_t paxosID, uint64_t nodeID,
+                     uint64_t proposalID, uint64_t acceptedProposalID,
+                     uint64_t runID, Buffer& value);
+
     bool            ProposeRequest(
                      uint64_t paxosID, uint64_t nodeID,
                      uint64_t proposalID, uint64_t runID, Buffer& value);
@@ -2,8 +2,25 @@
 #include "System/Events/EventLoop.h"
 #include "Framework/Replication/ReplicationConfig.h"
 
+PaxosProposerSlot::PaxosProposerSlot()
+{
+    paxosID = 0;
+    proposalID = 0;
+    highestReceivedProposalID = 0;
+    runID = 0;
+    vote = NULL;
+    restart = false;
+    prev = next = this;
+}
+
+PaxosProposerSlot::~PaxosProposerSlot()
+{
+    delete vote;
+}
+
 PaxosProposer::~PaxosProposer()
 {
+    pipeline.DeleteList();
     delete vote;
 }
 
@@ -19,6 +36,9 @@ void PaxosProposer::Init(QuorumContext* context_)
     restartTimeout.SetDelay(PAXOS_RESTART_TIMEOUT);
 
     vote = NULL;
+    pipelineBroken = false;
+    pipelineEnabled = false;
+    pipelineProposalID = 0;
     state.Init();
 }
 
@@ -39,6 +59,11 @@ void PaxosProposer::SetUseTimeouts(bool useTimeouts_)
     useTimeouts = useTimeouts_;
 }
 
+void PaxosProposer::SetDummy(Buffer& dummy_)
+{
+    dummy.Write(dummy_);
+}
+
 void PaxosProposer::OnPrepareResponse(PaxosMessage& imsg)
 {
     Log_Trace("msg.nodeID = %u", imsg.nodeID);
@@ -78,7 +103,60 @@ void PaxosProposer::OnPrepareResponse(PaxosMessage& imsg)
         EventLoop::Add(&restartTimeout);
     }
     else if (vote->IsAccepted())
+    {
+        pipelineEnabled = true;
+        if (context->GetPipelineDepth() > 1)
+            pipelineProposalID = state.proposalID;
         StartProposing();
+        ProposePipelineAgain();
+    }
+}
+
+void PaxosProposer::OnPipelinedPrepareResponse(PaxosMessage& imsg)
+{
+    uint64_t            paxosID;
+    PaxosProposerSlot*  slot;
+
+    Log_Trace("msg.nodeID = %u", imsg.nodeID);
+
+    if (!state.preparing || imsg.proposalID != state.proposalID)
+        return;
+
+    if (imsg.paxosID <= context->GetPaxosID() ||
+     imsg.paxosID >= context->GetPaxosID() + context->GetPipelineDepth())
+        return;
+
+    FOREACH (slot, pipeline)
+    {
+        if (slot->paxosID == imsg.paxosID)
+            break;
+    }
+
+    // the rounds in between are filled with the dummy, nothing can be chosen in them
+    // if none of the acceptors reports a value
+    paxosID = (pipeline.GetLength() > 0 ? pipeline.Last()->paxosID : context->GetPaxosID());
+    while (slot == NULL && paxosID < imsg.paxosID)
+    {
+        slot = new PaxosProposerSlot;
+        slot->paxosID = ++paxosID;
+        slot->runID = REPLICATION_CONFIG->GetRunID();
+        slot->value.Write(dummy);
+        slot->vote = context->GetQuorum()->NewVote();
+        pipeline.Append(slot);
+        if (slot->paxosID != imsg.paxosID)
+            slot = NULL;
+    }
+    if (slot == NULL)
+        return;
+
+    // as in the current round, the value accepted with the highest proposalID wins
+    if (imsg.acceptedProposalID >= slot->highestReceivedProposalID)
+    {
+        slot->highestReceivedProposalID = imsg.acceptedProposalID;
+        slot->runID = imsg.runID;
+        ASSERT(imsg.value.GetLength() > 0);
+        slot->value.Write(imsg.value);
+    }
 }
 
 void PaxosProposer::OnProposeResponse(PaxosMessage& imsg)
@@ -115,22 +193,131 @@ void PaxosProposer::OnProposeResponse(PaxosMessage& imsg)
 
 void PaxosProposer::Propose(Buffer& value)
 {
+    ProposeWithRunID(REPLICATION_CONFIG->GetRunID(), value);
+}
+
+void PaxosProposer::ProposePipelined(uint64_t paxosID, Buffer& value)
+{
+    PaxosMessage        omsg;
+    PaxosProposerSlot*  slot;
+
     Log_Trace();
-    
-    if (IsActive())
-        ASSERT_FAIL();
 
-    state.proposedRunID = REPLICATION_CONFIG->GetRunID();
+    ASSERT(state.multi);
     ASSERT(value.GetLength() > 0);
-    state.proposedValue.Write(value);
 
-    if (state.multi && state.numProposals == 0)
+    ASSERT(pipelineEnabled);
+
+    slot = new PaxosProposerSlot;
+    slot->paxosID = paxosID;
+    slot->proposalID = pipelineProposalID;
+    slot->runID = REPLICATION_CONFIG->GetRunID();
+    slot->value.Write(value);
+    slot->vote = context->GetQuorum()->NewVote();
+    pipeline.Append(slot);
+
+    omsg.ProposeRequest(paxosID, MY_NODEID, slot->proposalID, slot->runID, slot->value);
+    context->GetTransport()->BroadcastMessage(omsg);
+}
+
+void PaxosProposer::OnPipelinedProposeResponse(PaxosMessage& imsg)
+{
+    PaxosProposerSlot*  slot;
+
+    FOREACH (slot, pipeline)
     {
-        state.numProposals++;
-        StartProposing();
+        if (slot->paxosID == imsg.paxosID)
+            break;
+    }
+
+    if (slot == NULL || imsg.proposalID != slot->proposalID)
+        return;
+
+    if (imsg.type == PAXOS_PROPOSE_REJECTED)
+    {
+        Log_Debug("Pipelined propose rejected, quorumID: %U, paxosID: %U",
+         context->GetQuorumID(), imsg.paxosID);
+        slot->vote->RegisterRejected(imsg.nodeID);
+        // no new rounds until the pipeline drains and a prepare succeeds,
+        // the slot is proposed again when it becomes the current round
+        pipelineBroken = true;
+        pipelineEnabled = false;
     }
     else
-        StartPreparing();   
+        slot->vote->RegisterAccepted(imsg.nodeID);
+}
+
+bool PaxosProposer::ContinuePipelined()
+{
+    PaxosMessage        omsg;
+    PaxosProposerSlot*  slot;
+
+    slot = pipeline.First();
+    if (slot == NULL)
+        return false;
+
+    ASSERT(!IsActive() && !IsLearnSent());
+    ASSERT(slot->paxosID == context->GetPaxosID());
+
+    pipeline.Remove(slot);
+    if (pipeline.GetLength() == 0)
+        pipelineBroken = false;
+
+    if (slot->restart || slot->vote->IsRejected() || !state.multi ||
+     (!pipelineEnabled && !slot->vote->IsAccepted()))
+    {
+        // propose it again as a regular round
+        ProposeWithRunID(slot->runID, slot->value);
+        delete slot;
+        return true;
+    }
+
+    // continue the round where the pipelined proposal left off
+    state.proposedRunID = slot->runID;
+    state.proposedValue.Write(slot->value);
+    state.proposalID = slot->proposalID;
+    state.numProposals++;
+    delete vote;
+    vote = slot->vote;
+    slot->vote = NULL;
+    delete slot;
+
+    if (vote->IsAccepted())
+    {
+        // a majority have already accepted it, we have consensus
+        omsg.LearnProposal(context->GetPaxosID(), MY_NODEID, state.proposalID);
+        BroadcastMessage(omsg);
+        state.learnSent = true;
+    }
+    else
+    {
+        state.proposing = true;
+        if (restartTimeout.IsActive())
+            EventLoop::Remove(&restartTimeout);
+        EventLoop::Reset(&proposeTimeout);
+    }
+
+    return true;
+}
+
+void PaxosProposer::ClearPipeline()
+{
+    pipeline.DeleteList();
+    pipelineBroken = false;
+}
+
+void PaxosProposer::BreakPipeline()
+{
+    PaxosProposerSlot*  slot;
+
+    // the votes were collected from the old quorum,
+    // the values are proposed again as regular rounds
+    FOREACH (slot, pipeline)
+        slot->restart = true;
+
+    if (pipeline.GetLength() > 0)
+        pipelineBroken = true;
+    pipelineEnabled = false;
 }
 
 void PaxosProposer::Restart()
@@ -164,6 +351,8 @@ void PaxosProposer::Stop()
     state.preparing = false;
     state.proposing = false;
     state.multi = false;
+    pipelineEnabled = false;
+    ClearPipeline();
     EventLoop::Remove(&prepareTimeout);
     EventLoop::Remove(&proposeTimeout);
     EventLoop::Remove(&restartTimeout);
@@ -179,9 +368,31 @@ bool PaxosProposer::IsLearnSent()
     return state.learnSent;
 }
 
+bool PaxosProposer::IsPipelineBroken()
+{
+    return pipelineBroken;
+}
+
+bool PaxosProposer::IsPipelineEnabled()
+{
+    return pipelineEnabled;
+}
+
+unsigned PaxosProposer::GetNumPipelined()
+{
+    return pipeline.GetLength();
+}
+
 uint64_t PaxosProposer::GetMemoryUsage()
 {
-    return sizeof(PaxosProposer) + state.proposedValue.GetSize();
+    uint64_t            size;
+    PaxosProposerSlot*  slot;
+
+    size = sizeof(PaxosProposer) + state.proposedValue.GetSize();
+    FOREACH (slot, pipeline)
+        size += sizeof(PaxosProposerSlot) + slot->value.GetSize();
+
+    return size;
 }
 
 void PaxosProposer::OnPrepareTimeout()
@@ -270,7 +481,8 @@ void PaxosProposer::StopProposing()
 
 void PaxosProposer::StartPreparing()
 {
-    PaxosMessage omsg;
+    PaxosMessage        omsg;
+    PaxosProposerSlot*  slot;
     
     Log_Trace();
 
@@ -279,8 +491,15 @@ void PaxosProposer::StartPreparing()
     NewVote();
     state.preparing = true;
     state.numProposals++;
-    state.proposalID = REPLICATION_CONFIG->NextProposalID(MAX(state.proposalID, state.highestPromisedProposalID));
+    // the acceptors keep the promise of the last prepare in the next rounds
+    state.proposalID = REPLICATION_CONFIG->NextProposalID(
+     MAX(MAX(state.proposalID, state.highestPromisedProposalID), pipelineProposalID));
     state.highestReceivedProposalID = 0;
+
+    // nothing is proposed ahead until the prepare succeeds
+    pipelineEnabled = false;
+    FOREACH (slot, pipeline)
+        slot->highestReceivedProposalID = 0;
     
     omsg.PrepareRequest(context->GetPaxosID(), MY_NODEID, state.proposalID);
     BroadcastMessage(omsg);
@@ -311,6 +530,52 @@ void PaxosProposer::StartProposing()
     EventLoop::Reset(&proposeTimeout);
 }
 
+void PaxosProposer::ProposeWithRunID(uint64_t runID, Buffer& value)
+{
+    Log_Trace();
+    
+    if (IsActive())
+        ASSERT_FAIL();
+
+    state.proposedRunID = runID;
+    ASSERT(value.GetLength() > 0);
+    state.proposedValue.Write(value);
+
+    // when pipelining, a round is prepared until pipelining is enabled,
+    // then the rounds are proposed with the proposalID of that prepare
+    if (state.multi && state.numProposals == 0 &&
+     (pipelineEnabled || context->GetPipelineDepth() <= 1))
+    {
+        if (context->GetPipelineDepth() > 1)
+            state.proposalID = pipelineProposalID;
+        state.numProposals++;
+        StartProposing();
+    }
+    else
+        StartPreparing();   
+}
+
+void PaxosProposer::ProposePipelineAgain()
+{
+    PaxosMessage        omsg;
+    PaxosProposerSlot*  slot;
+
+    // the values in the pipeline, including the ones reported by the acceptors,
+    // are proposed again with the new proposalID before any new rounds
+    FOREACH (slot, pipeline)
+    {
+        slot->proposalID = pipelineProposalID;
+        slot->restart = false;
+        delete slot->vote;
+        slot->vote = context->GetQuorum()->NewVote();
+
+        omsg.ProposeRequest(slot->paxosID, MY_NODEID, slot->proposalID, slot->runID, slot->value);
+        context->GetTransport()->BroadcastMessage(omsg);
+    }
+
+    pipelineBroken = false;
+}
+
 void PaxosProposer::NewVote()
 {
     delete vote;
@@ -4,6 +4,7 @@
 #include "System/Common.h"
 #include "System/Events/Countdown.h"
 #include "System/Events/Timer.h"
+#include "System/Containers/InList.h"
 #include "Framework/Replication/Quorums/QuorumContext.h"
 #include "PaxosMessage.h"
 #include "States/PaxosProposerState.h"
@@ -13,11 +14,51 @@ class ReplicatedLog; // forward
 #define PAXOS_ROUND_TIMEOUT     (5*1000)
 #define PAXOS_RESTART_TIMEOUT   (100)
 
+/*
+===============================================================================================
+
+ PaxosProposerSlot
+
+ A round proposed by the leader ahead of the current one.
+
+===============================================================================================
+*/
+
+struct PaxosProposerSlot
+{
+    PaxosProposerSlot();
+    ~PaxosProposerSlot();
+
+    uint64_t            paxosID;
+    uint64_t            proposalID;
+    uint64_t            highestReceivedProposalID;
+    uint64_t            runID;
+    Buffer              value;
+    QuorumVote*         vote;
+    bool                restart;
+
+    PaxosProposerSlot*  prev;
+    PaxosProposerSlot*  next;
+};
+
 /*
 ===============================================================================================
 
  PaxosProposer
 
+ In multi paxos the leader may propose the values of the next rounds while the current
+ one is still in progress (pipelining). These are kept in slots, and the first slot
+ becomes the current round in ContinuePipelined(), after the previous round was executed.
+ Learn messages are only sent for the current round, so values are still learned and
+ executed in paxosID order.
+
+ Pipelining is only enabled by a successful prepare, and the rounds are proposed with its
+ proposalID until the next one. After a restart, a rejected pipelined proposal, a quorum
+ change or the loss of the lease, the next round is prepared again before new rounds are
+ proposed ahead. The acceptors also report the values they accepted ahead in the responses
+ to the prepare; these take the place of the values in the pipeline, the rounds between
+ them are filled with the dummy value, and they are proposed again before any new ones.
+
 ===============================================================================================
 */
 
@@ -31,13 +72,23 @@ public:
     void            Init(QuorumContext* context);
     void            RemoveTimers();
     void            SetUseTimeouts(bool useTimeouts);
+    void            SetDummy(Buffer& dummy);
     void            OnPrepareResponse(PaxosMessage& msg);
+    void            OnPipelinedPrepareResponse(PaxosMessage& msg);
     void            OnProposeResponse(PaxosMessage& msg);
     void            Propose(Buffer& value);
+    void            ProposePipelined(uint64_t paxosID, Buffer& value);
+    void            OnPipelinedProposeResponse(PaxosMessage& msg);
+    bool            ContinuePipelined();
+    void            ClearPipeline();
+    void            BreakPipeline();
     void            Restart();
     void            Stop();
     bool            IsActive();
     bool            IsLearnSent();
+    bool            IsPipelineBroken();
+    bool            IsPipelineEnabled();
+    unsigned        GetNumPipelined();
     uint64_t        GetMemoryUsage();
 
     State           state;
@@ -51,14 +102,21 @@ private:
     void            StopProposing();
     void            StartPreparing();
     void            StartProposing();
+    void            ProposeWithRunID(uint64_t runID, Buffer& value);
+    void            ProposePipelineAgain();
     void            NewVote();
 
     bool            useTimeouts;
+    bool            pipelineBroken;
+    bool            pipelineEnabled;
+    uint64_t        pipelineProposalID;
+    Buffer          dummy;
     QuorumContext*  context;
     QuorumVote*     vote;
     Countdown       prepareTimeout;
     Countdown       proposeTimeout;
     Countdown       restartTimeout;
+    InList<PaxosProposerSlot> pipeline;
 };
 
 #endif
@@ -44,6 +44,8 @@ public:
     virtual bool                UseProposeTimeouts()                                            = 0;
     virtual bool                UseCommitChaining()                                             = 0;
     virtual bool                AlwaysUseDatabaseCatchup()                                      = 0;
+    // number of rounds the leader may have in flight, 1 disables pipelining
+    virtual unsigned            GetPipelineDepth()                                              = 0;
     virtual bool                IsPaxosBlocked()                                                = 0;
     virtual Buffer&             GetNextValue()                                                  = 0;
 
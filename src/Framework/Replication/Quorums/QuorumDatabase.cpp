@@ -127,6 +127,37 @@ void QuorumDatabase::SetAcceptedValue(uint64_t paxosID, ReadBuffer value)
     logShard->Set(rbKey, value);
 }
 
+void QuorumDatabase::DeleteAcceptedValue(uint64_t paxosID)
+{
+    Buffer      key;
+    ReadBuffer  rbKey;
+
+    key.Writef("accepted:%021U", paxosID);
+    rbKey.Wrap(key);
+
+    logShard->Delete(rbKey);
+}
+
+void QuorumDatabase::GetPipelinedState(Buffer& value)
+{
+    ReadBuffer  key("pipelined");
+    ReadBuffer  rbValue;
+
+    value.Clear();
+    if (paxosShard->Get(key, rbValue))
+        value.Write(rbValue);
+}
+
+void QuorumDatabase::SetPipelinedState(ReadBuffer value)
+{
+    ReadBuffer  key("pipelined");
+
+    if (value.GetLength() == 0)
+        paxosShard->Delete(key);
+    else
+        paxosShard->Set(key, value);
+}
+
 bool QuorumDatabase::IsCommitting()
 {
     return paxosShard->GetEnvironment()->IsCommitting(context->GetQuorumID());
@@ -45,6 +45,10 @@ public:
 
     void                GetAcceptedValue(uint64_t paxosID, Buffer& value);
     void                SetAcceptedValue(uint64_t paxosID, ReadBuffer value);
+    void                DeleteAcceptedValue(uint64_t paxosID);
+
+    void                GetPipelinedState(Buffer& value);
+    void                SetPipelinedState(ReadBuffer value);
 
     bool                IsCommitting();
     
@@ -10,6 +10,7 @@ ReplicatedLog::ReplicatedLog()
 {
     canaryTimer.SetCallable(MFUNC(ReplicatedLog, OnCanaryTimeout));
     canaryTimer.SetDelay(CANARY_TIMEOUT);
+    pipelinedLearn.SetCallable(MFUNC(ReplicatedLog, OnPipelinedLearn));
 }
 
 void ReplicatedLog::Init(QuorumContext* context_)
@@ -32,11 +33,13 @@ void ReplicatedLog::Init(QuorumContext* context_)
     EventLoop::Add(&canaryTimer);
     
     dummy.Write("dummy");
+    proposer.SetDummy(dummy);
 }
 
 void ReplicatedLog::Shutdown()
 {
     EventLoop::Remove(&canaryTimer);
+    EventLoop::Remove(&pipelinedLearn);
     proposer.RemoveTimers();
 }
 
@@ -76,13 +79,31 @@ bool ReplicatedLog::IsWaitingOnAppend()
     return waitingOnAppend;
 }
 
+bool ReplicatedLog::IsPipelinedMessage(PaxosMessage& msg)
+{
+    if (context->GetPipelineDepth() <= 1)
+        return false;
+
+    if (msg.type != PAXOS_PROPOSE_REQUEST && !msg.IsProposeResponse() &&
+     msg.type != PAXOS_LEARN_PROPOSAL && msg.type != PAXOS_PREPARE_PIPELINED_ACCEPTED)
+        return false;
+
+    // messages of the rounds in the pipeline window don't mean this node is lagging
+    return (msg.paxosID > paxosID && msg.paxosID < paxosID + context->GetPipelineDepth());
+}
+
+unsigned ReplicatedLog::GetNumPipelined()
+{
+    return proposer.GetNumPipelined();
+}
+
 void ReplicatedLog::TryAppendDummy()
 {
     Log_Trace();
     
     proposer.SetUseTimeouts(true);
     
-    if (proposer.IsActive() || proposer.IsLearnSent())
+    if (proposer.IsActive() || proposer.IsLearnSent() || proposer.GetNumPipelined() > 0)
     {
         appendDummyNext = true;
         return;
@@ -106,10 +127,23 @@ void ReplicatedLog::TryAppendNextValue()
     Log_Trace();
     
     if (waitingOnAppend)
+    {
+        TryAppendPipelined();
         return;
+    }
 
     if (!context->IsLeaseOwner() || proposer.IsActive() || proposer.IsLearnSent() || !proposer.state.multi)
+    {
+        TryAppendPipelined();
         return;
+    }
+
+    // the values already proposed ahead come first
+    if (proposer.ContinuePipelined())
+    {
+        TryAppendPipelined();
+        return;
+    }
 
     if (appendDummyNext)
     {
@@ -124,6 +158,10 @@ void ReplicatedLog::TryAppendNextValue()
     
     proposer.SetUseTimeouts(context->UseProposeTimeouts());
     Append(value);
+
+    // the proposer keeps a copy, so the context may prepare the next value
+    if (context->GetPipelineDepth() > 1)
+        value.Clear();
 }
 
 void ReplicatedLog::TryCatchup()
@@ -134,6 +172,9 @@ void ReplicatedLog::TryCatchup()
 
 void ReplicatedLog::Restart()
 {
+    // the pipelined votes were collected from the old quorum
+    proposer.BreakPipeline();
+
     if (waitingOnAppend)
         return;
 
@@ -142,7 +183,10 @@ void ReplicatedLog::Restart()
 
     context->OnStartProposing();
 
-    proposer.state.multi = false;
+    // when pipelining, the values in flight must still be recognized as our own
+    // when they are learned, so multi paxos stays on
+    if (context->GetPipelineDepth() <= 1)
+        proposer.state.multi = false;
     if (proposer.IsActive())
         proposer.Restart();
 }
@@ -162,7 +206,7 @@ void ReplicatedLog::NewPaxosRound()
     paxosID++;
     proposer.RemoveTimers();
     proposer.state.OnNewPaxosRound();
-    acceptor.state.OnNewPaxosRound();
+    acceptor.OnNewPaxosRound(); // the value accepted ahead becomes the current state
     lastRequestChosenTime = 0;
 }
 
@@ -237,6 +281,8 @@ void ReplicatedLog::OnLeaseTimeout()
 
 void ReplicatedLog::OnAppendComplete()
 {
+    uint64_t    nodeID;
+
     waitingOnAppend = false;
 
     NewPaxosRound(); // increments paxosID, clears proposer, acceptor
@@ -253,6 +299,14 @@ void ReplicatedLog::OnAppendComplete()
         context->GetDatabase()->Commit();
     }
 
+    if (acceptor.IsChosen(nodeID))
+    {
+        // the learn message for this round arrived while the previous one was executing,
+        // keep the Paxos message queue blocked and process it in OnPipelinedLearn()
+        EventLoop::Add(&pipelinedLearn);
+        return;
+    }
+
     context->OnMessageProcessed();
 
     TryAppendNextValue();
@@ -306,7 +360,9 @@ bool ReplicatedLog::OnPrepareResponse(PaxosMessage& imsg)
 
     Log_Trace();
     
-    if (imsg.paxosID == paxosID)
+    if (imsg.type == PAXOS_PREPARE_PIPELINED_ACCEPTED)
+        proposer.OnPipelinedPrepareResponse(imsg);
+    else if (imsg.paxosID == paxosID)
         proposer.OnPrepareResponse(imsg);
     
     return true;
@@ -337,6 +393,8 @@ bool ReplicatedLog::OnProposeResponse(PaxosMessage& imsg)
 
     if (imsg.paxosID == paxosID)
         proposer.OnProposeResponse(imsg);
+    else if (imsg.paxosID > paxosID)
+        proposer.OnPipelinedProposeResponse(imsg);
 
     return true;
 }
@@ -349,6 +407,15 @@ bool ReplicatedLog::OnLearnChosen(PaxosMessage& imsg)
     Log_Debug("OnLearnChosen begin");
 #endif
 
+    if (imsg.type == PAXOS_LEARN_PROPOSAL && imsg.paxosID > paxosID && acceptor.OnPipelinedLearn(imsg))
+    {
+        // the value was accepted ahead, it is processed after the current round
+        // if the learn message for the current round was lost, request it
+        if (!waitingOnAppend)
+            RequestChosen(imsg.nodeID);
+        return true;
+    }
+
     if (context->GetDatabase()->IsCommitting())
     {
 #ifdef RLOG_DEBUG_MESSAGES
@@ -488,6 +555,26 @@ void ReplicatedLog::OnCanaryTimeout()
     EventLoop::Add(&canaryTimer);
 }
 
+void ReplicatedLog::OnPipelinedLearn()
+{
+    uint64_t    nodeID;
+
+    // the state may have been reset by a catchup in the meantime
+    if (waitingOnAppend || !acceptor.IsChosen(nodeID))
+    {
+        context->OnMessageProcessed();
+        return;
+    }
+
+    if (context->GetDatabase()->IsCommitting())
+    {
+        EventLoop::Add(&pipelinedLearn);
+        return;
+    }
+
+    ProcessLearnChosen(nodeID, acceptor.state.acceptedRunID);
+}
+
 void ReplicatedLog::ProcessLearnChosen(uint64_t nodeID, uint64_t runID)
 {
     bool        ownAppend;
@@ -537,6 +624,7 @@ void ReplicatedLog::ProcessLearnChosen(uint64_t nodeID, uint64_t runID)
     else
     {
         proposer.state.multi = false;
+        proposer.ClearPipeline();
         Log_Trace("Multi paxos disabled");
     }
 
@@ -551,6 +639,34 @@ void ReplicatedLog::ProcessLearnChosen(uint64_t nodeID, uint64_t runID)
     }
 }
 
+void ReplicatedLog::TryAppendPipelined()
+{
+    if (context->GetPipelineDepth() <= 1)
+        return;
+
+    if (!context->IsLeaseOwner() || !proposer.state.multi || appendDummyNext)
+        return;
+
+    // if the current round is free, TryAppendNextValue() proposes the value in it
+    if (!waitingOnAppend && !proposer.IsActive() && !proposer.IsLearnSent())
+        return;
+
+    if (!proposer.IsPipelineEnabled() || proposer.IsPipelineBroken() ||
+     proposer.GetNumPipelined() + 1 >= context->GetPipelineDepth())
+        return;
+
+    Buffer& value = context->GetNextValue();
+    if (value.GetLength() == 0)
+        return;
+
+    proposer.ProposePipelined(paxosID + 1 + proposer.GetNumPipelined(), value);
+    value.Clear();
+
+#ifdef RLOG_DEBUG_MESSAGES
+    Log_Debug("Pipelined proposal for paxosID = %U", paxosID + proposer.GetNumPipelined());
+#endif
+}
+
 void ReplicatedLog::OnRequest(PaxosMessage& imsg)
 {
     Buffer          value;
@@ -566,7 +682,7 @@ void ReplicatedLog::OnRequest(PaxosMessage& imsg)
         omsg.LearnValue(imsg.paxosID, MY_NODEID, 0, value);
         context->GetTransport()->SendMessage(imsg.nodeID, omsg);
     }
-    else if (GetPaxosID() < imsg.paxosID)
+    else if (GetPaxosID() < imsg.paxosID && !IsPipelinedMessage(imsg))
     {
         //  I am lagging and need to catch-up
         RequestChosen(imsg.nodeID);
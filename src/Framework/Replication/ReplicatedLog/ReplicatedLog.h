@@ -8,12 +8,17 @@
 #define REQUEST_CHOSEN_TIMEOUT      (1000)
 #define CANARY_TIMEOUT              (60*1000) // 1 minute
 #define PAXOS_CATCHUP_GRANULARITY   (100*KiB)
+#define MAX_PIPELINE_DEPTH          (64)
 
 /*
 ===============================================================================================
 
  ReplicatedLog
 
+ If the context's pipeline depth is larger than 1, the leader proposes the next values
+ while the current round is in progress, see PaxosProposer. The acceptors accept these
+ ahead of the current round, but learn and execute them in paxosID order.
+
 ===============================================================================================
 */
 
@@ -35,6 +40,8 @@ public:
     bool                    IsMultiPaxosEnabled();
     bool                    IsAppending();
     bool                    IsWaitingOnAppend();
+    bool                    IsPipelinedMessage(PaxosMessage& msg);
+    unsigned                GetNumPipelined();
 
     void                    TryAppendDummy();
     void                    TryAppendNextValue();
@@ -60,6 +67,7 @@ public:
 
 private:
     void                    Append(Buffer& value);
+    void                    TryAppendPipelined();
 
     bool                    OnPrepareRequest(PaxosMessage& msg);
     bool                    OnPrepareResponse(PaxosMessage& msg);
@@ -69,6 +77,7 @@ private:
     bool                    OnRequestChosen(PaxosMessage& msg);
     bool                    OnStartCatchup(PaxosMessage& msg);
     void                    OnCanaryTimeout();
+    void                    OnPipelinedLearn();
 
     void                    ProcessLearnChosen(uint64_t nodeID, uint64_t runID);
 
@@ -87,5 +96,6 @@ private:
     uint64_t                lastLearnChosenTime;
     uint64_t                replicationThroughput;
     Countdown               canaryTimer;
+    YieldTimer              pipelinedLearn;
 };
 #endif
@@ -4,6 +4,7 @@
 #include "System/Stopwatch.h"
 #include "StorageEnvironment.h"
 #include "StorageFileDeleter.h"
+#include "StorageLogArchiver.h"
 
 StorageArchiveLogSegmentJob::StorageArchiveLogSegmentJob(StorageEnvironment* env_, 
  StorageLogSegment* logSegment_, const char* script_)
@@ -15,18 +16,18 @@ StorageArchiveLogSegmentJob::StorageArchiveLogSegmentJob(StorageEnvironment* env
 
 void StorageArchiveLogSegmentJob::Execute()
 {
-    Buffer  dest;
     Buffer  cmdline;
     
     if (ReadBuffer::Cmp(script, "$archive") == 0)
     {
         Log_Message("Archiving log segment %U...", logSegment->GetLogSegmentID());
 
-        dest.Write(env->archivePath);
-        dest.Appendf("log.%020U.%020U", logSegment->GetTrackID(), logSegment->GetLogSegmentID());
-        dest.NullTerminate();
-
-        FS_Rename(logSegment->filename.GetBuffer(), dest.GetBuffer());
+        if (!StorageLogArchiver::Archive(logSegment->filename,
+         logSegment->GetTrackID(), logSegment->GetLogSegmentID()))
+        {
+            Log_Message("Unable to archive log segment %U/%U",
+             logSegment->GetTrackID(), logSegment->GetLogSegmentID());
+        }
     }
     else if (ReadBuffer::Cmp(script, "$delete") == 0)
     {
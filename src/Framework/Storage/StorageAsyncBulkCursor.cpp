@@ -3,6 +3,7 @@
 #include "StorageEnvironment.h"
 #include "StorageMemoChunkLister.h"
 #include "StorageUnwrittenChunkLister.h"
+#include "StorageValueLog.h"
 #include "System/Events/Callable.h"
 #include "System/IO/IOProcessor.h"
 
@@ -21,6 +22,7 @@ StorageAsyncBulkResult::StorageAsyncBulkResult(StorageAsyncBulkCursor* cursor_)
 {
     cursor = cursor_;
     last = false;
+    error = false;
 }
 
 void StorageAsyncBulkResult::OnComplete()
@@ -52,16 +54,28 @@ void StorageAsyncBulkResult::OnComplete()
 StorageAsyncBulkCursor::StorageAsyncBulkCursor()
 {
     isAborted = false;
+    readError = false;
     env = NULL;
     shard = NULL;
     lastResult = NULL;
     itChunk = NULL;
     threadPool = NULL;
+    reader = NULL;
+    valueLogPin = 0;
+}
+
+StorageAsyncBulkCursor::~StorageAsyncBulkCursor()
+{
+    delete reader;
+    if (env != NULL)
+        env->GetValueLog()->Unpin(valueLogPin);
 }
 
 void StorageAsyncBulkCursor::SetEnvironment(StorageEnvironment* env_)
 {
     env = env_;
+    // the values of the chunks read by the cursor are not deleted while it is alive
+    valueLogPin = env->GetValueLog()->Pin();
 }
 
 void StorageAsyncBulkCursor::SetShard(uint64_t contextID, uint64_t shardID)
@@ -85,6 +99,11 @@ StorageAsyncBulkResult* StorageAsyncBulkCursor::GetLastResult()
     return lastResult;
 }
 
+bool StorageAsyncBulkCursor::HasReadError()
+{
+    return readError;
+}
+
 void StorageAsyncBulkCursor::OnNextChunk()
 {
     ReadBuffer                  startKey;
@@ -96,7 +115,10 @@ void StorageAsyncBulkCursor::OnNextChunk()
     StorageMemoChunkLister      memoLister;
     StorageUnwrittenChunkLister unwrittenLister;
     
-    if (itChunk == NULL)
+    // the iteration ends at the first error, the result with the error was already delivered
+    if (readError)
+        itChunk = NULL;
+    else if (itChunk == NULL)
         itChunk = shard->GetChunks().First();
     else
         itChunk = shard->GetChunks().Next(itChunk);
@@ -112,6 +134,10 @@ void StorageAsyncBulkCursor::OnNextChunk()
     {
         fileChunk = (StorageFileChunk*) (*itChunk);
         chunkName = fileChunk->GetFilename();
+        // the file is opened here, because the chunk may be deleted and its file moved away
+        // before the read starts in the thread
+        reader = new StorageChunkReader;
+        reader->AcquireFD(chunkName);
         threadPool->Execute(MFUNC(StorageAsyncBulkCursor, AsyncReadFileChunk));
     }
     else if ((*itChunk)->GetChunkState() == StorageChunk::Unwritten)
@@ -119,7 +145,7 @@ void StorageAsyncBulkCursor::OnNextChunk()
         fileChunk = (StorageFileChunk*) (*itChunk);
         unwrittenLister.Init(*fileChunk, startKey, prefix, 0, true);
         result = new StorageAsyncBulkResult(this);
-        result->dataPage = *unwrittenLister.GetDataPage();
+        TransferDataPage(result, unwrittenLister.GetDataPage());
         result->onComplete = onComplete;
         lastResult = result;
         // direct callback, maybe yieldTimer would be better
@@ -151,16 +177,15 @@ void StorageAsyncBulkCursor::Abort()
 // this runs in async thread
 void StorageAsyncBulkCursor::AsyncReadFileChunk()
 {
-    StorageChunkReader      reader;
     StorageDataPage*        dataPage;
     StorageAsyncBulkResult* result;
     Callable                onNextChunk = MFUNC(StorageAsyncBulkCursor, OnNextChunk);
     
-    reader.Open(chunkName, MAX_PRELOAD_THRESHOLD);
+    reader->Open(chunkName, MAX_PRELOAD_THRESHOLD);
     
     lastResult = NULL;
     result = new StorageAsyncBulkResult(this);
-    dataPage = reader.FirstDataPage();
+    dataPage = reader->FirstDataPage();
     
     while (dataPage != NULL)
     {
@@ -172,22 +197,63 @@ void StorageAsyncBulkCursor::AsyncReadFileChunk()
             return;
         }
     
-        TransferDataPage(result, dataPage);
+        if (!TransferDataPage(result, dataPage))
+        {
+            delete reader;
+            reader = NULL;
+            OnResult(result);
+            IOProcessor::Complete(&onNextChunk);
+            return;
+        }
         OnResult(result);
         
         result = new StorageAsyncBulkResult(this);
-        dataPage = reader.NextDataPage();
+        dataPage = reader->NextDataPage();
     }
     
+    // the results hold copies of the pages
+    delete reader;
+    reader = NULL;
     OnResult(result);
     IOProcessor::Complete(&onNextChunk);
 }
 
-void StorageAsyncBulkCursor::TransferDataPage(StorageAsyncBulkResult* result, 
+bool StorageAsyncBulkCursor::TransferDataPage(StorageAsyncBulkResult* result, 
  StorageDataPage* dataPage)
 {
-    // TODO: zero-copy
-    result->dataPage = *dataPage;
+    StorageFileKeyValue*    it;
+    StorageFileKeyValue     resolved;
+    ReadBuffer              value;
+    Buffer                  valueBuffer;
+
+    if (!env->GetValueLog()->IsEnabled())
+    {
+        // TODO: zero-copy
+        result->dataPage = *dataPage;
+        return true;
+    }
+
+    // replace value log pointers with the values, so that the receiver gets plain pages
+    FOREACH (it, *dataPage)
+    {
+        if (it->IsValueLogged())
+        {
+            if (!env->GetValueLog()->Resolve(it, valueBuffer, value))
+            {
+                // the receiver gets the error instead of a page with missing keys
+                Log_Message("Unable to read values from the value log for bulk cursor");
+                result->error = true;
+                readError = true;
+                break;
+            }
+            resolved.Set(it->GetKey(), value);
+            result->dataPage.Append(&resolved);
+        }
+        else
+            result->dataPage.Append(it);
+    }
+    result->dataPage.Finalize();
+    return !result->error;
 }
 
 void StorageAsyncBulkCursor::OnResult(StorageAsyncBulkResult* result)
@@ -7,6 +7,8 @@
 #include "StorageChunk.h"
 #include "StorageShard.h"
 
+class StorageChunkReader;
+
 class StorageEnvironment;
 class StorageMemoChunk;
 class StorageFileChunk;
@@ -28,6 +30,7 @@ public:
     void                    OnComplete();
 
     bool                    last;
+    bool                    error;      // a value could not be read from the value log
     StorageAsyncBulkCursor* cursor;
     Callable                onComplete;
     StorageDataPage         dataPage;
@@ -46,6 +49,7 @@ class StorageAsyncBulkCursor
     friend class StorageAsyncBulkResult;
 public:
     StorageAsyncBulkCursor();
+    ~StorageAsyncBulkCursor();
 
     void                    SetEnvironment(StorageEnvironment* env);
     void                    SetShard(uint64_t contextID_, uint64_t shardID);
@@ -53,23 +57,27 @@ public:
     void                    SetOnComplete(Callable onComplete);
 
     StorageAsyncBulkResult* GetLastResult();    
+    bool                    HasReadError();
     
     void                    OnNextChunk();
     void                    Abort();
         
 private:
     void                    AsyncReadFileChunk();
-    void                    TransferDataPage(StorageAsyncBulkResult* result, StorageDataPage* page);
+    bool                    TransferDataPage(StorageAsyncBulkResult* result, StorageDataPage* page);
     void                    OnResult(StorageAsyncBulkResult* result);
     
     bool                    isAborted;
+    bool                    readError;
     Buffer                  chunkName;
+    StorageChunkReader*     reader;
     Callable                onComplete;
     StorageShard*           shard;
     StorageChunk**          itChunk;
     ThreadPool*             threadPool;
     StorageEnvironment*     env;
     StorageAsyncBulkResult* lastResult;
+    uint64_t                valueLogPin;
 };
 
 #endif
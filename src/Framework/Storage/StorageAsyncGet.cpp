@@ -3,14 +3,19 @@
 #include "StoragePageCache.h"
 #include "StorageShard.h"
 #include "StorageEnvironment.h"
+#include "StorageValueLog.h"
 #include "System/IO/IOProcessor.h"
 
 StorageAsyncGet::StorageAsyncGet()
 {
     lastLoadedPage = NULL;
     ret = false;
+    failed = false;
     completed = false;
     skipMemoChunk = false;
+    valueLogRead = false;
+    valueLogPin = 0;
+    loaderFDAcquired = false;
 }
 
 StorageChunk** StorageAsyncGet::GetChunkIterator(StorageShard* shard)
@@ -145,21 +150,36 @@ void StorageAsyncGet::SetLastLoadedPage(StorageFileChunk* fileChunk)
 
 void StorageAsyncGet::SetupLoaderFileChunk(StorageFileChunk* fileChunk)
 {
-    if (loaderFileChunk.GetChunkID() == fileChunk->GetChunkID())
-        return;
+    if (loaderFileChunk.GetChunkID() != fileChunk->GetChunkID())
+    {
+        if (loaderFDAcquired)
+            loaderFileChunk.ReleaseFD();
+        loaderFDAcquired = false;
+
+        loaderFileChunk.Close();
+        loaderFileChunk.Init();
 
-    loaderFileChunk.Close();
-    loaderFileChunk.Init();
+        loaderFileChunk.useCache = false;
+        loaderFileChunk.SetFilename(fileChunk->GetFilename());
+        // it is safe to shallow copy headerPage
+        loaderFileChunk.headerPage = fileChunk->headerPage;
+    }
 
-    loaderFileChunk.useCache = false;
-    loaderFileChunk.SetFilename(fileChunk->GetFilename());
-    // it is safe to shallow copy headerPage
-    loaderFileChunk.headerPage = fileChunk->headerPage;
+    // the chunk may be deleted and its file moved away before the thread pool loads
+    // the page, so the file is kept open from here until the get completes
+    if (!loaderFDAcquired)
+        loaderFDAcquired = loaderFileChunk.AcquireFD();
 }
 
 // This function is executed in the main thread
 void StorageAsyncGet::OnComplete()
 {
+    if (valueLogPin != 0)
+        env->GetValueLog()->Unpin(valueLogPin);
+    valueLogPin = 0;
+    if (loaderFDAcquired)
+        loaderFileChunk.ReleaseFD();
+    loaderFDAcquired = false;
     Call(onComplete);
 }
 
@@ -168,6 +188,14 @@ void StorageAsyncGet::AsyncLoadPage()
 {
     Callable            asyncGet;
 
+    if (stage == VALUE_LOG)
+    {
+        valueLogRead = env->GetValueLog()->Read(ReadBuffer(valueLogPointer), valueBuffer);
+        asyncGet = MFUNC(StorageAsyncGet, OnValueLogRead);
+        IOProcessor::Complete(&asyncGet);
+        return;
+    }
+
     if (stage == BLOOM_PAGE)
         lastLoadedPage = loaderFileChunk.AsyncLoadBloomPage();
     else if (stage == INDEX_PAGE)
@@ -178,3 +206,13 @@ void StorageAsyncGet::AsyncLoadPage()
     asyncGet = MFUNC(StorageAsyncGet, ExecuteAsyncGet);
     IOProcessor::Complete(&asyncGet);
 }
+
+// This function is executed in the main thread
+void StorageAsyncGet::OnValueLogRead()
+{
+    value.Wrap(valueBuffer);
+    ret = valueLogRead;
+    failed = !valueLogRead;
+    completed = true;
+    OnComplete();
+}
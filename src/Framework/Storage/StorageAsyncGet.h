@@ -1,7 +1,7 @@
 #ifndef STORAGEASYNCGET_H
 #define STORAGEASYNCGET_H
 
-#include "System/Buffers/ReadBuffer.h"
+#include "System/Buffers/Buffer.h"
 #include "System/Events/Callable.h"
 #include "StorageFileChunk.h"
 
@@ -27,11 +27,13 @@ public:
         START,
         INDEX_PAGE,
         BLOOM_PAGE,
-        DATA_PAGE
+        DATA_PAGE,
+        VALUE_LOG
     };
     ReadBuffer          key;
     ReadBuffer          value;
     bool                ret;
+    bool                failed;     // the key exists, but its value could not be read
     bool                completed;
     bool                skipMemoChunk;
     Stage               stage;
@@ -45,6 +47,11 @@ public:
     uint64_t            chunkID;
     StorageEnvironment* env;
     StorageFileChunk    loaderFileChunk;
+    bool                loaderFDAcquired;
+    Buffer              valueLogPointer;
+    Buffer              valueBuffer;
+    bool                valueLogRead;
+    uint64_t            valueLogPin;
     
     StorageAsyncGet();
 
@@ -54,6 +61,7 @@ public:
     void                SetupLoaderFileChunk(StorageFileChunk* fileChunk);
     void                OnComplete();
     void                AsyncLoadPage();
+    void                OnValueLogRead();
 };
 
 #endif
@@ -4,8 +4,11 @@
 #include "StorageMemoChunkLister.h"
 #include "StorageFileChunkLister.h"
 #include "StorageUnwrittenChunkLister.h"
+#include "StorageListCursor.h"
+#include "StorageListFilter.h"
 #include "StorageShard.h"
 #include "StorageEnvironment.h"
+#include "StorageValueLog.h"
 
 #define MAX_RESULT_SIZE     (1024*KiB)
 
@@ -21,6 +24,8 @@ StorageAsyncListResult::StorageAsyncListResult(StorageAsyncList* asyncList_) :
 void StorageAsyncListResult::OnComplete()
 {
     asyncList->lastResult = this;
+    if (!final && asyncList->batchSize > 0)
+        asyncList->paused = true;
     Call(onComplete);
     asyncList->lastResult = NULL;
     if (final)
@@ -28,13 +33,36 @@ void StorageAsyncListResult::OnComplete()
         asyncList->env->DecreaseNumCursors();
         asyncList->Clear();
     }
+    else if (asyncList->IsAborted())
+    {
+        // let the merge finish, so the final result is completed
+        asyncList->Continue();
+    }
     delete this;
 }
 
-void StorageAsyncListResult::Append(StorageFileKeyValue* kv)
+bool StorageAsyncListResult::Append(StorageFileKeyValue* kv)
 {
+    StorageFileKeyValue resolved;
+    ReadBuffer          value;
+
+    if (kv->IsValueLogged())
+    {
+        // this runs in the list thread, so reading the value log does not block the main thread
+        if (asyncList->type != StorageAsyncList::KEYVALUE)
+            value.Reset();
+        else if (!asyncList->env->GetValueLog()->Resolve(kv, valueBuffer, value))
+        {
+            asyncList->readError = true;
+            return false;
+        }
+        resolved.Set(kv->GetKey(), value);
+        kv = &resolved;
+    }
+
     numKeys++;
     dataPage.Append(kv);
+    return true;
 }
 
 uint32_t StorageAsyncListResult::GetSize()
@@ -53,17 +81,27 @@ void StorageAsyncList::Init()
     ret = false;
     completed = false;
     aborted = false;
+    paused = false;
+    readError = false;
     forwardDirection = true;
     startWithLastKey = false;
+    keepCursor = false;
+    cursor = NULL;
+    batchSize = 0;
+    filter = NULL;
     num = 0;
     stage = START;
     threadPool = NULL;
     iterators = NULL;
     listers = NULL;
     numListers = 0;
+    chunkIDs = NULL;
+    resumed = NULL;
+    lastKeyValue = NULL;
     lastResult = NULL;
     env = NULL;
     requestID = 0;
+    valueLogPin = 0;
 }
 
 void StorageAsyncList::Clear()
@@ -77,6 +115,12 @@ void StorageAsyncList::Clear()
     delete[] iterators;
     iterators = NULL;
     numListers = 0;
+    delete[] chunkIDs;
+    delete[] resumed;
+    delete lastKeyValue;
+    delete cursor;
+    if (valueLogPin != 0)
+        env->GetValueLog()->Unpin(valueLogPin);
 
     Init();
 }
@@ -91,22 +135,51 @@ void StorageAsyncList::ExecuteAsyncList()
     StorageUnwrittenChunkLister*    unwrittenLister;
     StorageChunk::ChunkState        chunkState;
     bool                            keysOnly;
+    unsigned                        listerCount;
     
     Log_Debug("List[%U] StorageAsyncList START", requestID);
     keysOnly = (type == KEY || type == COUNT);
+    if (filter != NULL && filter->IsValueNeeded())
+        keysOnly = false;
 
     if (!forwardDirection && prefix.GetLength() > 0 && !startKey.BeginsWith(prefix) && count > 0)
         count++;
 
+    // it is not known in advance how many keys a lister has to return for 'count' matches
+    listerCount = (filter != NULL ? 0 : count);
+
     if (stage == START)
     {
-        numChunks = shard->GetChunks().GetLength() + 1;
+        // the values of the listed chunks are not deleted until the list is cleared
+        valueLogPin = env->GetValueLog()->Pin();
+
+        numChunks = shard->GetChunks().GetLength() + 2;
 
         listers = new StorageChunkLister*[numChunks];
         iterators = new StorageFileKeyValue*[numChunks];
+        chunkIDs = new uint64_t[numChunks];
+        resumed = new bool[numChunks];
         numListers = 0;
         preloadBufferSize = 0;  // preload only one page
 
+        if (cursor != NULL && !IsCursorValid())
+        {
+            Log_Debug("List[%U] StorageAsyncList chunks changed, dropping cursor", requestID);
+            delete cursor;
+            cursor = NULL;
+        }
+
+        if (cursor != NULL)
+        {
+            // the last key-value of the previous page is the least relevant,
+            // a newer version in the memo chunks overrides it
+            listers[numListers] = cursor->lastKeyValue;
+            chunkIDs[numListers] = 0;
+            resumed[numListers] = false;
+            cursor->lastKeyValue = NULL;
+            numListers++;
+        }
+
         FOREACH (itChunk, shard->GetChunks())
         {
             chunkState = (*itChunk)->GetChunkState();
@@ -114,27 +187,46 @@ void StorageAsyncList::ExecuteAsyncList()
             if (chunkState == StorageChunk::Serialized)
             {
                 memoLister = new StorageMemoChunkLister;
-                memoLister->Init((StorageMemoChunk*) *itChunk, startKey, endKey, prefix, count, 
+                memoLister->Init((StorageMemoChunk*) *itChunk, startKey, endKey, prefix, listerCount, 
                  keysOnly, forwardDirection);
                 listers[numListers] = memoLister;
+                chunkIDs[numListers] = 0;
+                resumed[numListers] = false;
                 numListers++;
             }
             else if (chunkState == StorageChunk::Unwritten)
             {
                 unwrittenLister = new StorageUnwrittenChunkLister;
-                unwrittenLister->Init(*((StorageFileChunk*) *itChunk), startKey, prefix, count, forwardDirection);
+                unwrittenLister->Init(*((StorageFileChunk*) *itChunk), startKey, prefix, listerCount, forwardDirection);
                 listers[numListers] = unwrittenLister;
+                chunkIDs[numListers] = 0;
+                resumed[numListers] = false;
                 numListers++;
             }
             else if (chunkState == StorageChunk::Written)
             {
-                fileLister = new StorageFileChunkLister;
-                fileLister->Init((StorageFileChunk*) *itChunk, startKey, endKey, prefix, count, 
-                 keysOnly, preloadBufferSize, forwardDirection);
+                fileLister = NULL;
+                if (cursor != NULL)
+                    fileLister = cursor->TakeLister((*itChunk)->GetChunkID(), iterators[numListers]);
+                resumed[numListers] = (fileLister != NULL);
+                if (fileLister != NULL)
+                {
+                    fileLister->SetRange(endKey, prefix);
+                }
+                else
+                {
+                    fileLister = new StorageFileChunkLister;
+                    fileLister->Init((StorageFileChunk*) *itChunk, startKey, endKey, prefix, listerCount, 
+                     keysOnly, preloadBufferSize, forwardDirection);
+                }
                 listers[numListers] = fileLister;
+                chunkIDs[numListers] = (*itChunk)->GetChunkID();
                 numListers++;
             }
         }
+
+        delete cursor;
+        cursor = NULL;
         
         stage = MEMO_CHUNK;
     }
@@ -143,7 +235,7 @@ void StorageAsyncList::ExecuteAsyncList()
 
     if (stage == MEMO_CHUNK)
     {
-        LoadMemoChunk(keysOnly);
+        LoadMemoChunk(keysOnly, listerCount);
         stage = FILE_CHUNK;
     }
     
@@ -155,15 +247,17 @@ void StorageAsyncList::ExecuteAsyncList()
     }
 }
 
-void StorageAsyncList::LoadMemoChunk(bool keysOnly)
+void StorageAsyncList::LoadMemoChunk(bool keysOnly, unsigned listerCount)
 {
     StorageMemoChunkLister* memoLister;
     
     memoLister = new StorageMemoChunkLister;
-    memoLister->Init(shard->GetMemoChunk(), startKey, endKey, prefix, count, keysOnly, forwardDirection);
+    memoLister->Init(shard->GetMemoChunk(), startKey, endKey, prefix, listerCount, keysOnly, forwardDirection);
 
     // memochunk is always on the last position, because it is the most current
     listers[numListers] = memoLister;
+    chunkIDs[numListers] = 0;
+    resumed[numListers] = false;
 
     numListers++;
 }
@@ -174,6 +268,10 @@ void StorageAsyncList::AsyncLoadChunks()
 
     for (i = 0; i < numListers; i++)
     {
+        // resumed listers continue where the previous page stopped
+        if (resumed[i])
+            continue;
+
         Log_Debug("List[%U] Setting iterator to firstKey %R", requestID, &startKey);
         iterators[i] = listers[i]->First(startKey);
 
@@ -181,6 +279,9 @@ void StorageAsyncList::AsyncLoadChunks()
             iterators[i] = NULL;
     }
     
+    if (!forwardDirection && prefix.GetLength() > 0 && !startKey.BeginsWith(prefix) && count > 0)
+        count--;
+
     stage = MERGE;
     AsyncMergeResult();
 }
@@ -188,15 +289,13 @@ void StorageAsyncList::AsyncLoadChunks()
 void StorageAsyncList::AsyncMergeResult()
 {
     StorageFileKeyValue*    it;
+    StorageFileKeyValue     filtered;
     StorageAsyncListResult* result;
 
     Log_Debug("List[%U] Starting AsyncMergeResult", requestID);
 
     result = new StorageAsyncListResult(this);
 
-    if (!forwardDirection && prefix.GetLength() > 0 && !startKey.BeginsWith(prefix) && count > 0)
-        count--;
-
     while(!IsDone())
     {
         // TODO: Yield
@@ -231,9 +330,28 @@ void StorageAsyncList::AsyncMergeResult()
             continue;
         }
 
-        result->Append(it);
+        if (filter != NULL)
+        {
+            it = Filter(it, filtered);
+            if (it == NULL)
+                continue;
+        }
+
+        if (!result->Append(it))
+            break;
         num++;
+
+        if (keepCursor && count != 0 && num >= count)
+            SaveLastKeyValue(it);
                 
+        if (batchSize > 0 && result->GetSize() >= batchSize)
+        {
+            // the merge is continued by Continue() from the main thread
+            Log_Debug("List[%U] Pausing AsyncMergeResult", requestID);
+            OnResult(result);
+            return;
+        }
+
         if (result->GetSize() > MAX_RESULT_SIZE)
         {
             OnResult(result);
@@ -287,7 +405,7 @@ bool StorageAsyncList::IsDone()
     if (env->IsShuttingDown())
         return true;
 
-    if (IsAborted())
+    if (IsAborted() || HasReadError())
         return true;
 
     return false;
@@ -298,11 +416,122 @@ bool StorageAsyncList::IsAborted()
     return aborted;
 }
 
+bool StorageAsyncList::HasReadError()
+{
+    return readError;
+}
+
 void StorageAsyncList::SetAborted(bool aborted_)
 {
     aborted = aborted_;
 }
 
+// this is called from the list thread, returns NULL if kv does not match the filter
+StorageFileKeyValue* StorageAsyncList::Filter(StorageFileKeyValue* kv, StorageFileKeyValue& filtered)
+{
+    ReadBuffer  value;
+
+    if (kv->IsValueLogged())
+    {
+        if (type == KEYVALUE || filter->IsValueNeeded())
+        {
+            if (!env->GetValueLog()->Resolve(kv, filterBuffer, value))
+            {
+                readError = true;
+                return NULL;
+            }
+        }
+    }
+    else
+        value = kv->GetValue();
+
+    if (!filter->Match(kv->GetKey(), value))
+        return NULL;
+
+    if (type != KEYVALUE)
+        value.Reset();
+    filtered.Set(kv->GetKey(), value);
+    return &filtered;
+}
+
+// this is called from main thread, after a partial result was completed
+void StorageAsyncList::Continue()
+{
+    if (!paused)
+        return;
+
+    paused = false;
+    threadPool->Execute(MFUNC(StorageAsyncList, AsyncMergeResult));
+}
+
+// the cursor is only valid if the written chunks of the shard did not change
+bool StorageAsyncList::IsCursorValid()
+{
+    StorageChunk**  itChunk;
+    unsigned        numWritten;
+
+    if (cursor->keysOnly != (type == KEY || type == COUNT))
+        return false;
+
+    numWritten = 0;
+    FOREACH (itChunk, shard->GetChunks())
+    {
+        if ((*itChunk)->GetChunkState() != StorageChunk::Written)
+            continue;
+        if (!cursor->HasChunk((*itChunk)->GetChunkID()))
+            return false;
+        numWritten++;
+    }
+
+    return (numWritten == cursor->numListers);
+}
+
+// this is called from the list thread, while the data page of kv is still loaded
+void StorageAsyncList::SaveLastKeyValue(StorageFileKeyValue* kv)
+{
+    lastKeyValue = new StorageMemoChunkLister;
+    lastKeyValue->GetDataPage()->Append(kv, type != KEYVALUE);
+    lastKeyValue->GetDataPage()->Finalize();
+}
+
+// this is called from main thread, when the final result is completed
+StorageListCursor* StorageAsyncList::DetachCursor()
+{
+    unsigned            i;
+    unsigned            n;
+    StorageListCursor*  detached;
+
+    if (lastKeyValue == NULL || listers == NULL)
+        return NULL;
+
+    detached = new StorageListCursor;
+    detached->keysOnly = (type == KEY || type == COUNT);
+    detached->prefix.Write(prefix);
+    detached->endKey.Write(endKey);
+    detached->lastKey.Write(lastKeyValue->GetDataPage()->First()->GetKey());
+    detached->chunkIDs = new uint64_t[numListers];
+    detached->listers = new StorageFileChunkLister*[numListers];
+    detached->iterators = new StorageFileKeyValue*[numListers];
+    
+    for (i = 0; i < numListers; i++)
+    {
+        if (chunkIDs[i] == 0)
+            continue;
+
+        n = detached->numListers++;
+        detached->chunkIDs[n] = chunkIDs[i];
+        detached->listers[n] = (StorageFileChunkLister*) listers[i];
+        detached->listers[n]->SetRange(detached->endKey, detached->prefix);
+        detached->iterators[n] = iterators[i];
+        listers[i] = NULL;
+    }
+
+    detached->lastKeyValue = lastKeyValue;
+    lastKeyValue = NULL;
+
+    return detached;
+}
+
 #define ADVANCE_ITERATOR(i) iterators[i] = listers[i]->Next(iterators[i])
 
 bool StorageAsyncList::IsKeyInShard(const ReadBuffer& key)
@@ -14,6 +14,9 @@ class StorageFileKeyValue;
 class StoragePage;
 class StorageAsyncList;
 class StorageEnvironment;
+class StorageListCursor;
+class StorageListFilter;
+class StorageMemoChunkLister;
 class ThreadPool;
 
 /*
@@ -32,11 +35,12 @@ public:
     unsigned            numKeys;
     bool                final;
     Callable            onComplete;
+    Buffer              valueBuffer;
 
     StorageAsyncListResult(StorageAsyncList* asyncList);
     
     void                OnComplete();
-    void                Append(StorageFileKeyValue* kv);
+    bool                Append(StorageFileKeyValue* kv);
     uint32_t            GetSize();
 };
 
@@ -45,6 +49,19 @@ public:
 
  StorageAsyncList
 
+ If keepCursor is set and a forward list stops at 'count', the positions of the listers
+ can be taken by DetachCursor(). Setting cursor before the list is started resumes them.
+
+ If batchSize is set, the merge pauses after each result of batchSize bytes, and the
+ owner calls Continue() when the client is ready for more, so results are streamed to
+ the client instead of piling up in the server's memory.
+
+ If filter is set, only the key-values it matches are returned and counted. The
+ listers are then not limited to 'count' keys, as they cannot tell which ones match.
+
+ If a value cannot be read from the value log, the merge stops with the final result
+ and HasReadError() is set, the owner must fail the list instead of returning it.
+
 ===============================================================================================
 */
 
@@ -73,10 +90,16 @@ public:
     Type                    type;
     bool                    forwardDirection;
     bool                    startWithLastKey;
+    bool                    keepCursor;
+    StorageListCursor*      cursor;
+    uint32_t                batchSize;
+    StorageListFilter*      filter;
     
     bool                    ret;
     bool                    completed;
     bool                    aborted;
+    bool                    paused;
+    bool                    readError;  // a value could not be read from the value log
     unsigned                num;
     Stage                   stage;
     Callable                onComplete;
@@ -87,26 +110,37 @@ public:
     StorageFileKeyValue**   iterators;
     StorageChunkLister**    listers;
     unsigned                numListers;
+    uint64_t*               chunkIDs;
+    bool*                   resumed;
+    StorageMemoChunkLister* lastKeyValue;
     StorageAsyncListResult* lastResult;
+    Buffer                  filterBuffer;
     StorageEnvironment*     env;
     uint64_t                requestID;
+    uint64_t                valueLogPin;
 
     StorageAsyncList();
     
     void                    Init();
     void                    Clear();
     void                    ExecuteAsyncList();
-    void                    LoadMemoChunk(bool keysOnly);
+    void                    LoadMemoChunk(bool keysOnly, unsigned listerCount);
     void                    AsyncLoadChunks();
     void                    AsyncMergeResult();
+    void                    Continue();
     void                    OnResult(StorageAsyncListResult* result);
     bool                    IsDone();
     bool                    IsAborted();
+    bool                    HasReadError();
     void                    SetAborted(bool aborted);
     bool                    IsKeyInShard(const ReadBuffer& key);
     int                     CompareSmallestKey(const ReadBuffer& key, const ReadBuffer& smallestKey);
     StorageFileKeyValue*    GetSmallest();
     StorageFileKeyValue*    Next();
+    StorageFileKeyValue*    Filter(StorageFileKeyValue* kv, StorageFileKeyValue& filtered);
+    bool                    IsCursorValid();
+    void                    SaveLastKeyValue(StorageFileKeyValue* kv);
+    StorageListCursor*      DetachCursor();
 };
 
 #endif
@@ -1,6 +1,7 @@
 #include "StorageBulkCursor.h"
 #include "StorageEnvironment.h"
 #include "StoragePageCache.h"
+#include "StorageValueLog.h"
 
 StorageBulkCursor::StorageBulkCursor()
  : dataPage(NULL, 0)
@@ -8,6 +9,7 @@ StorageBulkCursor::StorageBulkCursor()
     blockShard = false;
     shard = NULL;
     isLast = false;
+    readError = false;
     contextID = 0;
     shardID = 0;
     chunkID = 0;
@@ -15,16 +17,20 @@ StorageBulkCursor::StorageBulkCursor()
     logCommandID = 0;
     env = NULL;
     blockCounter = 0;
+    valueLogPin = 0;
 }
 
 StorageBulkCursor::~StorageBulkCursor()
 {
+    env->GetValueLog()->Unpin(valueLogPin);
     env->DecreaseNumCursors();
 }
 
 void StorageBulkCursor::SetEnvironment(StorageEnvironment* env_)
 {
     env = env_;
+    // the values of the chunks read by the cursor are not deleted while it is alive
+    valueLogPin = env->GetValueLog()->Pin();
 }
 
 void StorageBulkCursor::SetOnBlockShard(Callable onBlockShard_, Callable onUnblockShard_)
@@ -71,6 +77,9 @@ StorageKeyValue* StorageBulkCursor::Next(StorageKeyValue* it)
     StorageChunk*       chunk;
     StorageChunk**      itChunk;
 
+    if (readError)
+        return NULL;
+
     kv = dataPage.Next((StorageFileKeyValue*) it);
     
     if (kv != NULL)
@@ -152,6 +161,11 @@ StorageKeyValue* StorageBulkCursor::Next(StorageKeyValue* it)
     return kv;
 }
 
+bool StorageBulkCursor::HasReadError()
+{
+    return readError;
+}
+
 void StorageBulkCursor::SetLast(bool isLast_)
 {
     isLast = isLast_;
@@ -169,6 +183,21 @@ void StorageBulkCursor::SetNextKey(ReadBuffer key)
 
 void StorageBulkCursor::AppendKeyValue(StorageKeyValue* kv)
 {
+    StorageFileKeyValue resolved;
+    ReadBuffer          value;
+
+    if (kv->IsValueLogged())
+    {
+        if (!env->GetValueLog()->Resolve(kv, valueBuffer, value))
+        {
+            // skipping the key would lose it at the receiver of the cursor
+            readError = true;
+            return;
+        }
+        resolved.Set(kv->GetKey(), value);
+        kv = &resolved;
+    }
+
     dataPage.Append(kv);
 }
 
@@ -188,6 +217,17 @@ StorageKeyValue* StorageBulkCursor::FromNextBunch(StorageChunk* chunk)
             dataPage.Reset();
             chunk->NextBunch(*this, shard);
             //Log_Debug("NextBunch chunkID = %U", chunkID);
+            if (readError)
+            {
+                Log_Message("Unable to read value log values of chunk %U", chunkID);
+                if (blockShard && blockCounter > 0)
+                {
+                    ASSERT(blockCounter == 1);
+                    blockCounter--;
+                    Call(onUnblockShard);
+                }
+                return NULL;
+            }
             if (dataPage.First())
                 return dataPage.First();
             else    
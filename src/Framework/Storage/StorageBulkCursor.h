@@ -31,6 +31,9 @@ public:
     StorageKeyValue*        First();
     StorageKeyValue*        Next(StorageKeyValue* it);
 
+    // a value could not be read from the value log, the iteration stopped
+    bool                    HasReadError();
+
     void                    SetLast(bool last);
     ReadBuffer              GetNextKey();
     void                    SetNextKey(ReadBuffer key);
@@ -42,6 +45,7 @@ private:
 
     bool                    blockShard;
     bool                    isLast;
+    bool                    readError;
     uint64_t                contextID;
     uint64_t                shardID;
     uint64_t                chunkID;
@@ -53,7 +57,9 @@ private:
     StorageEnvironment*     env;
     Buffer                  nextKey;
     StorageDataPage         dataPage;
+    Buffer                  valueBuffer;
     int                     blockCounter;
+    uint64_t                valueLogPin;
 };
 
 #endif
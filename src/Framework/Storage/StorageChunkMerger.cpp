@@ -10,7 +10,8 @@
 bool StorageChunkMerger::Merge(
  StorageEnvironment* env_,
  List<Buffer*>& filenames, StorageFileChunk* mergeChunk_,  
- ReadBuffer firstKey, ReadBuffer lastKey)
+ ReadBuffer firstKey, ReadBuffer lastKey,
+ StorageValueLogGarbage* valueLogGarbage_, StorageValueLogGarbage* valueLogRelocated_)
 {
     unsigned    i;
     unsigned    numKeys;
@@ -21,6 +22,8 @@ bool StorageChunkMerger::Merge(
     env = env_;
     mergeChunk = mergeChunk_;
     mergeChunk->writeError = true;
+    valueLogGarbage = valueLogGarbage_;
+    valueLogRelocated = valueLogRelocated_;
 
     minLogSegmentID = 0;
     maxLogSegmentID = 0;
@@ -101,6 +104,8 @@ bool StorageChunkMerger::Merge(
     if (!WriteHeaderPage())
         return false;
 
+    // relocated values must be on disk before the TOC references them
+    env->GetValueLog()->Sync();
     StorageEnvironment::Sync(fd.GetFD());
 
     fd.Close();
@@ -266,6 +271,9 @@ bool StorageChunkMerger::WriteDataPages(ReadBuffer /*firstKey*/, ReadBuffer last
         it = Next(lastKey);
         if (it == NULL)
             break;
+
+        if (it->IsValueLogged() && env->GetValueLog()->IsDraining(it->GetValue()))
+            it = RelocateValue(it);
     
         YieldDiskReads();
         lastReadTime = EventLoop::Now();
@@ -410,7 +418,11 @@ StorageFileKeyValue* StorageChunkMerger::GetSmallest()
             // advance the previously smallest if it is equal to the current
             // because it is less relevant
             if (smallestKv != NULL && cmpres == 0)
+            {
+                if (smallestKv->IsValueLogged())
+                    shadowedPointers.Append(smallestKv->GetValue());
                 ADVANCE_ITERATOR(smallestIndex);
+            }
             smallestKv = iterators[i];
             smallestIndex = i;
             smallestKey = smallestKv->GetKey();
@@ -427,9 +439,11 @@ StorageFileKeyValue* StorageChunkMerger::GetSmallest()
 StorageFileKeyValue* StorageChunkMerger::Next(ReadBuffer& lastKey)
 {
     StorageFileKeyValue*    kv;
+    ReadBuffer              pointers;
 
     while (true)
     {
+        shadowedPointers.Clear();
         kv = GetSmallest();
         if (kv == NULL)
             return NULL;    // reached the end of all chunkfiles
@@ -438,6 +452,14 @@ StorageFileKeyValue* StorageChunkMerger::Next(ReadBuffer& lastKey)
         if (lastKey.GetLength() > 0 && ReadBuffer::Cmp(kv->GetKey(), lastKey) >= 0)
             return NULL;
 
+        // older versions of the key are dropped, and so are their values
+        pointers.Wrap(shadowedPointers);
+        while (pointers.GetLength() >= STORAGE_VALUELOG_POINTER_SIZE)
+        {
+            valueLogGarbage->Add(ReadBuffer(pointers.GetBuffer(), STORAGE_VALUELOG_POINTER_SIZE));
+            pointers.Advance(STORAGE_VALUELOG_POINTER_SIZE);
+        }
+
         if (kv->GetType() == STORAGE_KEYVALUE_TYPE_SET)
             return kv;
     }
@@ -445,6 +467,19 @@ StorageFileKeyValue* StorageChunkMerger::Next(ReadBuffer& lastKey)
     return NULL;
 }
 
+StorageFileKeyValue* StorageChunkMerger::RelocateValue(StorageFileKeyValue* kv)
+{
+    // the value is in a draining segment, copy it to the head of the value log
+    if (!env->GetValueLog()->Relocate(kv->GetValue(), relocatedValue, relocatedPointer))
+        return kv;
+
+    valueLogGarbage->Add(kv->GetValue());
+    valueLogRelocated->Add(ReadBuffer(relocatedPointer));
+
+    relocatedKv.SetValueLog(kv->GetKey(), ReadBuffer(relocatedPointer));
+    return &relocatedKv;
+}
+
 void StorageChunkMerger::YieldDiskReads()
 {
     uint64_t    waitTime;
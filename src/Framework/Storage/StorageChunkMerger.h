@@ -9,6 +9,7 @@
 #include "StorageDataPage.h"
 #include "StorageIndexPage.h"
 #include "StorageBloomPage.h"
+#include "StorageValueLog.h"
 
 class StorageEnvironment;   // forward
 class StorageChunk;         // forward
@@ -28,8 +29,12 @@ public:
                              StorageEnvironment* env,
                              List<Buffer*>& filenames,
                              StorageFileChunk* mergeChunk,
-                             ReadBuffer firstKey, ReadBuffer lastKey);
+                             ReadBuffer firstKey, ReadBuffer lastKey,
+                             StorageValueLogGarbage* valueLogGarbage,
+                             StorageValueLogGarbage* valueLogRelocated);
                              // filename1 is older than filename2
+                             // valueLogGarbage is unreferenced if the merged chunk is used,
+                             // valueLogRelocated is unreferenced if it is dropped
 
     void                    OnMergeFinished();
 
@@ -46,6 +51,7 @@ private:
     bool                    IsDone();
     StorageFileKeyValue*    GetSmallest();
     StorageFileKeyValue*    Next(ReadBuffer& lastKey);
+    StorageFileKeyValue*    RelocateValue(StorageFileKeyValue* kv);
     void                    YieldDiskReads();
 
     FDGuard                 fd;
@@ -62,6 +68,13 @@ private:
     unsigned                numReaders;
     StorageFileKeyValue**   iterators;
 
+    StorageValueLogGarbage* valueLogGarbage;
+    StorageValueLogGarbage* valueLogRelocated;
+    Buffer                  shadowedPointers;
+    Buffer                  relocatedPointer;
+    Buffer                  relocatedValue;
+    StorageFileKeyValue     relocatedKv;
+
     StorageEnvironment*     env;
     StorageFileChunk*       mergeChunk;
 
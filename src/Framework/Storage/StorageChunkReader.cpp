@@ -4,8 +4,19 @@
 #include "System/Time.h"
 #include "System/IO/IOProcessor.h"
 
+StorageChunkReader::StorageChunkReader()
+{
+    fdAcquired = false;
+    preloadThreshold = 0;
+    index = 0;
+    prevIndex = 0;
+}
+
 StorageChunkReader::~StorageChunkReader()
 {
+    if (fdAcquired)
+        fileChunk.ReleaseFD();
+
     if (preloadThreshold == 0)
     {
         if (prevIndex < fileChunk.numDataPages)
@@ -42,6 +53,8 @@ void StorageChunkReader::Open(
 
     fileChunk.useCache = false;
     fileChunk.SetFilename(filename);
+    if (!fdAcquired)
+        fdAcquired = fileChunk.AcquireFD();
     fileChunk.ReadHeaderPage();
     fileChunk.LoadIndexPage();
 
@@ -51,6 +64,14 @@ void StorageChunkReader::Open(
     offset = 0;
 }
 
+bool StorageChunkReader::AcquireFD(ReadBuffer filename)
+{
+    fileChunk.SetFilename(filename);
+    if (!fdAcquired)
+        fdAcquired = fileChunk.AcquireFD();
+    return fdAcquired;
+}
+
 void StorageChunkReader::OpenWithFileChunk(
  StorageFileChunk* fileChunk_, ReadBuffer& firstKey_, uint64_t preloadThreshold_,
  bool keysOnly_, bool forwardDirection_)
@@ -75,6 +96,8 @@ void StorageChunkReader::OpenWithFileChunk(
     // it is safe to shallow copy headerPage
     fileChunk.headerPage = fileChunk_->headerPage;
     fileChunk.SetNumDataPages(numDataPages);
+    if (!fdAcquired)
+        fdAcquired = fileChunk.AcquireFD();
 
     index = 0;
     offset = 0;
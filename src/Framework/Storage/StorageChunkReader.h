@@ -7,6 +7,7 @@
 class StorageChunkReader
 {
 public:
+    StorageChunkReader();
     ~StorageChunkReader();
 
     void                    Open(ReadBuffer filename, uint64_t preloadThreshold,
@@ -15,6 +16,9 @@ public:
     void                    OpenWithFileChunk(StorageFileChunk* fileChunk, ReadBuffer& firstKey, 
                              uint64_t preloadThreshold, bool keysOnly = false, bool forwardDirection = true);
 
+    // opens the file ahead of Open(), e.g. in the main thread before the chunk can be deleted
+    bool                    AcquireFD(ReadBuffer filename);
+
     void                    SetEndKey(ReadBuffer endKey);
     void                    SetPrefix(ReadBuffer prefix);
     void                    SetCount(unsigned count);
@@ -37,6 +41,7 @@ private:
     bool                    keysOnly;
     bool                    forwardDirection;
     bool                    isLocated;
+    bool                    fdAcquired;
     uint64_t                offset;
     uint32_t                index;
     uint32_t                prevIndex;
@@ -2,6 +2,7 @@
 #include "StorageEnvironment.h"
 #include "StorageMemoChunk.h"
 #include "StorageFileChunk.h"
+#include "StorageValueLog.h"
 #include "System/PointerGuard.h"
 
 bool StorageChunkSerializer::Serialize(StorageEnvironment* env_, StorageMemoChunk* memoChunk_)
@@ -79,6 +80,9 @@ bool StorageChunkSerializer::WriteHeaderPage()
 bool StorageChunkSerializer::WriteDataPages()
 {
     StorageMemoKeyValue*    it;
+    StorageKeyValue*        kv;
+    StorageFileKeyValue     pointerKv;
+    Buffer                  pointer;
     StorageDataPage*        dataPage;
     unsigned                dataPageIndex;
 
@@ -92,16 +96,28 @@ bool StorageChunkSerializer::WriteDataPages()
         if (memoChunk->UseBloomFilter())
             fileChunk->bloomPage->Add(it->GetKey());
 
+        kv = it;
+        if (memoChunk->valueLogThreshold > 0 && it->GetType() == STORAGE_KEYVALUE_TYPE_SET &&
+         it->GetValue().GetLength() > memoChunk->valueLogThreshold)
+        {
+            // on failure the value is stored inline
+            if (env->GetValueLog()->Append(it->GetValue(), pointer))
+            {
+                pointerKv.SetValueLog(it->GetKey(), ReadBuffer(pointer));
+                kv = &pointerKv;
+            }
+        }
+
         if (dataPage->GetNumKeys() == 0)
         {
-            dataPage->Append(it);
+            dataPage->Append(kv);
             fileChunk->indexPage->Append(it->GetKey(), dataPageIndex, offset);
         }
         else
         {
-            if (dataPage->GetLength() + dataPage->GetIncrement(it) <= STORAGE_DEFAULT_DATA_PAGE_SIZE)
+            if (dataPage->GetLength() + dataPage->GetIncrement(kv) <= STORAGE_DEFAULT_DATA_PAGE_SIZE)
             {
-                dataPage->Append(it);
+                dataPage->Append(kv);
             }
             else
             {
@@ -111,7 +127,7 @@ bool StorageChunkSerializer::WriteDataPages()
                 dataPageIndex++;
                 dataPage = new StorageDataPage(fileChunk, dataPageIndex);
                 dataPage->SetOffset(offset);
-                dataPage->Append(it);
+                dataPage->Append(kv);
                 fileChunk->indexPage->Append(it->GetKey(), dataPageIndex, offset);
             }
         }
@@ -1,6 +1,7 @@
 #include "StorageChunkWriter.h"
 #include "StorageEnvironment.h"
 #include "StorageChunk.h"
+#include "StorageValueLog.h"
 #include "System/FileSystem.h"
 #include "System/Events/EventLoop.h"
 
@@ -29,6 +30,8 @@ bool StorageChunkWriter::Write(StorageEnvironment* env_, StorageFileChunk* file_
             return false;
     }
 
+    // the TOC must not reference values that are not on disk
+    env->GetValueLog()->Sync();
     StorageEnvironment::Sync(fd.GetFD());
 
     fd.Close();
@@ -67,6 +67,11 @@ void StorageConfig::SetMaxChunkPerShard(unsigned maxChunkPerShard_)
     maxChunkPerShard = maxChunkPerShard_;
 }
 
+void StorageConfig::SetMaxOpenChunkFiles(unsigned maxOpenChunkFiles_)
+{
+    maxOpenChunkFiles = maxOpenChunkFiles_;
+}
+
 uint64_t StorageConfig::GetChunkSize()
 {
     return chunkSize;
@@ -131,3 +136,8 @@ unsigned StorageConfig::GetMaxChunkPerShard()
 {
     return maxChunkPerShard;
 }
+
+unsigned StorageConfig::GetMaxOpenChunkFiles()
+{
+    return maxOpenChunkFiles;
+}
@@ -27,6 +27,7 @@ public:
     void		SetAbortWaitingListsNum(uint64_t abortWaitingListsNum);
     void        SetListDataPageCacheSize(uint64_t listDataPageCacheSize);
     void        SetMaxChunkPerShard(unsigned maxChunkPerShard);
+    void        SetMaxOpenChunkFiles(unsigned maxOpenChunkFiles);
 
     uint64_t    GetChunkSize();
     uint64_t    GetLogSegmentSize();
@@ -41,6 +42,7 @@ public:
     uint64_t	GetAbortWaitingListsNum();
     uint64_t    GetListDataPageCacheSize();
     unsigned    GetMaxChunkPerShard();
+    unsigned    GetMaxOpenChunkFiles();
 
 private:
     uint64_t    chunkSize;
@@ -56,6 +58,7 @@ private:
     uint64_t	abortWaitingListsNum;
     uint64_t    listDataPageCacheSize;
     unsigned    maxChunkPerShard;
+    unsigned    maxOpenChunkFiles;
 };
 
 #endif
@@ -119,7 +119,10 @@ void StorageDataPage::Append(StorageKeyValue* kv, bool keysOnly)
 
     ASSERT(kv->GetKey().GetLength() > 0);
 
-    keysBuffer.Append(kv->GetType());                               // 1 byte(s)
+    if (kv->IsValueLogged() && keysOnly == false)
+        keysBuffer.Append(STORAGE_KEYVALUE_TYPE_VALUELOG);          // 1 byte(s)
+    else
+        keysBuffer.Append(kv->GetType());                           // 1 byte(s)
     keysBuffer.AppendLittle16(kv->GetKey().GetLength());            // 2 byte(s)
     keysBuffer.Append(kv->GetKey());
     if (kv->GetType() == STORAGE_KEYVALUE_TYPE_SET && keysOnly == false)
@@ -132,6 +135,8 @@ void StorageDataPage::Append(StorageKeyValue* kv, bool keysOnly)
     {
         if (keysOnly)
             fkv.Set(ReadBuffer(kv->GetKey()), ReadBuffer());
+        else if (kv->IsValueLogged())
+            fkv.SetValueLog(ReadBuffer(kv->GetKey()), ReadBuffer(kv->GetValue()));
         else
             fkv.Set(ReadBuffer(kv->GetKey()), ReadBuffer(kv->GetValue()));
     }
@@ -202,7 +207,10 @@ void StorageDataPage::Finalize()
             vpos = buffer.GetBuffer() + vit;
             vit += vlen;
             
-            it->Set(ReadBuffer(kpos, klen), ReadBuffer(vpos, vlen));
+            if (it->IsValueLogged())
+                it->SetValueLog(ReadBuffer(kpos, klen), ReadBuffer(vpos, vlen));
+            else
+                it->Set(ReadBuffer(kpos, klen), ReadBuffer(vpos, vlen));
         }
         else
         {
@@ -399,7 +407,8 @@ bool StorageDataPage::Read(Buffer& buffer_, bool keysOnly)
         // type
         if (!kparse.ReadChar(type))
             goto Fail;
-        if (type != STORAGE_KEYVALUE_TYPE_SET && type != STORAGE_KEYVALUE_TYPE_DELETE)
+        if (type != STORAGE_KEYVALUE_TYPE_SET && type != STORAGE_KEYVALUE_TYPE_DELETE &&
+         type != STORAGE_KEYVALUE_TYPE_VALUELOG)
             goto Fail;
         kparse.Advance(1);
 
@@ -415,7 +424,7 @@ bool StorageDataPage::Read(Buffer& buffer_, bool keysOnly)
         key.Wrap(kparse.GetBuffer(), klen);
         kparse.Advance(klen);
 
-        if (type == STORAGE_KEYVALUE_TYPE_SET)
+        if (type == STORAGE_KEYVALUE_TYPE_SET || type == STORAGE_KEYVALUE_TYPE_VALUELOG)
         {
             if (!keysOnly)
             {
@@ -433,7 +442,10 @@ bool StorageDataPage::Read(Buffer& buffer_, bool keysOnly)
             else
                 value.Reset();
 
-            fkv.Set(key, value);
+            if (type == STORAGE_KEYVALUE_TYPE_VALUELOG && !keysOnly)
+                fkv.SetValueLog(key, value);
+            else
+                fkv.Set(key, value);
             AppendKeyValue(fkv);
         }
         else
@@ -3,10 +3,12 @@
 #include "System/FileSystem.h"
 #include "StorageFileChunk.h"
 #include "StorageFileDeleter.h"
+#include "StorageValueLog.h"
 
-StorageDeleteFileChunkJob::StorageDeleteFileChunkJob(StorageFileChunk* chunk_)
+StorageDeleteFileChunkJob::StorageDeleteFileChunkJob(StorageFileChunk* chunk_, StorageValueLog* valueLog_)
 {
     chunk = chunk_;
+    valueLog = valueLog_;
 }
 
 StorageDeleteFileChunkJob::~StorageDeleteFileChunkJob()
@@ -17,12 +19,19 @@ StorageDeleteFileChunkJob::~StorageDeleteFileChunkJob()
 
 void StorageDeleteFileChunkJob::Execute()
 {
-    Stopwatch   sw;
-    Buffer      filename;
+    Stopwatch               sw;
+    Buffer                  filename;
+    StorageValueLogGarbage  garbage;
     
     Log_Message("Deleting file chunk %U from disk", chunk->GetChunkID());
     sw.Start();
     
+    if (valueLog != NULL && valueLog->IsEnabled())
+    {
+        garbage.Add(chunk);
+        garbage.Commit(valueLog);
+    }
+
     filename.Write(chunk->GetFilename());
     delete chunk;
     chunk = NULL;
@@ -4,6 +4,7 @@
 #include "System/Threading/Job.h"
 
 class StorageFileChunk;
+class StorageValueLog;
 
 /*
 ===============================================================================================
@@ -16,13 +17,14 @@ class StorageFileChunk;
 class StorageDeleteFileChunkJob : public Job
 {
 public:
-    StorageDeleteFileChunkJob(StorageFileChunk* chunk);
+    StorageDeleteFileChunkJob(StorageFileChunk* chunk, StorageValueLog* valueLog = NULL);
     ~StorageDeleteFileChunkJob();
 
     void                Execute();
     void                OnComplete();
 
     StorageFileChunk*   chunk;
+    StorageValueLog*    valueLog;   // set for the chunk of a deleted shard, its values are garbage
 };
 
 #endif
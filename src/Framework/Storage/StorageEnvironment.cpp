@@ -9,6 +9,7 @@
 #include "StorageRecovery.h"
 #include "StoragePageCache.h"
 #include "StorageListPageCache.h"
+#include "StorageFDCache.h"
 #include "StorageAsyncGet.h"
 #include "StorageAsyncList.h"
 #include "StorageSerializeChunkJob.h"
@@ -18,6 +19,8 @@
 #include "StorageDeleteFileChunkJob.h"
 #include "StorageArchiveLogSegmentJob.h"
 #include "StorageFileDeleter.h"
+#include "StorageLogArchiver.h"
+#include "StorageValueLog.h"
 
 
 #define SERIALIZECHUNKJOB   ((StorageSerializeChunkJob*)(serializeChunkJobs.GetActiveJob()))
@@ -78,6 +81,7 @@ StorageEnvironment::StorageEnvironment()
     
     nextChunkID = 1;
     shuttingDown = false;
+    lastCommitTime = 0;
     writingTOC = false;
     numCursors = 0;
     mergeEnabledCounter = 0; // disabled
@@ -96,7 +100,6 @@ bool StorageEnvironment::Open(Buffer& envPath_, StorageConfig config_)
 
     config = config_;
 
-    StorageFileDeleter::Init();
     commitJobs.Start();
     serializeChunkJobs.Start();
     writeChunkJobs.Start();
@@ -107,7 +110,8 @@ bool StorageEnvironment::Open(Buffer& envPath_, StorageConfig config_)
     asyncListThread = ThreadPool::Create(configFile.GetIntValue("database.numAsyncThreads", 10));
     asyncListThread->Start();
 
-    asyncGetThread = ThreadPool::Create(1);
+    asyncGetThread = ThreadPool::Create(configFile.GetIntValue("database.numAsyncGetThreads",
+     STORAGE_DEFAULT_NUM_ASYNC_GET_THREADS));
     asyncGetThread->Start();
 
     envPath.Write(envPath_);
@@ -169,9 +173,15 @@ bool StorageEnvironment::Open(Buffer& envPath_, StorageConfig config_)
             STOP_FAIL(1);
         }
     }
+
+    StorageFileDeleter::Init(envPath);
+    StorageLogArchiver::Init(archivePath);
     
     StoragePageCache::Init(config);
     StorageListPageCache::SetMaxCacheSize(config.GetListDataPageCacheSize());
+    StorageFDCache::Init(config.GetMaxOpenChunkFiles());
+    valueLog.Init(envPath);
+    manifest.Open(this);
     
     if (!recovery.TryRecovery(this))
     {
@@ -197,6 +207,7 @@ void StorageEnvironment::Close()
     StorageFileChunk*   fileChunk;
     
     shuttingDown = true;
+    EventLoop::Remove(&backgroundTimer);
 
     StorageFileDeleter::Shutdown();
     commitJobs.Stop();
@@ -216,6 +227,11 @@ void StorageEnvironment::Close()
     FOREACH (fileChunk, fileChunks)
         fileChunk->RemovePagesFromCache();
     fileChunks.DeleteList();
+    StorageFDCache::Shutdown();
+
+    manifest.Close();
+    valueLog.Shutdown();
+    StorageLogArchiver::Shutdown();
 }
 
 void StorageEnvironment::Sync(FD fd)
@@ -324,13 +340,15 @@ void StorageEnvironment::GetShardIDs(uint64_t contextID, uint64_t tableID, Buffe
     }
 }
 
-bool StorageEnvironment::Get(uint16_t contextID, uint64_t shardID, ReadBuffer key, ReadBuffer& value)
+bool StorageEnvironment::Get(uint16_t contextID, uint64_t shardID, ReadBuffer key, ReadBuffer& value,
+ Buffer& valueBuffer, bool& failed)
 {
     StorageShard*       shard;
     StorageChunk*       chunk;
     StorageChunk**      itChunk;
     StorageKeyValue*    kv;
 
+    failed = false;
     shard = GetShard(contextID, shardID);
     if (shard == NULL)
         return false;
@@ -366,7 +384,12 @@ bool StorageEnvironment::Get(uint16_t contextID, uint64_t shardID, ReadBuffer ke
             }
             else if (kv->GetType() == STORAGE_KEYVALUE_TYPE_SET)
             {
-                value = kv->GetValue();
+                // the key exists, a value that cannot be read is an error, not a missing key
+                if (!valueLog.Resolve(kv, valueBuffer, value))
+                {
+                    failed = true;
+                    return false;
+                }
                 return true;
             }
             else
@@ -386,6 +409,7 @@ bool StorageEnvironment::TryNonblockingGet(uint16_t contextID, uint64_t shardID,
 
     asyncGet->completed = true;
     asyncGet->ret = false;
+    asyncGet->failed = false;
     shard = GetShard(contextID, shardID);
     if (shard == NULL)
         return true;
@@ -425,6 +449,7 @@ void StorageEnvironment::AsyncGet(uint16_t contextID, uint64_t shardID, StorageA
 
     asyncGet->completed = true;
     asyncGet->ret = false;
+    asyncGet->failed = false;
         
     shard = GetShard(contextID, shardID);
     if (shard == NULL)
@@ -464,6 +489,8 @@ void StorageEnvironment::AsyncGet(uint16_t contextID, uint64_t shardID, StorageA
     asyncGet->lastLoadedPage = NULL;
     asyncGet->stage = StorageAsyncGet::START;
     asyncGet->threadPool = asyncGetThread;
+    // the pointer read from a chunk page stays valid until the get completes
+    asyncGet->valueLogPin = valueLog.Pin();
     asyncGet->ExecuteAsyncGet();
 }
 
@@ -648,6 +675,7 @@ bool StorageEnvironment::Commit(uint64_t trackID, Callable& onCommit)
 
 bool StorageEnvironment::Commit(uint64_t trackID)
 {
+    uint64_t            start;
     Job*                job;
     StorageLogSegment*  logSegment;
 
@@ -659,7 +687,9 @@ bool StorageEnvironment::Commit(uint64_t trackID)
     FOREACH(job, commitJobs)
         ASSERT(((StorageCommitJob*)job)->logSegment->GetTrackID() != trackID);
 
+    start = NowClock();
     logSegment->Commit();
+    lastCommitTime = NowClock() - start;
     OnCommit(NULL);
 
     return true;
@@ -678,6 +708,11 @@ bool StorageEnvironment::IsCommitting(uint64_t trackID)
     return false;
 }
 
+uint64_t StorageEnvironment::GetLastCommitTime()
+{
+    return lastCommitTime;
+}
+
 bool StorageEnvironment::PushMemoChunk(uint16_t contextID, uint64_t shardID)
 {
     StorageShard*       shard;
@@ -691,6 +726,7 @@ bool StorageEnvironment::PushMemoChunk(uint16_t contextID, uint64_t shardID)
         return false; // never serialize log storage shards if we don't want file chunks
     
     memoChunk = shard->GetMemoChunk();            
+    memoChunk->SetValueLogThreshold(valueLog.GetThreshold(shard));
     shard->PushMemoChunk(new StorageMemoChunk(nextChunkID++, shard->UseBloomFilter()));
 
     serializeChunkJobs.Execute(new StorageSerializeChunkJob(this, memoChunk));
@@ -846,6 +882,18 @@ printable.Write(a); if (!printable.IsAsciiPrintable()) { printable.ToHexadecimal
     buffer.Appendf("Free disk space:  %s\n", HumanBytes(FS_FreeDiskSpace(tmp.GetBuffer()), humanBuf));
     buffer.Appendf("Total chunk file disk usage: %s\n", HumanBytes(GetChunkFileDiskUsage(), humanBuf));
     buffer.Appendf("Total log file disk usage: %s\n", HumanBytes(GetLogSegmentDiskUsage(), humanBuf));
+    buffer.Appendf("Open chunk files: %u (max: %u)\n", StorageFDCache::GetNumOpen(), StorageFDCache::GetMaxOpen());
+    buffer.Appendf("Manifest size: %s", HumanBytes(manifest.GetSize(), humanBuf));
+    buffer.Appendf(" (compactions: %U)\n", manifest.GetNumCompactions());
+    buffer.Appendf("Archived log segments: %u", StorageLogArchiver::GetNumFiles());
+    buffer.Appendf(" (size: %s, pending: %U)\n", HumanBytes(StorageLogArchiver::GetSize(), humanBuf),
+     *Registry::GetUintPtr("storage.archive.numPendingSegments"));
+    if (valueLog.IsEnabled())
+    {
+        buffer.Appendf("Total value log disk usage: %s", HumanBytes(valueLog.GetDiskUsage(), humanBuf));
+        buffer.Appendf(" (garbage: %s, ", HumanBytes(valueLog.GetGarbageSize(), humanBuf));
+        buffer.Appendf("segments: %u)\n", valueLog.GetNumSegments());
+    }
     buffer.Appendf("Total database disk usage: %s\n", HumanBytes(GetChunkFileDiskUsage() + GetLogSegmentDiskUsage(), humanBuf));
 }
 
@@ -956,6 +1004,11 @@ unsigned StorageEnvironment::GetNumFinishedMergeJobs()
     return numFinishedMergeJobs;
 }
 
+StorageValueLog* StorageEnvironment::GetValueLog()
+{
+    return &valueLog;
+}
+
 StorageConfig& StorageEnvironment::GetConfig()
 {
     return config;
@@ -1037,6 +1090,7 @@ void StorageEnvironment::DeleteShard(uint16_t contextID, uint64_t shardID, bool
     StorageChunk**          itChunk;
     StorageMemoChunk*       memoChunk;
     StorageFileChunk*       fileChunk;
+    bool                    valueLogGarbage;
 
     // TODO: check for uncommited stuff
 
@@ -1044,6 +1098,8 @@ void StorageEnvironment::DeleteShard(uint16_t contextID, uint64_t shardID, bool
     if (shard == NULL)
         return;        // does not exists
 
+    valueLogGarbage = (shard->GetStorageType() == STORAGE_SHARD_TYPE_STANDARD);
+
     Log_Message("Deleting shard %u/%U", contextID, shardID);
 
     if (shard->GetMemoChunk() != NULL)
@@ -1078,7 +1134,8 @@ void StorageEnvironment::DeleteShard(uint16_t contextID, uint64_t shardID, bool
             else
             {
                 fileChunk->RemovePagesFromCache();
-                deleteChunkJobs.Enqueue(new StorageDeleteFileChunkJob(fileChunk)); // Enqueue() instead of Execute() because WriteTOC() is required before
+                // the values of the shard in the value log are no longer referenced
+                deleteChunkJobs.Enqueue(new StorageDeleteFileChunkJob(fileChunk, valueLogGarbage ? &valueLog : NULL)); // Enqueue() instead of Execute() because WriteTOC() is required before
             }
         }
     }
@@ -1086,6 +1143,7 @@ void StorageEnvironment::DeleteShard(uint16_t contextID, uint64_t shardID, bool
     if (mergeChunkJobs.IsActive() && MERGECHUNKJOB->contextID == contextID && MERGECHUNKJOB->shardID == shardID)
         MERGECHUNKJOB->mergeChunk->deleted = true;
 
+    manifest.OnDeleteShard(shard);
     shards.Remove(shard);
     delete shard;
     
@@ -1194,6 +1252,7 @@ void StorageEnvironment::OnCommit(StorageCommitJob* job)
 {
     if (job)
     {
+        lastCommitTime = NowClock() - job->startTime;
         Log_Debug("Commiting done in track %U, elapsed: %U msec", 
           job->logSegment->GetTrackID(),
           NowClock() - job->startTime);
@@ -1292,6 +1351,7 @@ Candidate:
     memoChunk = candidateShard->GetMemoChunk();
     Log_Debug("Serializing chunk %U, size: %s", memoChunk->GetChunkID(),
         HumanBytes(memoChunk->GetSize(), humanBuf));
+    memoChunk->SetValueLogThreshold(valueLog.GetThreshold(candidateShard));
     candidateShard->PushMemoChunk(new StorageMemoChunk(nextChunkID++, candidateShard->UseBloomFilter()));
     serializeChunkJobs.Execute(new StorageSerializeChunkJob(this, memoChunk));
 }
@@ -1380,7 +1440,9 @@ void StorageEnvironment::TryMergeChunks()
 void StorageEnvironment::TryArchiveLogSegments()
 {
     bool                archive;
+    uint64_t            numPending;
     StorageLogSegment*  logSegment;
+    StorageLogSegment*  candidate;
     StorageShard*       shard;
     Track*              track;
 
@@ -1389,9 +1451,8 @@ void StorageEnvironment::TryArchiveLogSegments()
     if (!StorageFileDeleter::IsEnabled())
         return;
 
-    if (archiveLogJobs.IsActive())
-        return;
-
+    candidate = NULL;
+    numPending = 0;
     FOREACH(track, logManager.tracks)
     {
         logSegment = logManager.GetTail(track->trackID);
@@ -1400,32 +1461,44 @@ void StorageEnvironment::TryArchiveLogSegments()
 
         if (track->deleted)
         {
-            if (logSegment->IsOpen())
-                logSegment->Close();
-
-            archiveLogJobs.Execute(new StorageArchiveLogSegmentJob(this, logSegment, archiveScript));
-            return;
-        }
-
-        if (track->logSegments.GetLength() <= 1)
+            numPending += track->logSegments.GetLength();
+            if (!candidate)
+            {
+                if (logSegment->IsOpen())
+                    logSegment->Close();
+                candidate = logSegment;
+            }
             continue;
+        }
 
-        archive = true;
-        FOREACH (shard, shards)
+        // segments are archived oldest first, count the finished ones not backing any shard
+        for (; logSegment != track->logSegments.Last(); logSegment = track->logSegments.Next(logSegment))
         {
-            if (shard->IsBackingLogSegment(logSegment->GetTrackID(), logSegment->GetLogSegmentID()))
+            archive = true;
+            FOREACH (shard, shards)
             {
-                archive = false;
-                break;
+                if (shard->IsBackingLogSegment(logSegment->GetTrackID(), logSegment->GetLogSegmentID()))
+                {
+                    archive = false;
+                    break;
+                }
             }
-        }
+            if (!archive)
+                break;
 
-        if (archive)
-        {
-            archiveLogJobs.Execute(new StorageArchiveLogSegmentJob(this, logSegment, archiveScript));
-            return;
+            numPending++;
+            if (!candidate)
+                candidate = logSegment;
         }
     }
+
+    // archive lag: number of finished log segments waiting to be archived
+    *Registry::GetUintPtr("storage.archive.numPendingSegments") = numPending;
+
+    if (!candidate || archiveLogJobs.IsActive())
+        return;
+
+    archiveLogJobs.Execute(new StorageArchiveLogSegmentJob(this, candidate, archiveScript));
 }
 
 void StorageEnvironment::TryDeleteFileChunks()
@@ -1570,8 +1643,10 @@ void StorageEnvironment::MergeChunk(StorageShard* shard)
 
 void StorageEnvironment::OnChunkSerialize(StorageSerializeChunkJob* job)
 {
-    Buffer              tmp;
-    StorageFileChunk*   fileChunk;
+    Buffer                  tmp;
+    StorageFileChunk*       fileChunk;
+    StorageValueLogGarbage  valueLogGarbage;
+    uint32_t                i;
 
     if (!job->memoChunk->deleted)
     {
@@ -1580,6 +1655,22 @@ void StorageEnvironment::OnChunkSerialize(StorageSerializeChunkJob* job)
         OnChunkSerialized(job->memoChunk, fileChunk);
         fileChunks.Append(fileChunk);
     }
+    else
+    {
+        // the serializer appended the values of the deleted shard to the value log,
+        // the chunk was never written, its pages are in memory
+        fileChunk = job->memoChunk->RemoveFileChunk();
+        if (fileChunk != NULL)
+        {
+            for (i = 0; i < fileChunk->numDataPages; i++)
+            {
+                if (fileChunk->dataPages[i] != NULL)
+                    valueLogGarbage.Add(fileChunk->dataPages[i]);
+            }
+            valueLogGarbage.Commit(&valueLog);
+            delete fileChunk;
+        }
+    }
 
     deleteChunkJobs.Execute(new StorageDeleteMemoChunkJob(job->memoChunk));
     
@@ -1599,7 +1690,7 @@ void StorageEnvironment::OnChunkWrite(StorageWriteChunkJob* job)
         job->writeChunk->AddPagesToCache();
     }
     else
-        deleteChunkJobs.Execute(new StorageDeleteFileChunkJob(job->writeChunk));
+        deleteChunkJobs.Execute(new StorageDeleteFileChunkJob(job->writeChunk, &valueLog));
 
     WriteTOC();
     TryArchiveLogSegments();
@@ -1629,6 +1720,14 @@ void StorageEnvironment::OnChunkMerge(StorageMergeChunkJob* job)
         if (!job->mergeChunk->IsEmpty())
             shard->GetChunks().Add(job->mergeChunk);
         WriteTOC(); // TODO: async
+
+        // the input chunks are no longer in the TOC
+        job->valueLogGarbage.Commit(&valueLog);
+    }
+    else
+    {
+        // values copied by the merge are not referenced
+        job->valueLogRelocated.Commit(&valueLog);
     }
     
     // enqueue the input chunks for deleting
@@ -1646,7 +1745,9 @@ void StorageEnvironment::OnChunkMerge(StorageMergeChunkJob* job)
         if (!inputChunk->deleted)
             fileChunks.Remove(inputChunk);
 
-        deleteChunkJobs.Execute(new StorageDeleteFileChunkJob(inputChunk));
+        // the input chunks of a deleted shard hold all of its values, the merged chunk
+        // holds the same pointers, or the relocated ones committed above
+        deleteChunkJobs.Execute(new StorageDeleteFileChunkJob(inputChunk, inputChunk->deleted ? &valueLog : NULL));
     }
 
     if (shard != NULL && job->mergeChunk->written && !job->mergeChunk->IsEmpty())
@@ -1686,6 +1787,7 @@ void StorageEnvironment::OnBackgroundTimer()
     TryMergeChunks();
     TryArchiveLogSegments();
     TryDeleteFileChunks();
+    valueLog.Collect();
     
     EventLoop::Add(&backgroundTimer);
     Log_Trace("End");
@@ -1693,7 +1795,6 @@ void StorageEnvironment::OnBackgroundTimer()
 
 void StorageEnvironment::WriteTOC()
 {
-    StorageEnvironmentWriter    writer;
     char                        humanBuf[5];
     Stopwatch                   sw;
 
@@ -1701,8 +1802,10 @@ void StorageEnvironment::WriteTOC()
 
     sw.Start();
 
+    // only the changes are appended to the manifest,
+    // the TOC itself is rewritten when the manifest is compacted
     writingTOC = true;
-    if (!writer.Write(this))
+    if (!manifest.Write())
     {
         envPath.NullTerminate();
         Log_Message("Unable to write table of contents file to disk.");
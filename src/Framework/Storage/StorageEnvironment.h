@@ -18,6 +18,8 @@
 #include "StorageBulkCursor.h"
 #include "StorageAsyncBulkCursor.h"
 #include "StorageLogManager.h"
+#include "StorageManifest.h"
+#include "StorageValueLog.h"
 
 class StorageRecovery;
 class StorageEnvironmentWriter;
@@ -40,6 +42,7 @@ class StorageArchiveLogSegmentJob;
 #endif
 
 #define STORAGE_DEFAULT_MERGE_CPU_THRESHOLD         (50)
+#define STORAGE_DEFAULT_NUM_ASYNC_GET_THREADS       8
 
 struct ShardSize;
 
@@ -55,6 +58,7 @@ class StorageEnvironment
 {
     friend class StorageRecovery;
     friend class StorageEnvironmentWriter;
+    friend class StorageManifest;
     friend class StorageChunkSerializer;
     friend class StorageChunkWriter;
     friend class StorageChunkMerger;
@@ -97,7 +101,10 @@ public:
 
     bool                    DeleteTrack(uint64_t trackID);
                              
-    bool                    Get(uint16_t contextID, uint64_t shardID, ReadBuffer key, ReadBuffer& value);
+    // a value read from the value log is copied to the caller's valueBuffer, and value points into it,
+    // failed is set when the value could not be read from the value log
+    bool                    Get(uint16_t contextID, uint64_t shardID, ReadBuffer key, ReadBuffer& value,
+                             Buffer& valueBuffer, bool& failed);
     bool                    Set(uint16_t contextID, uint64_t shardID, ReadBuffer key, ReadBuffer value);
     bool                    Delete(uint16_t contextID, uint64_t shardID, ReadBuffer key);
 
@@ -114,6 +121,7 @@ public:
     bool                    Commit(uint64_t trackID);
     bool                    Commit(uint64_t trackID, Callable& onCommit_);
     bool                    IsCommitting(uint64_t trackID);
+    uint64_t                GetLastCommitTime();
     
     bool                    PushMemoChunk(uint16_t contextID, uint64_t shardID);
     void                    DumpMemoChunks();
@@ -135,6 +143,7 @@ public:
     unsigned                GetNumActiveListThreads();
     unsigned                GetNumFinishedMergeJobs();
     StorageConfig&          GetConfig();
+    StorageValueLog*        GetValueLog();
     
     void                    OnCommit(StorageCommitJob* job);
     void                    TryFinalizeLogSegments();
@@ -177,6 +186,8 @@ private:
     FileChunkList           fileChunks;
     StorageConfig           config;
     LogManager              logManager;
+    StorageManifest         manifest;
+    StorageValueLog         valueLog;
 
     Countdown               backgroundTimer;
     Callable                onBackgroundTimer;
@@ -191,6 +202,7 @@ private:
     ThreadPool*             asyncGetThread;
 
     uint64_t                nextChunkID;
+    uint64_t                lastCommitTime;
     int                     mergeEnabledCounter; // enabled if > 0
     uint32_t                mergeCpuThreshold;   // only merge if CPU % is below this number
     unsigned                numFinishedMergeJobs;
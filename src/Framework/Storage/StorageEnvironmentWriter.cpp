@@ -1,6 +1,7 @@
 #include "StorageEnvironmentWriter.h"
 #include "System/FileSystem.h"
 #include "StorageEnvironment.h"
+#include "StorageManifest.h"
 
 #define STORAGE_TOC_VERSION         1
 #define STORAGE_TOC_HEADER_SIZE     12
@@ -88,9 +89,14 @@ bool StorageEnvironmentWriter::DeleteSnapshot(StorageEnvironment* env, uint64_t
     return ret;
 }
 
+uint32_t StorageEnvironmentWriter::GetChecksum()
+{
+    return checksum;
+}
+
 void StorageEnvironmentWriter::WriteBuffer()
 {
-    uint32_t        numShards, checksum, length;
+    uint32_t        numShards, length;
     StorageShard*   itShard;
     ReadBuffer      dataPart;
     
@@ -120,32 +126,10 @@ void StorageEnvironmentWriter::WriteShard(StorageShard* shard)
 {
     Buffer          tmp;
     uint32_t        numChunks;
-    ReadBuffer      firstKey, lastKey;
-    StorageChunk**  itChunk;
-    
-    firstKey = shard->GetFirstKey();
-    lastKey = shard->GetLastKey();
-    
-    writeBuffer.AppendLittle64(shard->GetTrackID());
-    writeBuffer.AppendLittle16(shard->GetContextID());
-    writeBuffer.AppendLittle64(shard->GetTableID());
-    writeBuffer.AppendLittle64(shard->GetShardID());
-    writeBuffer.AppendLittle64(shard->GetLogSegmentID());
-    writeBuffer.AppendLittle32(shard->GetLogCommandID());
-    writeBuffer.Appendf("%#R", &firstKey);
-    writeBuffer.Appendf("%#R", &lastKey);
-    writeBuffer.Appendf("%b", shard->UseBloomFilter());
-    writeBuffer.Appendf("%c", shard->GetStorageType());
-    
-    numChunks = 0;
-    FOREACH (itChunk, shard->GetChunks())
-    {
-        if ((*itChunk)->GetChunkState() == StorageChunk::Written)
-        {
-            numChunks++;
-            tmp.AppendLittle64((*itChunk)->GetChunkID());
-        }
-    }
+    
+    // the manifest uses the same shard record format
+    StorageManifest::WriteShardMeta(shard, writeBuffer);
+    numChunks = StorageManifest::WriteShardChunkIDs(shard, tmp);
     
     writeBuffer.AppendLittle32(numChunks);
     writeBuffer.Append(tmp);
@@ -23,6 +23,8 @@ public:
     
     uint64_t                WriteSnapshot(StorageEnvironment* env);
     bool                    DeleteSnapshot(StorageEnvironment* env, uint64_t tocID);
+    
+    uint32_t                GetChecksum();
 
 private:
     void                    WriteBuffer();
@@ -31,6 +33,7 @@ private:
     StorageEnvironment*     env;
     FDGuard                 fd;
     Buffer                  writeBuffer;
+    uint32_t                checksum;
 };
 
 #endif
@@ -0,0 +1,155 @@
+#include "StorageFDCache.h"
+#include "System/FileSystem.h"
+#include "System/Registry.h"
+#include "System/Threading/Mutex.h"
+#include "System/Containers/InList.h"
+
+static Mutex                        mutex;
+static InList<StorageFDCacheEntry>  entries;    // most recently used first
+static unsigned                     maxOpen = STORAGE_DEFAULT_MAX_OPEN_CHUNK_FILES;
+static uint64_t*                    numOpens = NULL;
+static uint64_t*                    numCloses = NULL;
+static uint64_t*                    numHits = NULL;
+
+StorageFDCacheEntry::StorageFDCacheEntry()
+{
+    fd = INVALID_FD;
+    numUsers = 0;
+    prev = next = this;
+}
+
+void StorageFDCache::Init(unsigned maxOpen_)
+{
+    SetMaxOpen(maxOpen_);
+
+    numOpens = Registry::GetUintPtr("storage.fdCache.numOpens");
+    numCloses = Registry::GetUintPtr("storage.fdCache.numCloses");
+    numHits = Registry::GetUintPtr("storage.fdCache.numHits");
+}
+
+void StorageFDCache::Shutdown()
+{
+    StorageFDCacheEntry*    entry;
+    MutexGuard              guard(mutex);
+
+    FOREACH_FIRST (entry, entries)
+    {
+        entries.Remove(entry);
+        FS_FileClose(entry->fd);
+        entry->fd = INVALID_FD;
+
+        entry = entries.First();
+    }
+}
+
+void StorageFDCache::SetMaxOpen(unsigned maxOpen_)
+{
+    MutexGuard  guard(mutex);
+
+    maxOpen = maxOpen_;
+    if (maxOpen == 0)
+        maxOpen = 1;
+
+    CloseColdEntries();
+}
+
+unsigned StorageFDCache::GetMaxOpen()
+{
+    return maxOpen;
+}
+
+unsigned StorageFDCache::GetNumOpen()
+{
+    return entries.GetLength();
+}
+
+FD StorageFDCache::Acquire(StorageFDCacheEntry* entry, const char* filename)
+{
+    MutexGuard  guard(mutex);
+
+    if (entry->fd != INVALID_FD)
+    {
+        entries.Remove(entry);
+        entries.Prepend(entry);
+        entry->numUsers++;
+        if (numHits)
+            (*numHits)++;
+        return entry->fd;
+    }
+
+    Log_Debug("Opening chunk file %s", filename);
+
+    entry->fd = FS_Open(filename, FS_READONLY);
+    if (entry->fd == INVALID_FD)
+        return INVALID_FD;
+
+    entry->filename.Write(filename);
+    entry->filename.NullTerminate();
+    entries.Prepend(entry);
+    entry->numUsers++;
+    if (numOpens)
+        (*numOpens)++;
+
+    CloseColdEntries();
+
+    return entry->fd;
+}
+
+void StorageFDCache::Release(StorageFDCacheEntry* entry)
+{
+    MutexGuard  guard(mutex);
+
+    ASSERT(entry->numUsers > 0);
+    entry->numUsers--;
+
+    CloseColdEntries();
+}
+
+void StorageFDCache::Remove(StorageFDCacheEntry* entry)
+{
+    MutexGuard  guard(mutex);
+
+    if (entry->fd == INVALID_FD)
+        return;
+
+    entries.Remove(entry);
+    FS_FileClose(entry->fd);
+    entry->fd = INVALID_FD;
+    entry->numUsers = 0;
+    if (numCloses)
+        (*numCloses)++;
+}
+
+bool StorageFDCache::IsOpen(const char* filename)
+{
+    StorageFDCacheEntry*    entry;
+    MutexGuard              guard(mutex);
+
+    FOREACH (entry, entries)
+    {
+        if (strcmp(entry->filename.GetBuffer(), filename) == 0)
+            return true;
+    }
+
+    return false;
+}
+
+void StorageFDCache::CloseColdEntries()
+{
+    StorageFDCacheEntry*    entry;
+    StorageFDCacheEntry*    prev;
+
+    // files being read are skipped, they are closed by a later Release()
+    for (entry = entries.Last(); entry != NULL && entries.GetLength() > maxOpen; entry = prev)
+    {
+        prev = entries.Prev(entry);
+        if (entry->numUsers > 0)
+            continue;
+
+        entries.Remove(entry);
+        FS_FileClose(entry->fd);
+        entry->fd = INVALID_FD;
+        if (numCloses)
+            (*numCloses)++;
+    }
+}
@@ -0,0 +1,63 @@
+#ifndef STORAGEFDCACHE_H
+#define STORAGEFDCACHE_H
+
+#include "System/IO/FD.h"
+#include "System/Buffers/Buffer.h"
+
+#define STORAGE_DEFAULT_MAX_OPEN_CHUNK_FILES    1024
+
+/*
+===============================================================================================
+
+ StorageFDCacheEntry
+
+===============================================================================================
+*/
+
+class StorageFDCacheEntry
+{
+public:
+    StorageFDCacheEntry();
+
+    FD                          fd;
+    unsigned                    numUsers;
+    Buffer                      filename;
+
+    StorageFDCacheEntry*        prev;
+    StorageFDCacheEntry*        next;
+};
+
+/*
+===============================================================================================
+
+ StorageFDCache
+
+ Chunk files are opened lazily on the first read and kept open in LRU order.
+ When more than maxOpen files are open, the least recently used ones which are not
+ being read at the moment are closed. Safe to call from the async get and list threads.
+ IsOpen() tells the file deleter whether a reader may still read the file.
+
+===============================================================================================
+*/
+
+class StorageFDCache
+{
+public:
+    static void                 Init(unsigned maxOpen);
+    static void                 Shutdown();
+
+    static void                 SetMaxOpen(unsigned maxOpen);
+    static unsigned             GetMaxOpen();
+    static unsigned             GetNumOpen();
+
+    static FD                   Acquire(StorageFDCacheEntry* entry, const char* filename);
+    static void                 Release(StorageFDCacheEntry* entry);
+    static void                 Remove(StorageFDCacheEntry* entry);
+
+    static bool                 IsOpen(const char* filename);
+
+private:
+    static void                 CloseColdEntries();
+};
+
+#endif
@@ -1,5 +1,6 @@
 #include "System/FileSystem.h"
 #include "StorageFileChunk.h"
+#include "StorageFDCache.h"
 #include "StorageBulkCursor.h"
 #include "StoragePageCache.h"
 #include "StorageEnvironment.h"
@@ -28,7 +29,6 @@ void StorageFileChunk::Init()
     fileSize = 0;
     useCache = true;
     deleted = false;
-    fd = INVALID_FD;
 }
 
 void StorageFileChunk::Close()
@@ -37,8 +37,7 @@ void StorageFileChunk::Close()
     
     //Log_Debug("Closing chunk %U", headerPage.GetChunkID());
 
-    if (fd != INVALID_FD)
-        FS_FileClose(fd);
+    StorageFDCache::Remove(&fdEntry);
     
     for (i = 0; i < numDataPages; i++)
     {
@@ -58,9 +57,6 @@ void StorageFileChunk::ReadHeaderPage()
     Buffer      buffer;
     uint64_t    offset;
     
-    if (fd == INVALID_FD)
-        OpenForReading();
-
     if (headerPage.GetChunkID() > 0)
         return; // already loaded
 
@@ -110,12 +106,22 @@ Buffer& StorageFileChunk::GetFilename()
 
 bool StorageFileChunk::OpenForReading()
 {
-    Log_Debug("Opening chunk file %s", filename.GetBuffer());
-    
-    fd = FS_Open(filename.GetBuffer(), FS_READONLY);
-    if (fd != INVALID_FD)
-        return true;
-    return false;
+    // the file is opened by the FD cache, and may be closed when not in use
+    if (StorageFDCache::Acquire(&fdEntry, filename.GetBuffer()) == INVALID_FD)
+        return false;
+    StorageFDCache::Release(&fdEntry);
+    return true;
+}
+
+bool StorageFileChunk::AcquireFD()
+{
+    // keeps the file open until ReleaseFD(), so it remains readable even if it is deleted
+    return StorageFDCache::Acquire(&fdEntry, filename.GetBuffer()) != INVALID_FD;
+}
+
+void StorageFileChunk::ReleaseFD()
+{
+    StorageFDCache::Release(&fdEntry);
 }
 
 StorageChunk::ChunkState StorageFileChunk::GetChunkState()
@@ -282,6 +288,15 @@ void StorageFileChunk::AsyncGet(StorageAsyncGet* asyncGet)
         return;
     }
 
+    if (kv->IsValueLogged())
+    {
+        // the data page only has the pointer, the value is read in the threadPool
+        asyncGet->stage = StorageAsyncGet::VALUE_LOG;
+        asyncGet->valueLogPointer.Write(kv->GetValue());
+        asyncGet->threadPool->Execute(MFUNC_OF(StorageAsyncGet, AsyncLoadPage, asyncGet));
+        return;
+    }
+
     asyncGet->value = kv->GetValue();
     asyncGet->ret = true;
     asyncGet->completed = true;
@@ -474,9 +489,6 @@ void StorageFileChunk::LoadBloomPage()
     Buffer      buffer;
     uint64_t    offset;
     
-    if (fd == INVALID_FD)
-        OpenForReading();
-    
     if (bloomPage)
     {
         // already loaded
@@ -514,9 +526,6 @@ void StorageFileChunk::LoadIndexPage()
     Buffer      buffer;
     uint64_t    offset;
 
-    if (fd == INVALID_FD)
-        OpenForReading();
-
     if (indexPage)
     {
         // already loaded
@@ -560,9 +569,6 @@ void StorageFileChunk::LoadDataPage(uint32_t index, uint64_t offset, bool bulk,
     if (useCache)
         ASSERT(dataPage == NULL);
 
-    if (fd == INVALID_FD)
-        OpenForReading();
-    
     if (dataPages[index])
     {
         ASSERT(dataPage == NULL);
@@ -621,9 +627,6 @@ StoragePage* StorageFileChunk::AsyncLoadBloomPage()
     
     Log_Debug("async loading bloom page: %U, cache size: %U, cache num: %u", GetChunkID(), StoragePageCache::GetSize(), StoragePageCache::GetNumPages());
 
-    if (fd == INVALID_FD)
-        OpenForReading();
-    
     page = new StorageBloomPage(NULL);
     offset = headerPage.GetBloomPageOffset();
     page->SetOffset(offset);
@@ -659,9 +662,6 @@ StoragePage* StorageFileChunk::AsyncLoadIndexPage()
 
     Log_Debug("async loading index page: %U, cache size: %U, cache num: %u", GetChunkID(), StoragePageCache::GetSize(), StoragePageCache::GetNumPages());
     
-    if (fd == INVALID_FD)
-        OpenForReading();
-
     page = new StorageIndexPage(NULL);
     offset = headerPage.GetIndexPageOffset();
     page->SetOffset(offset);
@@ -696,9 +696,6 @@ StoragePage* StorageFileChunk::AsyncLoadDataPage(uint32_t index, uint64_t offset
     
 //    Log_Debug("async loading data page, chunk:%u, index: %u", headerPage.GetChunkID(), index);
 
-    if (fd == INVALID_FD)
-        OpenForReading();
-    
     page = new StorageDataPage(NULL, index);
     page->SetOffset(offset);
     if (!ReadPage(offset, buffer))
@@ -833,6 +830,24 @@ void StorageFileChunk::ExtendDataPageArray()
 }
 
 bool StorageFileChunk::ReadPage(uint64_t offset, Buffer& buffer, bool keysOnly)
+{
+    FD      fd;
+    bool    ret;
+    
+    fd = StorageFDCache::Acquire(&fdEntry, filename.GetBuffer());
+    if (fd == INVALID_FD)
+    {
+        Log_Message("ReadPage failing, unable to open %s", filename.GetBuffer());
+        return false;
+    }
+    
+    ret = ReadPage(fd, offset, buffer, keysOnly);
+    
+    StorageFDCache::Release(&fdEntry);
+    return ret;
+}
+
+bool StorageFileChunk::ReadPage(FD fd, uint64_t offset, Buffer& buffer, bool keysOnly)
 {
     uint32_t    size, keysSize, rest;
     ssize_t     nread;
@@ -7,6 +7,7 @@
 #include "StorageIndexPage.h"
 #include "StorageBloomPage.h"
 #include "StorageDataPage.h"
+#include "StorageFDCache.h"
 
 class StorageAsyncGet;
 
@@ -34,6 +35,8 @@ public:
     Buffer&             GetFilename();
 
     bool                OpenForReading();
+    bool                AcquireFD();
+    void                ReleaseFD();
 
     ChunkState          GetChunkState();
     
@@ -105,9 +108,10 @@ private:
     void                AllocateDataPageArray();
     void                ExtendDataPageArray();
     bool                ReadPage(uint64_t offset, Buffer& buffer, bool keysOnly = false);
+    bool                ReadPage(FD fd, uint64_t offset, Buffer& buffer, bool keysOnly);
 
     Buffer              filename;
-    FD                  fd;
+    StorageFDCacheEntry fdEntry;
 };
 
 #endif
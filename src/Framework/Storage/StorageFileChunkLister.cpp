@@ -19,6 +19,15 @@ void StorageFileChunkLister::Load()
 {
 }
 
+// the range buffers belong to the request, they are set again when a list cursor is resumed
+void StorageFileChunkLister::SetRange(ReadBuffer endKey_, ReadBuffer prefix_)
+{
+    endKey = endKey_;
+    prefix = prefix_;
+    reader.SetPrefix(prefix);
+    reader.SetEndKey(endKey);
+}
+
 void StorageFileChunkLister::SetDirection(bool /*forwardDirection_*/)
 {
 }
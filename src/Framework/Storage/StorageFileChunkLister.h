@@ -20,6 +20,7 @@ public:
                              unsigned count, bool keysOnly, uint64_t preloadBufferSize, bool forwardDirection);
 
     void                    Load();
+    void                    SetRange(ReadBuffer endKey, ReadBuffer prefix);
     
     void                    SetDirection(bool forwardDirection);
     StorageFileKeyValue*    First(ReadBuffer& firstKey);
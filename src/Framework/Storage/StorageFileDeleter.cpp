@@ -1,11 +1,24 @@
 #include "StorageFileDeleter.h"
+#include "StorageFDCache.h"
 #include "System/FileSystem.h"
 #include "System/Threading/Signal.h"
+#include "System/Registry.h"
+#include "System/Stopwatch.h"
+#include "System/Config.h"
+#include "System/Time.h"
 
 static volatile bool                    enabled = true;
 static volatile bool                    running = false;
 static ThreadPool*                      threadPool = NULL;
 static Mutex                            enabledMutex;
+static Mutex                            pendingMutex;
+static Buffer                           deletedPath;
+static uint64_t                         stepSize = STORAGE_DEFAULT_DELETE_STEP_SIZE;
+static volatile uint64_t                bytesPerSec = STORAGE_DEFAULT_DELETE_BYTES_PER_SEC;
+static unsigned                         numPending = 0;
+static uint64_t                         nextDeletedID = 0;
+static uint64_t*                        numFilesDeleted = NULL;
+static uint64_t*                        numBytesDeleted = NULL;
 
 /*
 ===============================================================================================
@@ -18,35 +31,175 @@ static Mutex                            enabledMutex;
 class StorageFileDeleterTask
 {
 public:
-    StorageFileDeleterTask(const char* filename);
+    StorageFileDeleterTask(const char* filename, bool moved);
 
+    bool                        MoveToDeleted();
     void                        DeleteFile();
 
 private:
+    void                        TruncateAndDelete();
+
     Buffer                      filename;
+    Buffer                      openedFilename;    // the name the readers opened the file with
+    bool                        moved;
 };
 
 
-StorageFileDeleterTask::StorageFileDeleterTask(const char* filename_)
+StorageFileDeleterTask::StorageFileDeleterTask(const char* filename_, bool moved_)
 {
     filename.Write(filename_);
     filename.NullTerminate();
+    openedFilename.Write(filename);
+    openedFilename.NullTerminate();
+    moved = moved_;
 }
 
 void StorageFileDeleterTask::DeleteFile()
 {
-    MutexGuard      enabledGuard(enabledMutex);
+    bool    locked;
+
+    // a file not moved by Delete() waits until the deletes are enabled, e.g. after a backup
+    locked = !moved;
+    if (locked)
+        enabledMutex.Lock();
+
+    if (running && !moved)
+        MoveToDeleted();
+    
+    // once moved, the file is out of the way of backups
+    if (locked && moved)
+    {
+        enabledMutex.Unlock();
+        locked = false;
+    }
 
     if (running)
     {
         Log_Debug("Deleting %s", filename.GetBuffer());
 
-        FS_Delete(filename.GetBuffer());
+        TruncateAndDelete();
     }
 
+    if (locked)
+        enabledMutex.Unlock();
+
+    pendingMutex.Lock();
+    numPending--;
+    pendingMutex.Unlock();
+
     delete this;
 }
 
+bool StorageFileDeleterTask::MoveToDeleted()
+{
+    Buffer          target;
+    const char*     name;
+    const char*     p;
+    uint64_t        deletedID;
+
+    name = filename.GetBuffer();
+    for (p = name; *p != 0; p++)
+    {
+        if (*p == '/' || *p == '\\')
+            name = p + 1;
+    }
+
+    // the same name may be deleted again while the previous file is still being truncated,
+    // and deleted/ may hold files of the last run, so each file gets a name of its own
+    do
+    {
+        pendingMutex.Lock();
+        deletedID = nextDeletedID++;
+        pendingMutex.Unlock();
+
+        target.Write(deletedPath);
+        target.Appendf("%s.%U", name, deletedID);
+        target.NullTerminate();
+    }
+    while (FS_Exists(target.GetBuffer()));
+
+    if (!FS_Rename(filename.GetBuffer(), target.GetBuffer()))
+    {
+        // e.g. the file is on another device, delete it in place
+        Log_Debug("Unable to move %s to %s", filename.GetBuffer(), target.GetBuffer());
+        return false;
+    }
+
+    filename.Write(target);
+    filename.NullTerminate();
+    moved = true;
+    return true;
+}
+
+void StorageFileDeleterTask::TruncateAndDelete()
+{
+    FD          fd;
+    int64_t     size;
+    uint64_t    step;
+    uint64_t    budget;
+    bool        unlinked;
+    Stopwatch   sw;
+
+    size = 0;
+    unlinked = false;
+    fd = FS_Open(filename.GetBuffer(), FS_READWRITE);
+    if (fd != INVALID_FD)
+    {
+        size = FS_FileSize(fd);
+
+        // nobody can open the file once it is unlinked, its extents are then released
+        // by truncating the fd held here
+        unlinked = FS_Delete(filename.GetBuffer());
+
+        // readers that still have the file open would read short pages, for them the
+        // kernel releases the file when the last one closes it
+        if (StorageFDCache::IsOpen(openedFilename.GetBuffer()))
+        {
+            Log_Debug("%s is still being read, not truncating", filename.GetBuffer());
+            FS_FileClose(fd);
+            fd = INVALID_FD;
+        }
+    }
+
+    if (fd != INVALID_FD)
+    {
+        // releasing the extents of a large file at once can stall the disk
+        while (running && size > (int64_t) stepSize)
+        {
+            sw.Restart();
+            step = stepSize;
+            size -= step;
+            if (!FS_FileTruncate(fd, size))
+                break;
+            
+            if (numBytesDeleted)
+                (*numBytesDeleted) += step;
+
+            if (bytesPerSec > 0)
+            {
+                budget = step * 1000 / bytesPerSec;
+                if (sw.Elapsed() < budget)
+                    MSleep((unsigned long) (budget - sw.Elapsed()));
+            }
+        }
+        
+        FS_FileClose(fd);
+        
+        // the rest is deleted on next startup
+        if (!running && !unlinked)
+            return;
+    }
+
+    if (size > 0 && numBytesDeleted)
+        (*numBytesDeleted) += size;
+
+    if (!unlinked)
+        FS_Delete(filename.GetBuffer());
+
+    if (numFilesDeleted)
+        (*numFilesDeleted)++;
+}
+
 /*
 ===============================================================================================
 
@@ -55,13 +208,67 @@ void StorageFileDeleterTask::DeleteFile()
 ===============================================================================================
 */
 
-void StorageFileDeleter::Init()
+void StorageFileDeleter::Init(Buffer& envPath)
 {
+    const char*                 name;
+    Buffer                      tmp;
+    FS_Dir                      dir;
+    FS_DirEntry                 entry;
+    StorageFileDeleterTask*     task;
+
     ASSERT(threadPool == NULL);
 
+    stepSize = configFile.GetInt64Value("database.deleteStepSize", STORAGE_DEFAULT_DELETE_STEP_SIZE);
+    if (stepSize == 0)
+        stepSize = STORAGE_DEFAULT_DELETE_STEP_SIZE;
+    bytesPerSec = configFile.GetInt64Value("database.deleteBytesPerSec", STORAGE_DEFAULT_DELETE_BYTES_PER_SEC);
+
+    numFilesDeleted = Registry::GetUintPtr("storage.fileDeleter.numFilesDeleted");
+    numBytesDeleted = Registry::GetUintPtr("storage.fileDeleter.numBytesDeleted");
+
+    deletedPath.Write(envPath);
+    deletedPath.Append("deleted/");
+    tmp.Write(deletedPath);
+    tmp.NullTerminate();
+    if (!FS_IsDirectory(tmp.GetBuffer()))
+    {
+        if (!FS_CreateDir(tmp.GetBuffer()))
+        {
+            Log_Message("Unable to create deleted directory: %s", tmp.GetBuffer());
+            STOP_FAIL(1);
+        }
+    }
+
     running = true;
     threadPool = ThreadPool::Create(1);
     threadPool->Start();
+
+    // continue the deletions interrupted by the last shutdown
+    dir = FS_OpenDir(tmp.GetBuffer());
+    if (dir == FS_INVALID_DIR)
+        return;
+
+    while ((entry = FS_ReadDir(dir)) != FS_INVALID_DIR_ENTRY)
+    {
+        name = FS_DirEntryName(entry);
+        if (FS_IsSpecial(name))
+            continue;
+        
+        tmp.Write(deletedPath);
+        tmp.Append(name);
+        tmp.NullTerminate();
+        if (FS_IsDirectory(tmp.GetBuffer()))
+            continue;
+
+        pendingMutex.Lock();
+        numPending++;
+        pendingMutex.Unlock();
+
+        // task will delete itself
+        task = new StorageFileDeleterTask(tmp.GetBuffer(), true);
+        threadPool->Execute(MFUNC_OF(StorageFileDeleterTask, DeleteFile, task));
+    }
+    FS_CloseDir(dir);
 }
 
 void StorageFileDeleter::Shutdown()
@@ -80,8 +287,20 @@ void StorageFileDeleter::Delete(const char* filename)
 {
     StorageFileDeleterTask*     task;
 
+    pendingMutex.Lock();
+    numPending++;
+    pendingMutex.Unlock();
+
     // task will delete itself
-    task = new StorageFileDeleterTask(filename);
+    task = new StorageFileDeleterTask(filename, false);
+
+    // once in deleted/, the delete is continued by Init() after a crash, only the
+    // truncation and the unlink are left to the background thread; while disabled,
+    // e.g. during a backup, the file stays in place and the recovery deletes it
+    // as an orphan after a crash
+    if (enabled)
+        task->MoveToDeleted();
+
     threadPool->Execute(MFUNC_OF(StorageFileDeleterTask, DeleteFile, task));
 }
 
@@ -105,6 +324,21 @@ bool StorageFileDeleter::IsEnabled()
     return enabled;
 }
 
+void StorageFileDeleter::SetBytesPerSec(uint64_t bytesPerSec_)
+{
+    bytesPerSec = bytesPerSec_;
+}
+
+uint64_t StorageFileDeleter::GetBytesPerSec()
+{
+    return bytesPerSec;
+}
+
+unsigned StorageFileDeleter::GetNumPending()
+{
+    return numPending;
+}
+
 Mutex& StorageFileDeleter::GetMutex()
 {
     return enabledMutex;
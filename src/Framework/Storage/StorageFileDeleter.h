@@ -6,10 +6,18 @@
 #include "System/Containers/InList.h"
 #include "System/Buffers/Buffer.h"
 
+#define STORAGE_DEFAULT_DELETE_STEP_SIZE        (32*MiB)
+#define STORAGE_DEFAULT_DELETE_BYTES_PER_SEC    (128*MiB)
+
 /*
 ===============================================================================================
 
  StorageFileDeleter
+
+ Delete() moves the file to the deleted/ directory of the environment right away, so pending
+ deletions survive a crash or restart. The background thread then unlinks the file and
+ truncates it in steps of deleteStepSize with at most deleteBytesPerSec, unless a reader
+ still has it open in the StorageFDCache.
 
 ===============================================================================================
 */
@@ -17,13 +25,17 @@
 class StorageFileDeleter
 {
 public:
-    static void                 Init();
+    static void                 Init(Buffer& envPath);
     static void                 Shutdown();
 
     static void                 Delete(const char* filename);
     static void                 SetEnabled(bool enabled);
     static bool                 IsEnabled();
 
+    static void                 SetBytesPerSec(uint64_t bytesPerSec);
+    static uint64_t             GetBytesPerSec();
+    static unsigned             GetNumPending();
+
     static Mutex&               GetMutex();
 };
 
@@ -3,18 +3,29 @@
 StorageFileKeyValue::StorageFileKeyValue()
 {
     type = 0;
+    valueLogged = false;
 }
 
 void StorageFileKeyValue::Set(ReadBuffer key_, ReadBuffer value_)
 {
     type = STORAGE_KEYVALUE_TYPE_SET;
+    valueLogged = false;
     key = key_;
     value = value_;
 }
 
+void StorageFileKeyValue::SetValueLog(ReadBuffer key_, ReadBuffer pointer_)
+{
+    type = STORAGE_KEYVALUE_TYPE_SET;
+    valueLogged = true;
+    key = key_;
+    value = pointer_;
+}
+
 void StorageFileKeyValue::Delete(ReadBuffer key_)
 {
     type = STORAGE_KEYVALUE_TYPE_DELETE;
+    valueLogged = false;
     key = key_;
 }
 
@@ -41,3 +52,8 @@ ReadBuffer StorageFileKeyValue::GetValue() const
 {
     return value;
 }
+
+bool StorageFileKeyValue::IsValueLogged() const
+{
+    return valueLogged;
+}
@@ -19,16 +19,19 @@ public:
     StorageFileKeyValue();
 
     void                Set(ReadBuffer key, ReadBuffer value);
+    void                SetValueLog(ReadBuffer key, ReadBuffer pointer);
     void                Delete(ReadBuffer key);
     
     char                GetType();
     ReadBuffer          GetKey() const;
     ReadBuffer          GetValue() const;
+    bool                IsValueLogged() const;
 
     const ReadBuffer&   GetKeyReference() const;
 
 private:
     char                type;
+    bool                valueLogged;
     ReadBuffer          key;
     ReadBuffer          value;
 };
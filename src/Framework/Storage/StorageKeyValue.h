@@ -5,6 +5,7 @@
 
 #define STORAGE_KEYVALUE_TYPE_SET      's'
 #define STORAGE_KEYVALUE_TYPE_DELETE   'd'
+#define STORAGE_KEYVALUE_TYPE_VALUELOG 'v'    // on-disk type of a SET with a value log pointer
 
 #define STORAGE_KEY_LESS_THAN(a, b) \
     ((b).GetLength() == 0 || ReadBuffer::Cmp(a, b) < 0)
@@ -28,6 +29,9 @@ public:
     virtual char            GetType() = 0;
     virtual ReadBuffer      GetKey() const = 0;
     virtual ReadBuffer      GetValue() const = 0;
+
+    // if true, GetValue() returns a StorageValueLog pointer
+    virtual bool            IsValueLogged() const { return false; }
 };
 
 #endif
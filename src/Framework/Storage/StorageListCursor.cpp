@@ -0,0 +1,63 @@
+#include "StorageListCursor.h"
+#include "StorageFileChunkLister.h"
+#include "StorageMemoChunkLister.h"
+
+StorageListCursor::StorageListCursor()
+{
+    prev = next = this;
+    owner = NULL;
+    expireTime = 0;
+    contextID = 0;
+    shardID = 0;
+    keysOnly = false;
+    numListers = 0;
+    chunkIDs = NULL;
+    listers = NULL;
+    iterators = NULL;
+    lastKeyValue = NULL;
+}
+
+StorageListCursor::~StorageListCursor()
+{
+    unsigned    i;
+
+    for (i = 0; i < numListers; i++)
+        delete listers[i];
+    delete[] chunkIDs;
+    delete[] listers;
+    delete[] iterators;
+    delete lastKeyValue;
+}
+
+bool StorageListCursor::HasChunk(uint64_t chunkID)
+{
+    unsigned    i;
+
+    for (i = 0; i < numListers; i++)
+    {
+        if (chunkIDs[i] == chunkID)
+            return true;
+    }
+
+    return false;
+}
+
+StorageFileChunkLister* StorageListCursor::TakeLister(uint64_t chunkID, StorageFileKeyValue*& iterator)
+{
+    unsigned                i;
+    StorageFileChunkLister* lister;
+
+    for (i = 0; i < numListers; i++)
+    {
+        if (chunkIDs[i] == chunkID && listers[i] != NULL)
+        {
+            lister = listers[i];
+            iterator = iterators[i];
+            listers[i] = NULL;
+            return lister;
+        }
+    }
+
+    iterator = NULL;
+    return NULL;
+}
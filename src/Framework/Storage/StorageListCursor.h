@@ -0,0 +1,54 @@
+#ifndef STORAGELISTCURSOR_H
+#define STORAGELISTCURSOR_H
+
+#include "System/Buffers/Buffer.h"
+
+class StorageFileChunkLister;
+class StorageFileKeyValue;
+class StorageMemoChunkLister;
+
+/*
+===============================================================================================
+
+ StorageListCursor
+
+ The state of a forward list that stopped because it returned 'count' keys. It keeps
+ the listers of the written chunks at their positions, with their data pages pinned
+ in the list page cache, so the next page of the same listing continues without
+ locating the start key and reading the pages again. The last listed key-value is
+ kept, too, because the next page starts with it. In-memory chunks are listed again.
+
+ A cursor is only resumed if the shard still has the same written chunks.
+
+===============================================================================================
+*/
+
+class StorageListCursor
+{
+public:
+    StorageListCursor();
+    ~StorageListCursor();
+
+    bool                        HasChunk(uint64_t chunkID);
+    StorageFileChunkLister*     TakeLister(uint64_t chunkID, StorageFileKeyValue*& iterator);
+
+    StorageListCursor*          prev;
+    StorageListCursor*          next;
+
+    void*                       owner;
+    uint64_t                    expireTime;
+    uint16_t                    contextID;
+    uint64_t                    shardID;
+    bool                        keysOnly;
+    Buffer                      prefix;
+    Buffer                      endKey;
+    Buffer                      lastKey;
+
+    unsigned                    numListers;
+    uint64_t*                   chunkIDs;
+    StorageFileChunkLister**    listers;
+    StorageFileKeyValue**       iterators;
+    StorageMemoChunkLister*     lastKeyValue;
+};
+
+#endif
@@ -0,0 +1,27 @@
+#ifndef STORAGELISTFILTER_H
+#define STORAGELISTFILTER_H
+
+#include "System/Buffers/ReadBuffer.h"
+
+/*
+===============================================================================================
+
+ StorageListFilter
+
+ Evaluated by StorageAsyncList in the list thread on each key-value it would return.
+ Match() may shorten the value to project it. If IsValueNeeded() is false, the values
+ are not read for KEY lists.
+
+===============================================================================================
+*/
+
+class StorageListFilter
+{
+public:
+    virtual ~StorageListFilter() {}
+
+    virtual bool    Match(const ReadBuffer& key, ReadBuffer& value) = 0;
+    virtual bool    IsValueNeeded() = 0;
+};
+
+#endif
@@ -0,0 +1,370 @@
+#include "StorageLogArchiver.h"
+#include "StorageFileDeleter.h"
+#include "FDGuard.h"
+#include "System/FileSystem.h"
+#include "System/Config.h"
+#include "System/Registry.h"
+#include "System/Compressor.h"
+#include "System/Containers/SortedList.h"
+#include "System/Threading/Mutex.h"
+#include "System/Time.h"
+
+/*
+===============================================================================================
+
+ StorageArchivedFile
+
+===============================================================================================
+*/
+
+struct StorageArchivedFile
+{
+    Buffer                  filename;
+    uint64_t                size;
+    int64_t                 mtime;
+};
+
+static bool LessThan(StorageArchivedFile* a, StorageArchivedFile* b)
+{
+    if (a->mtime == b->mtime)
+        return Buffer::Cmp(a->filename, b->filename) < 0;
+    return a->mtime < b->mtime;
+}
+
+static Buffer                               archivePath;
+static SortedList<StorageArchivedFile*>     archivedFiles;  // oldest first
+static Mutex                                mutex;
+static uint64_t                             totalSize = 0;
+static bool                                 compression = false;
+static uint64_t                             maxSize = 0;
+static uint64_t                             maxAge = 0;
+static uint64_t*                            numArchived = NULL;
+static uint64_t*                            numBytesArchived = NULL;
+static uint64_t*                            numBytesWritten = NULL;
+static uint64_t*                            numRetentionDeletes = NULL;
+static uint64_t*                            lastArchiveLag = NULL;
+static uint64_t*                            lastArchiveTime = NULL;
+
+void StorageLogArchiver::Init(Buffer& archivePath_)
+{
+    const char*             name;
+    Buffer                  tmp;
+    FS_Dir                  dir;
+    FS_DirEntry             entry;
+    StorageArchivedFile*    archivedFile;
+
+    compression = configFile.GetBoolValue("database.archiveCompression", false);
+    maxSize = configFile.GetInt64Value("database.archiveMaxSize", 0);
+    maxAge = configFile.GetInt64Value("database.archiveMaxAge", 0);
+
+    numArchived = Registry::GetUintPtr("storage.archive.numArchived");
+    numBytesArchived = Registry::GetUintPtr("storage.archive.numBytesArchived");
+    numBytesWritten = Registry::GetUintPtr("storage.archive.numBytesWritten");
+    numRetentionDeletes = Registry::GetUintPtr("storage.archive.numRetentionDeletes");
+    lastArchiveLag = Registry::GetUintPtr("storage.archive.lastArchiveLag");
+    lastArchiveTime = Registry::GetUintPtr("storage.archive.lastArchiveTime");
+
+    archivePath.Write(archivePath_);
+
+    tmp.Write(archivePath);
+    tmp.NullTerminate();
+    dir = FS_OpenDir(tmp.GetBuffer());
+    if (dir == FS_INVALID_DIR)
+        return;
+
+    while ((entry = FS_ReadDir(dir)) != FS_INVALID_DIR_ENTRY)
+    {
+        name = FS_DirEntryName(entry);
+        if (!ReadBuffer(name).BeginsWith("log."))
+            continue;
+
+        tmp.Write(archivePath);
+        tmp.Append(name);
+        tmp.NullTerminate();
+
+        // partially written by a crash during archiving
+        if (strlen(name) > 4 && strcmp(name + strlen(name) - 4, ".tmp") == 0)
+        {
+            FS_Delete(tmp.GetBuffer());
+            continue;
+        }
+
+        archivedFile = new StorageArchivedFile;
+        archivedFile->filename.Write(tmp);
+        archivedFile->size = FS_FileSize(tmp.GetBuffer());
+        archivedFile->mtime = FS_FileModificationTime(tmp.GetBuffer());
+        archivedFiles.Add(archivedFile);
+        totalSize += archivedFile->size;
+    }
+    FS_CloseDir(dir);
+}
+
+void StorageLogArchiver::Shutdown()
+{
+    StorageArchivedFile**   itArchivedFile;
+
+    FOREACH (itArchivedFile, archivedFiles)
+        delete *itArchivedFile;
+    archivedFiles.Clear();
+    totalSize = 0;
+}
+
+bool StorageLogArchiver::Archive(Buffer& filename, uint64_t trackID, uint64_t logSegmentID)
+{
+    Buffer                  dest;
+    Buffer                  tmp;
+    int64_t                 size;
+    int64_t                 mtime;
+    bool                    moved;
+    StorageArchivedFile*    archivedFile;
+
+    filename.NullTerminate();
+
+    dest.Write(archivePath);
+    dest.Appendf("log.%020U.%020U", trackID, logSegmentID);
+    if (compression)
+        dest.Append(STORAGE_ARCHIVE_COMPRESSED_EXTENSION);
+    dest.NullTerminate();
+
+    size = FS_FileSize(filename.GetBuffer());
+    if (size < 0)
+        return false;
+
+    // how long the segment waited for archiving after its last write
+    mtime = FS_FileModificationTime(filename.GetBuffer());
+    if (mtime >= 0 && (uint64_t) mtime * 1000 < Now())
+        *lastArchiveLag = Now() - (uint64_t) mtime * 1000;
+
+    moved = false;
+    if (!compression)
+        moved = FS_Rename(filename.GetBuffer(), dest.GetBuffer());
+
+    if (!moved)
+    {
+        // write a copy and rename it when it is complete
+        tmp.Write(dest);
+        tmp.Append(".tmp");
+        tmp.NullTerminate();
+        if (!WriteArchiveFile(filename.GetBuffer(), tmp.GetBuffer(), compression))
+        {
+            FS_Delete(tmp.GetBuffer());
+            return false;
+        }
+        if (!FS_Rename(tmp.GetBuffer(), dest.GetBuffer()))
+            return false;
+        StorageFileDeleter::Delete(filename.GetBuffer());
+    }
+
+    archivedFile = new StorageArchivedFile;
+    archivedFile->filename.Write(dest);
+    archivedFile->size = FS_FileSize(dest.GetBuffer());
+    archivedFile->mtime = Now() / 1000;
+
+    mutex.Lock();
+    archivedFiles.Add(archivedFile);
+    totalSize += archivedFile->size;
+    mutex.Unlock();
+
+    (*numArchived)++;
+    (*numBytesArchived) += size;
+    (*numBytesWritten) += archivedFile->size;
+    *lastArchiveTime = Now();
+
+    ApplyRetention();
+
+    return true;
+}
+
+void StorageLogArchiver::ApplyRetention()
+{
+    StorageArchivedFile*    archivedFile;
+    uint64_t                now;
+    MutexGuard              guard(mutex);
+
+    now = Now() / 1000;
+    while (archivedFiles.GetLength() > 0)
+    {
+        archivedFile = *archivedFiles.First();
+        if (!(maxSize > 0 && totalSize > maxSize) &&
+         !(maxAge > 0 && (int64_t) now - archivedFile->mtime > (int64_t) maxAge))
+            break;
+
+        Log_Message("Deleting archived log segment %B because of retention",
+         &archivedFile->filename);
+
+        archivedFile->filename.NullTerminate();
+        StorageFileDeleter::Delete(archivedFile->filename.GetBuffer());
+        archivedFiles.Remove(archivedFiles.First());
+        totalSize -= archivedFile->size;
+        delete archivedFile;
+
+        (*numRetentionDeletes)++;
+    }
+}
+
+bool StorageLogArchiver::Restore(const char* src, const char* dst)
+{
+    size_t      len;
+    size_t      extlen;
+    bool        compressed;
+
+    len = strlen(src);
+    extlen = strlen(STORAGE_ARCHIVE_COMPRESSED_EXTENSION);
+    compressed = (len > extlen && strcmp(src + len - extlen, STORAGE_ARCHIVE_COMPRESSED_EXTENSION) == 0);
+
+    if (!ReadArchiveFile(src, dst, compressed))
+    {
+        FS_Delete(dst);
+        return false;
+    }
+
+    return true;
+}
+
+unsigned StorageLogArchiver::GetNumFiles()
+{
+    return archivedFiles.GetLength();
+}
+
+uint64_t StorageLogArchiver::GetSize()
+{
+    return totalSize;
+}
+
+bool StorageLogArchiver::WriteArchiveFile(const char* src, const char* dst, bool compress)
+{
+    FDGuard         srcFD;
+    FDGuard         dstFD;
+    Buffer          buffer;
+    Buffer          compressed;
+    Buffer          head;
+    Compressor      compressor;
+    int64_t         size;
+    uint64_t        offset;
+    ssize_t         length;
+    uint32_t        checksum;
+
+    if (srcFD.Open(src, FS_READONLY) == INVALID_FD)
+        return false;
+    if (dstFD.Open(dst, FS_CREATE | FS_WRITEONLY | FS_TRUNCATE) == INVALID_FD)
+        return false;
+
+    size = FS_FileSize(srcFD.GetFD());
+    if (size < 0)
+        return false;
+
+    buffer.Allocate(STORAGE_ARCHIVE_BLOCK_SIZE);
+    for (offset = 0; offset < (uint64_t) size; offset += length)
+    {
+        length = (ssize_t) MIN((uint64_t) size - offset, STORAGE_ARCHIVE_BLOCK_SIZE);
+        if (FS_FileReadOffs(srcFD.GetFD(), buffer.GetBuffer(), length, offset) != length)
+            return false;
+        buffer.SetLength(length);
+
+        if (!compress)
+        {
+            if (FS_FileWrite(dstFD.GetFD(), buffer.GetBuffer(), length) != length)
+                return false;
+            continue;
+        }
+
+        compressor.Compress(ReadBuffer(buffer), compressed);
+        checksum = ReadBuffer(buffer).GetChecksum();
+
+        head.Clear();
+        head.AppendLittle32(compressed.GetLength());
+        head.AppendLittle32(buffer.GetLength());
+        head.AppendLittle32(checksum);
+        if (FS_FileWrite(dstFD.GetFD(), head.GetBuffer(), head.GetLength()) != (ssize_t) head.GetLength())
+            return false;
+        if (FS_FileWrite(dstFD.GetFD(), compressed.GetBuffer(), compressed.GetLength()) != (ssize_t) compressed.GetLength())
+            return false;
+    }
+
+    FS_Sync(dstFD.GetFD());
+    return true;
+}
+
+bool StorageLogArchiver::ReadArchiveFile(const char* src, const char* dst, bool uncompress)
+{
+    FDGuard         srcFD;
+    FDGuard         dstFD;
+    Buffer          buffer;
+    Buffer          compressed;
+    Buffer          head;
+    ReadBuffer      parse;
+    Compressor      compressor;
+    int64_t         size;
+    uint64_t        offset;
+    ssize_t         length;
+    uint32_t        compressedSize;
+    uint32_t        uncompressedSize;
+    uint32_t        checksum;
+
+    if (srcFD.Open(src, FS_READONLY) == INVALID_FD)
+        return false;
+    if (dstFD.Open(dst, FS_CREATE | FS_WRITEONLY | FS_TRUNCATE) == INVALID_FD)
+        return false;
+
+    size = FS_FileSize(srcFD.GetFD());
+    if (size < 0)
+        return false;
+
+    head.Allocate(STORAGE_ARCHIVE_BLOCK_HEAD_SIZE);
+    buffer.Allocate(STORAGE_ARCHIVE_BLOCK_SIZE);
+    offset = 0;
+    while (offset < (uint64_t) size)
+    {
+        if (!uncompress)
+        {
+            length = (ssize_t) MIN((uint64_t) size - offset, STORAGE_ARCHIVE_BLOCK_SIZE);
+            if (FS_FileReadOffs(srcFD.GetFD(), buffer.GetBuffer(), length, offset) != length)
+                return false;
+            if (FS_FileWrite(dstFD.GetFD(), buffer.GetBuffer(), length) != length)
+                return false;
+            offset += length;
+            continue;
+        }
+
+        if ((uint64_t) size - offset < STORAGE_ARCHIVE_BLOCK_HEAD_SIZE ||
+         FS_FileReadOffs(srcFD.GetFD(), head.GetBuffer(), STORAGE_ARCHIVE_BLOCK_HEAD_SIZE, offset) != STORAGE_ARCHIVE_BLOCK_HEAD_SIZE)
+        {
+            Log_Message("Truncated block head in archived log segment %s", src);
+            return false;
+        }
+        offset += STORAGE_ARCHIVE_BLOCK_HEAD_SIZE;
+
+        head.SetLength(STORAGE_ARCHIVE_BLOCK_HEAD_SIZE);
+        parse.Wrap(head);
+        parse.ReadLittle32(compressedSize);
+        parse.Advance(sizeof(uint32_t));
+        parse.ReadLittle32(uncompressedSize);
+        parse.Advance(sizeof(uint32_t));
+        parse.ReadLittle32(checksum);
+        if (uncompressedSize > STORAGE_ARCHIVE_BLOCK_SIZE || compressedSize > (uint64_t) size - offset)
+        {
+            Log_Message("Invalid block head in archived log segment %s", src);
+            return false;
+        }
+
+        compressed.Allocate(compressedSize);
+        if (FS_FileReadOffs(srcFD.GetFD(), compressed.GetBuffer(), compressedSize, offset) != (ssize_t) compressedSize)
+            return false;
+        compressed.SetLength(compressedSize);
+        offset += compressedSize;
+
+        if (!compressor.Uncompress(ReadBuffer(compressed), buffer, uncompressedSize) ||
+         buffer.GetLength() != uncompressedSize ||
+         ReadBuffer(buffer).GetChecksum() != checksum)
+        {
+            Log_Message("Corrupt block in archived log segment %s", src);
+            return false;
+        }
+
+        if (FS_FileWrite(dstFD.GetFD(), buffer.GetBuffer(), uncompressedSize) != (ssize_t) uncompressedSize)
+            return false;
+    }
+
+    FS_Sync(dstFD.GetFD());
+    return true;
+}
@@ -0,0 +1,46 @@
+#ifndef STORAGELOGARCHIVER_H
+#define STORAGELOGARCHIVER_H
+
+#include "System/Buffers/Buffer.h"
+
+#define STORAGE_ARCHIVE_BLOCK_SIZE              (1*MiB)
+#define STORAGE_ARCHIVE_BLOCK_HEAD_SIZE         12      // compressed size, uncompressed size, CRC
+#define STORAGE_ARCHIVE_COMPRESSED_EXTENSION    ".lz"
+
+/*
+===============================================================================================
+
+ StorageLogArchiver
+
+ Built-in archiver used with database.archiveScript = $archive. Finished log segments are
+ moved to the archive directory by rename, or copied if the archive is on another device.
+ With database.archiveCompression they are written as a sequence of compressed blocks,
+ each prefixed by its compressed size, uncompressed size and the CRC of the uncompressed
+ data. The oldest archived segments are deleted when the archive exceeds
+ database.archiveMaxSize bytes, or they are older than database.archiveMaxAge seconds.
+
+ Restore() writes an archived segment back as a plain log segment, uncompressing and
+ checking the blocks of a compressed one.
+
+===============================================================================================
+*/
+
+class StorageLogArchiver
+{
+public:
+    static void             Init(Buffer& archivePath);
+    static void             Shutdown();
+
+    static bool             Archive(Buffer& filename, uint64_t trackID, uint64_t logSegmentID);
+    static void             ApplyRetention();
+    static bool             Restore(const char* src, const char* dst);
+
+    static unsigned         GetNumFiles();
+    static uint64_t         GetSize();
+
+private:
+    static bool             WriteArchiveFile(const char* src, const char* dst, bool compress);
+    static bool             ReadArchiveFile(const char* src, const char* dst, bool uncompress);
+};
+
+#endif
@@ -0,0 +1,251 @@
+#include "StorageManifest.h"
+#include "StorageEnvironment.h"
+#include "StorageEnvironmentWriter.h"
+#include "System/FileSystem.h"
+#include "System/Config.h"
+
+StorageManifest::StorageManifest()
+{
+    env = NULL;
+    numEdits = 0;
+    size = 0;
+    snapshotSize = 0;
+    compactionSize = STORAGE_MANIFEST_DEFAULT_COMPACTION_SIZE;
+    numCompactions = 0;
+    needCompaction = true;
+}
+
+void StorageManifest::Open(StorageEnvironment* env_)
+{
+    env = env_;
+
+    filename.Write(env->envPath);
+    filename.Append("manifest");
+    filename.NullTerminate();
+
+    compactionSize = configFile.GetInt64Value("database.manifestCompactionSize",
+     STORAGE_MANIFEST_DEFAULT_COMPACTION_SIZE);
+
+    // the manifest has already been replayed by StorageRecovery,
+    // the first Write() will write a new TOC and truncate it
+    needCompaction = true;
+    batch.Clear();
+    numEdits = 0;
+}
+
+void StorageManifest::Close()
+{
+    fd.Close();
+}
+
+bool StorageManifest::Write()
+{
+    StorageShard*   shard;
+    Buffer          header;
+    ReadBuffer      dataPart;
+    uint32_t        checksum;
+    ssize_t         writeSize;
+
+    if (needCompaction || (size > compactionSize && size > snapshotSize))
+        return Compact();
+
+    FOREACH (shard, env->shards)
+        WriteEdits(shard);
+
+    if (numEdits == 0)
+        return true;
+
+    // batch header: size, checksum, numEdits
+    header.AppendLittle32(STORAGE_MANIFEST_BATCH_HEADER_SIZE + batch.GetLength());
+    header.AppendLittle32(0);
+    header.AppendLittle32(numEdits);
+    header.Append(batch);
+    dataPart.Wrap(header.GetBuffer() + 8, header.GetLength() - 8);
+    checksum = dataPart.GetChecksum();
+    header.SetLength(4);
+    header.AppendLittle32(checksum);
+    header.SetLength(STORAGE_MANIFEST_BATCH_HEADER_SIZE + batch.GetLength());
+
+    batch.Clear();
+    numEdits = 0;
+
+    writeSize = header.GetLength();
+    if (FS_FileWriteOffs(fd.GetFD(), header.GetBuffer(), writeSize, size) != writeSize)
+        return false;
+    StorageEnvironment::Sync(fd.GetFD());
+    size += writeSize;
+
+    return true;
+}
+
+void StorageManifest::OnDeleteShard(StorageShard* shard)
+{
+    if (needCompaction)
+        return;
+
+    AppendEdit(STORAGE_MANIFEST_EDIT_DELETE_SHARD, shard->GetContextID(), shard->GetShardID());
+}
+
+uint64_t StorageManifest::GetSize()
+{
+    return size;
+}
+
+uint64_t StorageManifest::GetNumCompactions()
+{
+    return numCompactions;
+}
+
+void StorageManifest::WriteShardMeta(StorageShard* shard, Buffer& buffer)
+{
+    ReadBuffer      firstKey, lastKey;
+
+    firstKey = shard->GetFirstKey();
+    lastKey = shard->GetLastKey();
+
+    buffer.AppendLittle64(shard->GetTrackID());
+    buffer.AppendLittle16(shard->GetContextID());
+    buffer.AppendLittle64(shard->GetTableID());
+    buffer.AppendLittle64(shard->GetShardID());
+    buffer.AppendLittle64(shard->GetLogSegmentID());
+    buffer.AppendLittle32(shard->GetLogCommandID());
+    buffer.Appendf("%#R", &firstKey);
+    buffer.Appendf("%#R", &lastKey);
+    buffer.Appendf("%b", shard->UseBloomFilter());
+    buffer.Appendf("%c", shard->GetStorageType());
+}
+
+uint32_t StorageManifest::WriteShardChunkIDs(StorageShard* shard, Buffer& buffer)
+{
+    uint32_t        numChunks;
+    StorageChunk**  itChunk;
+
+    // only written chunks are in the TOC, the rest are recovered from the logs
+    numChunks = 0;
+    FOREACH (itChunk, shard->GetChunks())
+    {
+        if ((*itChunk)->GetChunkState() == StorageChunk::Written)
+        {
+            numChunks++;
+            buffer.AppendLittle64((*itChunk)->GetChunkID());
+        }
+    }
+
+    return numChunks;
+}
+
+bool StorageManifest::Compact()
+{
+    StorageEnvironmentWriter    writer;
+    StorageShard*               shard;
+    Buffer                      toc;
+    Buffer                      header;
+
+    if (!writer.Write(env))
+        return false;
+
+    // the TOC contains every edit, so the manifest can be truncated
+    fd.Close();
+    if (fd.Open(filename.GetBuffer(), FS_CREATE | FS_WRITEONLY | FS_TRUNCATE) == INVALID_FD)
+        return false;
+
+    header.AppendLittle32(STORAGE_MANIFEST_VERSION);
+    header.AppendLittle32(writer.GetChecksum());
+    if (FS_FileWrite(fd.GetFD(), header.GetBuffer(), header.GetLength()) != (ssize_t) header.GetLength())
+        return false;
+    StorageEnvironment::Sync(fd.GetFD());
+
+    FOREACH (shard, env->shards)
+    {
+        shard->manifestMeta.Clear();
+        WriteShardMeta(shard, shard->manifestMeta);
+        shard->manifestChunkIDs.Clear();
+        WriteShardChunkIDs(shard, shard->manifestChunkIDs);
+    }
+
+    toc.Write(env->envPath);
+    toc.Append("toc");
+    toc.NullTerminate();
+    snapshotSize = FS_FileSize(toc.GetBuffer());
+
+    batch.Clear();
+    numEdits = 0;
+    size = header.GetLength();
+    numCompactions++;
+    needCompaction = false;
+
+    return true;
+}
+
+void StorageManifest::WriteEdits(StorageShard* shard)
+{
+    uint32_t    numChunks;
+    unsigned    i;
+    uint64_t    chunkID;
+    ReadBuffer  oldIDs, newIDs;
+
+    meta.Clear();
+    WriteShardMeta(shard, meta);
+    chunkIDs.Clear();
+    numChunks = WriteShardChunkIDs(shard, chunkIDs);
+
+    if (Buffer::Cmp(meta, shard->manifestMeta) != 0)
+    {
+        // new or split shard, write the whole record in TOC format
+        batch.Append(STORAGE_MANIFEST_EDIT_SHARD);
+        batch.Append(meta);
+        batch.AppendLittle32(numChunks);
+        batch.Append(chunkIDs);
+        numEdits++;
+    }
+    else if (Buffer::Cmp(chunkIDs, shard->manifestChunkIDs) != 0)
+    {
+        // chunks are ordered by log position, not ID, but a shard has few chunks
+        oldIDs.Wrap(shard->manifestChunkIDs);
+        newIDs.Wrap(chunkIDs);
+        for (i = 0; i < oldIDs.GetLength(); i += 8)
+        {
+            chunkID = FromLittle64(*(uint64_t*) (oldIDs.GetBuffer() + i));
+            if (!ContainsChunkID(newIDs, chunkID))
+            {
+                AppendEdit(STORAGE_MANIFEST_EDIT_REMOVE_CHUNK, shard->GetContextID(), shard->GetShardID());
+                batch.AppendLittle64(chunkID);
+            }
+        }
+        for (i = 0; i < newIDs.GetLength(); i += 8)
+        {
+            chunkID = FromLittle64(*(uint64_t*) (newIDs.GetBuffer() + i));
+            if (!ContainsChunkID(oldIDs, chunkID))
+            {
+                AppendEdit(STORAGE_MANIFEST_EDIT_ADD_CHUNK, shard->GetContextID(), shard->GetShardID());
+                batch.AppendLittle64(chunkID);
+            }
+        }
+    }
+    else
+        return;
+
+    shard->manifestMeta.Write(meta);
+    shard->manifestChunkIDs.Write(chunkIDs);
+}
+
+void StorageManifest::AppendEdit(char type, uint16_t contextID, uint64_t shardID)
+{
+    batch.Append(type);
+    batch.AppendLittle16(contextID);
+    batch.AppendLittle64(shardID);
+    numEdits++;
+}
+
+bool StorageManifest::ContainsChunkID(ReadBuffer& chunkIDs, uint64_t chunkID)
+{
+    unsigned    i;
+
+    for (i = 0; i < chunkIDs.GetLength(); i += 8)
+    {
+        if (FromLittle64(*(uint64_t*) (chunkIDs.GetBuffer() + i)) == chunkID)
+            return true;
+    }
+
+    return false;
+}
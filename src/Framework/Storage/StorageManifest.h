@@ -0,0 +1,72 @@
+#ifndef STORAGEMANIFEST_H
+#define STORAGEMANIFEST_H
+
+#include "System/Buffers/Buffer.h"
+#include "FDGuard.h"
+
+class StorageEnvironment;   // forward
+class StorageShard;         // forward
+
+#define STORAGE_MANIFEST_EDIT_SHARD             'S'     // create or split, full shard record
+#define STORAGE_MANIFEST_EDIT_DELETE_SHARD      'D'
+#define STORAGE_MANIFEST_EDIT_ADD_CHUNK         'A'
+#define STORAGE_MANIFEST_EDIT_REMOVE_CHUNK      'R'
+
+#define STORAGE_MANIFEST_VERSION                1
+#define STORAGE_MANIFEST_HEADER_SIZE            8       // version, TOC checksum
+#define STORAGE_MANIFEST_BATCH_HEADER_SIZE      12      // size, checksum, numEdits
+#define STORAGE_MANIFEST_DEFAULT_COMPACTION_SIZE    (1*MiB)
+
+/*
+===============================================================================================
+
+ StorageManifest
+
+ Instead of rewriting the whole TOC on every change, the changes since the last TOC
+ are appended to the manifest file as edits. Each WriteTOC() call appends one checksummed
+ batch of edits, which is applied atomically on recovery. When the manifest grows larger
+ than the last TOC (and the compaction size), the TOC is rewritten and the manifest
+ is truncated. The manifest header stores the checksum of the TOC it was started on,
+ so a manifest left behind by a crash during compaction is not replayed.
+
+===============================================================================================
+*/
+
+class StorageManifest
+{
+public:
+    StorageManifest();
+
+    void                    Open(StorageEnvironment* env);
+    void                    Close();
+
+    bool                    Write();
+    void                    OnDeleteShard(StorageShard* shard);
+
+    uint64_t                GetSize();
+    uint64_t                GetNumCompactions();
+
+    static void             WriteShardMeta(StorageShard* shard, Buffer& buffer);
+    static uint32_t         WriteShardChunkIDs(StorageShard* shard, Buffer& buffer);
+
+private:
+    bool                    Compact();
+    void                    WriteEdits(StorageShard* shard);
+    void                    AppendEdit(char type, uint16_t contextID, uint64_t shardID);
+    static bool             ContainsChunkID(ReadBuffer& chunkIDs, uint64_t chunkID);
+
+    StorageEnvironment*     env;
+    Buffer                  filename;
+    FDGuard                 fd;
+    Buffer                  batch;
+    Buffer                  meta;
+    Buffer                  chunkIDs;
+    unsigned                numEdits;
+    uint64_t                size;
+    uint64_t                snapshotSize;
+    uint64_t                compactionSize;
+    uint64_t                numCompactions;
+    bool                    needCompaction;
+};
+
+#endif
@@ -29,6 +29,7 @@ StorageMemoChunk::StorageMemoChunk(uint64_t chunkID_, bool useBloomFilter_)
 {
     chunkID = chunkID_;
     useBloomFilter = useBloomFilter_;
+    valueLogThreshold = 0;
 
     serialized = false;
     minLogSegmentID = 0;
@@ -275,6 +276,11 @@ StorageFileChunk* StorageMemoChunk::RemoveFileChunk()
     return ret;
 }
 
+void StorageMemoChunk::SetValueLogThreshold(uint32_t valueLogThreshold_)
+{
+    valueLogThreshold = valueLogThreshold_;
+}
+
 void StorageMemoChunk::RemoveFirst()
 {
     StorageMemoKeyValueBlock*   block;
@@ -87,6 +87,9 @@ public:
     
     StorageFileChunk*       RemoveFileChunk();
 
+    // values larger than this are moved to the value log on serialization
+    void                    SetValueLogThreshold(uint32_t valueLogThreshold);
+
     void                    RemoveFirst(); // for logstorage
 
     StorageMemoKeyValue*    NewStorageMemoKeyValue();
@@ -102,6 +105,7 @@ private:
     uint64_t                maxLogSegmentID;
     uint32_t                maxLogCommandID;
     bool                    useBloomFilter;
+    uint32_t                valueLogThreshold;
     uint64_t                size;
     double                  avgSize;
     KeyValueTree            keyValues;
@@ -50,7 +50,8 @@ void StorageMergeChunkJob::Execute()
      filenames.GetLength(),
      mergeChunk->GetChunkID());
     sw.Start();
-    ret = merger.Merge(env, filenames, mergeChunk, firstKey, lastKey);
+    ret = merger.Merge(env, filenames, mergeChunk, firstKey, lastKey,
+     &valueLogGarbage, &valueLogRelocated);
     sw.Stop();
 
     if (mergeChunk->writeError)
@@ -4,6 +4,7 @@
 #include "System/Threading/Job.h"
 #include "System/Containers/List.h"
 #include "System/Buffers/Buffer.h"
+#include "StorageValueLog.h"
 
 class StorageEnvironment;
 class StorageFileChunk;
@@ -37,6 +38,8 @@ public:
     List<StorageFileChunk*> inputChunks;
     Buffer                  firstKey;
     Buffer                  lastKey;
+    StorageValueLogGarbage  valueLogGarbage;
+    StorageValueLogGarbage  valueLogRelocated;
 };
 
 #endif
@@ -6,6 +6,8 @@
 #include "System/PointerGuard.h"
 #include "StorageChunkSerializer.h"
 #include "StorageChunkWriter.h"
+#include "StorageValueLog.h"
+#include "StorageFileDeleter.h"
 
 static bool LessThan(const Buffer* a, const Buffer* b)
 {
@@ -22,8 +24,10 @@ bool StorageRecovery::TryRecovery(StorageEnvironment* env_)
     FS_DirEntry         entry;
     List<uint64_t>      replayedTrackIDs;
     Stopwatch           replayStopwatch;
+    bool                hasTOC;
     
     env = env_;
+    tocChecksum = 0;
     
     toc.Write(env->envPath);
     toc.Append("toc");
@@ -31,6 +35,7 @@ bool StorageRecovery::TryRecovery(StorageEnvironment* env_)
     tocNew.Write(env->envPath);
     tocNew.Append("toc.new");
     tocNew.NullTerminate();
+    hasTOC = true;
     if (TryReadTOC(tocNew))
     {
         FS_Delete(toc.GetBuffer());
@@ -39,11 +44,18 @@ bool StorageRecovery::TryRecovery(StorageEnvironment* env_)
     else
     {
         if (!TryReadTOC(toc))
-            return false;
+            hasTOC = false;
         
         FS_Delete(tocNew.GetBuffer());
     }
     
+    // apply the edits written since the last TOC
+    if (!TryReadManifest() && !hasTOC)
+        return false;
+    
+    // chunk headers are only read once the final chunk lists are known,
+    // because chunks removed by the manifest may no longer exist
+    CreateFileChunks();
     CreateMemoChunks(); 
     
     // compute the max. (logSegmentID, commandID) for each shard's chunk
@@ -87,6 +99,7 @@ bool StorageRecovery::TryRecovery(StorageEnvironment* env_)
     FS_CloseDir(dir);
     DeleteOrphanedChunks();
     DeleteOrphanedTracks();
+    ComputeValueLogGarbage();
     
     return true;
 }
@@ -135,13 +148,12 @@ bool StorageRecovery::TryReadTOC(Buffer& filename)
     if (compChecksum != checksum)
         return false;
     parse.Advance(4);
+    tocChecksum = checksum;
 
     parse.ReadLittle32(version);
     parse.Advance(4);
 
-    Log_Message("Opening chunk files...");
     ReadShards(version, parse);
-    Log_Message("Opening done.");
     
     fd.Close();
     
@@ -178,7 +190,6 @@ bool StorageRecovery::ReadShardVersion1(ReadBuffer& parse)
     uint32_t            numChunks, i;
     uint64_t            chunkID;
     StorageShard*       shard;
-    StorageFileChunk*   fileChunk;
 
     PointerGuard<StorageShard> shardGuard(new StorageShard);
     
@@ -211,6 +222,7 @@ bool StorageRecovery::ReadShardVersion1(ReadBuffer& parse)
         return false;
     parse.Advance(4);
 
+    // the file chunks are created by CreateFileChunks()
     for (i = 0; i < numChunks; i++)
     {
         if (!parse.ReadLittle64(chunkID))
@@ -220,28 +232,206 @@ bool StorageRecovery::ReadShardVersion1(ReadBuffer& parse)
         if (chunkID >= env->nextChunkID)
             env->nextChunkID = chunkID + 1;
         
-        fileChunk = env->GetFileChunk(chunkID);
+        shard->manifestChunkIDs.AppendLittle64(chunkID);
+    }
 
-        if (fileChunk == NULL)
-        {
-            fileChunk = new StorageFileChunk;
+    PutShard(shardGuard.Release());
+    
+    return true;
+}
 
-            fileChunk->SetFilename(env->chunkPath, chunkID);
-            fileChunk->written = true;
-            
-            fileChunk->ReadHeaderPage();
-            
-            env->fileChunks.Append(fileChunk);
+bool StorageRecovery::TryReadManifest()
+{
+    uint32_t    version, checksum, size, numEdits, i;
+    int64_t     fileSize;
+    unsigned    numBatches;
+    Buffer      filename;
+    Buffer      buffer;
+    ReadBuffer  parse, batch, dataPart;
+    FDGuard     fd;
+    
+    filename.Write(env->envPath);
+    filename.Append("manifest");
+    filename.NullTerminate();
+    
+    if (fd.Open(filename.GetBuffer(), FS_READONLY) == INVALID_FD)
+        return false;
+    
+    fileSize = FS_FileSize(fd.GetFD());
+    if (fileSize < STORAGE_MANIFEST_HEADER_SIZE)
+        return false;
+    
+    buffer.Allocate(fileSize);
+    if (FS_FileRead(fd.GetFD(), buffer.GetBuffer(), fileSize) != (ssize_t) fileSize)
+        return false;
+    buffer.SetLength(fileSize);
+    fd.Close();
+    
+    parse.Wrap(buffer);
+    parse.ReadLittle32(version);
+    parse.Advance(4);
+    if (version > STORAGE_MANIFEST_VERSION)
+        STOP_FAIL(1, "Manifest file version is newer than current ScalienDB version!");
+    
+    // the manifest belongs to an older TOC, its edits are already in the TOC
+    parse.ReadLittle32(checksum);
+    parse.Advance(4);
+    if (checksum != tocChecksum)
+        return false;
+    
+    numBatches = 0;
+    while (parse.GetLength() >= STORAGE_MANIFEST_BATCH_HEADER_SIZE)
+    {
+        parse.ReadLittle32(size);
+        if (size < STORAGE_MANIFEST_BATCH_HEADER_SIZE || size > parse.GetLength())
+            break;
+        
+        // a torn batch at the end was never acknowledged, skip it
+        dataPart.Wrap(parse.GetBuffer() + 8, size - 8);
+        parse.Advance(4);
+        parse.ReadLittle32(checksum);
+        if (dataPart.GetChecksum() != checksum)
+            break;
+        
+        batch.Wrap(parse.GetBuffer() + 8, size - 12);
+        parse.Advance(size - 4);
+        
+        dataPart.ReadLittle32(numEdits);
+        for (i = 0; i < numEdits; i++)
+        {
+            if (!ReplayManifestEdit(batch))
+            {
+                Log_Message("Unable to parse manifest edit in %s", filename.GetBuffer());
+                Log_Message("This should not happen.");
+                Log_Message("Possible causes: software bug, corrupted file...");
+                STOP_FAIL(1);
+            }
         }
         
-        shard->chunks.Add(fileChunk);
+        numBatches++;
     }
+    
+    Log_Message("Replayed %u batches from the manifest.", numBatches);
+    
+    return true;
+}
 
-    env->shards.Append(shardGuard.Release());
+bool StorageRecovery::ReplayManifestEdit(ReadBuffer& parse)
+{
+    char            type;
+    uint16_t        contextID;
+    uint64_t        shardID;
+    uint64_t        chunkID;
+    uint64_t        id;
+    unsigned        i;
+    Buffer          chunkIDs;
+    StorageShard*   shard;
+    
+    if (!parse.ReadChar(type))
+        return false;
+    parse.Advance(1);
+    
+    if (type == STORAGE_MANIFEST_EDIT_SHARD)
+        return ReadShardVersion1(parse);
+    
+    if (!parse.ReadLittle16(contextID))
+        return false;
+    parse.Advance(2);
+    if (!parse.ReadLittle64(shardID))
+        return false;
+    parse.Advance(8);
+    
+    shard = env->GetShard(contextID, shardID);
+    
+    switch (type)
+    {
+        case STORAGE_MANIFEST_EDIT_DELETE_SHARD:
+            if (shard != NULL)
+            {
+                env->shards.Remove(shard);
+                delete shard;
+            }
+            break;
+        case STORAGE_MANIFEST_EDIT_ADD_CHUNK:
+            if (!parse.ReadLittle64(chunkID))
+                return false;
+            parse.Advance(8);
+            if (chunkID >= env->nextChunkID)
+                env->nextChunkID = chunkID + 1;
+            if (shard != NULL)
+                shard->manifestChunkIDs.AppendLittle64(chunkID);
+            break;
+        case STORAGE_MANIFEST_EDIT_REMOVE_CHUNK:
+            if (!parse.ReadLittle64(chunkID))
+                return false;
+            parse.Advance(8);
+            if (shard == NULL)
+                break;
+            for (i = 0; i < shard->manifestChunkIDs.GetLength(); i += 8)
+            {
+                id = FromLittle64(*(uint64_t*) (shard->manifestChunkIDs.GetBuffer() + i));
+                if (id != chunkID)
+                    chunkIDs.AppendLittle64(id);
+            }
+            shard->manifestChunkIDs.Write(chunkIDs);
+            break;
+        default:
+            return false;
+    }
     
     return true;
 }
 
+void StorageRecovery::PutShard(StorageShard* shard)
+{
+    StorageShard*   oldShard;
+    
+    // a shard record in the manifest replaces the previous one
+    oldShard = env->GetShard(shard->GetContextID(), shard->GetShardID());
+    if (oldShard != NULL)
+    {
+        env->shards.Remove(oldShard);
+        delete oldShard;
+    }
+    
+    env->shards.Append(shard);
+}
+
+void StorageRecovery::CreateFileChunks()
+{
+    unsigned            i;
+    uint64_t            chunkID;
+    StorageShard*       shard;
+    StorageFileChunk*   fileChunk;
+    
+    Log_Message("Opening chunk files...");
+    FOREACH (shard, env->shards)
+    {
+        for (i = 0; i < shard->manifestChunkIDs.GetLength(); i += 8)
+        {
+            chunkID = FromLittle64(*(uint64_t*) (shard->manifestChunkIDs.GetBuffer() + i));
+            fileChunk = env->GetFileChunk(chunkID);
+            
+            if (fileChunk == NULL)
+            {
+                fileChunk = new StorageFileChunk;
+
+                fileChunk->SetFilename(env->chunkPath, chunkID);
+                fileChunk->written = true;
+                
+                fileChunk->ReadHeaderPage();
+                
+                env->fileChunks.Append(fileChunk);
+            }
+            
+            shard->chunks.Add(fileChunk);
+        }
+        
+        shard->manifestChunkIDs.Clear();
+    }
+    Log_Message("Opening done.");
+}
+
 void StorageRecovery::CreateMemoChunks()
 {
     StorageShard* it;
@@ -745,7 +935,7 @@ void StorageRecovery::DeleteOrphanedChunks()
                 tmp.Append(filename);
                 Log_Debug("Deleting orphaned chunk file %B...", &tmp);
                 tmp.NullTerminate();
-                FS_Delete(tmp.GetBuffer());
+                StorageFileDeleter::Delete(tmp.GetBuffer());
             }
         }
     }
@@ -755,6 +945,28 @@ void StorageRecovery::DeleteOrphanedChunks()
     FS_CloseDir(dir);
 }
 
+// the garbage counts of the value log are not persisted, because the merges and
+// the deleted shards make values unreachable only after their TOC edits
+void StorageRecovery::ComputeValueLogGarbage()
+{
+    StorageFileChunk*       itChunk;
+    StorageValueLogGarbage  referenced;
+    Stopwatch               sw;
+
+    if (!env->valueLog.IsEnabled())
+        return;
+
+    Log_Message("Computing value log garbage...");
+
+    sw.Start();
+    FOREACH (itChunk, env->fileChunks)
+        referenced.Add(itChunk);
+    env->valueLog.SetReferenced(referenced);
+    sw.Stop();
+
+    Log_Message("Computing done, elapsed: %U", (uint64_t) sw.Elapsed());
+}
+
 void StorageRecovery::DeleteOrphanedTracks()
 {
     StorageEnvironment::Track*  track;
@@ -905,6 +1117,7 @@ void StorageRecovery::TryWriteChunks()
             Log_Debug("Serializing chunk %U, size: %s", memoChunk->GetChunkID(),
                 HumanBytes(memoChunk->GetSize(), humanBuf));
 
+            memoChunk->SetValueLogThreshold(env->valueLog.GetThreshold(shard));
             shard->PushMemoChunk(new StorageMemoChunk(env->nextChunkID++, shard->UseBloomFilter()));
 
             // from StorageSerializeChunkJob::Execute()
@@ -25,6 +25,10 @@ private:
     bool                    TryReadTOC(Buffer& filename);
     bool                    ReadShards(uint32_t version, ReadBuffer& parse);
     bool                    ReadShardVersion1(ReadBuffer& parse);
+    bool                    TryReadManifest();
+    bool                    ReplayManifestEdit(ReadBuffer& parse);
+    void                    PutShard(StorageShard* shard);
+    void                    CreateFileChunks();
     void                    CreateMemoChunks();
     void                    ComputeShardRecovery();
     ReadBuffer              ReadFromFileBuffer(FD fd, uint64_t len);
@@ -33,6 +37,7 @@ private:
     bool                    ReplayLogSegmentOpt(uint64_t trackID, Buffer& filename);
     void                    DeleteOrphanedChunks();
     void                    DeleteOrphanedTracks();
+    void                    ComputeValueLogGarbage();
     
     void                    ExecuteSet(
                              uint64_t logSegmentID, uint32_t logCommandID,
@@ -48,6 +53,7 @@ private:
 
     StorageEnvironment*     env;
     Buffer                  fileBuffer;
+    uint32_t                tocChecksum;
     uint64_t                fileBufferPos;
     uint64_t                replayBytes;
     uint64_t                replayTime;
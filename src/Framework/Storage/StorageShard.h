@@ -25,6 +25,7 @@ class StorageShard
 {
     friend class StorageRecovery;
     friend class StorageBulkCursor;
+    friend class StorageManifest;
     
 public:
     typedef SortedList<StorageChunk*> ChunkList;
@@ -99,6 +100,9 @@ private:
     uint64_t            recoveryLogSegmentID; // only used
     uint32_t            recoveryLogCommandID; // during log recovery
 
+    Buffer              manifestMeta;       // last state written
+    Buffer              manifestChunkIDs;   // to the manifest
+
     // optimizations
     uint64_t            cachedSize;
     Buffer              cachedMidpoint;
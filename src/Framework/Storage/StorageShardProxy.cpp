@@ -13,7 +13,13 @@ void StorageShardProxy::Init(StorageEnvironment* environment_,
 
 bool StorageShardProxy::Get(ReadBuffer key, ReadBuffer& value)
 {
-    return environment->Get(contextID, shardID, key, value);
+    bool    ret;
+    bool    failed;
+
+    // the paxos and log shards are never stored in the value log
+    ret = environment->Get(contextID, shardID, key, value, valueBuffer, failed);
+    ASSERT(!failed);
+    return ret;
 }
 
 bool StorageShardProxy::Set(ReadBuffer key, ReadBuffer value)
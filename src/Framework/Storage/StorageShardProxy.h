@@ -2,7 +2,7 @@
 #define STORAGESHARDPROXY_H
 
 #include "System/Platform.h"
-#include "System/Buffers/ReadBuffer.h"
+#include "System/Buffers/Buffer.h"
 
 class StorageEnvironment;
 
@@ -26,6 +26,7 @@ private:
     uint16_t                contextID;
     uint64_t                shardID;
     uint64_t                trackID;
+    Buffer                  valueBuffer;
 };
 
 #endif
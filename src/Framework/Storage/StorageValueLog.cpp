@@ -0,0 +1,642 @@
+#include "StorageValueLog.h"
+#include "StorageShard.h"
+#include "StorageDataPage.h"
+#include "StorageFileChunk.h"
+#include "StorageChunkReader.h"
+#include "StorageFileDeleter.h"
+#include "System/FileSystem.h"
+#include "System/Config.h"
+#include "System/Registry.h"
+
+#define STORAGE_VALUELOG_PRELOAD_SIZE   (1*MB)
+
+/*
+===============================================================================================
+
+ StorageValueLogSegment
+
+===============================================================================================
+*/
+
+StorageValueLogSegment::StorageValueLogSegment()
+{
+    segmentID = 0;
+    size = 0;
+    garbageSize = 0;
+    retireEpoch = 0;
+    numReaders = 0;
+    draining = false;
+    synced = true;
+    fd = INVALID_FD;
+    prev = next = this;
+}
+
+StorageValueLogSegment::~StorageValueLogSegment()
+{
+    if (fd != INVALID_FD)
+        FS_FileClose(fd);
+}
+
+/*
+===============================================================================================
+
+ StorageValueLogGarbage
+
+===============================================================================================
+*/
+
+void StorageValueLogGarbage::Add(ReadBuffer pointer)
+{
+    uint64_t    segmentID;
+    uint64_t    offset;
+    uint32_t    length;
+
+    if (!StorageValueLog::ParsePointer(pointer, segmentID, offset, length))
+        return;
+
+    Add(segmentID, length);
+}
+
+void StorageValueLogGarbage::Add(uint64_t segmentID, uint64_t length)
+{
+    Item*   it;
+    Item    item;
+
+    FOREACH (it, items)
+    {
+        if (it->segmentID == segmentID)
+        {
+            it->length += length;
+            return;
+        }
+    }
+
+    item.segmentID = segmentID;
+    item.length = length;
+    items.Append(item);
+}
+
+void StorageValueLogGarbage::Add(StorageDataPage* dataPage)
+{
+    StorageFileKeyValue*    it;
+
+    FOREACH (it, *dataPage)
+    {
+        if (it->IsValueLogged())
+            Add(it->GetValue());
+    }
+}
+
+void StorageValueLogGarbage::Add(StorageFileChunk* chunk)
+{
+    StorageChunkReader  reader;
+    StorageDataPage*    dataPage;
+    uint32_t            i;
+
+    if (chunk->written)
+    {
+        reader.Open(ReadBuffer(chunk->GetFilename()), STORAGE_VALUELOG_PRELOAD_SIZE);
+        for (dataPage = reader.FirstDataPage(); dataPage != NULL; dataPage = reader.NextDataPage())
+            Add(dataPage);
+    }
+    else
+    {
+        // the pages of an unwritten chunk are in memory
+        for (i = 0; i < chunk->numDataPages; i++)
+        {
+            if (chunk->dataPages[i] != NULL)
+                Add(chunk->dataPages[i]);
+        }
+    }
+}
+
+void StorageValueLogGarbage::Commit(StorageValueLog* valueLog)
+{
+    Item*   it;
+
+    FOREACH (it, items)
+        valueLog->AddGarbage(it->segmentID, it->length);
+
+    items.Clear();
+}
+
+void StorageValueLogGarbage::Clear()
+{
+    items.Clear();
+}
+
+uint64_t StorageValueLogGarbage::GetLength(uint64_t segmentID)
+{
+    Item*   it;
+
+    FOREACH (it, items)
+    {
+        if (it->segmentID == segmentID)
+            return it->length;
+    }
+
+    return 0;
+}
+
+/*
+===============================================================================================
+
+ StorageValueLog
+
+===============================================================================================
+*/
+
+StorageValueLog::StorageValueLog()
+{
+    head = NULL;
+    threshold = 0;
+    segmentSize = STORAGE_VALUELOG_DEFAULT_SEGMENT_SIZE;
+    gcRatio = STORAGE_VALUELOG_DEFAULT_GC_RATIO;
+    epoch = 1;
+    numBytesAppended = NULL;
+    numBytesRead = NULL;
+    numBytesRelocated = NULL;
+    numSegmentsDeleted = NULL;
+}
+
+void StorageValueLog::Init(Buffer& envPath)
+{
+    FS_Dir                  dir;
+    FS_DirEntry             dirEntry;
+    const char*             name;
+    const char*             tableID;
+    unsigned                nread;
+    unsigned                i;
+    int                     numTables;
+    uint64_t                id;
+    uint64_t                segmentID;
+    StorageValueLogSegment* segment;
+    StorageValueLogSegment* it;
+
+    numBytesAppended = Registry::GetUintPtr("storage.valueLog.numBytesAppended");
+    numBytesRead = Registry::GetUintPtr("storage.valueLog.numBytesRead");
+    numBytesRelocated = Registry::GetUintPtr("storage.valueLog.numBytesRelocated");
+    numSegmentsDeleted = Registry::GetUintPtr("storage.valueLog.numSegmentsDeleted");
+
+    threshold = configFile.GetIntValue("database.valueLogThreshold", 0);
+    segmentSize = configFile.GetInt64Value("database.valueLogSegmentSize",
+     STORAGE_VALUELOG_DEFAULT_SEGMENT_SIZE);
+    gcRatio = configFile.GetIntValue("database.valueLogGCRatio", STORAGE_VALUELOG_DEFAULT_GC_RATIO);
+
+    tableIDs.Clear();
+    numTables = configFile.GetListNum("database.valueLogTables");
+    for (i = 0; i < (unsigned) numTables; i++)
+    {
+        tableID = configFile.GetListValue("database.valueLogTables", i, "");
+        id = BufferToUInt64(tableID, strlen(tableID), &nread);
+        if (nread == 0 || nread != strlen(tableID))
+        {
+            Log_Message("Invalid tableID in database.valueLogTables: %s", tableID);
+            continue;
+        }
+        tableIDs.Append(id);
+    }
+
+    valuePath.Write(envPath);
+    valuePath.Append("values/");
+
+    valuePath.NullTerminate();
+    if (!FS_IsDirectory(valuePath.GetBuffer()))
+    {
+        if (!FS_CreateDir(valuePath.GetBuffer()))
+        {
+            Log_Message("Unable to create value log directory: %s", valuePath.GetBuffer());
+            STOP_FAIL(1);
+        }
+    }
+    valuePath.SetLength(valuePath.GetLength() - 1); // drop the terminating zero
+
+    // open the existing segments in segmentID order
+    dir = FS_OpenDir(valuePath.GetBuffer());
+    if (dir == FS_INVALID_DIR)
+    {
+        Log_Message("Unable to open value log directory: %s", valuePath.GetBuffer());
+        STOP_FAIL(1);
+    }
+    while ((dirEntry = FS_ReadDir(dir)) != FS_INVALID_DIR_ENTRY)
+    {
+        name = FS_DirEntryName(dirEntry);
+        if (strncmp(name, "valuelog.", 9) != 0)
+            continue;
+        segmentID = BufferToUInt64(name + 9, strlen(name + 9), &nread);
+        if (nread == 0 || nread != strlen(name + 9))
+            continue;
+
+        segment = new StorageValueLogSegment;
+        segment->segmentID = segmentID;
+        SetSegmentFilename(segment);
+        segment->fd = FS_Open(segment->filename.GetBuffer(), FS_READWRITE);
+        if (segment->fd == INVALID_FD)
+        {
+            Log_Message("Unable to open value log segment: %s", segment->filename.GetBuffer());
+            STOP_FAIL(1);
+        }
+        segment->size = FS_FileSize(segment->fd);
+
+        FOREACH_BACK (it, segments)
+        {
+            if (it->segmentID < segmentID)
+                break;
+        }
+        if (it == NULL)
+            segments.Prepend(segment);
+        else
+            segments.InsertAfter(it, segment);
+    }
+    FS_CloseDir(dir);
+
+    // always start a new head segment, so that the sizes of the old segments are final
+    head = NULL;
+    if (threshold > 0 && tableIDs.GetLength() > 0)
+        head = CreateHead();
+}
+
+void StorageValueLog::Shutdown()
+{
+    MutexGuard  guard(mutex);
+
+    segments.DeleteList();
+    pins.Clear();
+    head = NULL;
+}
+
+bool StorageValueLog::IsEnabled()
+{
+    // pointers may exist even if no new values are appended
+    return segments.GetLength() > 0;
+}
+
+uint32_t StorageValueLog::GetThreshold(StorageShard* shard)
+{
+    uint64_t*   it;
+
+    if (head == NULL)
+        return 0;
+
+    if (shard->GetStorageType() != STORAGE_SHARD_TYPE_STANDARD)
+        return 0;
+
+    FOREACH (it, tableIDs)
+    {
+        if (*it == shard->GetTableID())
+            return threshold;
+    }
+
+    return 0;
+}
+
+bool StorageValueLog::Append(ReadBuffer value, Buffer& pointer)
+{
+    MutexGuard  guard(mutex);
+    uint64_t    offset;
+
+    ASSERT(head != NULL);
+
+    if (head->size > 0 && head->size + value.GetLength() > segmentSize)
+        head = CreateHead();
+
+    offset = head->size;
+    if (FS_FileWriteOffs(head->fd, value.GetBuffer(), value.GetLength(), offset) != (ssize_t) value.GetLength())
+    {
+        Log_Message("Unable to write value log segment: %s", head->filename.GetBuffer());
+        return false;
+    }
+
+    head->size += value.GetLength();
+    head->synced = false;
+    *numBytesAppended += value.GetLength();
+
+    pointer.Clear();
+    pointer.AppendLittle64(head->segmentID);
+    pointer.AppendLittle64(offset);
+    pointer.AppendLittle32(value.GetLength());
+
+    return true;
+}
+
+bool StorageValueLog::Read(ReadBuffer pointer, Buffer& value)
+{
+    uint64_t                segmentID;
+    uint64_t                offset;
+    uint32_t                length;
+    bool                    ret;
+    StorageValueLogSegment* segment;
+
+    if (!ParsePointer(pointer, segmentID, offset, length))
+        return false;
+
+    // the segment is not deleted and its fd is not closed while it has readers
+    mutex.Lock();
+    segment = FindSegment(segmentID);
+    if (segment != NULL)
+        segment->numReaders++;
+    mutex.Unlock();
+
+    if (segment == NULL)
+    {
+        Log_Message("Missing value log segment %U", segmentID);
+        return false;
+    }
+
+    ret = true;
+    value.Allocate(length);
+    if (FS_FileReadOffs(segment->fd, value.GetBuffer(), length, offset) != (ssize_t) length)
+    {
+        Log_Message("Unable to read value log segment %U at offset %U", segmentID, offset);
+        ret = false;
+    }
+    else
+    {
+        value.SetLength(length);
+        *numBytesRead += length;
+    }
+
+    mutex.Lock();
+    segment->numReaders--;
+    mutex.Unlock();
+
+    return ret;
+}
+
+bool StorageValueLog::Resolve(StorageKeyValue* kv, Buffer& buffer, ReadBuffer& value)
+{
+    if (!kv->IsValueLogged())
+    {
+        value = kv->GetValue();
+        return true;
+    }
+
+    if (!Read(kv->GetValue(), buffer))
+        return false;
+
+    value.Wrap(buffer);
+    return true;
+}
+
+bool StorageValueLog::IsDraining(ReadBuffer pointer)
+{
+    MutexGuard              guard(mutex);
+    uint64_t                segmentID;
+    uint64_t                offset;
+    uint32_t                length;
+    StorageValueLogSegment* segment;
+
+    if (head == NULL || !ParsePointer(pointer, segmentID, offset, length))
+        return false;
+
+    segment = FindSegment(segmentID);
+    if (segment == NULL || !segment->draining)
+        return false;
+
+    return true;
+}
+
+// copies the value from a draining segment to the head, the old pointer becomes garbage
+bool StorageValueLog::Relocate(ReadBuffer pointer, Buffer& value, Buffer& newPointer)
+{
+    if (!Read(pointer, value))
+        return false;
+    if (!Append(ReadBuffer(value), newPointer))
+        return false;
+
+    mutex.Lock();
+    *numBytesRelocated += value.GetLength();
+    mutex.Unlock();
+
+    return true;
+}
+
+uint64_t StorageValueLog::Pin()
+{
+    MutexGuard  guard(mutex);
+
+    if (segments.GetLength() == 0)
+        return 0;
+
+    pins.Append(epoch);
+    return epoch;
+}
+
+void StorageValueLog::Unpin(uint64_t pin)
+{
+    MutexGuard  guard(mutex);
+
+    if (pin == 0)
+        return;
+
+    pins.Remove(pin);
+}
+
+void StorageValueLog::Sync()
+{
+    StorageValueLogSegment* segment;
+    List<FD>                fds;
+    FD*                     itFD;
+
+    // collect under the lock, but sync outside of it, so that appends are not blocked
+    mutex.Lock();
+    FOREACH (segment, segments)
+    {
+        if (!segment->synced)
+        {
+            fds.Append(segment->fd);
+            segment->synced = true;
+        }
+    }
+    mutex.Unlock();
+
+    FOREACH (itFD, fds)
+    {
+#ifndef PLATFORM_WINDOWS
+        FS_Sync(*itFD);
+#endif
+    }
+}
+
+void StorageValueLog::AddGarbage(uint64_t segmentID, uint64_t length)
+{
+    MutexGuard              guard(mutex);
+    StorageValueLogSegment* segment;
+
+    segment = FindSegment(segmentID);
+    if (segment == NULL)
+        return;
+
+    segment->garbageSize += length;
+    if (segment->garbageSize > segment->size)
+        segment->garbageSize = segment->size;
+}
+
+// called after recovery, everything in the old segments that no chunk references is garbage
+void StorageValueLog::SetReferenced(StorageValueLogGarbage& referenced)
+{
+    MutexGuard              guard(mutex);
+    StorageValueLogSegment* segment;
+    uint64_t                length;
+
+    FOREACH (segment, segments)
+    {
+        if (segment == head)
+            continue;
+
+        // values shared by the chunks of split shards are counted more than once,
+        // which only delays the collection of the segment
+        length = referenced.GetLength(segment->segmentID);
+        if (length < segment->size)
+            segment->garbageSize = segment->size - length;
+        else
+            segment->garbageSize = 0;
+    }
+}
+
+void StorageValueLog::Collect()
+{
+    StorageValueLogSegment* segment;
+    char                    humanBuf[5];
+
+    if (!StorageFileDeleter::IsEnabled())
+        return;
+
+    mutex.Lock();
+    for (segment = segments.First(); segment != NULL; /* advanced in body */)
+    {
+        if (segment == head)
+        {
+            segment = segments.Next(segment);
+            continue;
+        }
+
+        if (segment->garbageSize >= segment->size)
+        {
+            // the readers pinned before the retirement may still hold pointers to it,
+            // the ones pinned later cannot see the chunks that referenced it
+            if (segment->retireEpoch == 0)
+                segment->retireEpoch = ++epoch;
+
+            if (segment->numReaders == 0 && GetOldestPin() >= segment->retireEpoch)
+            {
+                Log_Message("Deleting value log segment %U", segment->segmentID);
+                StorageFileDeleter::Delete(segment->filename.GetBuffer());
+                (*numSegmentsDeleted)++;
+                segment = segments.Delete(segment);
+                continue;
+            }
+        }
+        else if (!segment->draining && gcRatio > 0 && segment->garbageSize * 100 >= segment->size * gcRatio)
+        {
+            Log_Message("Draining value log segment %U, garbage: %s", segment->segmentID,
+             HumanBytes(segment->garbageSize, humanBuf));
+            segment->draining = true;
+        }
+
+        segment = segments.Next(segment);
+    }
+    mutex.Unlock();
+}
+
+uint64_t StorageValueLog::GetDiskUsage()
+{
+    MutexGuard              guard(mutex);
+    StorageValueLogSegment* segment;
+    uint64_t                size;
+
+    size = 0;
+    FOREACH (segment, segments)
+        size += segment->size;
+
+    return size;
+}
+
+uint64_t StorageValueLog::GetGarbageSize()
+{
+    MutexGuard              guard(mutex);
+    StorageValueLogSegment* segment;
+    uint64_t                size;
+
+    size = 0;
+    FOREACH (segment, segments)
+        size += segment->garbageSize;
+
+    return size;
+}
+
+unsigned StorageValueLog::GetNumSegments()
+{
+    MutexGuard  guard(mutex);
+
+    return segments.GetLength();
+}
+
+StorageValueLogSegment* StorageValueLog::FindSegment(uint64_t segmentID)
+{
+    StorageValueLogSegment* segment;
+
+    FOREACH (segment, segments)
+    {
+        if (segment->segmentID == segmentID)
+            return segment;
+    }
+
+    return NULL;
+}
+
+// returns the epoch of the oldest pin, or the largest epoch if nothing is pinned
+uint64_t StorageValueLog::GetOldestPin()
+{
+    uint64_t*   it;
+    uint64_t    oldest;
+
+    oldest = (uint64_t) -1;
+    FOREACH (it, pins)
+    {
+        if (*it < oldest)
+            oldest = *it;
+    }
+
+    return oldest;
+}
+
+void StorageValueLog::SetSegmentFilename(StorageValueLogSegment* segment)
+{
+    segment->filename.Write(valuePath);
+    segment->filename.Appendf("valuelog.%020U", segment->segmentID);
+    segment->filename.NullTerminate();
+}
+
+StorageValueLogSegment* StorageValueLog::CreateHead()
+{
+    StorageValueLogSegment* segment;
+
+    segment = new StorageValueLogSegment;
+    segment->segmentID = segments.GetLength() > 0 ? segments.Last()->segmentID + 1 : 1;
+    SetSegmentFilename(segment);
+    segment->fd = FS_Open(segment->filename.GetBuffer(), FS_CREATE | FS_READWRITE | FS_TRUNCATE);
+    if (segment->fd == INVALID_FD)
+    {
+        Log_Message("Unable to create value log segment: %s", segment->filename.GetBuffer());
+        STOP_FAIL(1);
+    }
+
+    segments.Append(segment);
+    return segment;
+}
+
+bool StorageValueLog::ParsePointer(ReadBuffer pointer,
+ uint64_t& segmentID, uint64_t& offset, uint32_t& length)
+{
+    if (pointer.GetLength() != STORAGE_VALUELOG_POINTER_SIZE)
+        return false;
+
+    pointer.ReadLittle64(segmentID);
+    pointer.Advance(8);
+    pointer.ReadLittle64(offset);
+    pointer.Advance(8);
+    pointer.ReadLittle32(length);
+
+    return true;
+}
@@ -0,0 +1,157 @@
+#ifndef STORAGEVALUELOG_H
+#define STORAGEVALUELOG_H
+
+#include "System/Buffers/Buffer.h"
+#include "System/Containers/List.h"
+#include "System/Containers/InList.h"
+#include "System/Threading/Mutex.h"
+#include "System/IO/FD.h"
+#include "StorageKeyValue.h"
+
+#define STORAGE_VALUELOG_POINTER_SIZE           20  // segmentID(8) + offset(8) + length(4)
+#define STORAGE_VALUELOG_DEFAULT_SEGMENT_SIZE   (256*MiB)
+#define STORAGE_VALUELOG_DEFAULT_GC_RATIO       50  // percent of garbage in a segment
+
+class StorageShard; // forward
+class StorageDataPage; // forward
+class StorageFileChunk; // forward
+class StorageValueLog; // forward
+
+/*
+===============================================================================================
+
+ StorageValueLogGarbage
+
+ Collects the value log bytes made unreachable by a merge. The merge job applies them
+ to the value log only after the merged chunk is in the TOC, so garbage is never
+ over-counted. Recovery uses it to count the bytes still referenced by the chunks.
+
+===============================================================================================
+*/
+
+class StorageValueLogGarbage
+{
+public:
+    void                        Add(ReadBuffer pointer);
+    void                        Add(uint64_t segmentID, uint64_t length);
+    void                        Add(StorageDataPage* dataPage);
+    void                        Add(StorageFileChunk* chunk);
+    void                        Commit(StorageValueLog* valueLog);
+    void                        Clear();
+    uint64_t                    GetLength(uint64_t segmentID);
+
+private:
+    struct Item
+    {
+        uint64_t                segmentID;
+        uint64_t                length;
+    };
+
+    List<Item>                  items;
+};
+
+/*
+===============================================================================================
+
+ StorageValueLogSegment
+
+===============================================================================================
+*/
+
+class StorageValueLogSegment
+{
+public:
+    StorageValueLogSegment();
+    ~StorageValueLogSegment();
+
+    uint64_t                    segmentID;
+    uint64_t                    size;
+    uint64_t                    garbageSize;
+    uint64_t                    retireEpoch;    // 0 if not retired
+    unsigned                    numReaders;
+    bool                        draining;
+    bool                        synced;
+    FD                          fd;
+    Buffer                      filename;
+
+    StorageValueLogSegment*     prev;
+    StorageValueLogSegment*     next;
+};
+
+/*
+===============================================================================================
+
+ StorageValueLog
+
+ Values larger than the threshold of a table listed in database.valueLogTables are stored
+ in append-only segment files under values/ instead of the data pages. The data pages hold
+ a fixed size pointer to the value. Garbage is accounted by the merges, and segments whose
+ garbage ratio exceeds the GC ratio are drained by relocating their live values in
+ subsequent merges. Fully unreferenced segments are deleted.
+
+ The garbage counts are not persisted. Recovery counts the bytes referenced by the chunks
+ in the TOC and calls SetReferenced(), the rest of each segment is garbage.
+
+ Readers that may still hold pointers read from older chunks pin the value log with Pin().
+ A fully unreferenced segment is retired with a new epoch, and deleted only when no read
+ is in progress on it and no pin older than its epoch remains.
+
+ Each StorageEnvironment owns its value log.
+
+===============================================================================================
+*/
+
+class StorageValueLog
+{
+public:
+    StorageValueLog();
+
+    void                        Init(Buffer& envPath);
+    void                        Shutdown();
+
+    bool                        IsEnabled();
+    uint32_t                    GetThreshold(StorageShard* shard);
+
+    bool                        Append(ReadBuffer value, Buffer& pointer);
+    bool                        Read(ReadBuffer pointer, Buffer& value);
+    bool                        Resolve(StorageKeyValue* kv, Buffer& buffer, ReadBuffer& value);
+    bool                        IsDraining(ReadBuffer pointer);
+    bool                        Relocate(ReadBuffer pointer, Buffer& value, Buffer& newPointer);
+    uint64_t                    Pin();
+    void                        Unpin(uint64_t pin);
+    void                        Sync();
+
+    void                        AddGarbage(uint64_t segmentID, uint64_t length);
+    void                        SetReferenced(StorageValueLogGarbage& referenced);
+    void                        Collect();
+
+    uint64_t                    GetDiskUsage();
+    uint64_t                    GetGarbageSize();
+    unsigned                    GetNumSegments();
+
+    static bool                 ParsePointer(ReadBuffer pointer,
+                                 uint64_t& segmentID, uint64_t& offset, uint32_t& length);
+
+private:
+    StorageValueLogSegment*     FindSegment(uint64_t segmentID);
+    uint64_t                    GetOldestPin();
+    void                        SetSegmentFilename(StorageValueLogSegment* segment);
+    StorageValueLogSegment*     CreateHead();
+
+    Buffer                      valuePath;
+    InList<StorageValueLogSegment> segments;
+    StorageValueLogSegment*     head;
+    List<uint64_t>              tableIDs;
+    uint32_t                    threshold;
+    uint64_t                    segmentSize;
+    unsigned                    gcRatio;
+    Mutex                       mutex;
+    uint64_t                    epoch;
+    List<uint64_t>              pins;
+    uint64_t*                   numBytesAppended;
+    uint64_t*                   numBytesRead;
+    uint64_t*                   numBytesRelocated;
+    uint64_t*                   numSegmentsDeleted;
+};
+
+#endif
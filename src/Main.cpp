@@ -7,6 +7,7 @@
 #include "System/FileSystem.h"
 #include "System/CrashReporter.h"
 #include "Framework/Storage/BloomFilter.h"
+#include "Framework/Storage/StorageLogArchiver.h"
 #include "Application/Common/ContextTransport.h"
 #include "Application/ConfigServer/ConfigServerApp.h"
 #include "Application/ShardServer/ShardServerApp.h"
@@ -195,6 +196,7 @@ static void PrintUsageAndExit(char* argv0)
             "\n"
             "       -v: print version number and exit\n"
             "       -r: start server in restore mode\n"
+            "       -u archived-file log-file: restore an archived log segment and exit\n"
             "       -t: turn trace mode on\n"
             "       -h: print this help\n"
             "\n"
@@ -264,6 +266,13 @@ static void ParseArgs(int argc, char** argv)
             case 'r':
                 restoreMode = true;
                 break;
+            case 'u':
+                if (i + 2 >= argc)
+                    PrintUsageAndExit(argv[0]);
+                if (!StorageLogArchiver::Restore(argv[i + 1], argv[i + 2]))
+                    STOP_FAIL(1, "Unable to restore archived log segment (%s)", argv[i + 1]);
+                STOP("Restored archived log segment %s to %s", argv[i + 1], argv[i + 2]);
+                break;
             case 'n':
                 setNodeID = true;
                 i++;
@@ -264,6 +264,22 @@ void Buffer::AppendLittle64(uint64_t x)
     Append((const char*) &x, sizeof(uint64_t));
 }
 
+void Buffer::AppendVarint(uint64_t x)
+{
+    char    tmp[10];
+    int     n;
+
+    n = 0;
+    while (x >= 0x80)
+    {
+        tmp[n++] = (char) ((x & 0x7F) | 0x80);
+        x >>= 7;
+    }
+    tmp[n++] = (char) x;
+
+    Append(tmp, n);
+}
+
 char Buffer::GetCharAt(unsigned i)
 {
     if (i > length - 1)
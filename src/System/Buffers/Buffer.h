@@ -55,6 +55,7 @@ public:
     void                AppendLittle16(uint16_t x);
     void                AppendLittle32(uint32_t x);
     void                AppendLittle64(uint64_t x);
+    void                AppendVarint(uint64_t x);   // 7 bits per byte, LSB first
 
     char                GetCharAt(unsigned i);
     void                SetCharAt(unsigned i, char c);
@@ -0,0 +1,63 @@
+#ifndef VARINT_H
+#define VARINT_H
+
+#include "Buffer.h"
+
+/*
+===============================================================================================
+
+ Varint helpers for binary message formats.
+
+ Integers are written by Buffer::AppendVarint(), byte strings are prefixed with their
+ varint length. Decoding works on a raw pointer which is advanced past the decoded item,
+ slices are wrapped and not copied, so they point into the decoded message.
+
+===============================================================================================
+*/
+
+inline bool DecodeVarint(const char*& p, const char* end, uint64_t& x)
+{
+    uint64_t    byte;
+    unsigned    shift;
+
+    x = 0;
+    for (shift = 0; p < end && shift < 64; shift += 7)
+    {
+        byte = (unsigned char) *p++;
+        x |= (byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0)
+            return true;
+    }
+
+    return false;
+}
+
+inline bool DecodeSlice(const char*& p, const char* end, ReadBuffer& slice)
+{
+    uint64_t    length;
+
+    if (!DecodeVarint(p, end, length) || length > (uint64_t) (end - p))
+        return false;
+    slice.Wrap((char*) p, (unsigned) length);
+    p += length;
+    return true;
+}
+
+inline void AppendSlice(Buffer& buffer, const ReadBuffer& slice)
+{
+    buffer.AppendVarint(slice.GetLength());
+    buffer.Append(slice.GetBuffer(), slice.GetLength());
+}
+
+// signed integers are zigzag encoded, so small negative numbers stay short
+inline uint64_t ZigZagEncode(int64_t x)
+{
+    return ((uint64_t) x << 1) ^ (uint64_t) (x >> 63);
+}
+
+inline int64_t ZigZagDecode(uint64_t x)
+{
+    return (int64_t) (x >> 1) ^ -(int64_t) (x & 1);
+}
+
+#endif
@@ -0,0 +1,170 @@
+#include "Compressor.h"
+
+#define HASH_LOG            14
+#define HASH_SIZE           (1 << HASH_LOG)
+#define MAX_LITERAL         32
+#define MAX_OFFSET          (1 << 13)
+#define MAX_REF             ((1 << 8) + (1 << 3))
+
+#define HASH(p)             ((((p)[0] << 16 | (p)[1] << 8 | (p)[2]) * 2654435761U) >> (32 - HASH_LOG))
+
+bool Compressor::Compress(ReadBuffer input, Buffer& output)
+{
+    const unsigned char*    ip;
+    const unsigned char*    inEnd;
+    const unsigned char*    ref;
+    const unsigned char*    table[HASH_SIZE];
+    unsigned char*          op;
+    unsigned char*          literalHead;
+    unsigned                len, maxLen, offset, i;
+
+    // literal runs add one control byte per 32 bytes in the worst case
+    output.Allocate(input.GetLength() + input.GetLength() / MAX_LITERAL + 1);
+    output.SetLength(0);
+
+    if (input.GetLength() == 0)
+        return true;
+
+    for (i = 0; i < HASH_SIZE; i++)
+        table[i] = NULL;
+
+    ip = (const unsigned char*) input.GetBuffer();
+    inEnd = ip + input.GetLength();
+    op = (unsigned char*) output.GetBuffer();
+
+    literalHead = op++;
+    *literalHead = 0;
+    len = 0;
+
+    while (ip + 2 < inEnd)
+    {
+        ref = table[HASH(ip)];
+        table[HASH(ip)] = ip;
+
+        if (ref != NULL && ref < ip && (unsigned)(ip - ref) <= MAX_OFFSET &&
+         ref[0] == ip[0] && ref[1] == ip[1] && ref[2] == ip[2])
+        {
+            offset = ip - ref - 1;
+            maxLen = inEnd - ip;
+            if (maxLen > MAX_REF)
+                maxLen = MAX_REF;
+            for (len = 3; len < maxLen && ref[len] == ip[len]; len++)
+                /* empty */;
+
+            // close the literal run
+            if (*literalHead == 0 && op == literalHead + 1)
+                op--;
+            else
+                *literalHead -= 1;
+
+            len -= 2;   // stored length is match length - 2
+            if (len < 7)
+            {
+                *op++ = (unsigned char) ((len << 5) + (offset >> 8));
+            }
+            else
+            {
+                *op++ = (unsigned char) ((7 << 5) + (offset >> 8));
+                *op++ = (unsigned char) (len - 7);
+            }
+            *op++ = (unsigned char) offset;
+
+            // index the positions inside the match for the next lookups
+            for (i = 1; i < len + 2 && ip + i + 2 < inEnd; i++)
+                table[HASH(ip + i)] = ip + i;
+
+            ip += len + 2;
+            literalHead = op++;
+            *literalHead = 0;
+            continue;
+        }
+
+        *op++ = *ip++;
+        if (++(*literalHead) == MAX_LITERAL)
+        {
+            *literalHead = MAX_LITERAL - 1;
+            literalHead = op++;
+            *literalHead = 0;
+        }
+    }
+
+    while (ip < inEnd)
+    {
+        *op++ = *ip++;
+        if (++(*literalHead) == MAX_LITERAL)
+        {
+            *literalHead = MAX_LITERAL - 1;
+            literalHead = op++;
+            *literalHead = 0;
+        }
+    }
+
+    // drop the empty literal run at the end
+    if (*literalHead == 0)
+        op--;
+    else
+        *literalHead -= 1;
+
+    output.SetLength((unsigned char*) op - (unsigned char*) output.GetBuffer());
+    return true;
+}
+
+bool Compressor::Uncompress(ReadBuffer input, Buffer& output, uint32_t uncompressedSize)
+{
+    const unsigned char*    ip;
+    const unsigned char*    inEnd;
+    unsigned char*          op;
+    unsigned char*          outEnd;
+    unsigned char*          ref;
+    unsigned                ctrl, len;
+
+    output.Allocate(uncompressedSize);
+    output.SetLength(0);
+
+    ip = (const unsigned char*) input.GetBuffer();
+    inEnd = ip + input.GetLength();
+    op = (unsigned char*) output.GetBuffer();
+    outEnd = op + uncompressedSize;
+
+    while (ip < inEnd)
+    {
+        ctrl = *ip++;
+
+        if (ctrl < MAX_LITERAL)
+        {
+            // literal run
+            len = ctrl + 1;
+            if (op + len > outEnd || ip + len > inEnd)
+                return false;
+            memcpy(op, ip, len);
+            op += len;
+            ip += len;
+        }
+        else
+        {
+            // back reference
+            len = ctrl >> 5;
+            if (len == 7)
+            {
+                if (ip >= inEnd)
+                    return false;
+                len += *ip++;
+            }
+            len += 2;
+            if (ip >= inEnd)
+                return false;
+            ref = op - ((ctrl & 0x1f) << 8) - 1 - *ip++;
+            if (ref < (unsigned char*) output.GetBuffer() || op + len > outEnd)
+                return false;
+            // the areas may overlap, copy byte by byte
+            while (len-- > 0)
+                *op++ = *ref++;
+        }
+    }
+
+    if (op != outEnd)
+        return false;
+
+    output.SetLength(uncompressedSize);
+    return true;
+}
@@ -0,0 +1,24 @@
+#ifndef COMPRESSOR_H
+#define COMPRESSOR_H
+
+#include "System/Buffers/Buffer.h"
+
+/*
+===============================================================================================
+
+ Compressor
+
+ A fast LZ77 codec in the LZF format. It trades compression ratio for speed, so it is
+ suitable for compressing data on the write path, e.g. archived log segments.
+
+===============================================================================================
+*/
+
+class Compressor
+{
+public:
+    bool            Compress(ReadBuffer input, Buffer& output);
+    bool            Uncompress(ReadBuffer input, Buffer& output, uint32_t uncompressedSize);
+};
+
+#endif
@@ -0,0 +1,380 @@
+#ifndef INHASHTABLE_H
+#define INHASHTABLE_H
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "System/Macros.h"
+#include "System/Common.h"
+#include "System/Platform.h"
+#include "System/Buffers/ReadBuffer.h"
+
+#define INHASHTABLE_MIN_SIZE        16      // power of 2
+#define INHASHTABLE_SHORT_KEY       16      // bytes of the key stored in the slot
+
+/*
+ ===============================================================================================
+
+ InHashNode is the datatype that is stored in InHashTable
+
+ ===============================================================================================
+ */
+
+template<typename T>
+class InHashNode
+{
+public:
+    uint32_t                hash;
+    bool                    inTable;
+
+    InHashNode();
+
+    bool                    IsInTable();
+};
+
+template<typename T>
+InHashNode<T>::InHashNode()
+{
+    hash = 0;
+    inTable = false;
+}
+
+template<typename T>
+bool InHashNode<T>::IsInTable()
+{
+    return inTable;
+}
+
+/*
+ ===============================================================================================
+
+ InHashSlot holds the hash, the length and the first bytes of the key, so that probing
+ touches the element only when the hash and the short key match and the key is longer
+
+ ===============================================================================================
+ */
+
+template<typename T>
+struct InHashSlot
+{
+    T*                      elem;   // NULL if the slot is empty
+    uint32_t                hash;
+    uint32_t                length;
+    char                    shortKey[INHASHTABLE_SHORT_KEY];
+};
+
+/*
+ ===============================================================================================
+
+ InHashTable is an intrusive hash table keyed by byte strings, implemented with
+ open addressing and linear probing. Removal shifts back the following entries of the
+ probe sequence, so there are no tombstones. The table grows at 3/4 load and shrinks
+ below 1/8. The elements are not ordered, and the table must not be modified while it
+ is iterated with First() and Next().
+
+ The element's key is returned by Key(const T*), which must be convertible to ReadBuffer.
+
+ ===============================================================================================
+ */
+
+template<typename T, InHashNode<T> T::*pnode = &T::hashNode>
+class InHashTable
+{
+public:
+    typedef InHashNode<T>   Node;
+    typedef InHashSlot<T>   Slot;
+
+    InHashTable();
+    ~InHashTable();
+
+    unsigned                GetCount();
+    unsigned                GetSize();
+
+    T*                      First();
+    T*                      Next(T* t);
+
+    T*                      Get(const ReadBuffer& key);
+    void                    Insert(T* t);
+    T*                      Remove(T* t);
+
+    void                    Clear();
+    void                    DeleteTable();
+
+    static uint32_t         Hash(const ReadBuffer& key);
+
+private:
+    bool                    IsMatch(Slot* slot, uint32_t hash, const ReadBuffer& key);
+    unsigned                GetSlot(T* t);
+    void                    Resize(unsigned newSize);
+
+    Slot*                   slots;
+    unsigned                size;
+    unsigned                mask;
+    unsigned                count;
+};
+
+template<typename T, InHashNode<T> T::*pnode>
+InHashTable<T, pnode>::InHashTable()
+{
+    slots = NULL;
+    size = 0;
+    mask = 0;
+    count = 0;
+}
+
+template<typename T, InHashNode<T> T::*pnode>
+InHashTable<T, pnode>::~InHashTable()
+{
+    Clear();
+}
+
+template<typename T, InHashNode<T> T::*pnode>
+unsigned InHashTable<T, pnode>::GetCount()
+{
+    return count;
+}
+
+template<typename T, InHashNode<T> T::*pnode>
+unsigned InHashTable<T, pnode>::GetSize()
+{
+    return size;
+}
+
+template<typename T, InHashNode<T> T::*pnode>
+T* InHashTable<T, pnode>::First()
+{
+    unsigned    i;
+
+    for (i = 0; i < size; i++)
+    {
+        if (slots[i].elem != NULL)
+            return slots[i].elem;
+    }
+
+    return NULL;
+}
+
+template<typename T, InHashNode<T> T::*pnode>
+T* InHashTable<T, pnode>::Next(T* t)
+{
+    unsigned    i;
+
+    for (i = GetSlot(t) + 1; i < size; i++)
+    {
+        if (slots[i].elem != NULL)
+            return slots[i].elem;
+    }
+
+    return NULL;
+}
+
+template<typename T, InHashNode<T> T::*pnode>
+T* InHashTable<T, pnode>::Get(const ReadBuffer& key)
+{
+    uint32_t    hash;
+    unsigned    i;
+    Slot*       slot;
+
+    if (count == 0)
+        return NULL;
+
+    hash = Hash(key);
+    for (i = hash & mask; ; i = (i + 1) & mask)
+    {
+        slot = &slots[i];
+        if (slot->elem == NULL)
+            return NULL;
+        if (IsMatch(slot, hash, key))
+            return slot->elem;
+    }
+}
+
+template<typename T, InHashNode<T> T::*pnode>
+void InHashTable<T, pnode>::Insert(T* t)
+{
+    uint32_t    hash;
+    unsigned    i;
+    Slot*       slot;
+    ReadBuffer  key;
+
+    ASSERT(!(t->*pnode).IsInTable());
+
+    if (size == 0)
+        Resize(INHASHTABLE_MIN_SIZE);
+    else if ((count + 1) * 4 > size * 3)
+        Resize(size * 2);
+
+    key = Key(t);
+    hash = Hash(key);
+    for (i = hash & mask; slots[i].elem != NULL; i = (i + 1) & mask)
+        ASSERT(!IsMatch(&slots[i], hash, key));
+
+    slot = &slots[i];
+    slot->elem = t;
+    slot->hash = hash;
+    slot->length = key.GetLength();
+    memcpy(slot->shortKey, key.GetBuffer(), MIN(key.GetLength(), INHASHTABLE_SHORT_KEY));
+
+    (t->*pnode).hash = hash;
+    (t->*pnode).inTable = true;
+    count++;
+}
+
+template<typename T, InHashNode<T> T::*pnode>
+T* InHashTable<T, pnode>::Remove(T* t)
+{
+    unsigned    i, j, k;
+
+    i = GetSlot(t);
+
+    // move back the entries that would not be found with an empty slot at i
+    for (j = (i + 1) & mask; slots[j].elem != NULL; j = (j + 1) & mask)
+    {
+        k = slots[j].hash & mask;
+        if (i <= j ? (i < k && k <= j) : (i < k || k <= j))
+            continue;
+        slots[i] = slots[j];
+        i = j;
+    }
+    slots[i].elem = NULL;
+
+    (t->*pnode).hash = 0;
+    (t->*pnode).inTable = false;
+    count--;
+
+    if (size > INHASHTABLE_MIN_SIZE && count * 8 < size)
+        Resize(size / 2);
+
+    return t;
+}
+
+template<typename T, InHashNode<T> T::*pnode>
+void InHashTable<T, pnode>::Clear()
+{
+    unsigned    i;
+
+    for (i = 0; i < size; i++)
+    {
+        if (slots[i].elem != NULL)
+        {
+            (slots[i].elem->*pnode).hash = 0;
+            (slots[i].elem->*pnode).inTable = false;
+        }
+    }
+
+    free(slots);
+    slots = NULL;
+    size = 0;
+    mask = 0;
+    count = 0;
+}
+
+template<typename T, InHashNode<T> T::*pnode>
+void InHashTable<T, pnode>::DeleteTable()
+{
+    unsigned    i;
+
+    for (i = 0; i < size; i++)
+    {
+        if (slots[i].elem != NULL)
+            delete slots[i].elem;
+    }
+
+    free(slots);
+    slots = NULL;
+    size = 0;
+    mask = 0;
+    count = 0;
+}
+
+template<typename T, InHashNode<T> T::*pnode>
+uint32_t InHashTable<T, pnode>::Hash(const ReadBuffer& key)
+{
+    uint64_t    h;
+    uint64_t    w;
+    unsigned    len;
+    const char* p;
+
+    // mixes eight bytes at a time, the byte order of the platform does not matter
+    p = key.GetBuffer();
+    len = key.GetLength();
+    h = 0x9E3779B97F4A7C15ULL ^ len;
+    while (len >= 8)
+    {
+        memcpy(&w, p, 8);
+        h = (h ^ w) * 0xFF51AFD7ED558CCDULL;
+        h ^= h >> 32;
+        p += 8;
+        len -= 8;
+    }
+    w = 0;
+    memcpy(&w, p, len);
+    h = (h ^ w) * 0xC4CEB9FE1A85EC53ULL;
+    h ^= h >> 29;
+
+    return (uint32_t) (h ^ (h >> 32));
+}
+
+template<typename T, InHashNode<T> T::*pnode>
+bool InHashTable<T, pnode>::IsMatch(Slot* slot, uint32_t hash, const ReadBuffer& key)
+{
+    ReadBuffer  elemKey;
+
+    if (slot->hash != hash || slot->length != key.GetLength())
+        return false;
+
+    if (memcmp(slot->shortKey, key.GetBuffer(), MIN(key.GetLength(), INHASHTABLE_SHORT_KEY)) != 0)
+        return false;
+
+    if (key.GetLength() <= INHASHTABLE_SHORT_KEY)
+        return true;
+
+    elemKey = Key(slot->elem);
+    return memcmp(elemKey.GetBuffer() + INHASHTABLE_SHORT_KEY, key.GetBuffer() + INHASHTABLE_SHORT_KEY,
+     key.GetLength() - INHASHTABLE_SHORT_KEY) == 0;
+}
+
+template<typename T, InHashNode<T> T::*pnode>
+unsigned InHashTable<T, pnode>::GetSlot(T* t)
+{
+    unsigned    i;
+
+    ASSERT((t->*pnode).IsInTable());
+
+    for (i = (t->*pnode).hash & mask; slots[i].elem != t; i = (i + 1) & mask)
+        ASSERT(slots[i].elem != NULL);
+
+    return i;
+}
+
+template<typename T, InHashNode<T> T::*pnode>
+void InHashTable<T, pnode>::Resize(unsigned newSize)
+{
+    unsigned    i, j;
+    unsigned    oldSize;
+    Slot*       oldSlots;
+
+    oldSlots = slots;
+    oldSize = size;
+
+    slots = (Slot*) malloc(newSize * sizeof(Slot));
+    ASSERT(slots != NULL);
+    memset(slots, 0, newSize * sizeof(Slot));
+    size = newSize;
+    mask = newSize - 1;
+
+    // the hash and the short key are kept in the slots, the elements are not touched
+    for (i = 0; i < oldSize; i++)
+    {
+        if (oldSlots[i].elem == NULL)
+            continue;
+        j = oldSlots[i].hash & mask;
+        while (slots[j].elem != NULL)
+            j = (j + 1) & mask;
+        slots[j] = oldSlots[i];
+    }
+
+    free(oldSlots);
+}
+
+#endif
@@ -456,6 +456,21 @@ int64_t FS_FileSize(const char* path)
     return buf.st_size;
 }
 
+int64_t FS_FileModificationTime(const char* path)
+{
+    int64_t     ret;
+    struct stat buf;
+    
+    ret = stat(path, &buf);
+    if (ret < 0)
+    {
+        Log_Errno("%s", path);
+        return ret;
+    }
+    
+    return buf.st_mtime;
+}
+
 bool FS_Rename(const char* src, const char* dst)
 {
     int     ret;
@@ -470,6 +485,20 @@ bool FS_Rename(const char* src, const char* dst)
     return true;
 }
 
+bool FS_Link(const char* src, const char* dst)
+{
+    int     ret;
+    
+    ret = link(src, dst);
+    if (ret < 0)
+    {
+        Log_Errno("src: %s, dst: %s", src, dst);
+        return false;
+    }
+    
+    return true;
+}
+
 void FS_Sync()
 {
     int     fd;
@@ -969,6 +998,21 @@ int64_t FS_FileSize(const char* path)
     return ((int64_t) attrData.nFileSizeHigh) << 32 | attrData.nFileSizeLow;
 }
 
+int64_t FS_FileModificationTime(const char* path)
+{
+    WIN32_FILE_ATTRIBUTE_DATA   attrData;
+    BOOL                        ret;
+    int64_t                     ft;
+
+    ret = GetFileAttributesEx(path, GetFileExInfoStandard, &attrData);
+    if (!ret)
+        return -1;
+    
+    // FILETIME is in 100 nanosecond units since 1601-01-01
+    ft = ((int64_t) attrData.ftLastWriteTime.dwHighDateTime) << 32 | attrData.ftLastWriteTime.dwLowDateTime;
+    return (ft - 116444736000000000LL) / 10000000;
+}
+
 bool FS_Rename(const char* src, const char* dst)
 {
     BOOL    ret;
@@ -983,6 +1027,20 @@ bool FS_Rename(const char* src, const char* dst)
     return true;
 }
 
+bool FS_Link(const char* src, const char* dst)
+{
+    BOOL    ret;
+    
+    ret = CreateHardLink(dst, src, NULL);
+    if (!ret)
+    {
+        Log_Errno("src: %s, dst: %s", src, dst);
+        return false;
+    }
+    
+    return true;
+}
+
 void FS_Sync()
 {
     // TODO: To flush all open files on a volume, call FlushFileBuffers with a handle to the volume.
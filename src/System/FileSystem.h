@@ -73,7 +73,9 @@ bool        FS_Exists(const char* path);
 int64_t     FS_FreeDiskSpace(const char* path);
 int64_t     FS_DiskSpace(const char* path);
 int64_t     FS_FileSize(const char* path);
+int64_t     FS_FileModificationTime(const char* path);
 bool        FS_Rename(const char* src, const char* dst);
+bool        FS_Link(const char* src, const char* dst);
 
 void        FS_Sync();
 void        FS_Sync(FD fd);
@@ -44,6 +44,7 @@ using namespace SDBPClient;
     case SDBP_NOSERVICE: TEST_LOG("%s status: SDBP_NOSERVICE", which); break; \
     case SDBP_FAILED: TEST_LOG("%s status: SDBP_FAILED", which); break; \
     case SDBP_BADSCHEMA: TEST_LOG("%s status: SDBP_BADSCHEMA", which); break; \
+    case SDBP_OVERLOADED: TEST_LOG("%s status: SDBP_OVERLOADED", which); break; \
     }
 
 static void TestShutdown();
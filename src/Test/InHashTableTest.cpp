@@ -0,0 +1,230 @@
+#include "Test.h"
+
+#include "System/Containers/InHashTable.h"
+#include "System/Containers/InTreeMap.h"
+#include "System/Stopwatch.h"
+#include "System/Buffers/Buffer.h"
+#include "Application/ShardServer/ShardLockManager.h"
+
+class HashKeyValue
+{
+    typedef InHashNode<HashKeyValue> HashNode;
+    typedef InTreeNode<HashKeyValue> TreeNode;
+
+public:
+    Buffer      key;
+    HashNode    hashNode;
+    TreeNode    treeNode;
+};
+
+static inline const Buffer& Key(const HashKeyValue* kv)
+{
+    return kv->key;
+}
+
+static inline int KeyCmp(const Buffer& a, const Buffer& b)
+{
+    return Buffer::Cmp(a, b);
+}
+
+static void WriteTestKey(Buffer& key, unsigned i)
+{
+    // keys longer than the short key of the slots share a common prefix
+    if (i % 2 == 0)
+        key.Writef("%u", i);
+    else
+        key.Writef("long/common/prefix/%010u", i);
+}
+
+TEST_DEFINE(TestInHashTableBasic)
+{
+    InHashTable<HashKeyValue>   table;
+    HashKeyValue*               kvs;
+    HashKeyValue*               kv;
+    Buffer                      key;
+    const unsigned              num = 100000;
+    unsigned                    i;
+    unsigned                    count;
+
+    kvs = new HashKeyValue[num];
+    for (i = 0; i < num; i++)
+    {
+        WriteTestKey(kvs[i].key, i);
+        table.Insert(&kvs[i]);
+        TEST_ASSERT(kvs[i].hashNode.IsInTable());
+    }
+    TEST_ASSERT(table.GetCount() == num);
+
+    for (i = 0; i < num; i++)
+    {
+        WriteTestKey(key, i);
+        TEST_ASSERT(table.Get(key) == &kvs[i]);
+    }
+
+    // keys differing only after the short key
+    key.Write("long/common/prefix/x");
+    TEST_ASSERT(table.Get(key) == NULL);
+
+    // remove every odd element
+    for (i = 1; i < num; i += 2)
+    {
+        TEST_ASSERT(table.Remove(&kvs[i]) == &kvs[i]);
+        TEST_ASSERT(!kvs[i].hashNode.IsInTable());
+    }
+    TEST_ASSERT(table.GetCount() == num / 2);
+
+    for (i = 0; i < num; i++)
+    {
+        WriteTestKey(key, i);
+        if (i % 2 == 0)
+            TEST_ASSERT(table.Get(key) == &kvs[i]);
+        else
+            TEST_ASSERT(table.Get(key) == NULL);
+    }
+
+    count = 0;
+    FOREACH (kv, table)
+    {
+        TEST_ASSERT(kv->hashNode.IsInTable());
+        count++;
+    }
+    TEST_ASSERT(count == table.GetCount());
+
+    for (i = 0; i < num; i += 2)
+        table.Remove(&kvs[i]);
+    TEST_ASSERT(table.GetCount() == 0);
+    TEST_ASSERT(table.GetSize() == INHASHTABLE_MIN_SIZE);
+    TEST_ASSERT(table.First() == NULL);
+
+    delete[] kvs;
+    return TEST_SUCCESS;
+}
+
+TEST_DEFINE(TestInHashTableRemoveRandom)
+{
+    InHashTable<HashKeyValue>   table;
+    HashKeyValue*               kvs;
+    Buffer                      key;
+    const unsigned              num = 10000;
+    unsigned                    i;
+    unsigned                    round;
+
+    kvs = new HashKeyValue[num];
+    for (i = 0; i < num; i++)
+        WriteTestKey(kvs[i].key, i);
+
+    // the backward shift on removal must keep every remaining element reachable
+    for (round = 0; round < 100 * num; round++)
+    {
+        i = RandomInt(0, num - 1);
+        if (kvs[i].hashNode.IsInTable())
+            table.Remove(&kvs[i]);
+        else
+            table.Insert(&kvs[i]);
+
+        if (round % num != 0)
+            continue;
+
+        for (i = 0; i < num; i++)
+        {
+            if (kvs[i].hashNode.IsInTable())
+                TEST_ASSERT(table.Get(kvs[i].key) == &kvs[i]);
+            else
+                TEST_ASSERT(table.Get(kvs[i].key) == NULL);
+        }
+    }
+
+    table.Clear();
+    for (i = 0; i < num; i++)
+        TEST_ASSERT(!kvs[i].hashNode.IsInTable());
+
+    delete[] kvs;
+    return TEST_SUCCESS;
+}
+
+TEST_DEFINE(TestInHashTableSpeed)
+{
+    InHashTable<HashKeyValue>   table;
+    InTreeMap<HashKeyValue>     tree;
+    HashKeyValue*               kvs;
+    HashKeyValue*               kv;
+    Buffer                      key;
+    Stopwatch                   sw;
+    const unsigned              num = 1000000;
+    unsigned                    i;
+    int                         cmpres;
+
+    kvs = new HashKeyValue[num];
+    for (i = 0; i < num; i++)
+        WriteTestKey(kvs[i].key, RandomInt(0, 1000 * 1000 * 1000));
+
+    sw.Start();
+    for (i = 0; i < num; i++)
+    {
+        if (table.Get(kvs[i].key) == NULL)
+            table.Insert(&kvs[i]);
+    }
+    for (i = 0; i < num; i++)
+        TEST_ASSERT(table.Get(kvs[i].key) != NULL);
+    sw.Stop();
+    printf("hash table insert and get time: %ld\n", (long) sw.Elapsed());
+
+    sw.Reset();
+    sw.Start();
+    for (i = 0; i < num; i++)
+    {
+        kv = tree.Locate(kvs[i].key, cmpres);
+        if (!FOUND_IN_TREE(kv, cmpres))
+            tree.InsertAt(&kvs[i], kv, cmpres);
+    }
+    for (i = 0; i < num; i++)
+        TEST_ASSERT(tree.Get(kvs[i].key) != NULL);
+    sw.Stop();
+    printf("tree insert and get time: %ld\n", (long) sw.Elapsed());
+
+    TEST_ASSERT(table.GetCount() == tree.GetCount());
+
+    table.Clear();
+    tree.Clear();
+    delete[] kvs;
+    return TEST_SUCCESS;
+}
+
+TEST_DEFINE(TestInHashTableShardLocks)
+{
+    ShardLockManager    lockManager;
+    Buffer              key;
+    Stopwatch           sw;
+    const unsigned      num = 1000000;
+    const unsigned      numRounds = 1000000;
+    unsigned            i;
+    unsigned            round;
+
+    // live locks do not expire during the test
+    lockManager.SetLockExpireTime(3600 * 1000);
+    for (i = 0; i < num; i++)
+    {
+        key.Writef("user:%u", i);
+        TEST_ASSERT(lockManager.TryLock(key, NULL));
+    }
+    TEST_ASSERT(lockManager.GetNumLocks() == num);
+
+    sw.Start();
+    for (round = 0; round < numRounds; round++)
+    {
+        i = RandomInt(0, num - 1);
+        key.Writef("user:%u", i);
+        TEST_ASSERT(lockManager.IsLocked(key));
+        lockManager.Unlock(key);
+        TEST_ASSERT(lockManager.TryLock(key, NULL));
+        TEST_ASSERT(!lockManager.TryLock(key, NULL));
+    }
+    sw.Stop();
+    printf("lock/unlock time with %u live locks: %ld\n", num, (long) sw.Elapsed());
+
+    TEST_ASSERT(lockManager.GetNumLocks() == num);
+    lockManager.UnlockAll();
+    TEST_ASSERT(lockManager.GetTableCount() == 0);
+
+    return TEST_SUCCESS;
+}
@@ -0,0 +1,201 @@
+#include "Test.h"
+#include "System/Stopwatch.h"
+#include "System/Buffers/Buffer.h"
+#include "Framework/Messaging/MessageConnection.h"
+#include "Application/Common/KeyValueBatch.h"
+#include "Application/Common/ClusterMessage.h"
+
+TEST_DEFINE(TestKeyValueBatchRoundtrip)
+{
+    KeyValueBatch   batch;
+    KeyValueBatch   parsed;
+    Buffer          keys[100];
+    Buffer          values[100];
+    Buffer          block;
+    ReadBuffer      key, value, rb;
+    unsigned        i;
+    int             compression;
+    char            type;
+
+    for (i = 0; i < SIZE(keys); i++)
+    {
+        keys[i].Writef("user:%u", i);
+        values[i].Writef("value of user %u", i);
+    }
+
+    for (compression = 0; compression < 2; compression++)
+    {
+        batch.Clear();
+        for (i = 0; i < SIZE(keys); i++)
+        {
+            key.Wrap(keys[i]);
+            value.Wrap(values[i]);
+            if (i % 10 == 9)
+                batch.Delete(key);
+            else
+                batch.Set(key, value);
+        }
+        TEST_ASSERT(batch.GetNumItems() == SIZE(keys));
+
+        batch.Write(block, compression != 0);
+        TEST_ASSERT(block.GetLength() > 0);
+        TEST_ASSERT(block.GetCharAt(0) == (compression ? KEYVALUEBATCH_COMPRESSED : KEYVALUEBATCH_RAW));
+        if (compression)
+            TEST_ASSERT(block.GetLength() < batch.GetSize());
+
+        rb.Wrap(block);
+        TEST_ASSERT(parsed.Read(rb));
+        TEST_ASSERT(parsed.GetNumItems() == SIZE(keys));
+        for (i = 0; i < SIZE(keys); i++)
+        {
+            TEST_ASSERT(parsed.Next(type, key, value));
+            TEST_ASSERT(ReadBuffer::Cmp(key, keys[i]) == 0);
+            if (i % 10 == 9)
+            {
+                TEST_ASSERT(type == KEYVALUEBATCH_DELETE && value.GetLength() == 0);
+            }
+            else
+            {
+                TEST_ASSERT(type == KEYVALUEBATCH_SET && ReadBuffer::Cmp(value, values[i]) == 0);
+            }
+        }
+        TEST_ASSERT(!parsed.Next(type, key, value));
+
+        // truncated and corrupt blocks are rejected as a whole
+        rb.Wrap(block.GetBuffer(), block.GetLength() - 1);
+        TEST_ASSERT(!parsed.Read(rb));
+        TEST_ASSERT(!parsed.Next(type, key, value));
+        block.GetBuffer()[0] = 'x';
+        rb.Wrap(block);
+        TEST_ASSERT(!parsed.Read(rb));
+    }
+
+    // incompressible items are sent raw
+    batch.Clear();
+    key.Wrap("k");
+    value.Wrap("v");
+    batch.Set(key, value);
+    batch.Write(block, true);
+    TEST_ASSERT(block.GetCharAt(0) == KEYVALUEBATCH_RAW);
+
+    // an empty batch
+    batch.Clear();
+    batch.Write(block, true);
+    rb.Wrap(block);
+    TEST_ASSERT(parsed.Read(rb));
+    TEST_ASSERT(parsed.GetNumItems() == 0 && !parsed.Next(type, key, value));
+
+    return TEST_SUCCESS;
+}
+
+// one message per key-value, like the migration stream without batching
+static long SendKeyValues(unsigned num, uint64_t& numBytes)
+{
+    ClusterMessage  msg;
+    Buffer          key, value, wire;
+    ReadBuffer      rbKey, rbValue, rb;
+    Stopwatch       sw;
+    unsigned        i;
+
+    numBytes = 0;
+    sw.Restart();
+    for (i = 0; i < num; i++)
+    {
+        key.Writef("user:%u", i);
+        value.Writef("value of user %u", i);
+        rbKey.Wrap(key);
+        rbValue.Wrap(value);
+        msg.ShardMigrationSet(1, 2, rbKey, rbValue);
+        msg.Write(wire);
+        numBytes += wire.GetLength();
+
+        rb.Wrap(wire);
+        if (!msg.Read(rb) || msg.key.GetLength() != key.GetLength())
+            return -1;
+    }
+    sw.Stop();
+
+    return (long) sw.Elapsed();
+}
+
+// batches filling the write buffer of the connection
+static long SendBatches(unsigned num, bool compression, uint64_t& numBytes)
+{
+    ClusterMessage  msg;
+    KeyValueBatch   batch;
+    KeyValueBatch   parsed;
+    Buffer          key, value, block, wire;
+    ReadBuffer      rbKey, rbValue, rb;
+    Stopwatch       sw;
+    unsigned        i;
+    unsigned        numItems;
+    char            type;
+
+    numBytes = 0;
+    numItems = 0;
+    sw.Restart();
+    for (i = 0; i < num; i++)
+    {
+        key.Writef("user:%u", i);
+        value.Writef("value of user %u", i);
+        rbKey.Wrap(key);
+        rbValue.Wrap(value);
+        batch.Set(rbKey, rbValue);
+        if (batch.GetSize() < MESSAGING_BUFFER_THRESHOLD && i < num - 1)
+            continue;
+
+        batch.Write(block, compression);
+        rb.Wrap(block);
+        msg.ShardMigrationBatch(1, 2, rb);
+        msg.Write(wire);
+        numBytes += wire.GetLength();
+        batch.Clear();
+
+        rb.Wrap(wire);
+        if (!msg.Read(rb) || !parsed.Read(msg.value))
+            return -1;
+        while (parsed.Next(type, rbKey, rbValue))
+            numItems++;
+    }
+    sw.Stop();
+
+    if (numItems != num)
+        return -1;
+
+    return (long) sw.Elapsed();
+}
+
+TEST_DEFINE(TestKeyValueBatchRate)
+{
+    const unsigned  num = 1000*1000;
+    long            elapsed;
+    uint64_t        numBytes;
+    uint64_t        numDataBytes;
+    Buffer          key, value;
+    unsigned        i;
+
+    numDataBytes = 0;
+    for (i = 0; i < num; i++)
+    {
+        key.Writef("user:%u", i);
+        value.Writef("value of user %u", i);
+        numDataBytes += key.GetLength() + value.GetLength();
+    }
+
+    elapsed = SendKeyValues(num, numBytes);
+    TEST_ASSERT(elapsed >= 0);
+    TEST_LOG("per key:    %ld msec, %.1f MB/sec, %" PRIu64 " bytes on the wire",
+     elapsed, numDataBytes / 1000.0 / MAX(elapsed, 1), numBytes);
+
+    elapsed = SendBatches(num, false, numBytes);
+    TEST_ASSERT(elapsed >= 0);
+    TEST_LOG("batched:    %ld msec, %.1f MB/sec, %" PRIu64 " bytes on the wire",
+     elapsed, numDataBytes / 1000.0 / MAX(elapsed, 1), numBytes);
+
+    elapsed = SendBatches(num, true, numBytes);
+    TEST_ASSERT(elapsed >= 0);
+    TEST_LOG("compressed: %ld msec, %.1f MB/sec, %" PRIu64 " bytes on the wire",
+     elapsed, numDataBytes / 1000.0 / MAX(elapsed, 1), numBytes);
+
+    return TEST_SUCCESS;
+}
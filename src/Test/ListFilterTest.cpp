@@ -0,0 +1,82 @@
+#include "Test.h"
+#include "Application/Common/ListFilter.h"
+
+static bool MatchFilter(const char* filter, const char* key, const char* value)
+{
+    ListFilter  listFilter;
+    ReadBuffer  rbFilter(filter);
+    ReadBuffer  rbKey(key);
+    ReadBuffer  rbValue(value);
+
+    if (!listFilter.Parse(rbFilter))
+        return false;
+    return listFilter.Match(rbKey, rbValue);
+}
+
+static bool ParseFilter(const char* filter)
+{
+    ListFilter  listFilter;
+    ReadBuffer  rbFilter(filter);
+
+    return listFilter.Parse(rbFilter);
+}
+
+TEST_DEFINE(TestListFilterParse)
+{
+    TEST_ASSERT(ParseFilter(""));
+    TEST_ASSERT(ParseFilter("keyprefix(a) valuecontains(b)"));
+    TEST_ASSERT(ParseFilter("valuerange(,10) first(3)"));
+    TEST_ASSERT(ParseFilter("keycontains(\\))"));
+
+    TEST_ASSERT(!ParseFilter("keyprefix"));
+    TEST_ASSERT(!ParseFilter("keyprefix(a"));
+    TEST_ASSERT(!ParseFilter("unknown(a)"));
+    TEST_ASSERT(!ParseFilter("keyprefix(a,b)"));
+    TEST_ASSERT(!ParseFilter("valuerange(x,10)"));
+    TEST_ASSERT(!ParseFilter("first(-1)"));
+    TEST_ASSERT(!ParseFilter("first(1) first(2)"));
+
+    return TEST_SUCCESS;
+}
+
+TEST_DEFINE(TestListFilterMatch)
+{
+    ListFilter  listFilter;
+    ReadBuffer  value;
+
+    TEST_ASSERT(MatchFilter("", "key", "value"));
+    TEST_ASSERT(MatchFilter("keyprefix(user:)", "user:1", ""));
+    TEST_ASSERT(!MatchFilter("keyprefix(user:)", "use", ""));
+    TEST_ASSERT(MatchFilter("keycontains(:1)", "user:12", ""));
+    TEST_ASSERT(MatchFilter("keycontains(\\))", "a)b", ""));
+    TEST_ASSERT(MatchFilter("valueprefix(ab) valuecontains(cd)", "k", "abcd"));
+    TEST_ASSERT(!MatchFilter("valueprefix(ab) valuecontains(cd)", "k", "abc"));
+
+    TEST_ASSERT(MatchFilter("valuerange(10,20)", "k", "15"));
+    TEST_ASSERT(MatchFilter("valuerange(-5,)", "k", "-5"));
+    TEST_ASSERT(!MatchFilter("valuerange(10,20)", "k", "21"));
+    TEST_ASSERT(!MatchFilter("valuerange(10,20)", "k", "15x"));
+    TEST_ASSERT(!MatchFilter("valuerange(10,20)", "k", ""));
+
+    TEST_ASSERT(MatchFilter("keyregex(^user:[0-9]+$)", "user:123", ""));
+    TEST_ASSERT(!MatchFilter("keyregex(^user:[0-9]+$)", "user:", ""));
+    TEST_ASSERT(!MatchFilter("keyregex(^user:[0-9]+$)", "user:12a", ""));
+    TEST_ASSERT(MatchFilter("keyregex(a.*c)", "xxabbbcxx", ""));
+    TEST_ASSERT(MatchFilter("keyregex(^ab?c$)", "ac", ""));
+    TEST_ASSERT(!MatchFilter("keyregex(^ab?c$)", "abbc", ""));
+    TEST_ASSERT(MatchFilter("keyregex([^a-z]$)", "abc1", ""));
+    TEST_ASSERT(MatchFilter("valueregex(^a\\.b$)", "k", "a.b"));
+    TEST_ASSERT(!MatchFilter("valueregex(^a\\.b$)", "k", "axb"));
+
+    // projection
+    TEST_ASSERT(listFilter.Parse(ReadBuffer("first(3)")));
+    TEST_ASSERT(listFilter.HasProjection() && !listFilter.IsValueNeeded());
+    value.Wrap("abcdef");
+    listFilter.Project(value);
+    TEST_ASSERT(value.Equals("abc"));
+    value.Wrap("ab");
+    listFilter.Project(value);
+    TEST_ASSERT(value.Equals("ab"));
+
+    return TEST_SUCCESS;
+}
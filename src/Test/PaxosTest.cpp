@@ -0,0 +1,410 @@
+#include "Test.h"
+
+#include "Framework/Replication/Paxos/PaxosAcceptor.h"
+#include "Framework/Replication/Paxos/PaxosProposer.h"
+#include "Framework/Replication/Quorums/MajorityQuorum.h"
+#include "Framework/Replication/ReplicationConfig.h"
+#include "Framework/Storage/StorageEnvironment.h"
+#include "Framework/Storage/StorageShard.h"
+#include "System/Events/EventLoop.h"
+#include "System/IO/IOProcessor.h"
+#include "System/FileSystem.h"
+
+#define TEST_QUORUMID   1
+
+static StorageConfig    paxosConfig;
+
+/*
+===============================================================================================
+
+ TestQuorumContext
+
+ A quorum of three nodes with the Paxos state in a local environment. The messages
+ are not delivered anywhere, the tests feed the responses directly.
+
+===============================================================================================
+*/
+
+class TestQuorumContext : public QuorumContext
+{
+public:
+    void                Init(StorageEnvironment* env);
+
+    bool                IsLeaseOwner()                      { return true; }
+    bool                IsLeaseKnown()                      { return true; }
+    uint64_t            GetLeaseOwner()                     { return MY_NODEID; }
+    bool                IsLeader()                          { return true; }
+
+    void                OnLearnLease()                      {}
+    void                OnLeaseTimeout()                    {}
+    void                OnIsLeader()                        {}
+
+    uint64_t            GetQuorumID()                       { return TEST_QUORUMID; }
+    void                SetPaxosID(uint64_t paxosID_)       { paxosID = paxosID_; }
+    uint64_t            GetPaxosID()                        { return paxosID; }
+    uint64_t            GetHighestPaxosID()                 { return paxosID; }
+    uint64_t            GetLastLearnChosenTime()            { return 0; }
+    uint64_t            GetReplicationThroughput()          { return 0; }
+
+    Quorum*             GetQuorum()                         { return &quorum; }
+    QuorumDatabase*     GetDatabase()                       { return &database; }
+    QuorumTransport*    GetTransport()                      { return &transport; }
+
+    bool                UseSyncCommit()                     { return true; }
+    bool                UseProposeTimeouts()                { return false; }
+    bool                UseCommitChaining()                 { return false; }
+    bool                AlwaysUseDatabaseCatchup()          { return false; }
+    unsigned            GetPipelineDepth()                  { return 4; }
+    bool                IsPaxosBlocked()                    { return false; }
+    Buffer&             GetNextValue()                      { return nextValue; }
+
+    void                OnStartProposing()                  {}
+    void                OnAppend(uint64_t, Buffer&, bool)   {}
+    void                OnMessage(ReadBuffer)               {}
+    void                OnMessageProcessed()                { numProcessed++; }
+    void                OnStartCatchup()                    {}
+    void                OnCatchupStarted()                  {}
+    void                OnCatchupComplete(uint64_t)         {}
+
+    void                StopReplication()                   {}
+    void                ContinueReplication()               {}
+
+    bool                IsWaitingOnAppend()                 { return false; }
+
+    unsigned            numProcessed;
+
+private:
+    uint64_t            paxosID;
+    MajorityQuorum      quorum;
+    QuorumDatabase      database;
+    QuorumTransport     transport;
+    StorageShardProxy   paxosShard;
+    StorageShardProxy   logShard;
+    Buffer              nextValue;
+};
+
+void TestQuorumContext::Init(StorageEnvironment* env)
+{
+    if (!env->ShardExists(QUORUM_DATABASE_QUORUM_PAXOS_CONTEXT, TEST_QUORUMID))
+    {
+        env->CreateShard(TEST_QUORUMID, QUORUM_DATABASE_QUORUM_PAXOS_CONTEXT, TEST_QUORUMID, 0,
+         "", "", true, STORAGE_SHARD_TYPE_DUMP);
+        env->CreateShard(TEST_QUORUMID, QUORUM_DATABASE_QUORUM_LOG_CONTEXT, TEST_QUORUMID, 0,
+         "", "", true, STORAGE_SHARD_TYPE_LOG);
+    }
+
+    paxosShard.Init(env, QUORUM_DATABASE_QUORUM_PAXOS_CONTEXT, TEST_QUORUMID);
+    logShard.Init(env, QUORUM_DATABASE_QUORUM_LOG_CONTEXT, TEST_QUORUMID);
+    database.Init(this, &paxosShard, &logShard);
+
+    if (quorum.GetNumNodes() == 0)
+    {
+        quorum.AddNode(MY_NODEID);
+        quorum.AddNode(MY_NODEID + 1);
+        quorum.AddNode(MY_NODEID + 2);
+    }
+    transport.SetQuorum(&quorum);
+    transport.SetQuorumID(TEST_QUORUMID);
+
+    paxosID = 0;
+    numProcessed = 0;
+}
+
+static void SetupPaxosTest(StorageEnvironment& env, Buffer& envPath)
+{
+    IOProcessor::Init(1024);
+    EventLoop::Init();
+    StartClock();
+
+    envPath.Write("test/paxos/");
+    envPath.NullTerminate();
+    FS_RecDeleteDir(envPath.GetBuffer());
+    FS_CreateDir("test");
+    envPath.SetLength(envPath.GetLength() - 1);
+
+    paxosConfig.SetChunkSize(64*KiB);
+    paxosConfig.SetLogSegmentSize(1*MiB);
+    paxosConfig.SetFileChunkCacheSize(1*MiB);
+    paxosConfig.SetMemoChunkCacheSize(16*MiB);
+    paxosConfig.SetLogSize(16*MiB);
+    paxosConfig.SetMergeBufferSize(1*MiB);
+    paxosConfig.SetSyncGranularity(1*MiB);
+    paxosConfig.SetReplicatedLogSize(16*MiB);
+    env.Open(envPath, paxosConfig);
+}
+
+static void ShutdownPaxosTest(StorageEnvironment& env, Buffer& envPath)
+{
+    env.Close();
+    EventLoop::Shutdown();
+    IOProcessor::Shutdown();
+
+    envPath.NullTerminate();
+    FS_RecDeleteDir(envPath.GetBuffer());
+}
+
+// returns true if the acceptor has rejected the proposal right away
+static bool Propose(PaxosAcceptor& acceptor, uint64_t paxosID, uint64_t proposalID, Buffer& value)
+{
+    PaxosMessage    msg;
+
+    msg.ProposeRequest(paxosID, MY_NODEID + 1, proposalID, 1, value);
+    return acceptor.OnProposeRequest(msg);
+}
+
+static bool Prepare(PaxosAcceptor& acceptor, uint64_t paxosID, uint64_t proposalID)
+{
+    PaxosMessage    msg;
+
+    msg.PrepareRequest(paxosID, MY_NODEID + 1, proposalID);
+    return acceptor.OnPrepareRequest(msg);
+}
+
+TEST_DEFINE(TestPaxosPipelinedAccept)
+{
+    StorageEnvironment  env;
+    Buffer              envPath;
+    Buffer              value;
+    TestQuorumContext   context;
+    PaxosAcceptor       acceptor;
+
+    SetupPaxosTest(env, envPath);
+    context.Init(&env);
+    acceptor.Init(&context);
+    value.Write("value");
+
+    // nothing is accepted ahead before a prepare
+    TEST_ASSERT(!acceptor.IsPipelineEnabled());
+    TEST_ASSERT(Propose(acceptor, 1, 10, value));
+
+    TEST_ASSERT(!Prepare(acceptor, 0, 10));
+    TEST_ASSERT(acceptor.IsPipelineEnabled());
+    TEST_ASSERT(!Propose(acceptor, 0, 10, value));
+    TEST_ASSERT(!Propose(acceptor, 1, 10, value));
+    TEST_ASSERT(!Propose(acceptor, 2, 10, value));
+
+    // outside of the window
+    TEST_ASSERT(Propose(acceptor, 4, 10, value));
+
+    // only with the proposalID of the last prepare, which covers the rounds ahead
+    TEST_ASSERT(!Prepare(acceptor, 0, 20));
+    TEST_ASSERT(Propose(acceptor, 3, 10, value));
+    TEST_ASSERT(!Propose(acceptor, 3, 20, value));
+
+    // a higher proposalID that was not prepared does not overwrite the rounds ahead
+    TEST_ASSERT(Propose(acceptor, 2, 30, value));
+
+    // the value accepted ahead becomes the state of the round,
+    // and the promise of the last prepare still holds
+    context.SetPaxosID(1);
+    acceptor.OnNewPaxosRound();
+    TEST_ASSERT(acceptor.state.accepted);
+    TEST_ASSERT(acceptor.state.acceptedProposalID == 10);
+    TEST_ASSERT(acceptor.state.promisedProposalID == 20);
+    TEST_ASSERT(Propose(acceptor, 1, 10, value));
+
+    ShutdownPaxosTest(env, envPath);
+
+    return TEST_SUCCESS;
+}
+
+TEST_DEFINE(TestPaxosPipelinedRestart)
+{
+    StorageEnvironment* env;
+    Buffer              envPath;
+    Buffer              value;
+    TestQuorumContext   context;
+    PaxosAcceptor*      acceptor;
+
+    env = new StorageEnvironment;
+    SetupPaxosTest(*env, envPath);
+    context.Init(env);
+    acceptor = new PaxosAcceptor;
+    acceptor->Init(&context);
+    value.Write("value");
+
+    TEST_ASSERT(!Prepare(*acceptor, 0, 10));
+    TEST_ASSERT(!Propose(*acceptor, 0, 10, value));
+    TEST_ASSERT(!Propose(*acceptor, 2, 10, value));
+    delete acceptor;
+
+    // the accepted rounds are recovered from the environment after a restart
+    env->Close();
+    delete env;
+    EventLoop::Shutdown();
+    EventLoop::Init();
+    env = new StorageEnvironment;
+    env->Open(envPath, paxosConfig);
+    context.Init(env);
+    acceptor = new PaxosAcceptor;
+    acceptor->Init(&context);
+    TEST_ASSERT(acceptor->state.accepted);
+    TEST_ASSERT(acceptor->state.promisedProposalID == 10);
+
+    // pipelining is enabled again only by a prepare
+    TEST_ASSERT(!acceptor->IsPipelineEnabled());
+    TEST_ASSERT(Propose(*acceptor, 1, 10, value));
+    TEST_ASSERT(!Prepare(*acceptor, 0, 30));
+    TEST_ASSERT(Propose(*acceptor, 1, 10, value));
+    TEST_ASSERT(!Propose(*acceptor, 1, 30, value));
+
+    // both rounds accepted ahead are still there
+    context.SetPaxosID(1);
+    acceptor->OnNewPaxosRound();
+    TEST_ASSERT(acceptor->state.accepted && acceptor->state.acceptedProposalID == 30);
+    context.SetPaxosID(2);
+    acceptor->OnNewPaxosRound();
+    TEST_ASSERT(acceptor->state.accepted && acceptor->state.acceptedProposalID == 10);
+    TEST_ASSERT(acceptor->state.promisedProposalID == 30);
+    delete acceptor;
+
+    ShutdownPaxosTest(*env, envPath);
+    delete env;
+
+    return TEST_SUCCESS;
+}
+
+TEST_DEFINE(TestPaxosPipelineRecovery)
+{
+    StorageEnvironment  env;
+    Buffer              envPath;
+    Buffer              value;
+    TestQuorumContext   context;
+    PaxosProposer       proposer;
+    PaxosMessage        msg;
+
+    SetupPaxosTest(env, envPath);
+    context.Init(&env);
+    proposer.Init(&context);
+    proposer.SetUseTimeouts(false);
+    value.Write("value");
+
+    // even in multi paxos, the first round after a restart is prepared
+    proposer.state.multi = true;
+    TEST_ASSERT(!proposer.IsPipelineEnabled());
+    proposer.Propose(value);
+    TEST_ASSERT(proposer.state.preparing);
+
+    msg.PrepareCurrentlyOpen(0, MY_NODEID, proposer.state.proposalID);
+    proposer.OnPrepareResponse(msg);
+    msg.PrepareCurrentlyOpen(0, MY_NODEID + 1, proposer.state.proposalID);
+    proposer.OnPrepareResponse(msg);
+    TEST_ASSERT(proposer.state.proposing);
+    TEST_ASSERT(proposer.IsPipelineEnabled());
+
+    // a rejected pipelined proposal disables pipelining
+    proposer.ProposePipelined(1, value);
+    TEST_ASSERT(proposer.GetNumPipelined() == 1);
+    msg.ProposeRejected(1, MY_NODEID + 1, proposer.state.proposalID);
+    proposer.OnPipelinedProposeResponse(msg);
+    TEST_ASSERT(proposer.IsPipelineBroken());
+    TEST_ASSERT(!proposer.IsPipelineEnabled());
+
+    // the rejected value is prepared again when its round comes
+    msg.ProposeAccepted(0, MY_NODEID, proposer.state.proposalID);
+    proposer.OnProposeResponse(msg);
+    msg.ProposeAccepted(0, MY_NODEID + 1, proposer.state.proposalID);
+    proposer.OnProposeResponse(msg);
+    TEST_ASSERT(proposer.IsLearnSent());
+    context.SetPaxosID(1);
+    proposer.state.OnNewPaxosRound();
+    TEST_ASSERT(proposer.ContinuePipelined());
+    TEST_ASSERT(proposer.state.preparing);
+    TEST_ASSERT(!proposer.IsPipelineBroken());
+
+    msg.PrepareCurrentlyOpen(1, MY_NODEID, proposer.state.proposalID);
+    proposer.OnPrepareResponse(msg);
+    msg.PrepareCurrentlyOpen(1, MY_NODEID + 1, proposer.state.proposalID);
+    proposer.OnPrepareResponse(msg);
+    TEST_ASSERT(proposer.IsPipelineEnabled());
+
+    // the loss of the lease disables it again
+    proposer.Stop();
+    TEST_ASSERT(!proposer.IsPipelineEnabled());
+
+    proposer.RemoveTimers();
+    ShutdownPaxosTest(env, envPath);
+
+    return TEST_SUCCESS;
+}
+
+TEST_DEFINE(TestPaxosPipelinePrepare)
+{
+    StorageEnvironment  env;
+    Buffer              envPath;
+    Buffer              value;
+    Buffer              accepted;
+    Buffer              dummy;
+    TestQuorumContext   context;
+    PaxosProposer       proposer;
+    PaxosMessage        msg;
+
+    SetupPaxosTest(env, envPath);
+    context.Init(&env);
+    proposer.Init(&context);
+    proposer.SetUseTimeouts(false);
+    dummy.Write("dummy");
+    proposer.SetDummy(dummy);
+    value.Write("value");
+    accepted.Write("accepted");
+
+    // a new leader prepares, one acceptor reports a value accepted for round 2
+    // from the previous leader, and an older one from another acceptor
+    proposer.state.multi = true;
+    proposer.Propose(value);
+    TEST_ASSERT(proposer.state.preparing);
+
+    msg.PreparePipelinedAccepted(2, MY_NODEID, proposer.state.proposalID, 10, 7, accepted);
+    proposer.OnPipelinedPrepareResponse(msg);
+    msg.PreparePipelinedAccepted(2, MY_NODEID + 1, proposer.state.proposalID, 5, 8, value);
+    proposer.OnPipelinedPrepareResponse(msg);
+    TEST_ASSERT(!proposer.IsPipelineEnabled());
+
+    // reports from outside the window are ignored
+    msg.PreparePipelinedAccepted(4, MY_NODEID + 1, proposer.state.proposalID, 10, 7, value);
+    proposer.OnPipelinedPrepareResponse(msg);
+
+    msg.PrepareCurrentlyOpen(0, MY_NODEID, proposer.state.proposalID);
+    proposer.OnPrepareResponse(msg);
+    msg.PrepareCurrentlyOpen(0, MY_NODEID + 1, proposer.state.proposalID);
+    proposer.OnPrepareResponse(msg);
+    TEST_ASSERT(proposer.state.proposing);
+    TEST_ASSERT(proposer.IsPipelineEnabled());
+
+    // the reported value is proposed again in its round, after a dummy in round 1,
+    // and new values only come after them
+    TEST_ASSERT(proposer.GetNumPipelined() == 2);
+    proposer.ProposePipelined(3, value);
+
+    msg.ProposeAccepted(0, MY_NODEID, proposer.state.proposalID);
+    proposer.OnProposeResponse(msg);
+    msg.ProposeAccepted(0, MY_NODEID + 1, proposer.state.proposalID);
+    proposer.OnProposeResponse(msg);
+    TEST_ASSERT(proposer.IsLearnSent());
+
+    context.SetPaxosID(1);
+    proposer.state.OnNewPaxosRound();
+    TEST_ASSERT(proposer.ContinuePipelined());
+    TEST_ASSERT(proposer.state.proposing);
+    TEST_ASSERT(BUFCMP(&proposer.state.proposedValue, &dummy));
+    TEST_ASSERT(proposer.state.proposedRunID == REPLICATION_CONFIG->GetRunID());
+
+    proposer.RemoveTimers();
+    proposer.state.OnNewPaxosRound();
+    context.SetPaxosID(2);
+    TEST_ASSERT(proposer.ContinuePipelined());
+    TEST_ASSERT(BUFCMP(&proposer.state.proposedValue, &accepted));
+    TEST_ASSERT(proposer.state.proposedRunID == 7);
+
+    proposer.RemoveTimers();
+    proposer.state.OnNewPaxosRound();
+    context.SetPaxosID(3);
+    TEST_ASSERT(proposer.ContinuePipelined());
+    TEST_ASSERT(BUFCMP(&proposer.state.proposedValue, &value));
+    TEST_ASSERT(proposer.GetNumPipelined() == 0);
+
+    proposer.RemoveTimers();
+    ShutdownPaxosTest(env, envPath);
+
+    return TEST_SUCCESS;
+}
@@ -0,0 +1,402 @@
+#include "Test.h"
+#include "System/Stopwatch.h"
+#include "System/Buffers/Buffer.h"
+#include "Application/SDBP/SDBPRequestMessage.h"
+#include "Application/SDBP/SDBPResponseMessage.h"
+
+static bool RoundtripRequest(ClientRequest& request, bool binary, ClientRequest& parsed)
+{
+    SDBPRequestMessage  msg;
+    Buffer              buffer;
+    ReadBuffer          rb;
+
+    msg.request = &request;
+    msg.binary = binary;
+    if (!msg.Write(buffer))
+        return false;
+
+    rb.Wrap(buffer);
+    if (SDBPRequestMessage::IsBinary(rb) != binary)
+        return false;
+    parsed.Init();
+    msg.request = &parsed;
+    return msg.Read(rb);
+}
+
+TEST_DEFINE(TestSDBPMessageBinaryRoundtrip)
+{
+    ClientRequest       request;
+    ClientRequest       parsed;
+    ClientResponse      response;
+    ClientResponse      parsedResponse;
+    SDBPResponseMessage msg;
+    List<uint64_t>      nodes;
+    uint64_t            nodeID;
+    ReadBuffer          key, value, test, rb;
+    ReadBuffer          keys[2];
+    Buffer              buffer;
+
+    key.Wrap("key");
+    value.Wrap("value");
+    test.Wrap("");
+
+    request.TestAndSet(1, 2, 3, key, test, value);
+    TEST_ASSERT(RoundtripRequest(request, true, parsed));
+    TEST_ASSERT(parsed.type == CLIENTREQUEST_TEST_AND_SET);
+    TEST_ASSERT(parsed.commandID == 1 && parsed.configPaxosID == 2 && parsed.tableID == 3);
+    TEST_ASSERT(Buffer::Cmp(parsed.key, request.key) == 0);
+    TEST_ASSERT(Buffer::Cmp(parsed.test, request.test) == 0);
+    TEST_ASSERT(Buffer::Cmp(parsed.value, request.value) == 0);
+
+    request.Init();
+    request.Add(4, 5, 6, key, -1000);
+    request.transactional = true;
+    TEST_ASSERT(RoundtripRequest(request, true, parsed));
+    TEST_ASSERT(parsed.type == CLIENTREQUEST_ADD && parsed.number == -1000 && parsed.transactional);
+
+    request.Init();
+    request.ListKeyValues(7, 8, 9, key, value, test, 100, false);
+    TEST_ASSERT(RoundtripRequest(request, true, parsed));
+    TEST_ASSERT(parsed.type == CLIENTREQUEST_LIST_KEYVALUES);
+    TEST_ASSERT(parsed.count == 100 && parsed.forwardDirection == false);
+    TEST_ASSERT(Buffer::Cmp(parsed.endKey, request.endKey) == 0);
+    TEST_ASSERT(parsed.filter.GetLength() == 0);
+
+    request.filter.Write("keyprefix(a) first(10)");
+    TEST_ASSERT(RoundtripRequest(request, true, parsed));
+    TEST_ASSERT(Buffer::Cmp(parsed.filter, request.filter) == 0);
+
+    for (nodeID = 100; nodeID < 102; nodeID++)
+        nodes.Append(nodeID);
+    request.Init();
+    request.CreateQuorum(10, key, nodes);
+    TEST_ASSERT(RoundtripRequest(request, true, parsed));
+    TEST_ASSERT(parsed.nodes.GetLength() == 2 && *parsed.nodes.Last() == 101);
+
+    // text requests are still accepted
+    TEST_ASSERT(RoundtripRequest(request, false, parsed));
+    TEST_ASSERT(parsed.nodes.GetLength() == 2);
+
+    // responses
+    keys[0].Wrap("a");
+    keys[1].Wrap("b");
+    response.request = &request;
+    response.ListKeys(2, keys);
+    msg.response = &response;
+    msg.binary = true;
+    TEST_ASSERT(msg.Write(buffer));
+    rb.Wrap(buffer);
+    msg.response = &parsedResponse;
+    TEST_ASSERT(msg.Read(rb));
+    TEST_ASSERT(parsedResponse.type == CLIENTRESPONSE_LIST_KEYS);
+    TEST_ASSERT(parsedResponse.commandID == 10 && parsedResponse.numKeys == 2);
+    TEST_ASSERT(ReadBuffer::Cmp(parsedResponse.keys[1], keys[1]) == 0);
+
+    response.OK();
+    response.paxosID = 12345;
+    msg.response = &response;
+    TEST_ASSERT(msg.Write(buffer));
+    rb.Wrap(buffer);
+    parsedResponse.Clear();
+    msg.response = &parsedResponse;
+    TEST_ASSERT(msg.Read(rb));
+    TEST_ASSERT(parsedResponse.type == CLIENTRESPONSE_OK && parsedResponse.paxosID == 12345);
+
+    // truncated messages are rejected
+    rb.Wrap(buffer.GetBuffer(), buffer.GetLength() - 1);
+    TEST_ASSERT(!msg.Read(rb));
+
+    return TEST_SUCCESS;
+}
+
+TEST_DEFINE(TestSDBPMessageMultiRoundtrip)
+{
+    ClientRequest       multi;
+    ClientRequest       requests[3];
+    ClientRequest*      items[3];
+    ClientRequest       parsed;
+    ClientRequest       parsedItem;
+    ClientResponse      parsedResponse;
+    SDBPRequestMessage  requestMsg;
+    SDBPResponseMessage responseMsg;
+    Buffer              keys[3];
+    Buffer              buffer;
+    ReadBuffer          key, value, rb, item;
+    unsigned            i;
+    int                 binary;
+
+    value.Wrap("value");
+    for (binary = 0; binary < 2; binary++)
+    {
+        for (i = 0; i < SIZE(requests); i++)
+        {
+            keys[i].Writef("key%u", i);
+            key.Wrap(keys[i]);
+            requests[i].Set(100 + i, 2, 3, key, value);
+            items[i] = &requests[i];
+        }
+        multi.Init();
+        multi.type = CLIENTREQUEST_MULTI_SET;
+        multi.commandID = 100;
+        multi.configPaxosID = 2;
+        multi.tableID = 3;
+        multi.items = items;
+        multi.numItems = SIZE(requests);
+
+        buffer.Clear();
+        requestMsg.request = &multi;
+        requestMsg.binary = (binary != 0);
+        TEST_ASSERT(requestMsg.Write(buffer));
+        rb.Wrap(buffer);
+        parsed.Init();
+        requestMsg.request = &parsed;
+        TEST_ASSERT(requestMsg.Read(rb));
+        TEST_ASSERT(parsed.type == CLIENTREQUEST_MULTI_SET && parsed.numItems == SIZE(requests));
+        for (i = 0; i < SIZE(requests); i++)
+        {
+            parsedItem.Init();
+            TEST_ASSERT(requestMsg.ReadMultiItem(&parsedItem));
+            TEST_ASSERT(parsedItem.type == CLIENTREQUEST_SET && parsedItem.commandID == 100 + i);
+            TEST_ASSERT(parsedItem.tableID == 3 && Buffer::Cmp(parsedItem.key, keys[i]) == 0);
+            TEST_ASSERT(Buffer::Cmp(parsedItem.value, requests[i].value) == 0);
+        }
+        TEST_ASSERT(!requestMsg.ReadMultiItem(&parsedItem));
+
+        // one response carries the responses of all items
+        for (i = 0; i < SIZE(requests); i++)
+        {
+            requests[i].response.request = &requests[i];
+            requests[i].response.OK();
+        }
+        requests[1].response.Failed();
+        multi.response.request = &multi;
+        multi.response.Multi();
+        responseMsg.response = &multi.response;
+        responseMsg.binary = (binary != 0);
+        TEST_ASSERT(responseMsg.Write(buffer));
+        rb.Wrap(buffer);
+        parsedResponse.Init();
+        responseMsg.response = &parsedResponse;
+        TEST_ASSERT(responseMsg.Read(rb));
+        TEST_ASSERT(parsedResponse.type == CLIENTRESPONSE_MULTI);
+        for (i = 0; i < SIZE(requests); i++)
+        {
+            TEST_ASSERT(responseMsg.ReadMultiItem(item));
+            parsedResponse.Init();
+            TEST_ASSERT(responseMsg.Read(item));
+            TEST_ASSERT(parsedResponse.commandID == 100 + i);
+            TEST_ASSERT(parsedResponse.type == (i == 1 ? CLIENTRESPONSE_FAILED : CLIENTRESPONSE_OK));
+        }
+        TEST_ASSERT(!responseMsg.ReadMultiItem(item));
+
+        multi.items = NULL;
+        multi.numItems = 0;
+    }
+
+    return TEST_SUCCESS;
+}
+
+// one request: the client writes a SET, the server reads it and writes
+// the OK response, the client reads the response
+static long RunRequests(unsigned num, bool binary, unsigned& numBytes)
+{
+    ClientRequest       request;
+    ClientRequest       serverRequest;
+    ClientResponse      clientResponse;
+    SDBPRequestMessage  requestMsg;
+    SDBPResponseMessage responseMsg;
+    Buffer              key, value, wire;
+    ReadBuffer          rbKey, rbValue, rb;
+    Stopwatch           sw;
+    unsigned            i;
+
+    value.Append('x', 100);
+    rbValue.Wrap(value);
+    numBytes = 0;
+    requestMsg.binary = binary;
+    responseMsg.binary = binary;
+
+    sw.Restart();
+    for (i = 0; i < num; i++)
+    {
+        key.Writef("user:%u", i);
+        rbKey.Wrap(key);
+        request.Set(1000000 + i, 42, 3, rbKey, rbValue);
+
+        wire.Clear();
+        requestMsg.request = &request;
+        requestMsg.Write(wire);
+        numBytes += wire.GetLength();
+
+        rb.Wrap(wire);
+        serverRequest.Init();
+        requestMsg.request = &serverRequest;
+        if (!requestMsg.Read(rb))
+            return -1;
+
+        serverRequest.response.request = &serverRequest;
+        serverRequest.response.OK();
+        serverRequest.response.paxosID = 1000 + i;
+        wire.Clear();
+        responseMsg.response = &serverRequest.response;
+        responseMsg.Write(wire);
+        numBytes += wire.GetLength();
+
+        rb.Wrap(wire);
+        clientResponse.Init();
+        responseMsg.response = &clientResponse;
+        if (!responseMsg.Read(rb) || clientResponse.commandID != request.commandID)
+            return -1;
+    }
+    sw.Stop();
+
+    return (long) sw.Elapsed();
+}
+
+TEST_DEFINE(TestSDBPMessageRequestRate)
+{
+    const unsigned  num = 1000*1000;
+    long            elapsed;
+    unsigned        numBytes;
+
+    elapsed = RunRequests(num, false, numBytes);
+    TEST_ASSERT(elapsed >= 0);
+    TEST_LOG("text:   %ld msec, %.0f req/sec, %u bytes/req",
+     elapsed, num * 1000.0 / MAX(elapsed, 1), numBytes / num);
+
+    elapsed = RunRequests(num, true, numBytes);
+    TEST_ASSERT(elapsed >= 0);
+    TEST_LOG("binary: %ld msec, %.0f req/sec, %u bytes/req",
+     elapsed, num * 1000.0 / MAX(elapsed, 1), numBytes / num);
+
+    return TEST_SUCCESS;
+}
+
+TEST_DEFINE(TestSDBPMessageVersionRoundtrip)
+{
+    ClientRequest       request;
+    ClientRequest       parsed;
+    ClientResponse      response;
+    ClientResponse      parsedResponse;
+    SDBPResponseMessage msg;
+    ReadBuffer          key, value, rb;
+    Buffer              buffer;
+    unsigned            i;
+    bool                binary;
+
+    key.Wrap("key");
+    value.Wrap("a value much larger than the version");
+
+    for (i = 0; i < 2; i++)
+    {
+        binary = (i == 0);
+
+        request.Init();
+        request.SetIfVersion(1, 2, 3, key, value, 1234567, 89);
+        TEST_ASSERT(RoundtripRequest(request, binary, parsed));
+        TEST_ASSERT(parsed.type == CLIENTREQUEST_SET_IF_VERSION);
+        TEST_ASSERT(parsed.versionPaxosID == 1234567 && parsed.versionCommandID == 89);
+        TEST_ASSERT(Buffer::Cmp(parsed.key, request.key) == 0);
+        TEST_ASSERT(Buffer::Cmp(parsed.value, request.value) == 0);
+
+        // version 0:0 means the key must not exist
+        request.Init();
+        request.DeleteIfVersion(4, 5, 6, key, 0, 0);
+        TEST_ASSERT(RoundtripRequest(request, binary, parsed));
+        TEST_ASSERT(parsed.type == CLIENTREQUEST_DELETE_IF_VERSION);
+        TEST_ASSERT(parsed.versionPaxosID == 0 && parsed.versionCommandID == 0);
+
+        // the version is returned with the value
+        response.Init();
+        response.request = &request;
+        response.Value(value);
+        response.SetVersion(1234567, 89);
+        msg.response = &response;
+        msg.binary = binary;
+        TEST_ASSERT(msg.Write(buffer));
+        rb.Wrap(buffer);
+        parsedResponse.Clear();
+        msg.response = &parsedResponse;
+        TEST_ASSERT(msg.Read(rb));
+        TEST_ASSERT(parsedResponse.type == CLIENTRESPONSE_VALUE);
+        TEST_ASSERT(ReadBuffer::Cmp(parsedResponse.value, value) == 0);
+        TEST_ASSERT(parsedResponse.versionPaxosID == 1234567);
+        TEST_ASSERT(parsedResponse.versionCommandID == 89);
+
+        // and with the result of a conditional write
+        response.Init();
+        response.request = &request;
+        response.OK();
+        response.SetConditionalSuccess(true);
+        response.SetVersion(1234568, 0);
+        msg.response = &response;
+        TEST_ASSERT(msg.Write(buffer));
+        rb.Wrap(buffer);
+        parsedResponse.Clear();
+        msg.response = &parsedResponse;
+        TEST_ASSERT(msg.Read(rb));
+        TEST_ASSERT(parsedResponse.type == CLIENTRESPONSE_OK);
+        TEST_ASSERT(parsedResponse.isConditionalSuccess);
+        TEST_ASSERT(parsedResponse.versionPaxosID == 1234568);
+        TEST_ASSERT(parsedResponse.versionCommandID == 0);
+    }
+
+    return TEST_SUCCESS;
+}
+
+TEST_DEFINE(TestSDBPMessageOverloaded)
+{
+    ClientRequest       request;
+    ClientRequest       parsed;
+    ClientResponse      response;
+    ClientResponse      parsedResponse;
+    SDBPRequestMessage  requestMsg;
+    SDBPResponseMessage msg;
+    ReadBuffer          key, rb;
+    Buffer              buffer;
+    unsigned            i;
+
+    key.Wrap("key");
+    request.Get(1234, 0, 1, key);
+
+    // the client announces in its binary requests that it knows the OVERLOADED response
+    for (i = 0; i < 2; i++)
+    {
+        buffer.Clear();
+        requestMsg.request = &request;
+        requestMsg.binary = true;
+        requestMsg.overloaded = (i == 0);
+        TEST_ASSERT(requestMsg.Write(buffer));
+        rb.Wrap(buffer);
+        parsed.Init();
+        requestMsg.request = &parsed;
+        requestMsg.overloaded = !requestMsg.overloaded;
+        TEST_ASSERT(requestMsg.Read(rb));
+        TEST_ASSERT(requestMsg.overloaded == (i == 0));
+        TEST_ASSERT(parsed.type == CLIENTREQUEST_GET && parsed.commandID == 1234);
+    }
+
+    // the response carries only the commandID, in both protocols, and
+    // older clients get NOSERVICE instead
+    for (i = 0; i < 4; i++)
+    {
+        response.Init();
+        response.request = &request;
+        response.Overloaded();
+        msg.response = &response;
+        msg.binary = (i % 2 == 0);
+        msg.overloaded = (i < 2);
+        TEST_ASSERT(msg.Write(buffer));
+        rb.Wrap(buffer);
+        parsedResponse.Clear();
+        msg.response = &parsedResponse;
+        TEST_ASSERT(msg.Read(rb));
+        if (i < 2)
+            TEST_ASSERT(parsedResponse.type == CLIENTRESPONSE_OVERLOADED);
+        else
+            TEST_ASSERT(parsedResponse.type == CLIENTRESPONSE_NOSERVICE);
+        TEST_ASSERT(parsedResponse.commandID == 1234);
+    }
+
+    return TEST_SUCCESS;
+}
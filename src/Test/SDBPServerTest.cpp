@@ -0,0 +1,63 @@
+#include "Test.h"
+
+#include "Application/SDBP/SDBPServer.h"
+#include "System/Events/EventLoop.h"
+#include "System/IO/IOProcessor.h"
+
+TEST_DEFINE(TestSDBPServerInFlightLimits)
+{
+    SDBPServer          server;
+    SDBPConnection      conn1;
+    SDBPConnection      conn2;
+
+    IOProcessor::Init(1024);
+    EventLoop::Init();
+
+    // any free port, the test does not connect
+    server.Init(0);
+    server.SetMaxInFlightRequests(4, 2);
+
+    TEST_ASSERT(server.GetNumInFlightRequests() == 0);
+    TEST_ASSERT(!server.IsOverLimit(&conn1, 0));
+
+    // the per session limit pauses only the session
+    server.OnRequestBegin(&conn1, 1);
+    TEST_ASSERT(!server.IsOverLimit(&conn1, 1));
+    server.OnRequestBegin(&conn1, 1);
+    TEST_ASSERT(server.IsOverLimit(&conn1, 2));
+    TEST_ASSERT(!server.IsOverLimit(&conn2, 0));
+
+    // the global limit pauses every session
+    server.OnRequestBegin(&conn2, 2);
+    TEST_ASSERT(server.GetNumInFlightRequests() == 4);
+    TEST_ASSERT(server.IsOverLimit(&conn2, 2));
+    TEST_ASSERT(server.IsOverLimit(&conn1, 1));
+
+    // transactional sessions are never paused, their requests wait for the commit
+    conn2.optimistic = true;
+    TEST_ASSERT(!server.IsOverLimit(&conn2, 2));
+    conn2.optimistic = false;
+
+    server.OnRequestEnd(&conn1);
+    TEST_ASSERT(server.GetNumInFlightRequests() == 3);
+    TEST_ASSERT(!server.IsOverLimit(&conn1, 1));
+    TEST_ASSERT(server.IsOverLimit(&conn2, 2));
+    server.OnRequestEnd(&conn2);
+    TEST_ASSERT(!server.IsOverLimit(&conn2, 1));
+
+    server.OnRequestEnd(&conn1);
+    server.OnRequestEnd(&conn2);
+    TEST_ASSERT(server.GetNumInFlightRequests() == 0);
+
+    // 0 turns the limits off
+    server.SetMaxInFlightRequests(0, 0);
+    server.OnRequestBegin(&conn1, 1);
+    TEST_ASSERT(!server.IsOverLimit(&conn1, 100));
+    server.OnRequestEnd(&conn1);
+
+    server.Shutdown();
+    EventLoop::Shutdown();
+    IOProcessor::Shutdown();
+
+    return TEST_SUCCESS;
+}
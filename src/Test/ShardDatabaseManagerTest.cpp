@@ -0,0 +1,136 @@
+#include "Test.h"
+
+#include "Application/Common/KeyValueBatch.h"
+#include "Application/ShardServer/ShardDatabaseManager.h"
+#include "Application/ShardServer/ShardMessage.h"
+#include "Framework/Replication/Quorums/QuorumDatabase.h"
+#include "Framework/Storage/StorageShard.h"
+#include "System/Events/EventLoop.h"
+#include "System/IO/IOProcessor.h"
+#include "System/FileSystem.h"
+#include "System/Config.h"
+
+#define TEST_QUORUMID   1
+#define TEST_SHARDID    2
+#define TEST_TABLEID    1
+#define TEST_DIR        "test/shard_database/"
+
+static void SetupShardDatabaseTest(ShardDatabaseManager& databaseManager)
+{
+    IOProcessor::Init(1024);
+    EventLoop::Init();
+    StartClock();
+
+    FS_RecDeleteDir(TEST_DIR);
+    FS_CreateDir("test");
+    configFile.SetValue("database.dir", TEST_DIR);
+    configFile.SetInt64Value("database.chunkSize", 64*KiB);
+    configFile.SetInt64Value("database.logSegmentSize", 1*MiB);
+    configFile.SetInt64Value("database.memoChunkCacheSize", 16*MiB);
+    configFile.SetInt64Value("database.logSize", 16*MiB);
+
+    databaseManager.Init(NULL);
+    databaseManager.GetEnvironment()->CreateShard(TEST_QUORUMID,
+     QUORUM_DATABASE_DATA_CONTEXT, TEST_SHARDID, TEST_TABLEID, "", "", true, STORAGE_SHARD_TYPE_STANDARD);
+}
+
+static void ShutdownShardDatabaseTest(ShardDatabaseManager& databaseManager)
+{
+    databaseManager.Shutdown();
+    EventLoop::Shutdown();
+    IOProcessor::Shutdown();
+
+    FS_RecDeleteDir(TEST_DIR);
+}
+
+static bool GetVersion(ShardDatabaseManager& databaseManager, const char* key_,
+ uint64_t& paxosID, uint64_t& commandID, Buffer& userValue)
+{
+    ReadBuffer  key(key_);
+    ReadBuffer  value;
+    ReadBuffer  parsed;
+    Buffer      valueBuffer;
+    bool        failed;
+
+    if (!databaseManager.GetEnvironment()->Get(
+     QUORUM_DATABASE_DATA_CONTEXT, TEST_SHARDID, key, value, valueBuffer, failed))
+        return false;
+    if (value.Readf("%U:%U:%R", &paxosID, &commandID, &parsed) < 4)
+        return false;
+    userValue.Write(parsed);
+    return true;
+}
+
+static void SetIfVersion(ShardMessage& message, const char* key, const char* value,
+ uint64_t versionPaxosID, uint64_t versionCommandID)
+{
+    message.type = SHARDMESSAGE_SET_IF_VERSION;
+    message.tableID = TEST_TABLEID;
+    message.key.Wrap(key);
+    message.value.Wrap(value);
+    message.versionPaxosID = versionPaxosID;
+    message.versionCommandID = versionCommandID;
+    message.clientRequest = NULL;
+}
+
+TEST_DEFINE(TestShardDatabaseMigrationVersions)
+{
+    ShardDatabaseManager    databaseManager;
+    ShardMessage            message;
+    KeyValueBatch           batch;
+    Buffer                  block;
+    Buffer                  userValue;
+    ReadBuffer              key;
+    ReadBuffer              value;
+    ReadBuffer              blockBuffer;
+    uint64_t                paxosID;
+    uint64_t                commandID;
+
+    SetupShardDatabaseTest(databaseManager);
+
+    // the source quorum wrote the value in round 10, which is in the past for this quorum
+    key.Wrap("a");
+    value.Wrap("10:0:migrated");
+    message.ShardMigrationSet(TEST_SHARDID, key, value);
+    databaseManager.ExecuteMessage(TEST_QUORUMID, 20, 1, message);
+
+    TEST_ASSERT(GetVersion(databaseManager, "a", paxosID, commandID, userValue));
+    TEST_ASSERT(paxosID == 20 && commandID == 1);
+    TEST_ASSERT(ReadBuffer::Cmp(userValue, "migrated") == 0);
+
+    key.Wrap("b");
+    value.Wrap("7:2:batched");
+    batch.Set(key, value);
+    key.Wrap("c");
+    batch.Delete(key);
+    batch.Write(block, true);
+    blockBuffer.Wrap(block);
+    message.ShardMigrationBatch(TEST_SHARDID, blockBuffer);
+    databaseManager.ExecuteMessage(TEST_QUORUMID, 21, 0, message);
+
+    TEST_ASSERT(GetVersion(databaseManager, "b", paxosID, commandID, userValue));
+    TEST_ASSERT(paxosID == 21 && commandID == 0);
+    TEST_ASSERT(ReadBuffer::Cmp(userValue, "batched") == 0);
+
+    // the version of the source is not accepted anymore
+    SetIfVersion(message, "a", "stale", 10, 0);
+    databaseManager.ExecuteMessage(TEST_QUORUMID, 22, 0, message);
+    TEST_ASSERT(GetVersion(databaseManager, "a", paxosID, commandID, userValue));
+    TEST_ASSERT(ReadBuffer::Cmp(userValue, "migrated") == 0);
+
+    SetIfVersion(message, "b", "stale", 7, 2);
+    databaseManager.ExecuteMessage(TEST_QUORUMID, 22, 1, message);
+    TEST_ASSERT(GetVersion(databaseManager, "b", paxosID, commandID, userValue));
+    TEST_ASSERT(ReadBuffer::Cmp(userValue, "batched") == 0);
+
+    // the version stamped by this quorum matches
+    SetIfVersion(message, "a", "current", 20, 1);
+    databaseManager.ExecuteMessage(TEST_QUORUMID, 23, 0, message);
+    TEST_ASSERT(GetVersion(databaseManager, "a", paxosID, commandID, userValue));
+    TEST_ASSERT(paxosID == 23 && commandID == 0);
+    TEST_ASSERT(ReadBuffer::Cmp(userValue, "current") == 0);
+
+    ShutdownShardDatabaseTest(databaseManager);
+
+    return TEST_SUCCESS;
+}
@@ -0,0 +1,103 @@
+#include "Test.h"
+#include "System/Events/EventLoop.h"
+#include "Application/ShardServer/ShardLoadTracker.h"
+
+TEST_DEFINE(TestShardLoadTrackerCounters)
+{
+    ShardLoadTracker    tracker;
+    ShardLoad*          load;
+    ReadBuffer          key("key");
+    unsigned            i;
+
+    EventLoop::UpdateTime();
+
+    TEST_ASSERT(tracker.GetLoad(1) == NULL);
+
+    for (i = 0; i < 1000; i++)
+    {
+        tracker.OnRead(1, key, 10);
+        tracker.OnRead(1, key, 10);
+        tracker.OnWrite(1, key, 100);
+    }
+    tracker.OnWrite(2, key, 0);
+
+    load = tracker.GetLoad(1);
+    TEST_ASSERT(load != NULL);
+    TEST_ASSERT(load->shardID == 1);
+    TEST_ASSERT(load->numReads == 2000);
+    TEST_ASSERT(load->numWrites == 1000);
+    TEST_ASSERT(load->readBytes == 2000 * (3 + 10));
+    TEST_ASSERT(load->writeBytes == 1000 * (3 + 100));
+    TEST_ASSERT(load->numSamples == SHARD_LOAD_NUM_SAMPLES);
+
+    load = tracker.GetLoad(2);
+    TEST_ASSERT(load != NULL);
+    TEST_ASSERT(load->numReads == 0);
+    TEST_ASSERT(load->numWrites == 1);
+
+    TEST_ASSERT(tracker.GetLoad(3) == NULL);
+
+    // the first update only starts the interval
+    tracker.Update();
+    TEST_ASSERT(tracker.GetLoad(1)->numReads == 2000);
+
+    MSleep(SHARD_LOAD_INTERVAL + 100);
+    EventLoop::UpdateTime();
+    tracker.Update();
+
+    load = tracker.GetLoad(1);
+    TEST_ASSERT(load != NULL);
+    TEST_ASSERT(load->numReads == 0);
+    TEST_ASSERT(load->numWrites == 0);
+    TEST_ASSERT(load->readRate > 0);
+    TEST_ASSERT(load->writeRate > 0);
+
+    // a shard with a rate below one request per second is dropped
+    TEST_ASSERT(tracker.GetLoad(2) == NULL);
+
+    return TEST_SUCCESS;
+}
+
+TEST_DEFINE(TestShardLoadTrackerSplitKey)
+{
+    ShardLoadTracker    tracker;
+    Buffer              key;
+    Buffer              splitKey;
+    ReadBuffer          firstKey;
+    ReadBuffer          lastKey;
+    ReadBuffer          empty;
+    unsigned            i;
+
+    EventLoop::UpdateTime();
+
+    // too few samples for a split key
+    key.Writef("%03u", 0);
+    tracker.OnWrite(1, key, 0);
+    TEST_ASSERT(!tracker.GetSplitKey(1, empty, empty, splitKey));
+    TEST_ASSERT(!tracker.GetSplitKey(2, empty, empty, splitKey));
+
+    // all requests go to the keys 100..199, the split key is their median
+    for (i = 1; i < SHARD_LOAD_NUM_SAMPLES; i++)
+    {
+        key.Writef("%03u", 100 + i * 100 / SHARD_LOAD_NUM_SAMPLES);
+        tracker.OnWrite(1, key, 0);
+    }
+    TEST_ASSERT(tracker.GetSplitKey(1, empty, empty, splitKey));
+    splitKey.NullTerminate();
+    TEST_LOG("split key: %s", splitKey.GetBuffer());
+    TEST_ASSERT(strcmp(splitKey.GetBuffer(), "140") >= 0);
+    TEST_ASSERT(strcmp(splitKey.GetBuffer(), "160") <= 0);
+
+    // the samples outside the range of the shard are skipped
+    firstKey.Wrap("170");
+    TEST_ASSERT(!tracker.GetSplitKey(1, firstKey, empty, splitKey));
+
+    // the split key is never the first key of the shard
+    firstKey.Wrap("100");
+    lastKey.Wrap("199");
+    TEST_ASSERT(tracker.GetSplitKey(1, firstKey, lastKey, splitKey));
+    TEST_ASSERT(ReadBuffer::Cmp(firstKey, splitKey) < 0);
+    TEST_ASSERT(ReadBuffer::Cmp(splitKey, lastKey) < 0);
+
+    return TEST_SUCCESS;
+}
@@ -0,0 +1,218 @@
+#include "Test.h"
+#include "System/Stopwatch.h"
+#include "System/Buffers/Buffer.h"
+#include "Application/ShardServer/ShardMessage.h"
+
+static void FillSet(ShardMessage& message, Buffer& key, Buffer& value, unsigned i)
+{
+    key.Writef("user:%U", (uint64_t) i * 7919);
+    value.Writef("value %u ", i);
+    value.Append('x', 100 - value.GetLength());
+    message.type = SHARDMESSAGE_SET;
+    message.tableID = 1 + (i % 4);
+    message.key.Wrap(key);
+    message.value.Wrap(value);
+}
+
+static bool IsEqual(ShardMessage& a, ShardMessage& b)
+{
+    if (a.type != b.type)
+        return false;
+    switch (a.type)
+    {
+        case SHARDMESSAGE_SET:
+        case SHARDMESSAGE_MIGRATION_SET:
+            return ReadBuffer::Cmp(a.key, b.key) == 0 && ReadBuffer::Cmp(a.value, b.value) == 0;
+        case SHARDMESSAGE_ADD:
+            return ReadBuffer::Cmp(a.key, b.key) == 0 && a.number == b.number;
+        case SHARDMESSAGE_START_TRANSACTION:
+            return ReadBuffer::Cmp(a.value, b.value) == 0;
+        case SHARDMESSAGE_SPLIT_SHARD:
+            return a.shardID == b.shardID && a.newShardID == b.newShardID &&
+             Buffer::Cmp(a.splitKey, b.splitKey) == 0;
+        default:
+            return true;
+    }
+}
+
+TEST_DEFINE(TestShardMessageBinaryRoundtrip)
+{
+    ShardMessage    messages[6];
+    ShardMessage    parsed;
+    Buffer          key, value, encoded;
+    ReadBuffer      rbKey, rbValue, parse;
+    unsigned        i;
+    int             read;
+    uint32_t        length;
+
+    FillSet(messages[0], key, value, 1);
+    messages[1].type = SHARDMESSAGE_ADD;
+    messages[1].tableID = 2;
+    messages[1].key.Wrap("counter");
+    messages[1].number = -12345;
+    messages[2].StartTransaction();
+    messages[3].type = SHARDMESSAGE_COMMIT_TRANSACTION;
+    rbKey.Wrap("m");
+    messages[4].SplitShard(10, 11, rbKey);
+    rbKey.Wrap("migrated");
+    rbValue.Wrap("");
+    messages[5].ShardMigrationSet(10, rbKey, rbValue);
+
+    for (i = 0; i < SIZE(messages); i++)
+        TEST_ASSERT(messages[i].AppendBinary(encoded));
+
+    // text messages may follow binary ones in the same value
+    messages[0].Append(encoded);
+    encoded.Append(' ');
+
+    parse.Wrap(encoded);
+    for (i = 0; i < SIZE(messages); i++)
+    {
+        TEST_ASSERT(ShardMessage::IsBinary(parse));
+        read = parsed.Read(parse);
+        TEST_ASSERT(read > 0);
+        TEST_ASSERT(IsEqual(messages[i], parsed));
+        parse.Advance(read);
+    }
+
+    TEST_ASSERT(!ShardMessage::IsBinary(parse));
+    read = parsed.Read(parse);
+    TEST_ASSERT(read > 0);
+    TEST_ASSERT(IsEqual(messages[0], parsed));
+    parse.Advance(read + 1);
+    TEST_ASSERT(parse.GetLength() == 0);
+
+    // truncated messages are rejected
+    parse.Wrap(encoded.GetBuffer(), 10);
+    TEST_ASSERT(parsed.Read(parse) == 0);
+
+    // a body ending within the number is rejected, and the number is left alone
+    encoded.Clear();
+    TEST_ASSERT(messages[1].AppendBinary(encoded));
+    memcpy(&length, encoded.GetBuffer() + 1, sizeof(uint32_t));
+    length = ToLittle32(FromLittle32(length) - 1);
+    memcpy(encoded.GetBuffer() + 1, &length, sizeof(uint32_t));
+    parse.Wrap(encoded.GetBuffer(), encoded.GetLength() - 1);
+    parsed.number = 1;
+    TEST_ASSERT(parsed.Read(parse) == 0);
+    TEST_ASSERT(parsed.number == 1);
+
+    return TEST_SUCCESS;
+}
+
+TEST_DEFINE(TestShardMessageTransactionReadVersions)
+{
+    ShardMessage    messages[3];
+    ShardMessage    parsed;
+    Buffer          readVersions, text, binary;
+    ReadBuffer      parse;
+    unsigned        i;
+    int             read;
+
+    // the read versions are opaque to the message, only the length matters
+    readVersions.Write("\x01\x04user\x05\x00", 8);
+    readVersions.Append("\x01\x04item\x00\x00 with:colons", 20);
+
+    messages[0].StartTransaction();
+    messages[0].value.Wrap(readVersions);
+    // a lock based transaction after an optimistic one has no read versions
+    messages[1].StartTransaction();
+    messages[2].type = SHARDMESSAGE_COMMIT_TRANSACTION;
+
+    for (i = 0; i < SIZE(messages); i++)
+    {
+        TEST_ASSERT(messages[i].Append(text));
+        text.Append(' ');
+        TEST_ASSERT(messages[i].AppendBinary(binary));
+    }
+
+    parse.Wrap(text);
+    for (i = 0; i < SIZE(messages); i++)
+    {
+        read = parsed.Read(parse);
+        TEST_ASSERT(read > 0);
+        TEST_ASSERT(IsEqual(messages[i], parsed));
+        parse.Advance(read + 1);
+    }
+    TEST_ASSERT(parse.GetLength() == 0);
+
+    parse.Wrap(binary);
+    for (i = 0; i < SIZE(messages); i++)
+    {
+        read = parsed.Read(parse);
+        TEST_ASSERT(read > 0);
+        TEST_ASSERT(IsEqual(messages[i], parsed));
+        parse.Advance(read);
+    }
+    TEST_ASSERT(parse.GetLength() == 0);
+
+    return TEST_SUCCESS;
+}
+
+TEST_DEFINE(TestShardMessageEncodingTiming)
+{
+    const unsigned  num = 1000*1000;
+    const unsigned  numDistinct = 1024;
+    ShardMessage*   messages;
+    ShardMessage    parsed;
+    Buffer*         keys;
+    Buffer*         values;
+    Buffer          text, binary;
+    ReadBuffer      parse;
+    Stopwatch       sw;
+    unsigned        i;
+    int             read;
+
+    messages = new ShardMessage[numDistinct];
+    keys = new Buffer[numDistinct];
+    values = new Buffer[numDistinct];
+    for (i = 0; i < numDistinct; i++)
+        FillSet(messages[i], keys[i], values[i], i);
+
+    // encode
+    sw.Restart();
+    for (i = 0; i < num; i++)
+    {
+        messages[i % numDistinct].Append(text);
+        text.Append(' ');
+    }
+    sw.Stop();
+    TEST_LOG("text encode:   %ld msec, %u bytes", (long) sw.Elapsed(), text.GetLength());
+
+    sw.Restart();
+    for (i = 0; i < num; i++)
+        messages[i % numDistinct].AppendBinary(binary);
+    sw.Stop();
+    TEST_LOG("binary encode: %ld msec, %u bytes", (long) sw.Elapsed(), binary.GetLength());
+
+    TEST_LOG("binary/text size: %.1f%%", 100.0 * binary.GetLength() / text.GetLength());
+
+    // decode
+    sw.Restart();
+    parse.Wrap(text);
+    while (parse.GetLength() > 0)
+    {
+        read = parsed.Read(parse);
+        TEST_ASSERT(read > 0);
+        parse.Advance(read + 1);
+    }
+    sw.Stop();
+    TEST_LOG("text decode:   %ld msec", (long) sw.Elapsed());
+
+    sw.Restart();
+    parse.Wrap(binary);
+    while (parse.GetLength() > 0)
+    {
+        read = parsed.Read(parse);
+        TEST_ASSERT(read > 0);
+        parse.Advance(read);
+    }
+    sw.Stop();
+    TEST_LOG("binary decode: %ld msec", (long) sw.Elapsed());
+
+    delete[] messages;
+    delete[] keys;
+    delete[] values;
+
+    return TEST_SUCCESS;
+}
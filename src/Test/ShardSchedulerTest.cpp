@@ -0,0 +1,83 @@
+#include "Test.h"
+
+#include "Application/ShardServer/ShardScheduler.h"
+
+static void RunSlice(ShardScheduler& scheduler, int cls)
+{
+    scheduler.Begin(cls);
+    while (!scheduler.IsSliceExpired())
+        ;
+    scheduler.End();
+}
+
+TEST_DEFINE(TestShardSchedulerWeights)
+{
+    ShardScheduler          scheduler;
+    ShardSchedulerClass*    read;
+    ShardSchedulerClass*    migration;
+    unsigned                round;
+
+    scheduler.SetWeight(SHARD_SCHEDULER_READ, 100);
+    scheduler.SetWeight(SHARD_SCHEDULER_MIGRATION, 10);
+    scheduler.SetLatencyTarget(SHARD_SCHEDULER_READ, 0);
+
+    // a class alone gets the full quantum
+    TEST_ASSERT(scheduler.GetSliceLength(SHARD_SCHEDULER_MIGRATION) == scheduler.GetQuantum());
+
+    // both classes always have work, the time is shared by the weights
+    for (round = 0; round < 50; round++)
+    {
+        RunSlice(scheduler, SHARD_SCHEDULER_READ);
+        RunSlice(scheduler, SHARD_SCHEDULER_MIGRATION);
+    }
+
+    read = scheduler.GetClass(SHARD_SCHEDULER_READ);
+    migration = scheduler.GetClass(SHARD_SCHEDULER_MIGRATION);
+    printf("busyTime read: %u, migration: %u\n", (unsigned) read->busyTime, (unsigned) migration->busyTime);
+    TEST_ASSERT(read->busyTime > 3 * migration->busyTime);
+    TEST_ASSERT(scheduler.IsDeferred(SHARD_SCHEDULER_MIGRATION));
+    TEST_ASSERT(!scheduler.IsDeferred(SHARD_SCHEDULER_READ));
+
+    // nothing is deferred when the scheduler is disabled
+    scheduler.SetEnabled(false);
+    TEST_ASSERT(!scheduler.IsDeferred(SHARD_SCHEDULER_MIGRATION));
+
+    return TEST_SUCCESS;
+}
+
+TEST_DEFINE(TestShardSchedulerLatencyTarget)
+{
+    ShardScheduler      scheduler;
+    Buffer              buffer;
+    unsigned            i;
+
+    // with equal weights the list that ran first is behind
+    scheduler.SetWeight(SHARD_SCHEDULER_READ, 100);
+    scheduler.SetWeight(SHARD_SCHEDULER_LIST, 100);
+    scheduler.SetLatencyTarget(SHARD_SCHEDULER_READ, 20);
+    RunSlice(scheduler, SHARD_SCHEDULER_LIST);
+    RunSlice(scheduler, SHARD_SCHEDULER_READ);
+    TEST_ASSERT(!scheduler.IsDeferred(SHARD_SCHEDULER_LIST));
+
+    // the reads are late, the others run minimal slices
+    for (i = 0; i < 10; i++)
+        scheduler.OnQueueDelay(SHARD_SCHEDULER_READ, 100);
+    TEST_ASSERT(scheduler.GetClass(SHARD_SCHEDULER_READ)->delay > 20);
+    TEST_ASSERT(scheduler.GetSliceLength(SHARD_SCHEDULER_READ) == scheduler.GetQuantum());
+    TEST_ASSERT(scheduler.GetSliceLength(SHARD_SCHEDULER_LIST) == SHARD_SCHEDULER_MIN_SLICE);
+    TEST_ASSERT(scheduler.IsDeferred(SHARD_SCHEDULER_LIST));
+
+    // back on target
+    for (i = 0; i < 50; i++)
+        scheduler.OnQueueDelay(SHARD_SCHEDULER_READ, 0);
+    TEST_ASSERT(!scheduler.IsDeferred(SHARD_SCHEDULER_LIST));
+
+    // 10 samples of 100 msec, 50 of 0 msec
+    scheduler.AppendHistogram(SHARD_SCHEDULER_READ, buffer);
+    buffer.NullTerminate();
+    printf("%s\n", buffer.GetBuffer());
+    TEST_ASSERT(scheduler.GetClass(SHARD_SCHEDULER_READ)->delayHistogram[0] == 50);
+    TEST_ASSERT(scheduler.GetClass(SHARD_SCHEDULER_READ)->delayHistogram[7] == 10);
+
+    return TEST_SUCCESS;
+}
@@ -3,9 +3,18 @@
 #include "Framework/Storage/StorageBulkCursor.h"
 #include "Framework/Storage/StorageEnvironment.h"
 #include "Framework/Storage/StorageAsyncList.h"
+#include "Framework/Storage/StorageValueLog.h"
+#include "Framework/Storage/StorageFileDeleter.h"
+#include "Framework/Storage/StorageLogArchiver.h"
+#include "Framework/Storage/StorageDataPage.h"
+#include "Framework/Storage/StorageChunkReader.h"
+#include "Framework/Storage/StorageFDCache.h"
+#include "System/FileSystem.h"
+#include "System/Registry.h"
 #include "System/Events/EventLoop.h"
 #include "System/IO/IOProcessor.h"
 #include "System/Stopwatch.h"
+#include "System/Time.h"
 #include "System/Config.h"
 
 static StorageConfig    storageConfig;
@@ -119,8 +128,10 @@ TEST_DEFINE(TestStorageSet)
     Buffer              key;
     Buffer              value;
     ReadBuffer          rbValue;
+    Buffer              valueBuffer;
     long                elapsed;
     bool                ret;
+    bool                failed;
     unsigned            num;
   
     // Initialization ==============================================================================
@@ -163,7 +174,7 @@ TEST_DEFINE(TestStorageSet)
         key.Writef("%020u", i);
 
         sw.Start();
-        ret = env.Get(4, 4, key, rbValue);
+        ret = env.Get(4, 4, key, rbValue, valueBuffer, failed);
         sw.Stop();
         TEST_ASSERT(ret);
     }
@@ -176,3 +187,506 @@ TEST_DEFINE(TestStorageSet)
     
     return TEST_SUCCESS;
 }
+
+static bool WriteTestFile(const char* filename, unsigned size)
+{
+    FD          fd;
+    Buffer      data;
+
+    fd = FS_Open(filename, FS_CREATE | FS_WRITEONLY | FS_TRUNCATE);
+    if (fd == INVALID_FD)
+        return false;
+    data.Allocate(size);
+    data.Zero();
+    FS_FileWrite(fd, data.GetBuffer(), size);
+    FS_FileClose(fd);
+    return true;
+}
+
+static unsigned GetNumDeletedFiles(const char* deletedPath)
+{
+    FS_Dir          dir;
+    FS_DirEntry     entry;
+    unsigned        num;
+
+    num = 0;
+    dir = FS_OpenDir(deletedPath);
+    if (dir == FS_INVALID_DIR)
+        return 0;
+    while ((entry = FS_ReadDir(dir)) != FS_INVALID_DIR_ENTRY)
+    {
+        if (!FS_IsSpecial(FS_DirEntryName(entry)))
+            num++;
+    }
+    FS_CloseDir(dir);
+
+    return num;
+}
+
+static bool WaitForDeleter()
+{
+    unsigned    i;
+
+    for (i = 0; i < 500 && StorageFileDeleter::GetNumPending() > 0; i++)
+        MSleep(10);
+
+    return StorageFileDeleter::GetNumPending() == 0;
+}
+
+TEST_DEFINE(TestStorageFileDeleter)
+{
+    Buffer              envPath;
+    StorageFDCacheEntry fdEntry;
+    FD                  fd;
+    uint64_t*           numFilesDeleted;
+    uint64_t            numDeleted;
+
+    envPath.Write("test/deleter/");
+    envPath.NullTerminate();
+    FS_RecDeleteDir(envPath.GetBuffer());
+    FS_CreateDir("test");
+    TEST_ASSERT(FS_CreateDir(envPath.GetBuffer()));
+    envPath.SetLength(envPath.GetLength() - 1);
+
+    configFile.SetIntValue("database.deleteStepSize", 4096);
+    StorageFileDeleter::Init(envPath);
+    StorageFileDeleter::SetBytesPerSec(0);
+
+    // the file leaves its place synchronously, the unlink is done in the background
+    TEST_ASSERT(WriteTestFile("test/deleter/chunk.1", 100000));
+    StorageFileDeleter::Delete("test/deleter/chunk.1");
+    TEST_ASSERT(!FS_Exists("test/deleter/chunk.1"));
+    TEST_ASSERT(WaitForDeleter());
+    TEST_ASSERT(GetNumDeletedFiles("test/deleter/deleted/") == 0);
+
+    // a name deleted again gets a file of its own in deleted/, both are deleted in the background
+    numFilesDeleted = Registry::GetUintPtr("storage.fileDeleter.numFilesDeleted");
+    numDeleted = *numFilesDeleted;
+    TEST_ASSERT(WriteTestFile("test/deleter/chunk.4", 100000));
+    StorageFileDeleter::Delete("test/deleter/chunk.4");
+    TEST_ASSERT(WriteTestFile("test/deleter/chunk.4", 100000));
+    StorageFileDeleter::Delete("test/deleter/chunk.4");
+    TEST_ASSERT(!FS_Exists("test/deleter/chunk.4"));
+    TEST_ASSERT(WaitForDeleter());
+    TEST_ASSERT(*numFilesDeleted == numDeleted + 2);
+    TEST_ASSERT(GetNumDeletedFiles("test/deleter/deleted/") == 0);
+
+    // a file still open in the FD cache is unlinked, but not truncated under its reader
+    TEST_ASSERT(WriteTestFile("test/deleter/chunk.5", 100000));
+    fd = StorageFDCache::Acquire(&fdEntry, "test/deleter/chunk.5");
+    TEST_ASSERT(fd != INVALID_FD);
+    StorageFileDeleter::Delete("test/deleter/chunk.5");
+    TEST_ASSERT(WaitForDeleter());
+    TEST_ASSERT(GetNumDeletedFiles("test/deleter/deleted/") == 0);
+    TEST_ASSERT(FS_FileSize(fd) == 100000);
+    StorageFDCache::Release(&fdEntry);
+    StorageFDCache::Remove(&fdEntry);
+
+    // while disabled, the file stays in place
+    TEST_ASSERT(WriteTestFile("test/deleter/chunk.2", 100000));
+    StorageFileDeleter::SetEnabled(false);
+    StorageFileDeleter::Delete("test/deleter/chunk.2");
+    MSleep(100);
+    TEST_ASSERT(FS_Exists("test/deleter/chunk.2"));
+    TEST_ASSERT(StorageFileDeleter::GetNumPending() == 1);
+    StorageFileDeleter::SetEnabled(true);
+    TEST_ASSERT(WaitForDeleter());
+    TEST_ASSERT(!FS_Exists("test/deleter/chunk.2"));
+    TEST_ASSERT(GetNumDeletedFiles("test/deleter/deleted/") == 0);
+    StorageFileDeleter::Shutdown();
+
+    // the files left in deleted/ by a shutdown are deleted by the next Init()
+    TEST_ASSERT(WriteTestFile("test/deleter/deleted/chunk.3", 100000));
+    StorageFileDeleter::Init(envPath);
+    TEST_ASSERT(WaitForDeleter());
+    TEST_ASSERT(!FS_Exists("test/deleter/deleted/chunk.3"));
+    StorageFileDeleter::Shutdown();
+
+    configFile.SetIntValue("database.deleteStepSize", 0);
+    envPath.NullTerminate();
+    FS_RecDeleteDir(envPath.GetBuffer());
+
+    return TEST_SUCCESS;
+}
+
+static bool ReadTestFile(const char* filename, Buffer& data)
+{
+    FD          fd;
+    int64_t     size;
+
+    fd = FS_Open(filename, FS_READONLY);
+    if (fd == INVALID_FD)
+        return false;
+    size = FS_FileSize(fd);
+    data.Allocate(size);
+    data.SetLength(FS_FileRead(fd, data.GetBuffer(), size));
+    FS_FileClose(fd);
+    return data.GetLength() == size;
+}
+
+static bool WriteTestLogSegment(const char* filename, Buffer& data)
+{
+    FD          fd;
+    unsigned    i;
+
+    // compressible, and longer than one archive block
+    data.Clear();
+    for (i = 0; data.GetLength() < 3 * STORAGE_ARCHIVE_BLOCK_SIZE / 2; i++)
+        data.Appendf("key%u:value%u,", i, i % 100);
+
+    fd = FS_Open(filename, FS_CREATE | FS_WRITEONLY | FS_TRUNCATE);
+    if (fd == INVALID_FD)
+        return false;
+    FS_FileWrite(fd, data.GetBuffer(), data.GetLength());
+    FS_FileClose(fd);
+    return true;
+}
+
+TEST_DEFINE(TestStorageLogArchiver)
+{
+    Buffer      envPath;
+    Buffer      archivePath;
+    Buffer      filename;
+    Buffer      data;
+    Buffer      restored;
+    FD          fd;
+    const char* archived;
+
+    envPath.Write("test/archiver/");
+    envPath.NullTerminate();
+    FS_RecDeleteDir(envPath.GetBuffer());
+    FS_CreateDir("test");
+    TEST_ASSERT(FS_CreateDir(envPath.GetBuffer()));
+    TEST_ASSERT(FS_CreateDir("test/archiver/archives"));
+    envPath.SetLength(envPath.GetLength() - 1);
+    archivePath.Write("test/archiver/archives/");
+
+    StorageFileDeleter::Init(envPath);
+
+    // a compressed segment is restored block by block
+    configFile.SetBoolValue("database.archiveCompression", true);
+    StorageLogArchiver::Init(archivePath);
+    filename.Write("test/archiver/log.1");
+    TEST_ASSERT(WriteTestLogSegment("test/archiver/log.1", data));
+    TEST_ASSERT(StorageLogArchiver::Archive(filename, 1, 1));
+    archived = "test/archiver/archives/log.00000000000000000001.00000000000000000001.lz";
+    TEST_ASSERT(FS_FileSize(archived) < (int64_t) data.GetLength());
+    TEST_ASSERT(StorageLogArchiver::Restore(archived, "test/archiver/restored.1"));
+    TEST_ASSERT(ReadTestFile("test/archiver/restored.1", restored));
+    TEST_ASSERT(Buffer::Cmp(data, restored) == 0);
+
+    // a corrupt block is detected by the checksum
+    fd = FS_Open(archived, FS_READWRITE);
+    TEST_ASSERT(fd != INVALID_FD);
+    FS_FileWriteOffs(fd, "XXXX", 4, STORAGE_ARCHIVE_BLOCK_HEAD_SIZE + 100);
+    FS_FileClose(fd);
+    TEST_ASSERT(!StorageLogArchiver::Restore(archived, "test/archiver/restored.2"));
+    TEST_ASSERT(!FS_Exists("test/archiver/restored.2"));
+    StorageLogArchiver::Shutdown();
+
+    // an uncompressed segment is moved and restored as is
+    configFile.SetBoolValue("database.archiveCompression", false);
+    StorageLogArchiver::Init(archivePath);
+    TEST_ASSERT(StorageLogArchiver::GetNumFiles() == 1);
+    filename.Write("test/archiver/log.2");
+    TEST_ASSERT(WriteTestLogSegment("test/archiver/log.2", data));
+    TEST_ASSERT(StorageLogArchiver::Archive(filename, 1, 2));
+    TEST_ASSERT(!FS_Exists("test/archiver/log.2"));
+    archived = "test/archiver/archives/log.00000000000000000001.00000000000000000002";
+    TEST_ASSERT(StorageLogArchiver::Restore(archived, "test/archiver/restored.3"));
+    TEST_ASSERT(ReadTestFile("test/archiver/restored.3", restored));
+    TEST_ASSERT(Buffer::Cmp(data, restored) == 0);
+    StorageLogArchiver::Shutdown();
+
+    StorageFileDeleter::Shutdown();
+    envPath.NullTerminate();
+    FS_RecDeleteDir(envPath.GetBuffer());
+
+    return TEST_SUCCESS;
+}
+
+TEST_DEFINE(TestStorageValueLog)
+{
+    Buffer                  envPath;
+    Buffer                  value;
+    Buffer                  readValue;
+    Buffer                  pointer1;
+    Buffer                  pointer2;
+    Buffer                  pointer3;
+    Buffer                  newPointer;
+    StorageValueLog         valueLog;
+    StorageValueLog         otherValueLog;
+    Buffer                  otherEnvPath;
+    StorageValueLogGarbage  garbage;
+    StorageValueLogGarbage  referenced;
+    StorageDataPage         dataPage(NULL, 0);
+    StorageFileKeyValue     kv;
+    uint64_t                segmentID1;
+    uint64_t                segmentID2;
+    uint64_t                offset;
+    uint32_t                length;
+    uint64_t                pin1;
+    uint64_t                pin2;
+    uint64_t                relocated;
+    uint64_t                garbageSize;
+    uint64_t*               numBytesRelocated;
+
+    envPath.Write("test/valuelog/");
+    envPath.NullTerminate();
+    FS_RecDeleteDir(envPath.GetBuffer());
+    FS_CreateDir("test");
+    TEST_ASSERT(FS_CreateDir(envPath.GetBuffer()));
+    envPath.SetLength(envPath.GetLength() - 1);
+
+    configFile.SetIntValue("database.valueLogThreshold", 1);
+    configFile.SetValue("database.valueLogTables", "1");
+    configFile.SetIntValue("database.valueLogSegmentSize", 100);
+    StorageFileDeleter::Init(envPath);
+    valueLog.Init(envPath);
+    numBytesRelocated = Registry::GetUintPtr("storage.valueLog.numBytesRelocated");
+
+    // the second value does not fit in the first segment
+    value.Allocate(60);
+    RandomBuffer(value.GetBuffer(), 60);
+    value.SetLength(60);
+    TEST_ASSERT(valueLog.Append(ReadBuffer(value), pointer1));
+    TEST_ASSERT(valueLog.Append(ReadBuffer(value), pointer2));
+    TEST_ASSERT(valueLog.GetNumSegments() == 2);
+    TEST_ASSERT(StorageValueLog::ParsePointer(ReadBuffer(pointer1), segmentID1, offset, length));
+    TEST_ASSERT(StorageValueLog::ParsePointer(ReadBuffer(pointer2), segmentID2, offset, length));
+    TEST_ASSERT(valueLog.Read(ReadBuffer(pointer1), readValue));
+    TEST_ASSERT(Buffer::Cmp(readValue, value) == 0);
+
+    // a reader pinned before the segment became garbage may still read it
+    pin1 = valueLog.Pin();
+    valueLog.AddGarbage(segmentID1, 60);
+    valueLog.Collect();
+    TEST_ASSERT(valueLog.GetNumSegments() == 2);
+    TEST_ASSERT(valueLog.Read(ReadBuffer(pointer1), readValue));
+
+    // the readers pinned after the retirement do not hold the segment
+    pin2 = valueLog.Pin();
+    valueLog.Unpin(pin1);
+    valueLog.Collect();
+    TEST_ASSERT(valueLog.GetNumSegments() == 1);
+    TEST_ASSERT(!valueLog.Read(ReadBuffer(pointer1), readValue));
+    valueLog.Unpin(pin2);
+
+    // the second segment is drained when it is no longer the head,
+    // only the relocations are counted, not the checks
+    TEST_ASSERT(valueLog.Append(ReadBuffer(value), pointer3));
+    valueLog.AddGarbage(segmentID2, 30);
+    valueLog.Collect();
+    relocated = *numBytesRelocated;
+    TEST_ASSERT(valueLog.IsDraining(ReadBuffer(pointer2)));
+    TEST_ASSERT(*numBytesRelocated == relocated);
+    TEST_ASSERT(valueLog.Relocate(ReadBuffer(pointer2), readValue, newPointer));
+    TEST_ASSERT(Buffer::Cmp(readValue, value) == 0);
+    TEST_ASSERT(*numBytesRelocated == relocated + 60);
+    TEST_ASSERT(!valueLog.IsDraining(ReadBuffer(newPointer)));
+
+    // the values in the pages of a deleted shard are garbage, the inline ones are not counted
+    garbageSize = valueLog.GetGarbageSize();
+    kv.SetValueLog(ReadBuffer("key1"), ReadBuffer(pointer3));
+    dataPage.Append(&kv);
+    kv.Set(ReadBuffer("key2"), ReadBuffer(value));
+    dataPage.Append(&kv);
+    dataPage.Finalize();
+    garbage.Add(&dataPage);
+    garbage.Commit(&valueLog);
+    TEST_ASSERT(valueLog.GetGarbageSize() == garbageSize + 60);
+
+    // recovery replaces the garbage counts of the old segments, the head is not counted
+    referenced.Add(segmentID2, 20);
+    referenced.Add(ReadBuffer(pointer3));
+    valueLog.SetReferenced(referenced);
+    TEST_ASSERT(valueLog.GetGarbageSize() == 40);
+
+    // the value logs of two environments are independent
+    otherEnvPath.Write("test/valuelog_other/");
+    otherEnvPath.NullTerminate();
+    FS_RecDeleteDir(otherEnvPath.GetBuffer());
+    TEST_ASSERT(FS_CreateDir(otherEnvPath.GetBuffer()));
+    otherEnvPath.SetLength(otherEnvPath.GetLength() - 1);
+    otherValueLog.Init(otherEnvPath);
+    TEST_ASSERT(otherValueLog.GetNumSegments() == 1);
+    TEST_ASSERT(!otherValueLog.Read(ReadBuffer(pointer3), readValue));
+    TEST_ASSERT(valueLog.Read(ReadBuffer(pointer3), readValue));
+    otherValueLog.Shutdown();
+    otherEnvPath.NullTerminate();
+    FS_RecDeleteDir(otherEnvPath.GetBuffer());
+
+    valueLog.Shutdown();
+    StorageFileDeleter::Shutdown();
+    configFile.SetIntValue("database.valueLogThreshold", 0);
+    envPath.NullTerminate();
+    FS_RecDeleteDir(envPath.GetBuffer());
+
+    return TEST_SUCCESS;
+}
+
+static bool WaitForChunkWrite(StorageEnvironment* env)
+{
+    unsigned    i;
+
+    for (i = 0; i < 1000 && env->GetChunkFileDiskUsage() == 0; i++)
+    {
+        EventLoop::RunOnce();
+        MSleep(10);
+    }
+
+    return env->GetChunkFileDiskUsage() > 0;
+}
+
+TEST_DEFINE(TestStorageValueLogRecovery)
+{
+    StorageEnvironment* env;
+    Buffer              envPath;
+    Buffer              key;
+    Buffer              value;
+    Buffer              pointer;
+    Buffer              valueBuffer;
+    Buffer              otherValueBuffer;
+    ReadBuffer          readValue;
+    ReadBuffer          otherReadValue;
+    bool                failed;
+    unsigned            i;
+
+    IOProcessor::Init(1024);
+    EventLoop::Init();
+    StartClock();
+    SetupDefaultStorageConfig();
+
+    envPath.Write("test/valuelog_recovery/");
+    envPath.NullTerminate();
+    FS_RecDeleteDir(envPath.GetBuffer());
+    FS_CreateDir("test");
+    envPath.SetLength(envPath.GetLength() - 1);
+
+    configFile.SetIntValue("database.valueLogThreshold", 100);
+    configFile.SetValue("database.valueLogTables", "1");
+
+    value.Allocate(1000);
+    RandomBuffer(value.GetBuffer(), 1000);
+    value.SetLength(1000);
+
+    env = new StorageEnvironment;
+    env->Open(envPath, storageConfig);
+    env->CreateShard(1, 1, 1, 1, "", "", true, STORAGE_SHARD_TYPE_STANDARD);
+    for (i = 0; i < 10; i++)
+    {
+        key.Writef("%03u", i);
+        value.GetBuffer()[0] = 'a' + i;
+        TEST_ASSERT(env->Set(1, 1, key, value));
+    }
+    env->Commit(1);
+    TEST_ASSERT(env->PushMemoChunk(1, 1));
+    TEST_ASSERT(WaitForChunkWrite(env));
+    TEST_ASSERT(env->GetValueLog()->GetDiskUsage() == 10 * 1000);
+
+    // a value appended for a chunk that never made it to the TOC
+    TEST_ASSERT(env->GetValueLog()->Append(ReadBuffer(value), pointer));
+    env->Close();
+    delete env;
+
+    // the garbage is found by recovery, and the referenced values are still there
+    env = new StorageEnvironment;
+    env->Open(envPath, storageConfig);
+    TEST_ASSERT(env->GetValueLog()->GetGarbageSize() == 1000);
+    key.Write("009");
+    TEST_ASSERT(env->Get(1, 1, key, readValue, valueBuffer, failed));
+    TEST_ASSERT(ReadBuffer::Cmp(readValue, ReadBuffer(value)) == 0);
+
+    // the value stays valid in the buffer of the caller during the next get
+    key.Write("005");
+    TEST_ASSERT(env->Get(1, 1, key, otherReadValue, otherValueBuffer, failed));
+    TEST_ASSERT(otherReadValue.GetCharAt(0) == 'f');
+    TEST_ASSERT(ReadBuffer::Cmp(readValue, ReadBuffer(value)) == 0);
+    env->Close();
+    delete env;
+
+    EventLoop::Shutdown();
+    IOProcessor::Shutdown();
+    configFile.SetIntValue("database.valueLogThreshold", 0);
+    envPath.NullTerminate();
+    FS_RecDeleteDir(envPath.GetBuffer());
+
+    return TEST_SUCCESS;
+}
+
+TEST_DEFINE(TestStorageChunkReaderAcquireFD)
+{
+    StorageEnvironment* env;
+    StorageFileChunk*   fileChunk;
+    StorageChunkReader  reader;
+    StorageDataPage*    dataPage;
+    Buffer              envPath;
+    Buffer              filename;
+    Buffer              movedFilename;
+    Buffer              key;
+    Buffer              value;
+    ReadBuffer          readValue;
+    Buffer              valueBuffer;
+    bool                failed;
+    unsigned            i;
+    unsigned            numKeys;
+
+    IOProcessor::Init(1024);
+    EventLoop::Init();
+    StartClock();
+    SetupDefaultStorageConfig();
+
+    envPath.Write("test/chunkreader/");
+    envPath.NullTerminate();
+    FS_RecDeleteDir(envPath.GetBuffer());
+    FS_CreateDir("test");
+    envPath.SetLength(envPath.GetLength() - 1);
+
+    env = new StorageEnvironment;
+    env->Open(envPath, storageConfig);
+    env->CreateShard(1, 1, 1, 1, "", "", true, STORAGE_SHARD_TYPE_STANDARD);
+    for (i = 0; i < 10; i++)
+    {
+        key.Writef("%03u", i);
+        value.Writef("value%u", i);
+        TEST_ASSERT(env->Set(1, 1, key, value));
+    }
+    env->Commit(1);
+    TEST_ASSERT(env->PushMemoChunk(1, 1));
+    TEST_ASSERT(WaitForChunkWrite(env));
+
+    fileChunk = (StorageFileChunk*) *env->GetShard(1, 1)->GetChunks().First();
+    TEST_ASSERT(fileChunk->GetChunkState() == StorageChunk::Written);
+    filename.Write(fileChunk->GetFilename());
+    filename.NullTerminate();
+
+    // the file acquired ahead of Open() is not evicted by the reads of other chunks
+    StorageFDCache::SetMaxOpen(1);
+    TEST_ASSERT(reader.AcquireFD(ReadBuffer(filename)));
+    key.Write("005");
+    TEST_ASSERT(env->Get(1, 1, key, readValue, valueBuffer, failed));
+
+    // and the reader does not need the file under its name any more, e.g. after a delete
+    movedFilename.Write(envPath);
+    movedFilename.Append("moved");
+    movedFilename.NullTerminate();
+    TEST_ASSERT(FS_Rename(filename.GetBuffer(), movedFilename.GetBuffer()));
+
+    numKeys = 0;
+    reader.Open(ReadBuffer(filename), 1*MB);
+    for (dataPage = reader.FirstDataPage(); dataPage != NULL; dataPage = reader.NextDataPage())
+        numKeys += dataPage->GetNumKeys();
+    TEST_ASSERT(numKeys == 10);
+
+    TEST_ASSERT(FS_Rename(movedFilename.GetBuffer(), filename.GetBuffer()));
+    StorageFDCache::SetMaxOpen(STORAGE_DEFAULT_MAX_OPEN_CHUNK_FILES);
+    env->Close();
+    delete env;
+
+    EventLoop::Shutdown();
+    IOProcessor::Shutdown();
+    envPath.NullTerminate();
+    FS_RecDeleteDir(envPath.GetBuffer());
+
+    return TEST_SUCCESS;
+}
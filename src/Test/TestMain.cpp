@@ -59,6 +59,10 @@ TEST_ADD(TestFormattingFD);
 TEST_ADD(TestFormattingOverflow);
 TEST_ADD(TestFormattingUnsigned);
 TEST_ADD(TestFormattingPadding);
+TEST_ADD(TestInHashTableBasic);
+TEST_ADD(TestInHashTableRemoveRandom);
+TEST_ADD(TestInHashTableShardLocks);
+TEST_ADD(TestInHashTableSpeed);
 TEST_ADD(TestInTreeMap);
 TEST_ADD(TestInTreeMapInsert);
 TEST_ADD(TestInTreeMapInsertRandom);
@@ -76,15 +80,42 @@ TEST_ADD(TestJSONAdvanced);
 TEST_ADD(TestJSONConfigStateReader);
 TEST_ADD(TestJSONConfigStateReader_ReadAndWrite);
 TEST_ADD(TestJSONConfigStateReader_Benchmark);
+TEST_ADD(TestKeyValueBatchRoundtrip);
+TEST_ADD(TestKeyValueBatchRate);
+TEST_ADD(TestListFilterParse);
+TEST_ADD(TestListFilterMatch);
 TEST_ADD(TestLogRotate);
 TEST_ADD(TestLogRotateMultiThreaded);
 TEST_ADD(TestLogTraceBuffer);
 TEST_ADD(TestManualBasic);
 TEST_ADD(TestMemoryOutOfMemoryError);
+TEST_ADD(TestPaxosPipelinedAccept);
+TEST_ADD(TestPaxosPipelinedRestart);
+TEST_ADD(TestPaxosPipelineRecovery);
+TEST_ADD(TestPaxosPipelinePrepare);
 TEST_ADD(TestSafeFormattingBasic);
+TEST_ADD(TestSDBPMessageBinaryRoundtrip);
+TEST_ADD(TestSDBPMessageMultiRoundtrip);
+TEST_ADD(TestSDBPMessageRequestRate);
+TEST_ADD(TestSDBPMessageOverloaded);
+TEST_ADD(TestSDBPMessageVersionRoundtrip);
+TEST_ADD(TestSDBPServerInFlightLimits);
+TEST_ADD(TestShardDatabaseMigrationVersions);
 TEST_ADD(TestShardExtensionBasic);
+TEST_ADD(TestShardLoadTrackerCounters);
+TEST_ADD(TestShardLoadTrackerSplitKey);
+TEST_ADD(TestShardMessageBinaryRoundtrip);
+TEST_ADD(TestShardMessageEncodingTiming);
+TEST_ADD(TestShardMessageTransactionReadVersions);
+TEST_ADD(TestShardSchedulerWeights);
+TEST_ADD(TestShardSchedulerLatencyTarget);
 TEST_ADD(TestStorageAsyncList);
+TEST_ADD(TestStorageFileDeleter);
+TEST_ADD(TestStorageLogArchiver);
 TEST_ADD(TestStorageSet);
+TEST_ADD(TestStorageValueLog);
+TEST_ADD(TestStorageValueLogRecovery);
+TEST_ADD(TestStorageChunkReaderAcquireFD);
 TEST_ADD(TestTimeMultithreadedNow);
 TEST_ADD(TestTimingBasicWrite);
 TEST_ADD(TestTimingSnprintf);